@@ -0,0 +1,24 @@
+//go:build treesitter
+
+package main
+
+// Builds tagged treesitter link the tree-sitter grammar (cgo) and register
+// its Parsley highlighter, so markdown code blocks, the dev error page and
+// the devtools log page are highlighted on the server, and its extractor, so
+// search indexes .pars and .part files by syntax. The packages live in
+// a module of their own, so build through its workspace:
+//
+//	make build-basil-treesitter
+//
+// go mod tidy does not read the workspace and reports these imports as
+// missing; run it as go mod tidy -e.
+
+import (
+	"github.com/sambeau/tree-sitter-parsley/basil/highlight"
+	"github.com/sambeau/tree-sitter-parsley/basil/searchtext"
+)
+
+func init() {
+	highlight.Register()
+	searchtext.Register()
+}
@@ -0,0 +1,70 @@
+// Command parsley-ls is the Parsley language server. Editors start it and
+// speak the Language Server Protocol to it over stdin and stdout.
+package main
+
+import (
+	"flag"
+	"fmt"
+	"io"
+	"os"
+
+	"github.com/sambeau/tree-sitter-parsley/basil/lower"
+	"github.com/sambeau/tree-sitter-parsley/bindings/go/lsp"
+)
+
+// Version is set at build time via -ldflags "-X main.Version=..."
+var Version = "dev"
+
+func main() {
+	if err := run(os.Args[1:], os.Stdin, os.Stdout, os.Stderr); err != nil {
+		fmt.Fprintf(os.Stderr, "parsley-ls: %v\n", err)
+		os.Exit(1)
+	}
+}
+
+func run(args []string, stdin io.Reader, stdout, stderr io.Writer) error {
+	flags := flag.NewFlagSet("parsley-ls", flag.ContinueOnError)
+	flags.SetOutput(stderr)
+	version := flags.Bool("version", false, "Print the version and exit")
+	// Editors commonly pass --stdio; it is the only transport, so accept it
+	flags.Bool("stdio", true, "Serve over stdin and stdout (the default)")
+	if err := flags.Parse(args); err != nil {
+		return err
+	}
+	if *version {
+		fmt.Fprintf(stdout, "parsley-ls %s\n", Version)
+		return nil
+	}
+
+	modules := lower.NewModules()
+	defer modules.Close()
+	server := lsp.NewServer()
+	defer server.Close()
+	server.SetFormatter(formatter{modules})
+	return server.Serve(stdin, stdout)
+}
+
+// formatter formats through pars fmt for the server
+type formatter struct {
+	modules *lower.Modules
+}
+
+func (f formatter) FormatRange(uri string, source []byte, spans []lsp.Span) ([]lsp.Replacement, []string) {
+	lowered := make([]lower.Span, len(spans))
+	for i, s := range spans {
+		lowered[i] = lower.Span{Start: s.Start, End: s.End}
+	}
+	replacements, errs := f.modules.FormatRange(uri, source, lowered...)
+	if len(errs) > 0 {
+		return nil, errs
+	}
+	result := make([]lsp.Replacement, len(replacements))
+	for i, r := range replacements {
+		result[i] = lsp.Replacement{Span: lsp.Span{Start: r.Start, End: r.End}, Text: r.Text}
+	}
+	return result, nil
+}
+
+func (f formatter) Remove(uri string) {
+	f.modules.Remove(uri)
+}
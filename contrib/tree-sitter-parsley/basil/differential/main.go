@@ -0,0 +1,480 @@
+// Command differential parses every Parsley source under the given paths
+// with both pkg/parsley/parser and the tree-sitter grammar and reports, per
+// file, how long each parser takes, what parser.go allocates, and where the
+// two disagree about the file's structure.
+//
+// Usage:
+//
+//	go run ./differential [-n iterations] [-json] [-baseline file [-update]] path...
+//
+//	make -C bench run-diff
+//
+// The structural check is deliberately coarse so that it only fires on real
+// grammar drift:
+//   - both parsers must accept the file, or both reject it
+//   - they must find the same top-level statements, of the same kind,
+//     starting on the same lines
+//   - they must agree on how many functions, calls, tags, ifs, fors, trys,
+//     imports and schemas the file contains (template and query
+//     interpolations are skipped; parser.go leaves those to the evaluator)
+//
+// With -baseline, disagreements listed in the file are expected and any
+// other one fails the run. -update rewrites the file with the current
+// disagreements, but only ever removes entries, so a change that makes the
+// parsers drift apart cannot be recorded as the new normal.
+package main
+
+import (
+	"bufio"
+	"encoding/json"
+	"flag"
+	"fmt"
+	"io/fs"
+	"os"
+	"path/filepath"
+	"reflect"
+	"runtime"
+	"slices"
+	"sort"
+	"strings"
+	"time"
+
+	"github.com/sambeau/basil/pkg/parsley/ast"
+	"github.com/sambeau/basil/pkg/parsley/lexer"
+	"github.com/sambeau/basil/pkg/parsley/parser"
+	tree_sitter_parsley "github.com/sambeau/tree-sitter-parsley/bindings/go"
+	tree_sitter "github.com/tree-sitter/go-tree-sitter"
+)
+
+// Result is one file's report. Field order is the JSON key order.
+type Result struct {
+	File          string   `json:"file"`
+	Bytes         int      `json:"bytes"`
+	TreeSitterUs  float64  `json:"tree_sitter_us"`
+	GoUs          float64  `json:"go_us"`
+	GoAllocs      uint64   `json:"go_allocs"`
+	GoAllocBytes  uint64   `json:"go_alloc_bytes"`
+	Disagreements []string `json:"disagreements"`
+}
+
+// Node kinds that lower to exactly one kind of AST node (or, for tags, one
+// of two), counted across the whole file
+var counted = []struct {
+	kind  string
+	nodes []string
+}{
+	{"function_expression", []string{"FunctionLiteral"}},
+	{"call_expression", []string{"CallExpression"}},
+	{"tag_expression", []string{"TagLiteral", "TagPairExpression"}},
+	{"if_expression", []string{"IfExpression"}},
+	{"for_expression", []string{"ForExpression"}},
+	{"try_expression", []string{"TryExpression"}},
+	{"import_expression", []string{"ImportExpression"}},
+	{"schema_declaration", []string{"SchemaDeclaration"}},
+}
+
+// Subtrees tree-sitter parses but parser.go keeps as text
+var opaque = map[string]bool{
+	"interpolation":          true,
+	"raw_interpolation":      true,
+	"raw_text_interpolation": true,
+	"query_body":             true,
+}
+
+// Top-level statement kinds, in the coarse categories both parsers share
+var statementKinds = map[string]string{
+	"let_statement":                 "let",
+	"assignment_statement":          "assign",
+	"dict_destructuring_assignment": "destructure",
+	"export_statement":              "export",
+	"return_statement":              "return",
+	"check_statement":               "check",
+	"expression_statement":          "expression",
+}
+
+func main() {
+	iterations := flag.Int("n", 10, "parses per file; the best time is reported")
+	asJSON := flag.Bool("json", false, "print one JSON object per file")
+	baseline := flag.String("baseline", "", "file of expected disagreements")
+	update := flag.Bool("update", false, "rewrite -baseline with the current disagreements")
+	flag.Usage = func() {
+		fmt.Fprintln(os.Stderr, "usage: differential [-n iterations] [-json] [-baseline file [-update]] path...")
+		flag.PrintDefaults()
+	}
+	flag.Parse()
+	files := collectSources(flag.Args())
+	if len(files) == 0 || *iterations < 1 || (*update && *baseline == "") {
+		flag.Usage()
+		os.Exit(2)
+	}
+
+	tsParser := tree_sitter.NewParser()
+	defer tsParser.Close()
+	if err := tsParser.SetLanguage(tree_sitter.NewLanguage(tree_sitter_parsley.Language())); err != nil {
+		fmt.Fprintln(os.Stderr, "error:", err)
+		os.Exit(1)
+	}
+
+	if !*asJSON {
+		fmt.Printf("%-60s %9s %10s %10s %7s %10s %10s %5s\n",
+			"file", "bytes", "ts_us", "go_us", "go/ts", "go_allocs", "go_B", "diffs")
+	}
+	var found []string
+	total := Result{File: "total"}
+	for _, file := range files {
+		source, err := os.ReadFile(file)
+		if err != nil {
+			fmt.Fprintln(os.Stderr, "warning:", err)
+			continue
+		}
+		r := compare(tsParser, file, source, *iterations)
+		for _, d := range r.Disagreements {
+			found = append(found, file+": "+d)
+		}
+
+		total.Bytes += r.Bytes
+		total.TreeSitterUs += r.TreeSitterUs
+		total.GoUs += r.GoUs
+		total.GoAllocs += r.GoAllocs
+		total.GoAllocBytes += r.GoAllocBytes
+		total.Disagreements = append(total.Disagreements, r.Disagreements...)
+		report(r, *asJSON)
+	}
+	report(total, *asJSON)
+
+	if !*asJSON {
+		for _, d := range found {
+			fmt.Println("disagreement:", d)
+		}
+	}
+	if *baseline != "" {
+		os.Exit(checkBaseline(*baseline, found, *update))
+	}
+}
+
+func report(r Result, asJSON bool) {
+	if asJSON {
+		if r.Disagreements == nil {
+			r.Disagreements = []string{}
+		}
+		line, _ := json.Marshal(r)
+		fmt.Println(string(line))
+		return
+	}
+	ratio := 0.0
+	if r.TreeSitterUs > 0 {
+		ratio = r.GoUs / r.TreeSitterUs
+	}
+	fmt.Printf("%-60s %9d %10.1f %10.1f %7.2f %10d %10d %5d\n",
+		r.File, r.Bytes, r.TreeSitterUs, r.GoUs, ratio,
+		r.GoAllocs, r.GoAllocBytes, len(r.Disagreements))
+}
+
+func compare(tsParser *tree_sitter.Parser, file string, source []byte, iterations int) Result {
+	r := Result{File: file, Bytes: len(source)}
+	text := string(source)
+
+	var tree *tree_sitter.Tree
+	best := time.Duration(-1)
+	for i := 0; i < iterations; i++ {
+		start := time.Now()
+		t := tsParser.Parse(source, nil)
+		elapsed := time.Since(start)
+		if best < 0 || elapsed < best {
+			best = elapsed
+		}
+		if tree == nil {
+			tree = t
+		} else {
+			t.Close()
+		}
+	}
+	defer tree.Close()
+	r.TreeSitterUs = float64(best.Nanoseconds()) / 1e3
+
+	var program *ast.Program
+	var errs []string
+	var before, after runtime.MemStats
+	best = -1
+	runtime.ReadMemStats(&before)
+	for i := 0; i < iterations; i++ {
+		start := time.Now()
+		p := parser.New(lexer.NewWithFilename(text, file))
+		program = p.ParseProgram()
+		elapsed := time.Since(start)
+		if best < 0 || elapsed < best {
+			best = elapsed
+		}
+		errs = p.Errors()
+	}
+	runtime.ReadMemStats(&after)
+	r.GoUs = float64(best.Nanoseconds()) / 1e3
+	r.GoAllocs = (after.Mallocs - before.Mallocs) / uint64(iterations)
+	r.GoAllocBytes = (after.TotalAlloc - before.TotalAlloc) / uint64(iterations)
+
+	r.Disagreements = disagreements(tree.RootNode(), source, program, errs)
+	return r
+}
+
+func disagreements(root *tree_sitter.Node, source []byte, program *ast.Program, errs []string) []string {
+	var out []string
+
+	if root.HasError() != (len(errs) > 0) {
+		if len(errs) > 0 {
+			return []string{"parser.go rejects, tree-sitter accepts: " + errs[0]}
+		}
+		where := firstError(root)
+		return []string{fmt.Sprintf("tree-sitter rejects at %d:%d, parser.go accepts",
+			where.Row+1, where.Column+1)}
+	}
+	if len(errs) > 0 {
+		// Both reject; their recovery is not comparable
+		return nil
+	}
+
+	var statements []*tree_sitter.Node
+	for i := uint(0); i < root.NamedChildCount(); i++ {
+		if child := root.NamedChild(i); !child.IsExtra() {
+			statements = append(statements, child)
+		}
+	}
+	if len(statements) != len(program.Statements) {
+		out = append(out, fmt.Sprintf("top-level statements: tree-sitter %d, parser.go %d",
+			len(statements), len(program.Statements)))
+	} else {
+		for i, node := range statements {
+			stmt := program.Statements[i]
+			first := int(node.StartPosition().Row) + 1
+			last := int(node.EndPosition().Row) + 1
+			kind, line := statementKind(stmt)
+			if want := statementKinds[node.Kind()]; want != kind {
+				out = append(out, fmt.Sprintf("statement %d (line %d): tree-sitter %s, parser.go %s",
+					i+1, first, want, kind))
+			} else if line != 0 && (line < first || line > last) {
+				out = append(out, fmt.Sprintf("statement %d: tree-sitter lines %d-%d, parser.go line %d",
+					i+1, first, last, line))
+			}
+		}
+	}
+
+	kinds := map[string]int{}
+	countKinds(root, kinds)
+	nodes := map[string]int{}
+	countNodes(reflect.ValueOf(program), nodes)
+	for _, c := range counted {
+		n := 0
+		for _, name := range c.nodes {
+			n += nodes[name]
+		}
+		if kinds[c.kind] != n {
+			out = append(out, fmt.Sprintf("%s: tree-sitter %d, parser.go %s %d",
+				c.kind, kinds[c.kind], strings.Join(c.nodes, "+"), n))
+		}
+	}
+	return out
+}
+
+// statementKind returns a statement's category and the line of the token that
+// the parser records for it (0 if it has none).
+func statementKind(stmt ast.Statement) (string, int) {
+	switch s := stmt.(type) {
+	case *ast.LetStatement:
+		if s.Export {
+			return "export", s.Token.Line
+		}
+		return "let", s.Token.Line
+	case *ast.AssignmentStatement:
+		switch {
+		case s.Export:
+			return "export", s.Token.Line
+		case s.DictPattern != nil:
+			return "destructure", s.Token.Line
+		}
+		return "assign", s.Token.Line
+	case *ast.IndexAssignmentStatement:
+		return "assign", s.Token.Line
+	case *ast.ReadStatement:
+		return letOrAssign(s.IsLet), s.Token.Line
+	case *ast.FetchStatement:
+		return letOrAssign(s.IsLet), s.Token.Line
+	case *ast.QueryOneStatement:
+		return dbStatementKind(s.Export, s.IsLet, len(s.Names)), s.Token.Line
+	case *ast.QueryManyStatement:
+		return dbStatementKind(s.Export, s.IsLet, len(s.Names)), s.Token.Line
+	case *ast.ExecuteStatement:
+		return dbStatementKind(s.Export, s.IsLet, len(s.Names)), s.Token.Line
+	case *ast.ExportNameStatement:
+		return "export", s.Token.Line
+	case *ast.ComputedExportStatement:
+		return "export", s.Token.Line
+	case *ast.ReturnStatement:
+		return "return", s.Token.Line
+	case *ast.CheckStatement:
+		return "check", s.Token.Line
+	case *ast.ExpressionStatement:
+		return "expression", s.Token.Line
+	case *ast.WriteStatement:
+		return "expression", s.Token.Line
+	case *ast.RemoteWriteStatement:
+		return "expression", s.Token.Line
+	case *ast.StopStatement:
+		return "expression", s.Token.Line
+	case *ast.SkipStatement:
+		return "expression", s.Token.Line
+	}
+	return fmt.Sprintf("%T", stmt), 0
+}
+
+func letOrAssign(isLet bool) string {
+	if isLet {
+		return "let"
+	}
+	return "assign"
+}
+
+func dbStatementKind(export, isLet bool, names int) string {
+	switch {
+	case export:
+		return "export"
+	case names == 0:
+		return "expression"
+	}
+	return letOrAssign(isLet)
+}
+
+// countKinds counts node kinds, skipping subtrees parser.go keeps as text.
+func countKinds(node *tree_sitter.Node, kinds map[string]int) {
+	if opaque[node.Kind()] {
+		return
+	}
+	kinds[node.Kind()]++
+	for i := uint(0); i < node.NamedChildCount(); i++ {
+		countKinds(node.NamedChild(i), kinds)
+	}
+}
+
+// countNodes counts AST nodes by type name.
+func countNodes(v reflect.Value, nodes map[string]int) {
+	switch v.Kind() {
+	case reflect.Pointer, reflect.Interface:
+		if !v.IsNil() {
+			countNodes(v.Elem(), nodes)
+		}
+	case reflect.Struct:
+		if v.Type().PkgPath() == "github.com/sambeau/basil/pkg/parsley/ast" {
+			nodes[v.Type().Name()]++
+		}
+		for i := 0; i < v.NumField(); i++ {
+			if v.Type().Field(i).IsExported() {
+				countNodes(v.Field(i), nodes)
+			}
+		}
+	case reflect.Slice:
+		for i := 0; i < v.Len(); i++ {
+			countNodes(v.Index(i), nodes)
+		}
+	case reflect.Map:
+		iter := v.MapRange()
+		for iter.Next() {
+			countNodes(iter.Value(), nodes)
+		}
+	}
+}
+
+// firstError returns where the first ERROR or MISSING node starts.
+func firstError(node *tree_sitter.Node) tree_sitter.Point {
+	if node.IsError() || node.IsMissing() {
+		return node.StartPosition()
+	}
+	for i := uint(0); i < node.ChildCount(); i++ {
+		if child := node.Child(i); child.HasError() {
+			return firstError(child)
+		}
+	}
+	return node.StartPosition()
+}
+
+// collectSources returns the .pars and .part files under paths, sorted.
+func collectSources(paths []string) []string {
+	var files []string
+	for _, root := range paths {
+		err := filepath.WalkDir(root, func(path string, entry fs.DirEntry, err error) error {
+			if err != nil {
+				return err
+			}
+			if !entry.IsDir() && (strings.HasSuffix(path, ".pars") || strings.HasSuffix(path, ".part")) {
+				files = append(files, path)
+			}
+			return nil
+		})
+		if err != nil {
+			fmt.Fprintln(os.Stderr, "warning:", err)
+		}
+	}
+	sort.Strings(files)
+	return files
+}
+
+// checkBaseline compares found with the disagreements recorded in path and
+// returns the exit status.
+func checkBaseline(path string, found []string, update bool) int {
+	known, err := readLines(path)
+	if err != nil && !os.IsNotExist(err) {
+		fmt.Fprintln(os.Stderr, "error:", err)
+		return 1
+	}
+	missing := os.IsNotExist(err)
+
+	var added []string
+	for _, d := range found {
+		if !missing && !slices.Contains(known, d) {
+			added = append(added, d)
+		}
+	}
+
+	switch {
+	case update && len(added) > 0:
+		fmt.Fprintf(os.Stderr, "refusing to add %d new disagreements to %s:\n", len(added), path)
+		for _, d := range added {
+			fmt.Fprintln(os.Stderr, "  "+d)
+		}
+		return 1
+	case update:
+		body := strings.Join(found, "\n")
+		if body != "" {
+			body += "\n"
+		}
+		if err := os.WriteFile(path, []byte(body), 0o644); err != nil {
+			fmt.Fprintln(os.Stderr, "error:", err)
+			return 1
+		}
+		fmt.Fprintf(os.Stderr, "recorded %d disagreements in %s\n", len(found), path)
+		return 0
+	case missing:
+		fmt.Fprintf(os.Stderr, "no baseline at %s; record one with -update\n", path)
+		return 0
+	case len(added) > 0:
+		fmt.Fprintf(os.Stderr, "%d disagreements not in %s:\n", len(added), path)
+		for _, d := range added {
+			fmt.Fprintln(os.Stderr, "  "+d)
+		}
+		return 1
+	}
+	return 0
+}
+
+func readLines(path string) ([]string, error) {
+	f, err := os.Open(path)
+	if err != nil {
+		return nil, err
+	}
+	defer f.Close()
+	var lines []string
+	scanner := bufio.NewScanner(f)
+	for scanner.Scan() {
+		if line := strings.TrimSpace(scanner.Text()); line != "" {
+			lines = append(lines, line)
+		}
+	}
+	return lines, scanner.Err()
+}
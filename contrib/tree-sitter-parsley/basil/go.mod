@@ -0,0 +1,16 @@
+module github.com/sambeau/tree-sitter-parsley/basil
+
+go 1.24.1
+
+require (
+	github.com/sambeau/basil v0.0.0
+	github.com/sambeau/tree-sitter-parsley v0.0.0
+	github.com/tree-sitter/go-tree-sitter v0.25.0
+)
+
+// The packages here build on Basil's own packages, so they are kept out of
+// the grammar's module and built from this checkout.
+replace (
+	github.com/sambeau/basil => ../../..
+	github.com/sambeau/tree-sitter-parsley => ../
+)
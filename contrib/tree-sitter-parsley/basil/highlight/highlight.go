@@ -0,0 +1,268 @@
+// Package highlight renders Parsley source as HTML using the grammar and
+// queries/highlights.scm, for Basil's server-side highlighting of markdown
+// code blocks and dev error pages (see pkg/parsley/highlight).
+//
+// Spans use highlight.js class names (hljs-keyword, hljs-string, ...), so
+// pages styled for the client-side grammar in contrib/highlightjs look the
+// same when the highlighting is done on the server instead.
+package highlight
+
+import (
+	"html"
+	"sort"
+	"strings"
+	"sync"
+
+	basilhighlight "github.com/sambeau/basil/pkg/parsley/highlight"
+	tree_sitter_parsley "github.com/sambeau/tree-sitter-parsley/bindings/go"
+	"github.com/sambeau/tree-sitter-parsley/queries"
+	tree_sitter "github.com/tree-sitter/go-tree-sitter"
+)
+
+// classes maps highlights.scm capture names to highlight.js classes. A
+// capture without an entry falls back to its parent name ("function.call"
+// to "function"); an empty class claims the node but adds no markup, which
+// keeps plain identifiers unstyled as highlight.js leaves them.
+var classes = map[string]string{
+	"keyword":             "hljs-keyword",
+	"string":              "hljs-string",
+	"string.escape":       "hljs-char escape_",
+	"string.regexp":       "hljs-regexp",
+	"string.special":      "hljs-symbol",
+	"string.special.url":  "hljs-link",
+	"number":              "hljs-number",
+	"constant.builtin":    "hljs-literal",
+	"comment":             "hljs-comment",
+	"function":            "hljs-title function_",
+	"function.builtin":    "hljs-built_in",
+	"variable":            "",
+	"variable.builtin":    "hljs-variable language_",
+	"variable.parameter":  "hljs-params",
+	"property":            "hljs-property",
+	"attribute":           "hljs-attr",
+	"tag":                 "hljs-name",
+	"type":                "hljs-type",
+	"module":              "hljs-title class_",
+	"operator":            "hljs-operator",
+	"punctuation":         "hljs-punctuation",
+	"punctuation.special": "hljs-subst",
+}
+
+func classFor(capture string) string {
+	for {
+		if class, ok := classes[capture]; ok {
+			return class
+		}
+		dot := strings.LastIndexByte(capture, '.')
+		if dot < 0 {
+			return ""
+		}
+		capture = capture[:dot]
+	}
+}
+
+// Highlighter turns Parsley source into HTML. The highlights query is
+// compiled once per Highlighter; parsers and query cursors are not safe for
+// concurrent use, so each call borrows an idle parser or makes a new one.
+// Highlighter is safe for concurrent use.
+type Highlighter struct {
+	language *tree_sitter.Language
+	query    *tree_sitter.Query
+	classes  []string // per capture index
+
+	mu   sync.Mutex
+	idle []*tree_sitter.Parser
+}
+
+// New compiles queries/highlights.scm and returns a Highlighter for it.
+func New() *Highlighter {
+	language := tree_sitter.NewLanguage(tree_sitter_parsley.Language())
+	query, err := tree_sitter.NewQuery(language, queries.Highlights)
+	if err != nil {
+		// The bundled query is compiled by this package's tests, so this
+		// only happens if highlights.scm and the grammar disagree
+		panic(err.Error())
+	}
+	names := query.CaptureNames()
+	h := &Highlighter{language: language, query: query, classes: make([]string, len(names))}
+	for i, name := range names {
+		h.classes[i] = classFor(name)
+	}
+	return h
+}
+
+var (
+	sharedOnce sync.Once
+	shared     *Highlighter
+)
+
+// HTML highlights source with a Highlighter shared by the whole process.
+func HTML(source string) string {
+	sharedOnce.Do(func() { shared = New() })
+	return shared.HTML(source)
+}
+
+// Register installs HTML as Basil's Parsley highlighter, turning on
+// server-side highlighting for markdown code blocks and dev error pages.
+func Register() {
+	basilhighlight.Register(HTML)
+}
+
+// A span is one capture: the bytes it covers and its class. Captures are
+// sorted so that outer spans come before the spans nested in them, and for
+// the same node the earliest pattern in highlights.scm comes first and wins,
+// as it does in tree-sitter's own highlighter.
+type span struct {
+	start, end uint
+	pattern    uint
+	class      string
+}
+
+// HTML returns source, HTML-escaped, with every highlighted node wrapped in
+// a <span class="...">. Spans are closed at the end of each line and reopened
+// on the next, so the result can be split on newlines.
+func (h *Highlighter) HTML(source string) string {
+	text := []byte(source)
+	parser := h.parser()
+	tree := parser.Parse(text, nil)
+	h.release(parser)
+	if tree == nil {
+		return html.EscapeString(source)
+	}
+	defer tree.Close()
+
+	cursor := tree_sitter.NewQueryCursor()
+	defer cursor.Close()
+
+	var spans []span
+	captures := cursor.Captures(h.query, tree.RootNode(), text)
+	for match, index := captures.Next(); match != nil; match, index = captures.Next() {
+		capture := match.Captures[index]
+		node := capture.Node
+		if node.StartByte() == node.EndByte() {
+			continue
+		}
+		spans = append(spans, span{
+			start:   node.StartByte(),
+			end:     node.EndByte(),
+			pattern: match.PatternIndex,
+			class:   h.classes[capture.Index],
+		})
+	}
+	sort.SliceStable(spans, func(i, j int) bool {
+		a, b := spans[i], spans[j]
+		if a.start != b.start {
+			return a.start < b.start
+		}
+		if a.end != b.end {
+			return a.end > b.end
+		}
+		return a.pattern < b.pattern
+	})
+
+	w := writer{source: source}
+	for _, s := range spans {
+		w.closeBefore(s.start)
+		if top := w.top(); top != nil {
+			// The same node again (a later, losing pattern), or a span that
+			// would cross the end of the one it starts in
+			if s.end > top.end || (s.start == top.start && s.end == top.end) {
+				continue
+			}
+		}
+		w.open(s)
+	}
+	w.closeBefore(uint(len(source)))
+	w.text(uint(len(source)))
+	return w.out.String()
+}
+
+func (h *Highlighter) parser() *tree_sitter.Parser {
+	h.mu.Lock()
+	if n := len(h.idle); n > 0 {
+		parser := h.idle[n-1]
+		h.idle = h.idle[:n-1]
+		h.mu.Unlock()
+		return parser
+	}
+	h.mu.Unlock()
+
+	parser := tree_sitter.NewParser()
+	if err := parser.SetLanguage(h.language); err != nil {
+		panic(err)
+	}
+	return parser
+}
+
+func (h *Highlighter) release(parser *tree_sitter.Parser) {
+	h.mu.Lock()
+	h.idle = append(h.idle, parser)
+	h.mu.Unlock()
+}
+
+// writer emits escaped source and the open spans around it.
+type writer struct {
+	source string
+	pos    uint   // bytes of source written so far
+	stack  []span // open spans, outermost first
+	out    strings.Builder
+}
+
+func (w *writer) top() *span {
+	if len(w.stack) == 0 {
+		return nil
+	}
+	return &w.stack[len(w.stack)-1]
+}
+
+// closeBefore closes every open span that ends at or before offset.
+func (w *writer) closeBefore(offset uint) {
+	for len(w.stack) > 0 && w.top().end <= offset {
+		w.text(w.top().end)
+		w.closeTag(*w.top())
+		w.stack = w.stack[:len(w.stack)-1]
+	}
+}
+
+func (w *writer) open(s span) {
+	w.text(s.start)
+	w.openTag(s)
+	w.stack = append(w.stack, s)
+}
+
+// text writes source up to offset, closing the open spans before each
+// newline and reopening them after it.
+func (w *writer) text(offset uint) {
+	for w.pos < offset {
+		chunk := w.source[w.pos:offset]
+		newline := strings.IndexByte(chunk, '\n')
+		if newline < 0 {
+			w.out.WriteString(html.EscapeString(chunk))
+			w.pos = offset
+			return
+		}
+		w.out.WriteString(html.EscapeString(chunk[:newline]))
+		for i := len(w.stack) - 1; i >= 0; i-- {
+			w.closeTag(w.stack[i])
+		}
+		w.out.WriteByte('\n')
+		for _, s := range w.stack {
+			w.openTag(s)
+		}
+		w.pos += uint(newline) + 1
+	}
+}
+
+func (w *writer) openTag(s span) {
+	if s.class != "" {
+		w.out.WriteString(`<span class="`)
+		w.out.WriteString(s.class)
+		w.out.WriteString(`">`)
+	}
+}
+
+func (w *writer) closeTag(s span) {
+	if s.class != "" {
+		w.out.WriteString("</span>")
+	}
+}
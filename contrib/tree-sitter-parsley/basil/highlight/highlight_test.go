@@ -0,0 +1,71 @@
+package highlight_test
+
+import (
+	"html"
+	"regexp"
+	"strings"
+	"testing"
+
+	"github.com/sambeau/tree-sitter-parsley/basil/highlight"
+)
+
+var tags = regexp.MustCompile(`<span class="[^"]*">|</span>`)
+
+func TestHighlightsKeywordsAndStrings(t *testing.T) {
+	out := highlight.HTML(`let greeting = "hi <there>"`)
+
+	for _, want := range []string{
+		`<span class="hljs-keyword">let</span>`,
+		`<span class="hljs-string">&#34;hi &lt;there&gt;&#34;</span>`,
+		`<span class="hljs-operator">=</span>`,
+	} {
+		if !strings.Contains(out, want) {
+			t.Errorf("expected %q in %q", want, out)
+		}
+	}
+}
+
+func TestFirstPatternWins(t *testing.T) {
+	// identifier is caught by the final @variable pattern too, but the
+	// earlier @function.call match must decide its class
+	out := highlight.HTML(`print(x)`)
+	if !strings.Contains(out, `<span class="hljs-title function_">print</span>`) {
+		t.Errorf("expected print to be highlighted as a call, got %q", out)
+	}
+	if strings.Contains(out, `x</span>`) {
+		t.Errorf("expected plain identifiers to stay unstyled, got %q", out)
+	}
+}
+
+func TestOutputIsEscapedSource(t *testing.T) {
+	sources := []string{
+		"let x = 1\n\n// comment <b>\nlet s = \"a\nb\"\n",
+		"<div class=\"a\">\n  {x & y}\n</div>",
+		"fn(a, b) {\n  a ++ b\n}",
+		"let broken = (",
+	}
+	for _, source := range sources {
+		out := highlight.HTML(source)
+		if got := html.UnescapeString(tags.ReplaceAllString(out, "")); got != source {
+			t.Errorf("text differs from source:\n got %q\nwant %q", got, source)
+		}
+	}
+}
+
+func TestSpansCloseAtLineEnds(t *testing.T) {
+	out := highlight.HTML("let s = \"one\ntwo\"\nlet t = `a\n{s}\nb`")
+	for i, line := range strings.Split(out, "\n") {
+		open := strings.Count(line, "<span")
+		closed := strings.Count(line, "</span>")
+		if open != closed {
+			t.Errorf("line %d has %d open and %d closed spans: %q", i+1, open, closed, line)
+		}
+	}
+}
+
+func TestRepeatedCallsAreIdentical(t *testing.T) {
+	source := `export fn double(n) { n * 2 }`
+	if highlight.HTML(source) != highlight.HTML(source) {
+		t.Error("expected identical output for identical source")
+	}
+}
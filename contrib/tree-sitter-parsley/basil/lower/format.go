@@ -0,0 +1,152 @@
+package lower
+
+import (
+	"sort"
+	"strings"
+
+	"github.com/sambeau/basil/pkg/parsley/ast"
+	"github.com/sambeau/basil/pkg/parsley/format"
+)
+
+// A Span is the bytes source[Start:End].
+type Span struct {
+	Start, End int
+}
+
+// A Replacement replaces the bytes of its span with Text.
+type Replacement struct {
+	Span
+	Text string
+}
+
+// Format formats the statements of source that changed since the previous
+// Update or Format for path, which for format-on-save is the statements
+// typed into since the file was last formatted. The first call for a path
+// formats all of it.
+//
+// The replacements are in order and do not overlap. Applied to source they
+// give exactly what pars fmt gives for the whole file, provided the
+// statements that did not change were already formatted. A module with a
+// syntax error is not formatted: the parser's errors are returned instead.
+func (m *Modules) Format(path string, source []byte) ([]Replacement, []string) {
+	m.mu.Lock()
+	defer m.mu.Unlock()
+
+	program, errs, _, mod := m.update(path, source)
+	if len(errs) > 0 {
+		return nil, errs
+	}
+	var units []unit
+	for i, p := range mod.layout {
+		if p.lowered {
+			units = append(units, unit{i, i + 1})
+		}
+	}
+	return formatUnits(program, mod.layout, source, units), nil
+}
+
+// FormatRange formats the top-level statements that overlap or touch any of
+// spans, for an editor's format-selection or format-on-type, or to format
+// just the regions an editor knows were edited. A span that falls between
+// two statements formats just the comments and blank lines there.
+func (m *Modules) FormatRange(path string, source []byte, spans ...Span) ([]Replacement, []string) {
+	m.mu.Lock()
+	defer m.mu.Unlock()
+
+	program, errs, _, mod := m.update(path, source)
+	if len(errs) > 0 {
+		return nil, errs
+	}
+	layout := mod.layout
+	units := make([]unit, 0, len(spans))
+	for _, s := range spans {
+		first := sort.Search(len(layout), func(i int) bool { return layout[i].end >= s.Start })
+		last := sort.Search(len(layout), func(i int) bool { return layout[i].start > s.End })
+		units = append(units, unit{first, max(first, last)})
+	}
+	sort.Slice(units, func(i, j int) bool { return units[i].first < units[j].first })
+	return formatUnits(program, layout, source, units), nil
+}
+
+// A unit is the run of statements [first, last) together with the gaps on
+// either side of it, gap i being the source between statement i-1 and
+// statement i: the trailing comment, blank lines and leading comments that
+// format.FormatGap prints. A statement's gaps are formatted with it because
+// they depend on it (a function is followed by a blank line, and the lexer
+// attaches a trailing comment to the statement after it).
+//
+// Statements inside a block are never formatted alone, because how a block
+// is printed (inline or not) depends on everything in it; a top-level
+// statement is always printed at column 0, so FormatProgram is its gaps and
+// statements printed one at a time.
+type unit struct {
+	first, last int
+}
+
+// formatUnits formats units, which are ordered by first, merging the ones
+// that share a gap. Without a layout, after a syntax error or if tree-sitter
+// and parser.go split the module differently, it formats the whole file.
+func formatUnits(program *ast.Program, layout []placement, source []byte, units []unit) []Replacement {
+	if len(layout) == 0 {
+		return replace(nil, source, 0, len(source), terminate(format.FormatProgram(program)))
+	}
+
+	gapStart := func(i int) int {
+		if i == 0 {
+			return 0
+		}
+		return layout[i-1].end
+	}
+	gapEnd := func(i int) int {
+		if i == len(layout) {
+			return len(source)
+		}
+		return layout[i].start
+	}
+	// After the last statement pars fmt writes one newline, unless the
+	// statement already ends with one
+	gap := func(i int, prev string) string {
+		if i < len(layout) {
+			return format.FormatGap(program, i)
+		}
+		return terminate(prev)[len(prev):]
+	}
+
+	var replacements []Replacement
+	for j := 0; j < len(units); {
+		u := units[j]
+		for j++; j < len(units) && units[j].first <= u.last; j++ {
+			u.last = max(u.last, units[j].last)
+		}
+
+		var text strings.Builder
+		prev := ""
+		if u.first == u.last && u.last == len(layout) {
+			prev = format.FormatNode(program.Statements[u.last-1])
+		}
+		text.WriteString(gap(u.first, prev))
+		for i := u.first; i < u.last; i++ {
+			prev = format.FormatNode(program.Statements[i])
+			text.WriteString(prev)
+			text.WriteString(gap(i+1, prev))
+		}
+		replacements = replace(replacements, source, gapStart(u.first), gapEnd(u.last), text.String())
+	}
+	return replacements
+}
+
+// replace appends a replacement unless it would leave source as it is.
+func replace(replacements []Replacement, source []byte, start, end int, text string) []Replacement {
+	if string(source[start:end]) == text {
+		return replacements
+	}
+	return append(replacements, Replacement{Span: Span{Start: start, End: end}, Text: text})
+}
+
+// terminate ends formatted output with a newline, as pars fmt does.
+func terminate(formatted string) string {
+	if strings.HasSuffix(formatted, "\n") {
+		return formatted
+	}
+	return formatted + "\n"
+}
@@ -0,0 +1,169 @@
+package lower
+
+import (
+	"path/filepath"
+	"strings"
+	"testing"
+
+	"github.com/sambeau/basil/pkg/parsley/format"
+)
+
+// wholeFile formats source the way pars fmt does.
+func wholeFile(t *testing.T, source string) string {
+	t.Helper()
+	program, errs := parseWhole("whole.pars", []byte(source))
+	if len(errs) > 0 {
+		t.Fatalf("parser errors: %v", errs)
+	}
+	return terminate(format.FormatProgram(program))
+}
+
+func apply(t *testing.T, source string, replacements []Replacement) string {
+	t.Helper()
+	var out strings.Builder
+	last := 0
+	for _, r := range replacements {
+		if r.Start < last || r.End < r.Start {
+			t.Fatalf("replacements out of order: %+v", replacements)
+		}
+		out.WriteString(source[last:r.Start])
+		out.WriteString(r.Text)
+		last = r.End
+	}
+	out.WriteString(source[last:])
+	return out.String()
+}
+
+// Formatting every statement one at a time must reassemble exactly what a
+// whole-file format produces, for every corpus input parser.go accepts.
+func TestFormatCorpusMatchesWholeFile(t *testing.T) {
+	files, err := filepath.Glob("../../../test/corpus/*.txt")
+	if err != nil || len(files) == 0 {
+		t.Fatalf("no corpus files found: %v", err)
+	}
+
+	modules := NewModules()
+	defer modules.Close()
+
+	for _, file := range files {
+		for _, c := range readCorpus(t, file) {
+			t.Run(filepath.Base(file)+"/"+c.name, func(t *testing.T) {
+				if _, errs := parseWhole(c.name, []byte(c.source)); len(errs) > 0 {
+					t.Skipf("parser.go rejects this input: %s", errs[0])
+				}
+				want := wholeFile(t, c.source)
+
+				modules.Remove(c.name)
+				replacements, errs := modules.Format(c.name, []byte(c.source))
+				if len(errs) > 0 {
+					t.Fatalf("Format errors: %v", errs)
+				}
+				if got := apply(t, c.source, replacements); got != want {
+					t.Errorf("Format gives\n%q\nwant\n%q", got, want)
+				}
+
+				replacements, _ = modules.FormatRange(c.name, []byte(c.source), Span{0, len(c.source)})
+				if got := apply(t, c.source, replacements); got != want {
+					t.Errorf("FormatRange over the file gives\n%q\nwant\n%q", got, want)
+				}
+			})
+		}
+	}
+}
+
+func TestFormatOnlyTouchesChangedStatements(t *testing.T) {
+	modules := NewModules()
+	defer modules.Close()
+
+	formatted := wholeFile(t, "// Totals\nlet a = 1\n\nlet f = fn(x) { x * 2 }\nlet b = a+2 // two\nexport c = f(b)\n")
+	if replacements, errs := modules.Format("m.pars", []byte(formatted)); len(errs) > 0 || len(replacements) > 0 {
+		t.Fatalf("formatting formatted source = %+v %v, want no replacements", replacements, errs)
+	}
+
+	tests := []struct {
+		name, from, to string
+	}{
+		{"edit middle statement", "let b = a + 2", "let   b=a+20"},
+		{"edit first statement", "let a = 1", "let a=[1,2 ,3]"},
+		{"edit last statement", "export c = f(b)", "export c = f( b )"},
+		{"turn a statement into a function", "let b = a + 2", "let b = fn(y) {y}"},
+		{"add a blank line", "let a = 1\n", "let a = 1\n\n\n"},
+		{"add a statement", "let a = 1\n", "let a = 1\nlet   z = 0\n"},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			if !strings.Contains(formatted, tt.from) {
+				t.Fatalf("%q is not in the formatted source", tt.from)
+			}
+			// Start from the formatted file, as after the previous save
+			if _, errs := modules.Format("m.pars", []byte(formatted)); len(errs) > 0 {
+				t.Fatalf("Format errors: %v", errs)
+			}
+			edited := strings.Replace(formatted, tt.from, tt.to, 1)
+			replacements, errs := modules.Format("m.pars", []byte(edited))
+			if len(errs) > 0 {
+				t.Fatalf("Format errors: %v", errs)
+			}
+			if got, want := apply(t, edited, replacements), wholeFile(t, edited); got != want {
+				t.Errorf("Format gives\n%q\nwant\n%q", got, want)
+			}
+			if len(replacements) != 1 {
+				t.Fatalf("replacements = %+v, want one around the edit", replacements)
+			}
+			edit := strings.Index(edited, tt.to)
+			r := replacements[0]
+			if r.Start > edit+len(tt.to) || r.End < edit {
+				t.Errorf("replacement %+v misses the edit at [%d, %d)", r, edit, edit+len(tt.to))
+			}
+			if r.Start == 0 && r.End == len(edited) {
+				t.Errorf("replacement %+v is the whole file", r)
+			}
+		})
+	}
+}
+
+func TestFormatRange(t *testing.T) {
+	modules := NewModules()
+	defer modules.Close()
+
+	source := "let a=1\nlet b=2 // two\n\n\n// c\nlet c=3\n"
+	tests := []struct {
+		name   string
+		at     string
+		length int
+		want   string
+	}{
+		{"one statement", "let b", 1, "let a=1\nlet b = 2 // two\n\n// c\nlet c=3\n"},
+		{"between statements", "\n\n// c", 0, "let a=1\nlet b=2 // two\n\n// c\nlet c=3\n"},
+		{"two statements", "let a", len("let a=1\nlet b"), "let a = 1\nlet b = 2 // two\n\n// c\nlet c=3\n"},
+		{"last statement", "let c", 2, "let a=1\nlet b=2 // two\n\n// c\nlet c = 3\n"},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			start := strings.Index(source, tt.at)
+			replacements, errs := modules.FormatRange("r.pars", []byte(source), Span{start, start + tt.length})
+			if len(errs) > 0 {
+				t.Fatalf("FormatRange errors: %v", errs)
+			}
+			if got := apply(t, source, replacements); got != tt.want {
+				t.Errorf("FormatRange gives\n%q\nwant\n%q", got, tt.want)
+			}
+		})
+	}
+
+	// Spans out of order, one of them on statements the other covers
+	c, a := strings.Index(source, "let c"), strings.Index(source, "let a")
+	replacements, _ := modules.FormatRange("r.pars", []byte(source), Span{c, c}, Span{a, a + 1}, Span{a, a})
+	if got, want := apply(t, source, replacements), "let a = 1\nlet b=2 // two\n\n// c\nlet c = 3\n"; got != want {
+		t.Errorf("FormatRange of two spans gives\n%q\nwant\n%q", got, want)
+	}
+}
+
+func TestFormatReportsSyntaxErrors(t *testing.T) {
+	modules := NewModules()
+	defer modules.Close()
+
+	if replacements, errs := modules.Format("bad.pars", []byte("let a = (1 +\n")); len(errs) == 0 || replacements != nil {
+		t.Errorf("Format = %+v %v, want the parser's errors", replacements, errs)
+	}
+}
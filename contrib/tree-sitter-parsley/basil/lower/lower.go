@@ -0,0 +1,293 @@
+// Package lower builds pkg/parsley/ast programs from tree-sitter-parsley
+// trees, one top-level statement at a time, and keeps each statement's AST
+// until an edit touches it.
+//
+// The tree-sitter tree decides where each top-level statement starts and ends.
+// Each statement is then lowered by parser.go itself, with a lexer positioned
+// where the statement sits in the file, so the AST is exactly what a
+// whole-file parse would produce: same nodes, same token positions, same
+// comments and blank-line trivia. On the next save only the statements that
+// overlap tree-sitter's changed ranges are lowered again; the rest come out of
+// the cache, moved to their new line if the lines above them changed.
+package lower
+
+import (
+	"sync"
+	"unicode/utf8"
+
+	"github.com/sambeau/basil/pkg/parsley/ast"
+	"github.com/sambeau/basil/pkg/parsley/lexer"
+	"github.com/sambeau/basil/pkg/parsley/parser"
+	tree_sitter_parsley "github.com/sambeau/tree-sitter-parsley/bindings/go"
+	tree_sitter "github.com/tree-sitter/go-tree-sitter"
+)
+
+// Modules lowers Parsley modules and caches their statements by path.
+//
+// Programs returned by Update share statement nodes with earlier programs for
+// the same path, so callers must treat the AST as read-only, as the evaluator
+// already does. Modules is safe for concurrent use.
+type Modules struct {
+	mu      sync.Mutex
+	docs    *tree_sitter_parsley.Documents
+	modules map[string]*module
+}
+
+// Stats describes how an Update produced its program.
+type Stats struct {
+	Statements int  // top-level statements in the module
+	Lowered    int  // statements parsed by this update
+	Reused     int  // statements taken from the cache
+	Whole      bool // the module was parsed in one piece (it has a syntax error)
+}
+
+type module struct {
+	chunks map[chunkKey][]*chunk
+
+	// The top-level statements of the last Update, one per AST statement,
+	// for the formatter. nil if the module was parsed whole or a chunk did
+	// not lower to exactly one statement.
+	layout []placement
+}
+
+// A placement is where a statement's tree-sitter node sits in the source.
+type placement struct {
+	start, end int
+	lowered    bool // parsed by the Update rather than reused
+}
+
+// A chunk is the source of one top-level statement, from the end of the
+// previous statement, so that it carries its own leading comments and blank
+// lines, through the end of this one.
+type chunk struct {
+	line       int // line of the chunk's first character
+	statements []ast.Statement
+}
+
+// Lowering a chunk depends on its text, on where its first line starts and on
+// the token before it; it does not depend on which line it is on, as lines
+// are shifted when a cached chunk is reused.
+type chunkKey struct {
+	text   string
+	column int
+	after  lexer.TokenType
+}
+
+// NewModules creates an empty cache.
+func NewModules() *Modules {
+	return &Modules{
+		docs:    tree_sitter_parsley.NewDocuments(),
+		modules: make(map[string]*module),
+	}
+}
+
+// Update lowers the new source for path and returns its program along with
+// the parser's errors. Statements that tree-sitter reports as unchanged since
+// the previous Update are reused rather than parsed again.
+//
+// A module with a syntax error is parsed whole by parser.go, so its errors
+// and recovery are the ones the server would report without the cache.
+func (m *Modules) Update(path string, source []byte) (*ast.Program, []string, Stats) {
+	m.mu.Lock()
+	defer m.mu.Unlock()
+
+	program, errs, stats, _ := m.update(path, source)
+	return program, errs, stats
+}
+
+// update is Update with m.mu held. It also returns the module, whose layout
+// describes the program.
+func (m *Modules) update(path string, source []byte) (*ast.Program, []string, Stats, *module) {
+	tree, changed := m.docs.Update(path, source)
+	defer tree.Close()
+	mod, ok := m.modules[path]
+	if !ok {
+		mod = &module{chunks: make(map[chunkKey][]*chunk)}
+		m.modules[path] = mod
+	}
+
+	mod.layout = nil
+
+	root := tree.RootNode()
+	if root.HasError() {
+		program, errs := parseWhole(path, source)
+		return program, errs, Stats{Statements: len(program.Statements), Whole: true}, mod
+	}
+
+	program := &ast.Program{Statements: []ast.Statement{}}
+	chunks := make(map[chunkKey][]*chunk)
+	var stats Stats
+	var layout []placement
+	aligned := true
+
+	start := 0
+	after := lexer.ILLEGAL
+	var pos cursor
+	for i := uint(0); i < root.ChildCount(); i++ {
+		node := root.Child(i)
+		if node.IsExtra() {
+			continue
+		}
+		end, semicolon := statementEnd(source, int(node.EndByte()))
+		line, column := pos.advance(source, start)
+		key := chunkKey{text: string(source[start:end]), column: column, after: after}
+
+		c := reuse(mod.chunks, key, line, start, end, changed)
+		reused := c != nil
+		if reused {
+			stats.Reused++
+		} else {
+			var errs []string
+			c, errs = lowerChunk(path, key, line)
+			if len(errs) > 0 {
+				// tree-sitter and parser.go disagree about this statement;
+				// trust parser.go with the whole module
+				program, errs := parseWhole(path, source)
+				return program, errs, Stats{Statements: len(program.Statements), Whole: true}, mod
+			}
+			stats.Lowered++
+		}
+		chunks[key] = append(chunks[key], c)
+		program.Statements = append(program.Statements, c.statements...)
+		aligned = aligned && len(c.statements) == 1
+		layout = append(layout, placement{start: int(node.StartByte()), end: int(node.EndByte()), lowered: !reused})
+
+		start = end
+		if semicolon {
+			after = lexer.SEMICOLON
+		} else {
+			after = lastToken(node, source)
+		}
+	}
+
+	mod.chunks = chunks
+	if aligned {
+		mod.layout = layout
+	}
+	stats.Statements = len(program.Statements)
+	return program, nil, stats, mod
+}
+
+// Remove forgets path.
+func (m *Modules) Remove(path string) {
+	m.mu.Lock()
+	defer m.mu.Unlock()
+
+	m.docs.Remove(path)
+	delete(m.modules, path)
+}
+
+// Close frees every cached tree.
+func (m *Modules) Close() {
+	m.mu.Lock()
+	defer m.mu.Unlock()
+
+	m.docs.Close()
+	m.modules = make(map[string]*module)
+}
+
+// reuse takes a cached chunk for key out of cache, unless the chunk's span
+// overlaps a changed range. The chunk is moved to line if it used to start on
+// a different one.
+func reuse(cache map[chunkKey][]*chunk, key chunkKey, line, start, end int, changed []tree_sitter.Range) *chunk {
+	for _, r := range changed {
+		if int(r.StartByte) < end && int(r.EndByte) > start {
+			return nil
+		}
+	}
+	candidates := cache[key]
+	if len(candidates) == 0 {
+		return nil
+	}
+	c := candidates[0]
+	cache[key] = candidates[1:]
+	if c.line == line {
+		return c
+	}
+	statements := make([]ast.Statement, len(c.statements))
+	for i, stmt := range c.statements {
+		statements[i] = shiftLines(stmt, line-c.line)
+	}
+	return &chunk{line: line, statements: statements}
+}
+
+// lowerChunk parses one chunk with a lexer that starts where the chunk does.
+func lowerChunk(path string, key chunkKey, line int) (*chunk, []string) {
+	l := lexer.NewAt(key.text, path, line, key.column, key.after)
+	p := parser.New(l)
+	program := p.ParseProgram()
+	if errs := p.Errors(); len(errs) > 0 {
+		return nil, errs
+	}
+	return &chunk{line: line, statements: program.Statements}, nil
+}
+
+func parseWhole(path string, source []byte) (*ast.Program, []string) {
+	p := parser.New(lexer.NewWithFilename(string(source), path))
+	program := p.ParseProgram()
+	return program, p.Errors()
+}
+
+// statementEnd extends a statement ending at end over trivia and a following
+// semicolon, which parser.go consumes as part of the statement but
+// tree-sitter treats as an extra. It reports whether there was a semicolon.
+func statementEnd(source []byte, end int) (int, bool) {
+	i := end
+	for i < len(source) {
+		switch {
+		case source[i] == ' ' || source[i] == '\t' || source[i] == '\r' || source[i] == '\n':
+			i++
+		case source[i] == '/' && i+1 < len(source) && source[i+1] == '/':
+			for i < len(source) && source[i] != '\n' {
+				i++
+			}
+		case source[i] == ';':
+			return i + 1, true
+		default:
+			return end, false
+		}
+	}
+	return end, false
+}
+
+// cursor tracks lines while Update walks forward through the source.
+type cursor struct {
+	offset    int
+	line      int
+	lineStart int
+}
+
+// advance moves to offset and returns its line and the number of characters
+// before it on that line, counted the way the lexer counts columns.
+func (c *cursor) advance(source []byte, offset int) (line, column int) {
+	if c.line == 0 {
+		c.line = 1
+	}
+	for ; c.offset < offset; c.offset++ {
+		if source[c.offset] == '\n' {
+			c.line++
+			c.lineStart = c.offset + 1
+		}
+	}
+	return c.line, utf8.RuneCount(source[c.lineStart:offset])
+}
+
+// lastToken returns the lexer's type for the last token of a statement,
+// which decides whether a / that starts the next chunk begins a regex and
+// whether a comment after it is a trailing comment.
+func lastToken(node *tree_sitter.Node, source []byte) lexer.TokenType {
+	for node.ChildCount() > 0 {
+		last := node.Child(node.ChildCount() - 1)
+		for i := node.ChildCount() - 1; last.IsExtra() && i > 0; i-- {
+			last = node.Child(i - 1)
+		}
+		node = last
+	}
+	tok := lexer.New(node.Utf8Text(source)).NextToken()
+	if tok.Type == lexer.ILLEGAL || tok.Type == lexer.EOF {
+		// Part of a larger token, such as a string's closing quote; any
+		// token that ends an operand has the same effect
+		return lexer.RPAREN
+	}
+	return tok.Type
+}
@@ -0,0 +1,128 @@
+package lower
+
+import (
+	"os"
+	"path/filepath"
+	"reflect"
+	"regexp"
+	"strings"
+	"testing"
+)
+
+// The tree-sitter corpus doubles as a conformance suite: every input that
+// parser.go accepts must lower to exactly the AST of a whole-file parse.
+func TestCorpusConformance(t *testing.T) {
+	files, err := filepath.Glob("../../../test/corpus/*.txt")
+	if err != nil || len(files) == 0 {
+		t.Fatalf("no corpus files found: %v", err)
+	}
+
+	modules := NewModules()
+	defer modules.Close()
+
+	for _, file := range files {
+		for _, c := range readCorpus(t, file) {
+			t.Run(filepath.Base(file)+"/"+c.name, func(t *testing.T) {
+				want, errs := parseWhole(c.name, []byte(c.source))
+				if len(errs) > 0 {
+					t.Skipf("parser.go rejects this input: %s", errs[0])
+				}
+				got, errs, stats := modules.Update(c.name, []byte(c.source))
+				if len(errs) > 0 {
+					t.Fatalf("Update errors: %v", errs)
+				}
+				if stats.Whole {
+					t.Skip("tree-sitter reports a syntax error")
+				}
+				if !reflect.DeepEqual(got, want) {
+					t.Errorf("lowered program differs\n got: %s\nwant: %s", got.String(), want.String())
+				}
+			})
+		}
+	}
+}
+
+func TestUpdateReusesUntouchedStatements(t *testing.T) {
+	modules := NewModules()
+	defer modules.Close()
+
+	source := "// Totals\nlet a = 1\n\nlet b = a + 2 // two\nlet c = fn(x) { x * b }\n"
+	if _, errs, stats := modules.Update("m.pars", []byte(source)); len(errs) > 0 || stats.Lowered != 3 {
+		t.Fatalf("first Update = %+v %v, want 3 statements lowered", stats, errs)
+	}
+
+	tests := []struct {
+		name    string
+		source  string
+		lowered int
+		reused  int
+	}{
+		{"unchanged", source, 0, 3},
+		{"edit middle statement", strings.Replace(source, "a + 2", "a + 20", 1), 1, 2},
+		{"insert line above", "let z = 0\n" + strings.Replace(source, "a + 2", "a + 20", 1), 2, 2},
+		{"semicolon after the new statement", "let z = 0;\n" + strings.Replace(source, "a + 2", "a + 20", 1), 2, 2},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			got, errs, stats := modules.Update("m.pars", []byte(tt.source))
+			if len(errs) > 0 {
+				t.Fatalf("Update errors: %v", errs)
+			}
+			if stats.Lowered != tt.lowered || stats.Reused != tt.reused {
+				t.Errorf("stats = %+v, want %d lowered and %d reused", stats, tt.lowered, tt.reused)
+			}
+			want, _ := parseWhole("m.pars", []byte(tt.source))
+			if !reflect.DeepEqual(got, want) {
+				t.Errorf("program differs from a whole-file parse\n got: %s\nwant: %s", got.String(), want.String())
+			}
+		})
+	}
+}
+
+func TestUpdateFallsBackOnSyntaxError(t *testing.T) {
+	modules := NewModules()
+	defer modules.Close()
+
+	_, errs, stats := modules.Update("bad.pars", []byte("let a = (1 +\n"))
+	if !stats.Whole || len(errs) == 0 {
+		t.Errorf("Update = %+v %v, want a whole-file parse with errors", stats, errs)
+	}
+}
+
+type corpusCase struct {
+	name   string
+	source string
+}
+
+var (
+	corpusHeader    = regexp.MustCompile(`(?m)^={3,}\n(.+)\n={3,}\n`)
+	corpusSeparator = regexp.MustCompile(`(?m)^-{3,}\n`)
+)
+
+// readCorpus returns the inputs of a tree-sitter corpus file.
+func readCorpus(t *testing.T, path string) []corpusCase {
+	t.Helper()
+	data, err := os.ReadFile(path)
+	if err != nil {
+		t.Fatal(err)
+	}
+	text := string(data)
+
+	var cases []corpusCase
+	headers := corpusHeader.FindAllStringSubmatchIndex(text, -1)
+	for i, h := range headers {
+		end := len(text)
+		if i+1 < len(headers) {
+			end = headers[i+1][0]
+		}
+		body := text[h[1]:end]
+		if sep := corpusSeparator.FindStringIndex(body); sep != nil {
+			body = body[:sep[0]]
+		}
+		cases = append(cases, corpusCase{
+			name:   strings.TrimSpace(text[h[2]:h[3]]),
+			source: strings.Trim(body, "\n"),
+		})
+	}
+	return cases
+}
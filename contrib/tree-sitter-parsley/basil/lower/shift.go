@@ -0,0 +1,85 @@
+package lower
+
+import (
+	"reflect"
+
+	"github.com/sambeau/basil/pkg/parsley/ast"
+	"github.com/sambeau/basil/pkg/parsley/lexer"
+)
+
+var (
+	tokenType        = reflect.TypeOf(lexer.Token{})
+	tagAttributeType = reflect.TypeOf(ast.TagAttribute{})
+)
+
+// shiftLines returns a copy of stmt with every token moved down by delta
+// lines. The cached statement is left alone, since earlier programs may still
+// be evaluating it.
+func shiftLines(stmt ast.Statement, delta int) ast.Statement {
+	return shift(reflect.ValueOf(stmt), delta).Interface().(ast.Statement)
+}
+
+// shift deep-copies v, adjusting the Line of every lexer.Token it holds.
+// Tokens the parser synthesised, with no position, keep line 0, and tag
+// attribute expressions are left as they are: the parser lexes them on their
+// own, so their lines count from the attribute, not the file.
+func shift(v reflect.Value, delta int) reflect.Value {
+	switch v.Kind() {
+	case reflect.Pointer:
+		if v.IsNil() {
+			return v
+		}
+		out := reflect.New(v.Elem().Type())
+		out.Elem().Set(shift(v.Elem(), delta))
+		return out
+
+	case reflect.Interface:
+		if v.IsNil() {
+			return v
+		}
+		out := reflect.New(v.Type()).Elem()
+		out.Set(shift(v.Elem(), delta))
+		return out
+
+	case reflect.Struct:
+		out := reflect.New(v.Type()).Elem()
+		out.Set(v)
+		if v.Type() == tagAttributeType {
+			return out
+		}
+		if v.Type() == tokenType {
+			if line := out.FieldByName("Line"); line.Int() > 0 {
+				line.SetInt(line.Int() + int64(delta))
+			}
+			return out
+		}
+		for i := 0; i < v.NumField(); i++ {
+			if out.Field(i).CanSet() {
+				out.Field(i).Set(shift(v.Field(i), delta))
+			}
+		}
+		return out
+
+	case reflect.Slice:
+		if v.IsNil() {
+			return v
+		}
+		out := reflect.MakeSlice(v.Type(), v.Len(), v.Len())
+		for i := 0; i < v.Len(); i++ {
+			out.Index(i).Set(shift(v.Index(i), delta))
+		}
+		return out
+
+	case reflect.Map:
+		if v.IsNil() {
+			return v
+		}
+		out := reflect.MakeMapWithSize(v.Type(), v.Len())
+		iter := v.MapRange()
+		for iter.Next() {
+			out.SetMapIndex(iter.Key(), shift(iter.Value(), delta))
+		}
+		return out
+	}
+	return v
+}
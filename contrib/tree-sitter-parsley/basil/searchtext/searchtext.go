@@ -0,0 +1,162 @@
+// Package searchtext extracts the searchable text of Parsley source using
+// the grammar and queries/search.scm, for Basil's full-text search of .pars
+// and .part files (see server/search).
+//
+// Basil does not use cgo, so it does not link this package itself: a build
+// that does calls Register at startup, and from then on watched Parsley
+// files are indexed by their exported names, tables, strings, comments and
+// identifiers rather than as plain text.
+package searchtext
+
+import (
+	"regexp"
+	"strings"
+	"sync"
+
+	"github.com/sambeau/basil/server/search"
+	tree_sitter_parsley "github.com/sambeau/tree-sitter-parsley/bindings/go"
+	"github.com/sambeau/tree-sitter-parsley/queries"
+	tree_sitter "github.com/tree-sitter/go-tree-sitter"
+)
+
+// Extractor pulls search text out of Parsley source. The search query is
+// compiled once per Extractor; parsers and query cursors are not safe for
+// concurrent use, so each call borrows an idle parser or makes a new one.
+// Extractor is safe for concurrent use, which the indexer's worker pool needs.
+type Extractor struct {
+	language *tree_sitter.Language
+	query    *tree_sitter.Query
+	kinds    []string // capture name per capture index
+
+	mu   sync.Mutex
+	idle []*tree_sitter.Parser
+}
+
+// New compiles queries/search.scm and returns an Extractor for it.
+func New() *Extractor {
+	language := tree_sitter.NewLanguage(tree_sitter_parsley.Language())
+	query, err := tree_sitter.NewQuery(language, queries.Search)
+	if err != nil {
+		// The bundled query is compiled by this package's tests, so this
+		// only happens if search.scm and the grammar disagree
+		panic(err.Error())
+	}
+	return &Extractor{language: language, query: query, kinds: query.CaptureNames()}
+}
+
+var (
+	sharedOnce sync.Once
+	shared     *Extractor
+)
+
+// Extract extracts source with an Extractor shared by the whole process.
+func Extract(source []byte) search.ParsleyText {
+	sharedOnce.Do(func() { shared = New() })
+	return shared.Extract(source)
+}
+
+// Register installs Extract as Basil's Parsley extractor for search.
+func Register() {
+	search.RegisterParsleyExtractor(Extract)
+}
+
+// Extract returns the text of source by kind, each piece once, in source
+// order. A file with syntax errors still gives whatever parsed around them.
+func (e *Extractor) Extract(source []byte) search.ParsleyText {
+	parser := e.parser()
+	defer e.release(parser)
+
+	tree := parser.Parse(source, nil)
+	defer tree.Close()
+
+	cursor := tree_sitter.NewQueryCursor()
+	defer cursor.Close()
+
+	var text search.ParsleyText
+	seen := map[[2]uint]bool{}    // nodes already taken, by byte range
+	names := map[string]bool{}    // identifiers already listed
+	tables := map[string]bool{}   // tables already listed
+	exported := map[string]bool{} // exports already listed
+	captures := cursor.Captures(e.query, tree.RootNode(), source)
+	for match, index := captures.Next(); match != nil; match, index = captures.Next() {
+		capture := match.Captures[index]
+		node := &capture.Node
+		key := [2]uint{node.StartByte(), node.EndByte()}
+		if seen[key] {
+			continue
+		}
+		seen[key] = true
+
+		value := node.Utf8Text(source)
+		switch e.kinds[capture.Index] {
+		case "export":
+			if !exported[value] {
+				exported[value] = true
+				text.Exports = append(text.Exports, value)
+			}
+		case "table":
+			if table := tableName(value); table != "" && !tables[table] {
+				tables[table] = true
+				text.Tables = append(text.Tables, table)
+			}
+		case "text":
+			if value = literalText(node.Kind(), value); value != "" {
+				text.Text = append(text.Text, value)
+			}
+		case "identifier":
+			if !names[value] && !exported[value] {
+				names[value] = true
+				text.Identifiers = append(text.Identifiers, value)
+			}
+		}
+	}
+	return text
+}
+
+// leadingName matches the identifier a query body or mutation starts with,
+// after the keyword and parenthesis of a mutation.
+var leadingName = regexp.MustCompile(`^(?:@\w+\s*\(\s*)?([A-Za-z_][A-Za-z0-9_]*)`)
+
+func tableName(text string) string {
+	m := leadingName.FindStringSubmatch(strings.TrimSpace(text))
+	if m == nil {
+		return ""
+	}
+	return m[1]
+}
+
+// literalText strips the delimiters from a string or comment.
+func literalText(kind, text string) string {
+	switch kind {
+	case "comment":
+		text = strings.TrimPrefix(text, "//")
+	case "string", "template_string", "raw_string":
+		if len(text) >= 2 {
+			text = text[1 : len(text)-1]
+		}
+	}
+	return strings.TrimSpace(text)
+}
+
+func (e *Extractor) parser() *tree_sitter.Parser {
+	e.mu.Lock()
+	defer e.mu.Unlock()
+	if n := len(e.idle); n > 0 {
+		p := e.idle[n-1]
+		e.idle = e.idle[:n-1]
+		return p
+	}
+	p := tree_sitter.NewParser()
+	if err := p.SetLanguage(e.language); err != nil {
+		// Only possible if the generated parser's ABI is not supported
+		// by the linked runtime
+		panic(err)
+	}
+	return p
+}
+
+func (e *Extractor) release(p *tree_sitter.Parser) {
+	e.mu.Lock()
+	defer e.mu.Unlock()
+	e.idle = append(e.idle, p)
+}
@@ -0,0 +1,57 @@
+package searchtext_test
+
+import (
+	"reflect"
+	"testing"
+
+	"github.com/sambeau/tree-sitter-parsley/basil/searchtext"
+)
+
+func TestExtractsByKind(t *testing.T) {
+	text := searchtext.Extract([]byte(`// Lists the active users
+export Roster = fn(props) {
+  let rows = @query(Users | status == "active" ??-> *)
+  <ul class="roster">"Nobody yet"</ul>
+}
+export {first, last} = names
+@insert(AuditLog, {by: props})
+`))
+
+	if want := []string{"Roster", "first", "last"}; !reflect.DeepEqual(text.Exports, want) {
+		t.Errorf("Exports = %q, want %q", text.Exports, want)
+	}
+	if want := []string{"Users", "AuditLog"}; !reflect.DeepEqual(text.Tables, want) {
+		t.Errorf("Tables = %q, want %q", text.Tables, want)
+	}
+	if want := []string{"Lists the active users", "active", "roster", "Nobody yet"}; !reflect.DeepEqual(text.Text, want) {
+		t.Errorf("Text = %q, want %q", text.Text, want)
+	}
+	if want := []string{"props", "rows", "status", "names", "AuditLog", "by"}; !reflect.DeepEqual(text.Identifiers, want) {
+		t.Errorf("Identifiers = %q, want %q", text.Identifiers, want)
+	}
+}
+
+func TestExtractsAroundSyntaxErrors(t *testing.T) {
+	text := searchtext.Extract([]byte("export greeting = \"hello\"\nlet broken = (\n"))
+	if len(text.Exports) != 1 || text.Exports[0] != "greeting" {
+		t.Errorf("Exports = %q, want [greeting]", text.Exports)
+	}
+	if len(text.Text) != 1 || text.Text[0] != "hello" {
+		t.Errorf("Text = %q, want [hello]", text.Text)
+	}
+}
+
+func TestExtractIsSafeForConcurrentUse(t *testing.T) {
+	e := searchtext.New()
+	source := []byte("export a = `b {c}`")
+	want := e.Extract(source)
+	results := make(chan bool, 8)
+	for i := 0; i < cap(results); i++ {
+		go func() { results <- reflect.DeepEqual(e.Extract(source), want) }()
+	}
+	for i := 0; i < cap(results); i++ {
+		if !<-results {
+			t.Error("concurrent Extract gave a different result")
+		}
+	}
+}
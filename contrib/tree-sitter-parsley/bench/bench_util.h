@@ -0,0 +1,214 @@
+/**
+ * Shared helpers for the native tree-sitter-parsley benchmarks
+ *
+ * - A counting allocator installed with ts_set_allocator, so benchmarks can
+ *   report live and peak runtime memory
+ * - Monotonic timing
+ * - Loading files and collecting .pars/.part sources under a directory
+ *
+ * Header-only: each benchmark is a single translation unit.
+ */
+
+#ifndef TREE_SITTER_PARSLEY_BENCH_UTIL_H_
+#define TREE_SITTER_PARSLEY_BENCH_UTIL_H_
+
+#define _XOPEN_SOURCE 700
+
+#include <tree_sitter/api.h>
+
+#include <ftw.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+const TSLanguage *tree_sitter_parsley(void);
+
+// ================================================================
+// Counting allocator
+// ================================================================
+
+// Each block carries its size in a header so free/realloc can account it.
+// 16 bytes keeps the returned pointer aligned for any runtime type.
+#define BENCH_ALLOC_HEADER 16
+
+static size_t bench_live_bytes = 0;
+static size_t bench_peak_bytes = 0;
+
+static inline void bench_account(size_t added, size_t removed) {
+    bench_live_bytes += added;
+    bench_live_bytes -= removed;
+    if (bench_live_bytes > bench_peak_bytes) {
+        bench_peak_bytes = bench_live_bytes;
+    }
+}
+
+static inline void *bench_malloc(size_t size) {
+    char *block = malloc(size + BENCH_ALLOC_HEADER);
+    if (!block) return NULL;
+    *(size_t *)block = size;
+    bench_account(size, 0);
+    return block + BENCH_ALLOC_HEADER;
+}
+
+static inline void *bench_calloc(size_t count, size_t size) {
+    size_t total = count * size;
+    char *block = calloc(1, total + BENCH_ALLOC_HEADER);
+    if (!block) return NULL;
+    *(size_t *)block = total;
+    bench_account(total, 0);
+    return block + BENCH_ALLOC_HEADER;
+}
+
+static inline void bench_free(void *ptr) {
+    if (!ptr) return;
+    char *block = (char *)ptr - BENCH_ALLOC_HEADER;
+    bench_account(0, *(size_t *)block);
+    free(block);
+}
+
+static inline void *bench_realloc(void *ptr, size_t size) {
+    if (!ptr) return bench_malloc(size);
+    char *block = (char *)ptr - BENCH_ALLOC_HEADER;
+    size_t old_size = *(size_t *)block;
+    char *grown = realloc(block, size + BENCH_ALLOC_HEADER);
+    if (!grown) return NULL;
+    *(size_t *)grown = size;
+    bench_account(size, old_size);
+    return grown + BENCH_ALLOC_HEADER;
+}
+
+// Install the counting allocator. Must run before any parser is created.
+static inline void bench_install_allocator(void) {
+    ts_set_allocator(bench_malloc, bench_calloc, bench_realloc, bench_free);
+}
+
+// Start a new peak measurement from the current live size
+static inline void bench_reset_peak(void) {
+    bench_peak_bytes = bench_live_bytes;
+}
+
+// ================================================================
+// Timing
+// ================================================================
+
+static inline double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// ================================================================
+// Source files
+// ================================================================
+
+// Read a whole file into a NUL-terminated buffer. Returns NULL on error.
+static inline char *bench_read_file(const char *path, uint32_t *length) {
+    FILE *file = fopen(path, "rb");
+    if (!file) return NULL;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size < 0 || (unsigned long)size > UINT32_MAX) {
+        fclose(file);
+        return NULL;
+    }
+    char *buffer = malloc((size_t)size + 1);
+    if (!buffer) {
+        fclose(file);
+        return NULL;
+    }
+    size_t read = fread(buffer, 1, (size_t)size, file);
+    fclose(file);
+    buffer[read] = '\0';
+    *length = (uint32_t)read;
+    return buffer;
+}
+
+typedef struct {
+    char **paths;
+    size_t count;
+    size_t capacity;
+} BenchFileList;
+
+// nftw has no user-data argument, so the walk appends to this list
+static BenchFileList *bench_walk_list = NULL;
+
+static inline bool bench_has_suffix(const char *path, const char *suffix) {
+    size_t path_len = strlen(path);
+    size_t suffix_len = strlen(suffix);
+    return path_len >= suffix_len &&
+           strcmp(path + path_len - suffix_len, suffix) == 0;
+}
+
+static inline void bench_list_push(BenchFileList *list, const char *path) {
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 64;
+        list->paths = realloc(list->paths, list->capacity * sizeof(char *));
+    }
+    list->paths[list->count++] = strdup(path);
+}
+
+static inline int bench_walk_entry(
+    const char *path,
+    const struct stat *info,
+    int type,
+    struct FTW *ftw
+) {
+    (void)info;
+    (void)ftw;
+    if (type == FTW_F &&
+        (bench_has_suffix(path, ".pars") || bench_has_suffix(path, ".part"))) {
+        bench_list_push(bench_walk_list, path);
+    }
+    return 0;
+}
+
+static inline int bench_compare_paths(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// Add `root` to the list: a .pars/.part file is added as is, a directory is
+// searched recursively. Paths are sorted so output is stable across runs.
+static inline void bench_collect_sources(BenchFileList *list, const char *root) {
+    struct stat info;
+    if (stat(root, &info) != 0) {
+        fprintf(stderr, "warning: cannot stat %s\n", root);
+        return;
+    }
+    if (S_ISDIR(info.st_mode)) {
+        bench_walk_list = list;
+        nftw(root, bench_walk_entry, 16, FTW_PHYS);
+        bench_walk_list = NULL;
+    } else {
+        bench_list_push(list, root);
+    }
+    qsort(list->paths, list->count, sizeof(char *), bench_compare_paths);
+}
+
+static inline void bench_list_free(BenchFileList *list) {
+    for (size_t i = 0; i < list->count; i++) free(list->paths[i]);
+    free(list->paths);
+    list->paths = NULL;
+    list->count = list->capacity = 0;
+}
+
+// Print `text` as a JSON string literal
+static inline void bench_print_json_string(FILE *out, const char *text) {
+    fputc('"', out);
+    for (const char *p = text; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            fputc('\\', out);
+            fputc(*p, out);
+        } else if ((unsigned char)*p < 0x20) {
+            fprintf(out, "\\u%04x", (unsigned char)*p);
+        } else {
+            fputc(*p, out);
+        }
+    }
+    fputc('"', out);
+}
+
+#endif // TREE_SITTER_PARSLEY_BENCH_UTIL_H_
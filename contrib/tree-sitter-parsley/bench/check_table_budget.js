@@ -0,0 +1,121 @@
+#!/usr/bin/env node
+/**
+ * Parse-table size budget for tree-sitter-parsley
+ *
+ * Reads the table sizes tree-sitter writes into src/parser.c and compares
+ * them with the ceilings in bench/table-budget.json. Exits non-zero if any
+ * value grew past its ceiling, so a grammar change that bloats the tables
+ * fails CI instead of silently growing every binary that embeds the parser.
+ *
+ * Run after `tree-sitter generate`:
+ *
+ *   node bench/check_table_budget.js           # report and check
+ *   node bench/check_table_budget.js --update  # lower the budget to the
+ *                                              # current sizes
+ *
+ * Budgets only move down: --update refuses to raise a ceiling. A ceiling
+ * of null has not been measured yet; the check fails until --update records
+ * it from a freshly generated parser.
+ *
+ * The sizes are only meaningful for a parser.c generated from the current
+ * grammar, so the check first makes sure parser.c has the external tokens
+ * listed in src/grammar.json.
+ */
+
+const fs = require("fs");
+const path = require("path");
+
+const root = path.join(__dirname, "..");
+const parserPath = path.join(root, "src", "parser.c");
+const grammarPath = path.join(root, "src", "grammar.json");
+const budgetPath = path.join(__dirname, "table-budget.json");
+
+function readDefine(source, name) {
+  const match = source.match(new RegExp(`^#define ${name} (\\d+)$`, "m"));
+  if (!match) {
+    throw new Error(`${name} not found in ${parserPath}`);
+  }
+  return Number(match[1]);
+}
+
+// A parser.c generated from an older grammar measures the wrong tables.
+// The external token count is the one generated value that grammar.json
+// states directly, so it catches a forgotten `tree-sitter generate`.
+function checkFresh(source) {
+  const grammar = JSON.parse(fs.readFileSync(grammarPath, "utf8"));
+  const expected = (grammar.externals || []).length;
+  const actual = readDefine(source, "EXTERNAL_TOKEN_COUNT");
+  if (actual !== expected) {
+    console.error(
+      `error: src/parser.c has ${actual} external tokens but src/grammar.json lists ${expected}; run \`tree-sitter generate\``,
+    );
+    process.exit(1);
+  }
+}
+
+function readSizes() {
+  const source = fs.readFileSync(parserPath, "utf8");
+  checkFresh(source);
+  const sizes = {};
+  for (const name of [
+    "STATE_COUNT",
+    "LARGE_STATE_COUNT",
+    "SYMBOL_COUNT",
+    "PRODUCTION_ID_COUNT",
+  ]) {
+    sizes[name] = readDefine(source, name);
+  }
+  sizes.parser_c_bytes = Buffer.byteLength(source);
+  return sizes;
+}
+
+function main() {
+  const update = process.argv.includes("--update");
+  const budget = JSON.parse(fs.readFileSync(budgetPath, "utf8"));
+  const sizes = readSizes();
+
+  let over = false;
+  let unset = false;
+  console.log(
+    `${"metric".padEnd(22)}${"budget".padStart(12)}${"actual".padStart(12)}${"delta".padStart(10)}`,
+  );
+  for (const [name, actual] of Object.entries(sizes)) {
+    const limit = budget[name];
+    const delta = limit == null ? 0 : actual - limit;
+    const sign = delta > 0 ? "+" : "";
+    let flag = delta > 0 ? "  OVER" : "";
+    if (delta > 0) over = true;
+    if (limit === null) {
+      flag = "  UNSET";
+      unset = true;
+    }
+    console.log(
+      `${name.padEnd(22)}${String(limit ?? "-").padStart(12)}${String(actual).padStart(12)}${(sign + delta).padStart(10)}${flag}`,
+    );
+  }
+
+  if (update) {
+    if (over) {
+      console.error(
+        "error: refusing to raise the budget; shrink the grammar or edit table-budget.json by hand",
+      );
+      process.exit(1);
+    }
+    fs.writeFileSync(budgetPath, JSON.stringify(sizes, null, 2) + "\n");
+    console.log(`updated ${path.relative(root, budgetPath)}`);
+    return;
+  }
+
+  if (over) {
+    console.error("error: parse tables exceed bench/table-budget.json");
+    process.exit(1);
+  }
+  if (unset) {
+    console.error(
+      "error: bench/table-budget.json has unmeasured ceilings; record them with --update",
+    );
+    process.exit(1);
+  }
+}
+
+main();
@@ -0,0 +1,354 @@
+/**
+ * Raw text chunk check for the external scanner
+ *
+ * The scanner cuts long <style>/<script>/<SQL> bodies into raw_text chunks
+ * whose boundaries depend on content, so that an edit only relexes the
+ * chunks near it and the parser can reuse the rest. This check drives
+ * src/scanner.c directly, the way the parser does inside a <script>: scan a
+ * token at the current position, continue from the token's end, and skip an
+ * @{...} interpolation when one starts. The lexer is a stand-in over a byte
+ * buffer, so the check needs neither the tree-sitter runtime nor a generated
+ * parser, and the scanner's limits are read from its own source.
+ *
+ * For every body it checks that:
+ * - the chunks cover the body up to its closing tag, in order, with no gaps
+ * - no chunk is longer than RAW_TEXT_CHUNK_HARD_LIMIT characters
+ * - after inserting a line at each of EDIT_COUNT offsets, at most
+ *   --max-relexed chunks differ from the chunks before the edit (once the
+ *   old chunks after the edit are shifted by the inserted length)
+ *
+ * Usage: chunk-check [--max-relexed N] [file...]
+ *
+ * Built-in bodies cover generated JavaScript and runs that offer no
+ * content-defined boundary (newlines, ";", "}", "<", "@" and one long
+ * line). Each file given is read as a <script> body, after the built-ins.
+ * Bytes are fed to the scanner one at a time, so multi-byte UTF-8 counts as
+ * several characters; the chunk boundaries are the same either way for
+ * ASCII delimiters.
+ */
+
+#include "scanner.c"
+
+#include <stdio.h>
+
+#define EDIT_COUNT 7
+#define EDIT_TEXT "  tweak(state, 1);\n"
+#define DEFAULT_MAX_RELEXED 3
+
+// ================================================================
+// Stand-in lexer
+// ================================================================
+
+typedef struct {
+    TSLexer lexer;
+    const char *text;
+    uint32_t length;
+    uint32_t position;
+    uint32_t token_end;
+} BufferLexer;
+
+static int32_t lookahead_at(const BufferLexer *b) {
+    return b->position < b->length ? (unsigned char)b->text[b->position] : 0;
+}
+
+static void buffer_advance(TSLexer *lexer, bool skip) {
+    (void)skip;
+    BufferLexer *b = (BufferLexer *)lexer;
+    if (b->position < b->length) b->position++;
+    lexer->lookahead = lookahead_at(b);
+}
+
+static void buffer_mark_end(TSLexer *lexer) {
+    BufferLexer *b = (BufferLexer *)lexer;
+    b->token_end = b->position;
+}
+
+static bool buffer_eof(const TSLexer *lexer) {
+    const BufferLexer *b = (const BufferLexer *)lexer;
+    return b->position >= b->length;
+}
+
+static uint32_t buffer_get_column(TSLexer *lexer) {
+    (void)lexer;
+    return 0;
+}
+
+// ================================================================
+// Chunking
+// ================================================================
+
+typedef struct {
+    uint32_t start, end;
+} Chunk;
+
+typedef struct {
+    Chunk *items;
+    uint32_t count, capacity;
+} Chunks;
+
+static void chunks_push(Chunks *chunks, uint32_t start, uint32_t end) {
+    if (chunks->count == chunks->capacity) {
+        chunks->capacity = chunks->capacity ? chunks->capacity * 2 : 64;
+        chunks->items = realloc(chunks->items, chunks->capacity * sizeof(Chunk));
+        if (!chunks->items) {
+            fprintf(stderr, "error: out of memory\n");
+            exit(1);
+        }
+    }
+    chunks->items[chunks->count++] = (Chunk){start, end};
+}
+
+// Scans `text` as a <script> body. Returns the offset where raw text ended:
+// the closing tag, or the end of the text.
+static uint32_t chunk_body(const char *text, uint32_t length, Chunks *chunks) {
+    void *scanner = tree_sitter_parsley_external_scanner_create();
+    // The committed parser passes two external tokens
+    bool valid_symbols[RAW_TEXT_INTERPOLATION_START + 1] = {false};
+    valid_symbols[RAW_TEXT] = true;
+    valid_symbols[RAW_TEXT_INTERPOLATION_START] = true;
+
+    BufferLexer b = {
+        .lexer = {
+            .advance = buffer_advance,
+            .mark_end = buffer_mark_end,
+            .get_column = buffer_get_column,
+            .eof = buffer_eof,
+        },
+        .text = text,
+        .length = length,
+    };
+    chunks->count = 0;
+
+    uint32_t position = 0;
+    while (position < length) {
+        b.position = position;
+        b.token_end = position;
+        b.lexer.lookahead = lookahead_at(&b);
+        if (!tree_sitter_parsley_external_scanner_scan(scanner, &b.lexer, valid_symbols)) {
+            break; // at the closing tag
+        }
+        if (b.lexer.result_symbol == RAW_TEXT_INTERPOLATION_START) {
+            // Stand in for the parser: the expression runs to the next }
+            position = b.token_end;
+            while (position < length && text[position] != '}') position++;
+            if (position < length) position++;
+            continue;
+        }
+        chunks_push(chunks, position, b.token_end);
+        position = b.token_end;
+    }
+
+    tree_sitter_parsley_external_scanner_destroy(scanner);
+    return position;
+}
+
+// ================================================================
+// Checks
+// ================================================================
+
+static bool is_closing_tag(const char *text) {
+    return strncmp(text, "</style>", 8) == 0 || strncmp(text, "</script>", 9) == 0;
+}
+
+static bool check_cover(const char *name, const char *text, uint32_t length,
+                        const Chunks *chunks, uint32_t end) {
+    uint32_t position = 0;
+    for (uint32_t i = 0; i < chunks->count; i++) {
+        const Chunk *c = &chunks->items[i];
+        // Gaps are only allowed for @{...} interpolations
+        if (c->start != position && strncmp(text + position, "@{", 2) != 0) {
+            fprintf(stderr, "%s: gap before chunk at %u\n", name, c->start);
+            return false;
+        }
+        if (c->end <= c->start) {
+            fprintf(stderr, "%s: empty chunk at %u\n", name, c->start);
+            return false;
+        }
+        if (c->end - c->start > RAW_TEXT_CHUNK_HARD_LIMIT) {
+            fprintf(stderr, "%s: chunk at %u is %u characters, over the hard limit of %u\n",
+                    name, c->start, c->end - c->start, RAW_TEXT_CHUNK_HARD_LIMIT);
+            return false;
+        }
+        position = c->end;
+    }
+    if (end < length && !is_closing_tag(text + end)) {
+        fprintf(stderr, "%s: raw text stopped at %u, not at a closing tag\n", name, end);
+        return false;
+    }
+    return true;
+}
+
+static bool same_chunk(const Chunks *before, uint32_t at, uint32_t inserted, Chunk c) {
+    for (uint32_t i = 0; i < before->count; i++) {
+        Chunk old = before->items[i];
+        if (old.start >= at) {
+            old.start += inserted;
+            old.end += inserted;
+        } else if (old.end > at) {
+            continue; // the edit falls inside this chunk
+        }
+        if (old.start == c.start && old.end == c.end) return true;
+    }
+    return false;
+}
+
+// Inserts EDIT_TEXT at EDIT_COUNT offsets (each just after a newline) and
+// returns the most chunks any one edit relexed
+static uint32_t check_edits(const char *text, uint32_t length, const Chunks *before) {
+    uint32_t inserted = (uint32_t)strlen(EDIT_TEXT);
+    char *edited = malloc(length + inserted);
+    Chunks after = {0};
+    uint32_t worst = 0;
+
+    for (int k = 1; k <= EDIT_COUNT; k++) {
+        uint32_t at = (uint32_t)((uint64_t)length * k / (EDIT_COUNT + 1));
+        while (at < length && text[at - 1] != '\n') at++;
+        memcpy(edited, text, at);
+        memcpy(edited + at, EDIT_TEXT, inserted);
+        memcpy(edited + at + inserted, text + at, length - at);
+        chunk_body(edited, length + inserted, &after);
+
+        uint32_t relexed = 0;
+        for (uint32_t i = 0; i < after.count; i++) {
+            if (!same_chunk(before, at, inserted, after.items[i])) relexed++;
+        }
+        if (relexed > worst) worst = relexed;
+    }
+
+    free(after.items);
+    free(edited);
+    return worst;
+}
+
+// A max_relexed of NO_REUSE_CHECK skips the edits
+#define NO_REUSE_CHECK UINT32_MAX
+
+static bool check_body(const char *name, const char *text, uint32_t length,
+                       uint32_t max_relexed) {
+    Chunks chunks = {0};
+    uint32_t end = chunk_body(text, length, &chunks);
+    bool ok = check_cover(name, text, length, &chunks, end);
+    uint32_t longest = 0;
+    for (uint32_t i = 0; i < chunks.count; i++) {
+        uint32_t n = chunks.items[i].end - chunks.items[i].start;
+        if (n > longest) longest = n;
+    }
+
+    char reuse[32] = "-";
+    if (ok && max_relexed != NO_REUSE_CHECK) {
+        uint32_t relexed = check_edits(text, length, &chunks);
+        if (relexed > max_relexed) {
+            fprintf(stderr, "%s: an edit relexed %u chunks, more than %u\n",
+                    name, relexed, max_relexed);
+            ok = false;
+        }
+        snprintf(reuse, sizeof reuse, "<= %u", relexed);
+    }
+
+    printf("%-24s %8u bytes %6u chunks  longest %5u  relexed per edit %-6s %s\n",
+           name, length, chunks.count, longest, reuse, ok ? "ok" : "FAIL");
+    free(chunks.items);
+    return ok;
+}
+
+// ================================================================
+// Bodies
+// ================================================================
+
+typedef struct {
+    char *text;
+    uint32_t length, capacity;
+} Buffer;
+
+static void buffer_append(Buffer *buf, const char *text, uint32_t length) {
+    if (buf->length + length > buf->capacity) {
+        buf->capacity = (buf->length + length) * 2;
+        buf->text = realloc(buf->text, buf->capacity);
+        if (!buf->text) {
+            fprintf(stderr, "error: out of memory\n");
+            exit(1);
+        }
+    }
+    memcpy(buf->text + buf->length, text, length);
+    buf->length += length;
+}
+
+// Generated JavaScript with markup strings, @ in text, optionally an
+// interpolation every few lines, and the closing tag at the end
+static void generate_script(Buffer *buf, uint32_t lines, bool interpolate) {
+    char line[160];
+    for (uint32_t i = 0; i < lines; i++) {
+        int n;
+        switch (i % 6) {
+            case 0: n = snprintf(line, sizeof line, "  function row%u(item) {\n", i); break;
+            case 1: n = snprintf(line, sizeof line, "    var html = '<li data-i=\"%u\">' + item.name + '</li>';\n", i); break;
+            case 2: n = snprintf(line, sizeof line, "    if (item.rank < %u && item.mail != \"a@b\") { count++; }\n", i % 97); break;
+            case 3:
+                n = snprintf(line, sizeof line, "    total += %s[%u] * item.score;\n",
+                             interpolate ? "@{weights}" : "weights", i % 13);
+                break;
+            case 4: n = snprintf(line, sizeof line, "    return html;\n"); break;
+            default: n = snprintf(line, sizeof line, "  }\n"); break;
+        }
+        buffer_append(buf, line, (uint32_t)n);
+    }
+    buffer_append(buf, "</script>", 9);
+}
+
+static void generate_run(Buffer *buf, char c, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) buffer_append(buf, &c, 1);
+    buffer_append(buf, "</script>", 9);
+}
+
+static bool check_generated(const char *name, Buffer *buf, uint32_t max_relexed) {
+    bool ok = check_body(name, buf->text, buf->length, max_relexed);
+    buf->length = 0;
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    uint32_t max_relexed = DEFAULT_MAX_RELEXED;
+    int first_file = 1;
+    if (argc > 2 && strcmp(argv[1], "--max-relexed") == 0) {
+        max_relexed = (uint32_t)strtoul(argv[2], NULL, 10);
+        first_file = 3;
+    }
+
+    bool ok = true;
+    Buffer buf = {0};
+
+    generate_script(&buf, 3000, false);
+    ok &= check_generated("script", &buf, max_relexed);
+    generate_script(&buf, 3000, true);
+    ok &= check_generated("script-interpolated", &buf, max_relexed);
+
+    // Runs with no content-defined boundary are cut at the hard limit, so
+    // there is nothing to resynchronise on; only the limit and cover matter
+    static const struct { const char *name; char c; } runs[] = {
+        {"newlines", '\n'}, {"semicolons", ';'}, {"braces", '}'},
+        {"less-thans", '<'}, {"ats", '@'}, {"one-line", 'x'},
+    };
+    for (size_t i = 0; i < sizeof runs / sizeof runs[0]; i++) {
+        generate_run(&buf, runs[i].c, 5 * RAW_TEXT_CHUNK_HARD_LIMIT + 7);
+        ok &= check_generated(runs[i].name, &buf, NO_REUSE_CHECK);
+    }
+
+    for (int i = first_file; i < argc; i++) {
+        FILE *file = fopen(argv[i], "rb");
+        if (!file) {
+            fprintf(stderr, "error: cannot read %s\n", argv[i]);
+            ok = false;
+            continue;
+        }
+        char chunk[8192];
+        size_t n;
+        while ((n = fread(chunk, 1, sizeof chunk, file)) > 0) {
+            buffer_append(&buf, chunk, (uint32_t)n);
+        }
+        fclose(file);
+        ok &= check_generated(argv[i], &buf, max_relexed);
+    }
+
+    free(buf.text);
+    return ok ? 0 : 1;
+}
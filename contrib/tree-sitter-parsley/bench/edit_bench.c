@@ -0,0 +1,373 @@
+/**
+ * Incremental reparse latency benchmark for tree-sitter-parsley
+ *
+ * Replays edit scripts (bench/edits/NAME.edits) against real source files. Every
+ * edit is applied with ts_tree_edit and followed by an incremental reparse,
+ * the way an editor or the Basil dev server would after a keystroke. For each
+ * script it reports p50/p99/max reparse time, the size of the ranges
+ * ts_tree_get_changed_ranges reports, and a cold parse of the final text for
+ * comparison.
+ *
+ * Usage: edit-bench [--json] script.edits...
+ *
+ * Edit script format, one command per line (# starts a comment):
+ *
+ *   file PATH        source file, relative to the script's directory
+ *   find "TEXT"      move the cursor to just after the next occurrence of TEXT
+ *   type "TEXT"      insert TEXT one character per edit (keystrokes)
+ *   paste "TEXT"     insert TEXT as a single edit
+ *   backspace N      delete N characters before the cursor, one per edit
+ *   delete N         delete N bytes after the cursor as a single edit
+ *
+ * Strings accept \n, \t, \" and \\ escapes.
+ */
+
+#include "bench_util.h"
+
+#include <ctype.h>
+
+// ================================================================
+// Source buffer
+// ================================================================
+
+typedef struct {
+    char *text;
+    uint32_t length;
+    uint32_t capacity;
+} Buffer;
+
+static void buffer_splice(Buffer *b, uint32_t at, uint32_t removed, const char *text, uint32_t added) {
+    if (b->length - removed + added + 1 > b->capacity) {
+        b->capacity = (b->length - removed + added + 1) * 2;
+        b->text = realloc(b->text, b->capacity);
+    }
+    memmove(b->text + at + added, b->text + at + removed, b->length - at - removed + 1);
+    memcpy(b->text + at, text, added);
+    b->length = b->length - removed + added;
+}
+
+// Row/column of a byte offset (columns are in bytes, as tree-sitter expects)
+static TSPoint point_at(const Buffer *b, uint32_t offset) {
+    TSPoint point = {0, 0};
+    for (uint32_t i = 0; i < offset; i++) {
+        if (b->text[i] == '\n') {
+            point.row++;
+            point.column = 0;
+        } else {
+            point.column++;
+        }
+    }
+    return point;
+}
+
+// Point reached after `text` when it starts at `start`
+static TSPoint point_after(TSPoint start, const char *text, uint32_t length) {
+    for (uint32_t i = 0; i < length; i++) {
+        if (text[i] == '\n') {
+            start.row++;
+            start.column = 0;
+        } else {
+            start.column++;
+        }
+    }
+    return start;
+}
+
+// ================================================================
+// Samples
+// ================================================================
+
+typedef struct {
+    double *values;
+    size_t count;
+    size_t capacity;
+} Samples;
+
+static void samples_push(Samples *s, double value) {
+    if (s->count == s->capacity) {
+        s->capacity = s->capacity ? s->capacity * 2 : 256;
+        s->values = realloc(s->values, s->capacity * sizeof(double));
+    }
+    s->values[s->count++] = value;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile; sorts the samples in place
+static double samples_percentile(Samples *s, double percentile) {
+    if (s->count == 0) return 0;
+    qsort(s->values, s->count, sizeof(double), compare_doubles);
+    size_t rank = (size_t)(percentile / 100.0 * (double)s->count + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > s->count) rank = s->count;
+    return s->values[rank - 1];
+}
+
+// ================================================================
+// Replay
+// ================================================================
+
+typedef struct {
+    TSParser *parser;
+    TSTree *tree;
+    Buffer buffer;
+    uint32_t cursor;
+    Samples reparse_us;
+    Samples changed_bytes;
+    uint64_t changed_ranges;
+    uint64_t edits;
+} Session;
+
+// Apply one edit at `start`: remove `removed` bytes, insert `text`
+static void session_edit(Session *s, uint32_t start, uint32_t removed, const char *text, uint32_t added) {
+    TSInputEdit edit;
+    edit.start_byte = start;
+    edit.old_end_byte = start + removed;
+    edit.new_end_byte = start + added;
+    edit.start_point = point_at(&s->buffer, start);
+    edit.old_end_point = point_after(edit.start_point, s->buffer.text + start, removed);
+    edit.new_end_point = point_after(edit.start_point, text, added);
+
+    buffer_splice(&s->buffer, start, removed, text, added);
+    ts_tree_edit(s->tree, &edit);
+
+    double began = bench_now();
+    TSTree *tree = ts_parser_parse_string(s->parser, s->tree, s->buffer.text, s->buffer.length);
+    double elapsed = bench_now() - began;
+
+    uint32_t range_count = 0;
+    TSRange *ranges = ts_tree_get_changed_ranges(s->tree, tree, &range_count);
+    uint64_t bytes = 0;
+    for (uint32_t i = 0; i < range_count; i++) {
+        bytes += ranges[i].end_byte - ranges[i].start_byte;
+    }
+    // Changed ranges are allocated with the runtime allocator
+    bench_free(ranges);
+
+    ts_tree_delete(s->tree);
+    s->tree = tree;
+
+    samples_push(&s->reparse_us, elapsed * 1e6);
+    samples_push(&s->changed_bytes, (double)bytes);
+    s->changed_ranges += range_count;
+    s->edits++;
+}
+
+// Length of the UTF-8 sequence starting with `lead`
+static uint32_t utf8_length(unsigned char lead) {
+    if (lead >= 0xF0) return 4;
+    if (lead >= 0xE0) return 3;
+    if (lead >= 0xC0) return 2;
+    return 1;
+}
+
+// Parse a double-quoted string argument with escapes. Returns false on error.
+static bool parse_string_arg(const char *p, char *out, uint32_t *length) {
+    while (isspace((unsigned char)*p)) p++;
+    if (*p++ != '"') return false;
+    uint32_t n = 0;
+    while (*p && *p != '"') {
+        char c = *p++;
+        if (c == '\\') {
+            c = *p++;
+            if (c == 'n') c = '\n';
+            else if (c == 't') c = '\t';
+            else if (c != '"' && c != '\\') return false;
+        }
+        out[n++] = c;
+    }
+    if (*p != '"') return false;
+    out[n] = '\0';
+    *length = n;
+    return true;
+}
+
+static void path_relative_to(const char *script, const char *path, char *out, size_t size) {
+    const char *slash = strrchr(script, '/');
+    if (path[0] == '/' || !slash) {
+        snprintf(out, size, "%s", path);
+    } else {
+        snprintf(out, size, "%.*s/%s", (int)(slash - script), script, path);
+    }
+}
+
+typedef struct {
+    uint64_t edits;
+    uint64_t changed_ranges;
+    double p50_us;
+    double p99_us;
+    double max_us;
+    double p50_changed;
+    double p99_changed;
+    double cold_us;
+    uint32_t final_bytes;
+} ScriptResult;
+
+static bool run_script(TSParser *parser, const char *script_path, ScriptResult *result) {
+    FILE *script = fopen(script_path, "r");
+    if (!script) {
+        fprintf(stderr, "error: cannot open %s\n", script_path);
+        return false;
+    }
+
+    Session s = {0};
+    s.parser = parser;
+    bool ok = true;
+    char line[4096];
+    char arg[4096];
+    int line_number = 0;
+
+    while (ok && fgets(line, sizeof(line), script)) {
+        line_number++;
+        line[strcspn(line, "\r\n")] = '\0';
+        char *p = line;
+        while (isspace((unsigned char)*p)) p++;
+        if (*p == '\0' || *p == '#') continue;
+
+        char command[16] = {0};
+        int consumed = 0;
+        sscanf(p, "%15s%n", command, &consumed);
+        const char *rest = p + consumed;
+        uint32_t length = 0;
+
+        if (strcmp(command, "file") == 0) {
+            while (isspace((unsigned char)*rest)) rest++;
+            char path[4096];
+            path_relative_to(script_path, rest, path, sizeof(path));
+            free(s.buffer.text);
+            if (s.tree) ts_tree_delete(s.tree);
+            s.buffer.text = bench_read_file(path, &s.buffer.length);
+            if (!s.buffer.text) {
+                fprintf(stderr, "%s:%d: cannot read %s\n", script_path, line_number, path);
+                ok = false;
+                break;
+            }
+            s.buffer.capacity = s.buffer.length + 1;
+            s.cursor = 0;
+            s.tree = ts_parser_parse_string(parser, NULL, s.buffer.text, s.buffer.length);
+        } else if (!s.tree) {
+            fprintf(stderr, "%s:%d: edit before file\n", script_path, line_number);
+            ok = false;
+        } else if (strcmp(command, "find") == 0 && parse_string_arg(rest, arg, &length)) {
+            const char *found = strstr(s.buffer.text + s.cursor, arg);
+            if (!found) {
+                fprintf(stderr, "%s:%d: text not found\n", script_path, line_number);
+                ok = false;
+            } else {
+                s.cursor = (uint32_t)(found - s.buffer.text) + length;
+            }
+        } else if (strcmp(command, "type") == 0 && parse_string_arg(rest, arg, &length)) {
+            for (uint32_t i = 0; i < length;) {
+                uint32_t n = utf8_length((unsigned char)arg[i]);
+                if (i + n > length) n = length - i;
+                session_edit(&s, s.cursor, 0, arg + i, n);
+                s.cursor += n;
+                i += n;
+            }
+        } else if (strcmp(command, "paste") == 0 && parse_string_arg(rest, arg, &length)) {
+            session_edit(&s, s.cursor, 0, arg, length);
+            s.cursor += length;
+        } else if (strcmp(command, "backspace") == 0) {
+            int count = atoi(rest);
+            for (int i = 0; i < count && s.cursor > 0; i++) {
+                uint32_t start = s.cursor - 1;
+                while (start > 0 && ((unsigned char)s.buffer.text[start] & 0xC0) == 0x80) start--;
+                session_edit(&s, start, s.cursor - start, "", 0);
+                s.cursor = start;
+            }
+        } else if (strcmp(command, "delete") == 0) {
+            uint32_t count = (uint32_t)atoi(rest);
+            if (count > s.buffer.length - s.cursor) count = s.buffer.length - s.cursor;
+            session_edit(&s, s.cursor, count, "", 0);
+        } else {
+            fprintf(stderr, "%s:%d: bad command: %s\n", script_path, line_number, p);
+            ok = false;
+        }
+    }
+    fclose(script);
+
+    if (ok && s.tree) {
+        memset(result, 0, sizeof(*result));
+        result->edits = s.edits;
+        result->changed_ranges = s.changed_ranges;
+        result->p50_us = samples_percentile(&s.reparse_us, 50);
+        result->p99_us = samples_percentile(&s.reparse_us, 99);
+        result->max_us = samples_percentile(&s.reparse_us, 100);
+        result->p50_changed = samples_percentile(&s.changed_bytes, 50);
+        result->p99_changed = samples_percentile(&s.changed_bytes, 99);
+        result->final_bytes = s.buffer.length;
+
+        double began = bench_now();
+        TSTree *cold = ts_parser_parse_string(parser, NULL, s.buffer.text, s.buffer.length);
+        result->cold_us = (bench_now() - began) * 1e6;
+        ts_tree_delete(cold);
+    }
+
+    if (s.tree) ts_tree_delete(s.tree);
+    free(s.buffer.text);
+    free(s.reparse_us.values);
+    free(s.changed_bytes.values);
+    return ok;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: edit-bench [--json] script.edits...\n");
+}
+
+int main(int argc, char **argv) {
+    bool json = false;
+    int first_script = 1;
+    if (argc > 1 && strcmp(argv[1], "--json") == 0) {
+        json = true;
+        first_script = 2;
+    }
+    if (first_script >= argc) {
+        usage();
+        return 2;
+    }
+
+    bench_install_allocator();
+    TSParser *parser = ts_parser_new();
+    if (!ts_parser_set_language(parser, tree_sitter_parsley())) {
+        fprintf(stderr, "error: incompatible tree-sitter runtime\n");
+        return 1;
+    }
+
+    if (!json) {
+        printf("%-40s %6s %9s %9s %9s %9s %10s %10s\n",
+               "script", "edits", "p50_us", "p99_us", "max_us", "cold_us",
+               "p50_chg_B", "p99_chg_B");
+    }
+
+    int status = 0;
+    for (int i = first_script; i < argc; i++) {
+        ScriptResult r;
+        if (!run_script(parser, argv[i], &r)) {
+            status = 1;
+            continue;
+        }
+        if (json) {
+            printf("{\"script\":");
+            bench_print_json_string(stdout, argv[i]);
+            printf(",\"edits\":%llu,\"final_bytes\":%u,\"changed_ranges\":%llu"
+                   ",\"p50_changed_bytes\":%.0f,\"p99_changed_bytes\":%.0f"
+                   ",\"p50_us\":%.1f,\"p99_us\":%.1f,\"max_us\":%.1f,\"cold_us\":%.1f}\n",
+                   (unsigned long long)r.edits, r.final_bytes,
+                   (unsigned long long)r.changed_ranges,
+                   r.p50_changed, r.p99_changed,
+                   r.p50_us, r.p99_us, r.max_us, r.cold_us);
+        } else {
+            printf("%-40s %6llu %9.1f %9.1f %9.1f %9.1f %10.0f %10.0f\n",
+                   argv[i], (unsigned long long)r.edits,
+                   r.p50_us, r.p99_us, r.max_us, r.cold_us,
+                   r.p50_changed, r.p99_changed);
+        }
+    }
+
+    ts_parser_delete(parser);
+    return status;
+}
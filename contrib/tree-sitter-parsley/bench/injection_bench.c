@@ -0,0 +1,443 @@
+/**
+ * Injection reparse benchmark for tree-sitter-parsley
+ *
+ * Compares injection queries, typically queries/injections.scm (combined: one
+ * injected document per language per file) and queries/injections-per-tag.scm
+ * (one document per tag), by what an edit inside an injected tag costs.
+ *
+ * For each query and file it builds the injection layers the way Zed and
+ * Neovim do: a combined pattern gives one layer holding every match's content
+ * ranges, any other pattern one layer per match. It then reports:
+ * - layers, and matches skipped because their language was not loaded
+ * - full parse time of every layer (best of N)
+ * - for an edit at the start of each content range (a space typed into the
+ *   tag), the incremental reparse time of the layer it falls in: p50, p99
+ *   and mean over all edit sites, plus the mean size of that layer
+ *
+ * The Parsley tree itself is reparsed identically in every mode, so it is
+ * not timed.
+ *
+ * Injected grammars are loaded from shared libraries, such as the ones
+ * `tree-sitter build` writes:
+ *
+ * Usage: injection-bench [-n iterations] [--json] -l css=libtree-sitter-css.so
+ *            [-l ...] -q injections.scm [-q ...] path...
+ *
+ * The library for -l NAME=PATH must export tree_sitter_NAME.
+ */
+
+#include "bench_util.h"
+
+#include <dlfcn.h>
+
+#define MAX_LANGUAGES 16
+
+typedef struct {
+    char name[64];
+    const TSLanguage *language;
+} InjectedLanguage;
+
+static InjectedLanguage languages[MAX_LANGUAGES];
+static size_t language_count = 0;
+
+static bool load_language(const char *spec) {
+    const char *eq = strchr(spec, '=');
+    if (!eq || eq == spec || (size_t)(eq - spec) >= sizeof(languages[0].name) ||
+        language_count == MAX_LANGUAGES) {
+        return false;
+    }
+    InjectedLanguage *l = &languages[language_count];
+    memcpy(l->name, spec, (size_t)(eq - spec));
+    l->name[eq - spec] = '\0';
+
+    char symbol[96] = "tree_sitter_";
+    size_t at = strlen(symbol);
+    for (const char *c = l->name; *c && at + 1 < sizeof(symbol); c++) {
+        symbol[at++] = (*c == '-' || *c == '.') ? '_' : *c;
+    }
+    symbol[at] = '\0';
+
+    void *library = dlopen(eq + 1, RTLD_NOW | RTLD_LOCAL);
+    if (!library) {
+        fprintf(stderr, "error: %s\n", dlerror());
+        return false;
+    }
+    const TSLanguage *(*language_fn)(void) = (const TSLanguage *(*)(void))dlsym(library, symbol);
+    if (!language_fn) {
+        fprintf(stderr, "error: %s does not export %s\n", eq + 1, symbol);
+        return false;
+    }
+    l->language = language_fn();
+    language_count++;
+    return true;
+}
+
+static const TSLanguage *find_language(const char *name) {
+    for (size_t i = 0; i < language_count; i++) {
+        if (strcmp(languages[i].name, name) == 0) return languages[i].language;
+    }
+    return NULL;
+}
+
+// ================================================================
+// Injection patterns
+// ================================================================
+
+typedef struct {
+    char language[64];
+    bool combined;
+} PatternInfo;
+
+// Read injection.language and injection.combined from each pattern's #set!
+// predicates
+static PatternInfo *read_patterns(const TSQuery *query) {
+    uint32_t pattern_count = ts_query_pattern_count(query);
+    PatternInfo *patterns = calloc(pattern_count, sizeof(PatternInfo));
+    for (uint32_t p = 0; p < pattern_count; p++) {
+        uint32_t step_count;
+        const TSQueryPredicateStep *steps = ts_query_predicates_for_pattern(query, p, &step_count);
+        for (uint32_t i = 0; i < step_count;) {
+            const char *args[3] = {NULL, NULL, NULL};
+            uint32_t argc = 0;
+            for (; i < step_count && steps[i].type != TSQueryPredicateStepTypeDone; i++) {
+                if (argc < 3 && steps[i].type == TSQueryPredicateStepTypeString) {
+                    uint32_t length;
+                    args[argc] = ts_query_string_value_for_id(query, steps[i].value_id, &length);
+                }
+                argc++;
+            }
+            i++;
+            if (!args[0] || strcmp(args[0], "set!") != 0 || !args[1]) continue;
+            if (strcmp(args[1], "injection.language") == 0 && args[2]) {
+                snprintf(patterns[p].language, sizeof(patterns[p].language), "%s", args[2]);
+            } else if (strcmp(args[1], "injection.combined") == 0) {
+                patterns[p].combined = true;
+            }
+        }
+    }
+    return patterns;
+}
+
+// ================================================================
+// Layers
+// ================================================================
+
+typedef struct {
+    uint32_t pattern;
+    const TSLanguage *language;
+    TSRange *ranges;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t bytes;
+    TSTree *tree;
+} Layer;
+
+typedef struct {
+    Layer *items;
+    size_t count;
+    size_t capacity;
+    size_t skipped; // matches whose language was not loaded
+} LayerList;
+
+static Layer *layer_new(LayerList *list, uint32_t pattern, const TSLanguage *language) {
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 16;
+        list->items = realloc(list->items, list->capacity * sizeof(Layer));
+    }
+    Layer *layer = &list->items[list->count++];
+    memset(layer, 0, sizeof(*layer));
+    layer->pattern = pattern;
+    layer->language = language;
+    return layer;
+}
+
+static void layer_push(Layer *layer, TSNode node) {
+    if (layer->count == layer->capacity) {
+        layer->capacity = layer->capacity ? layer->capacity * 2 : 4;
+        layer->ranges = realloc(layer->ranges, layer->capacity * sizeof(TSRange));
+    }
+    layer->ranges[layer->count++] = (TSRange){
+        .start_point = ts_node_start_point(node),
+        .end_point = ts_node_end_point(node),
+        .start_byte = ts_node_start_byte(node),
+        .end_byte = ts_node_end_byte(node),
+    };
+    layer->bytes += ts_node_end_byte(node) - ts_node_start_byte(node);
+}
+
+static void collect_layers(LayerList *list, TSQueryCursor *cursor, const TSQuery *query,
+                           const PatternInfo *patterns, uint32_t content_id, TSTree *tree) {
+    TSQueryMatch match;
+    ts_query_cursor_exec(cursor, query, ts_tree_root_node(tree));
+    while (ts_query_cursor_next_match(cursor, &match)) {
+        const PatternInfo *info = &patterns[match.pattern_index];
+        const TSLanguage *language = find_language(info->language);
+        if (!language) {
+            list->skipped++;
+            continue;
+        }
+
+        Layer *layer = NULL;
+        if (info->combined) {
+            for (size_t i = 0; i < list->count; i++) {
+                if (list->items[i].pattern == match.pattern_index) layer = &list->items[i];
+            }
+        }
+        if (!layer) layer = layer_new(list, match.pattern_index, language);
+        for (uint16_t c = 0; c < match.capture_count; c++) {
+            if (match.captures[c].index == content_id) layer_push(layer, match.captures[c].node);
+        }
+    }
+}
+
+static void layers_free(LayerList *list) {
+    for (size_t i = 0; i < list->count; i++) {
+        free(list->items[i].ranges);
+        if (list->items[i].tree) ts_tree_delete(list->items[i].tree);
+    }
+    free(list->items);
+    memset(list, 0, sizeof(*list));
+}
+
+static TSTree *parse_layer(TSParser *parser, const Layer *layer, const TSRange *ranges,
+                           TSTree *old_tree, const char *source, uint32_t length) {
+    ts_parser_set_language(parser, layer->language);
+    ts_parser_set_included_ranges(parser, ranges, layer->count);
+    return ts_parser_parse_string(parser, old_tree, source, length);
+}
+
+// ================================================================
+// Edits
+// ================================================================
+
+static TSPoint shift_point(TSPoint point, TSPoint at) {
+    if (point.row == at.row && point.column >= at.column) point.column++;
+    return point;
+}
+
+// Time reparsing layer after a space is typed at the start of range r
+static double time_edit(TSParser *parser, const Layer *layer, uint32_t r,
+                        const char *source, uint32_t length, int iterations) {
+    const TSRange *target = &layer->ranges[r];
+    uint32_t at = target->start_byte;
+    TSPoint point = target->start_point;
+
+    char *edited = malloc(length + 2);
+    memcpy(edited, source, at);
+    edited[at] = ' ';
+    memcpy(edited + at + 1, source + at, length - at + 1);
+
+    TSRange *ranges = malloc(layer->count * sizeof(TSRange));
+    for (uint32_t i = 0; i < layer->count; i++) {
+        ranges[i] = layer->ranges[i];
+        if (i > r) {
+            ranges[i].start_byte++;
+            ranges[i].start_point = shift_point(ranges[i].start_point, point);
+        }
+        if (i >= r) {
+            ranges[i].end_byte++;
+            ranges[i].end_point = shift_point(ranges[i].end_point, point);
+        }
+    }
+
+    TSInputEdit edit = {
+        .start_byte = at,
+        .old_end_byte = at,
+        .new_end_byte = at + 1,
+        .start_point = point,
+        .old_end_point = point,
+        .new_end_point = {point.row, point.column + 1},
+    };
+
+    double best = -1;
+    for (int i = 0; i < iterations; i++) {
+        TSTree *old_tree = ts_tree_copy(layer->tree);
+        ts_tree_edit(old_tree, &edit);
+        double start = bench_now();
+        TSTree *tree = parse_layer(parser, layer, ranges, old_tree, edited, length + 1);
+        double elapsed = bench_now() - start;
+        if (best < 0 || elapsed < best) best = elapsed;
+        ts_tree_delete(tree);
+        ts_tree_delete(old_tree);
+    }
+    free(ranges);
+    free(edited);
+    return best;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+typedef struct {
+    size_t layers;
+    size_t skipped;
+    double full_seconds;
+    size_t edits;
+    double p50_seconds;
+    double p99_seconds;
+    double mean_seconds;
+    double mean_layer_bytes;
+} InjectionRun;
+
+static void print_json(const char *query, const char *file, const InjectionRun *r) {
+    printf("{\"query\":");
+    bench_print_json_string(stdout, query);
+    printf(",\"file\":");
+    bench_print_json_string(stdout, file);
+    printf(",\"layers\":%zu,\"skipped\":%zu,\"full_us\":%.1f,\"edits\":%zu,"
+           "\"p50_us\":%.1f,\"p99_us\":%.1f,\"mean_us\":%.1f,\"mean_layer_bytes\":%.0f}\n",
+           r->layers, r->skipped, r->full_seconds * 1e6, r->edits, r->p50_seconds * 1e6,
+           r->p99_seconds * 1e6, r->mean_seconds * 1e6, r->mean_layer_bytes);
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: injection-bench [-n iterations] [--json] -l name=lib.so [-l ...] "
+                    "-q injections.scm [-q ...] path...\n");
+}
+
+int main(int argc, char **argv) {
+    int iterations = 10;
+    bool json = false;
+    const char **queries = calloc((size_t)argc, sizeof(char *));
+    size_t query_count = 0;
+    BenchFileList paths = {0};
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-q") == 0 && i + 1 < argc) {
+            queries[query_count++] = argv[++i];
+        } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            if (!load_language(argv[++i])) {
+                usage();
+                return 2;
+            }
+        } else if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (argv[i][0] == '-') {
+            usage();
+            return 2;
+        } else {
+            bench_collect_sources(&paths, argv[i]);
+        }
+    }
+    if (paths.count == 0 || query_count == 0 || iterations < 1) {
+        usage();
+        return 2;
+    }
+    if (language_count == 0) {
+        fprintf(stderr, "warning: no injected languages loaded (-l), every layer is skipped\n");
+    }
+
+    TSParser *parsley = ts_parser_new();
+    if (!ts_parser_set_language(parsley, tree_sitter_parsley())) {
+        fprintf(stderr, "error: incompatible tree-sitter runtime\n");
+        return 1;
+    }
+    TSParser *parser = ts_parser_new();
+    TSQueryCursor *cursor = ts_query_cursor_new();
+
+    if (!json) {
+        printf("%-44s %-36s %6s %7s %10s %6s %9s %9s %9s %10s\n", "query", "file", "layers",
+               "skipped", "full_us", "edits", "p50_us", "p99_us", "mean_us", "layer_B");
+    }
+
+    int status = 0;
+    for (size_t q = 0; q < query_count; q++) {
+        uint32_t query_length = 0;
+        char *text = bench_read_file(queries[q], &query_length);
+        if (!text) {
+            fprintf(stderr, "error: cannot read %s\n", queries[q]);
+            status = 1;
+            continue;
+        }
+        uint32_t error_offset;
+        TSQueryError error_type;
+        TSQuery *query = ts_query_new(tree_sitter_parsley(), text, query_length,
+                                      &error_offset, &error_type);
+        free(text);
+        if (!query) {
+            fprintf(stderr, "error: %s: query error %d at offset %u\n",
+                    queries[q], (int)error_type, error_offset);
+            status = 1;
+            continue;
+        }
+        PatternInfo *patterns = read_patterns(query);
+        uint32_t content_id = UINT32_MAX;
+        for (uint32_t c = 0; c < ts_query_capture_count(query); c++) {
+            uint32_t length;
+            const char *name = ts_query_capture_name_for_id(query, c, &length);
+            if (strcmp(name, "injection.content") == 0) content_id = c;
+        }
+
+        for (size_t f = 0; f < paths.count; f++) {
+            uint32_t length = 0;
+            char *source = bench_read_file(paths.paths[f], &length);
+            if (!source) {
+                fprintf(stderr, "warning: cannot read %s\n", paths.paths[f]);
+                continue;
+            }
+            TSTree *tree = ts_parser_parse_string(parsley, NULL, source, length);
+
+            LayerList layers = {0};
+            collect_layers(&layers, cursor, query, patterns, content_id, tree);
+
+            InjectionRun run = {.layers = layers.count, .skipped = layers.skipped};
+            run.full_seconds = -1;
+            for (int i = 0; i < iterations; i++) {
+                double start = bench_now();
+                for (size_t l = 0; l < layers.count; l++) {
+                    Layer *layer = &layers.items[l];
+                    if (layer->tree) ts_tree_delete(layer->tree);
+                    layer->tree = parse_layer(parser, layer, layer->ranges, NULL, source, length);
+                }
+                double elapsed = bench_now() - start;
+                if (run.full_seconds < 0 || elapsed < run.full_seconds) run.full_seconds = elapsed;
+            }
+
+            size_t sites = 0;
+            for (size_t l = 0; l < layers.count; l++) sites += layers.items[l].count;
+            double *times = calloc(sites ? sites : 1, sizeof(double));
+            double layer_bytes = 0;
+            for (size_t l = 0; l < layers.count; l++) {
+                for (uint32_t r = 0; r < layers.items[l].count; r++) {
+                    times[run.edits] = time_edit(parser, &layers.items[l], r, source, length, iterations);
+                    run.mean_seconds += times[run.edits];
+                    layer_bytes += layers.items[l].bytes;
+                    run.edits++;
+                }
+            }
+            if (run.edits > 0) {
+                qsort(times, run.edits, sizeof(double), compare_doubles);
+                run.p50_seconds = times[run.edits / 2];
+                run.p99_seconds = times[(run.edits * 99) / 100];
+                run.mean_seconds /= run.edits;
+                run.mean_layer_bytes = layer_bytes / run.edits;
+            }
+            free(times);
+
+            if (json) {
+                print_json(queries[q], paths.paths[f], &run);
+            } else {
+                printf("%-44s %-36s %6zu %7zu %10.1f %6zu %9.1f %9.1f %9.1f %10.0f\n", queries[q],
+                       paths.paths[f], run.layers, run.skipped, run.full_seconds * 1e6, run.edits,
+                       run.p50_seconds * 1e6, run.p99_seconds * 1e6, run.mean_seconds * 1e6,
+                       run.mean_layer_bytes);
+            }
+            layers_free(&layers);
+            ts_tree_delete(tree);
+            free(source);
+        }
+        free(patterns);
+        ts_query_delete(query);
+    }
+
+    ts_query_cursor_delete(cursor);
+    ts_parser_delete(parser);
+    ts_parser_delete(parsley);
+    free(queries);
+    bench_list_free(&paths);
+    return status;
+}
@@ -0,0 +1,186 @@
+/**
+ * Cold parse throughput benchmark for tree-sitter-parsley
+ *
+ * Parses every .pars/.part file under the given paths with src/parser.c +
+ * src/scanner.c linked against the tree-sitter runtime, and reports per file:
+ * - throughput in bytes/sec and nodes/sec (best of N parses)
+ * - tree memory (bytes retained by the tree) and peak runtime memory
+ * - ERROR and MISSING node counts
+ *
+ * Usage: parse-bench [-n iterations] [--json] path...
+ *
+ * --json prints one JSON object per file plus a final "total" object, with
+ * a fixed key order, so runs can be diffed across grammar changes.
+ */
+
+#include "bench_util.h"
+
+typedef struct {
+    uint32_t bytes;
+    uint64_t nodes;
+    uint64_t errors;
+    uint64_t missing;
+    double best_seconds;
+    size_t tree_bytes;
+    size_t peak_bytes;
+} ParseResult;
+
+// Count every node in the tree, plus ERROR and MISSING nodes
+static void count_nodes(TSTree *tree, ParseResult *result) {
+    TSTreeCursor cursor = ts_tree_cursor_new(ts_tree_root_node(tree));
+    for (;;) {
+        TSNode node = ts_tree_cursor_current_node(&cursor);
+        result->nodes++;
+        if (ts_node_is_error(node)) result->errors++;
+        if (ts_node_is_missing(node)) result->missing++;
+
+        if (ts_tree_cursor_goto_first_child(&cursor)) continue;
+        while (!ts_tree_cursor_goto_next_sibling(&cursor)) {
+            if (!ts_tree_cursor_goto_parent(&cursor)) {
+                ts_tree_cursor_delete(&cursor);
+                return;
+            }
+        }
+    }
+}
+
+static bool bench_file(
+    TSParser *parser,
+    const char *path,
+    int iterations,
+    ParseResult *result
+) {
+    uint32_t length = 0;
+    char *source = bench_read_file(path, &length);
+    if (!source) {
+        fprintf(stderr, "warning: cannot read %s\n", path);
+        return false;
+    }
+
+    memset(result, 0, sizeof(*result));
+    result->bytes = length;
+    result->best_seconds = -1;
+
+    for (int i = 0; i < iterations; i++) {
+        size_t live_before = bench_live_bytes;
+        bench_reset_peak();
+
+        double start = bench_now();
+        TSTree *tree = ts_parser_parse_string(parser, NULL, source, length);
+        double elapsed = bench_now() - start;
+
+        if (result->best_seconds < 0 || elapsed < result->best_seconds) {
+            result->best_seconds = elapsed;
+        }
+        if (bench_peak_bytes - live_before > result->peak_bytes) {
+            result->peak_bytes = bench_peak_bytes - live_before;
+        }
+
+        if (i == 0) {
+            count_nodes(tree, result);
+        }
+
+        size_t live_with_tree = bench_live_bytes;
+        ts_tree_delete(tree);
+        result->tree_bytes = live_with_tree - bench_live_bytes;
+    }
+
+    free(source);
+    return true;
+}
+
+static double per_second(double amount, double seconds) {
+    return seconds > 0 ? amount / seconds : 0;
+}
+
+static void print_json(const char *label, const ParseResult *r) {
+    printf("{\"file\":");
+    bench_print_json_string(stdout, label);
+    printf(",\"bytes\":%u,\"nodes\":%llu,\"errors\":%llu,\"missing\":%llu"
+           ",\"tree_bytes\":%zu,\"peak_bytes\":%zu"
+           ",\"best_us\":%.1f,\"bytes_per_sec\":%.0f,\"nodes_per_sec\":%.0f}\n",
+           r->bytes, (unsigned long long)r->nodes,
+           (unsigned long long)r->errors, (unsigned long long)r->missing,
+           r->tree_bytes, r->peak_bytes, r->best_seconds * 1e6,
+           per_second(r->bytes, r->best_seconds),
+           per_second((double)r->nodes, r->best_seconds));
+}
+
+static void print_row(const char *label, const ParseResult *r) {
+    printf("%-60s %9u %8llu %6llu %6llu %10zu %10zu %9.2f %10.0f\n",
+           label, r->bytes, (unsigned long long)r->nodes,
+           (unsigned long long)r->errors, (unsigned long long)r->missing,
+           r->tree_bytes, r->peak_bytes,
+           per_second(r->bytes, r->best_seconds) / 1e6,
+           per_second((double)r->nodes, r->best_seconds));
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: parse-bench [-n iterations] [--json] path...\n");
+}
+
+int main(int argc, char **argv) {
+    int iterations = 10;
+    bool json = false;
+    BenchFileList files = {0};
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (argv[i][0] == '-') {
+            usage();
+            return 2;
+        } else {
+            bench_collect_sources(&files, argv[i]);
+        }
+    }
+    if (files.count == 0 || iterations < 1) {
+        usage();
+        return 2;
+    }
+
+    bench_install_allocator();
+    TSParser *parser = ts_parser_new();
+    if (!ts_parser_set_language(parser, tree_sitter_parsley())) {
+        fprintf(stderr, "error: incompatible tree-sitter runtime\n");
+        return 1;
+    }
+
+    if (!json) {
+        printf("%-60s %9s %8s %6s %6s %10s %10s %9s %10s\n",
+               "file", "bytes", "nodes", "errors", "miss",
+               "tree_B", "peak_B", "MB/s", "nodes/s");
+    }
+
+    ParseResult total = {0};
+    for (size_t i = 0; i < files.count; i++) {
+        ParseResult r;
+        if (!bench_file(parser, files.paths[i], iterations, &r)) continue;
+
+        total.bytes += r.bytes;
+        total.nodes += r.nodes;
+        total.errors += r.errors;
+        total.missing += r.missing;
+        total.tree_bytes += r.tree_bytes;
+        if (r.peak_bytes > total.peak_bytes) total.peak_bytes = r.peak_bytes;
+        total.best_seconds += r.best_seconds;
+
+        if (json) {
+            print_json(files.paths[i], &r);
+        } else {
+            print_row(files.paths[i], &r);
+        }
+    }
+
+    if (json) {
+        print_json("total", &total);
+    } else {
+        print_row("total", &total);
+    }
+
+    ts_parser_delete(parser);
+    bench_list_free(&files);
+    return 0;
+}
@@ -0,0 +1,466 @@
+/**
+ * Parse profiler for tree-sitter-parsley
+ *
+ * Explains where parse time goes for a template, using an instrumentation
+ * build of the external scanner (-DTREE_SITTER_PARSLEY_SCANNER_STATS, see
+ * src/scanner_stats.h) and the runtime's parse log. For each file it parses
+ * once silently for timing and once with a logger installed, and reports:
+ * - parse time, parse steps and the most stack versions alive at once
+ * - GLR stack splits: how often the number of stack versions grew
+ * - reductions done while the stack was split, attributed to the grammar's
+ *   `conflicts` groups so an ambiguity can be traced to its rule
+ * - error recovery events (detect_error, recover_*, skip_*, resume)
+ * - external scanner calls and bytes per external token
+ * followed by totals: the hottest parse states, the conflict groups and
+ * the scanner table.
+ *
+ * Usage: parse-profile [-g grammar.json] [--top N] [--log file] [--json] path...
+ *
+ * -g reads the conflicts array from src/grammar.json. --log writes the raw
+ * parse log too, one line per event, for reading a single file in detail.
+ * --json prints one JSON object per file plus a final "total" object.
+ */
+
+#include "bench_util.h"
+#include "scanner_stats.h"
+
+#define MAX_CONFLICTS 64
+#define MAX_CONFLICT_SYMBOLS 8
+#define MAX_EVENT_KINDS 64
+
+typedef struct {
+    int count;
+    char *names[MAX_CONFLICT_SYMBOLS];
+    TSSymbol symbols[MAX_CONFLICT_SYMBOLS];
+} Conflict;
+
+typedef struct {
+    char name[32];
+    uint64_t count;
+} EventKind;
+
+// Counters for one file, or for all of them
+typedef struct {
+    double parse_seconds;
+    uint32_t bytes;
+    uint64_t steps;             // "process" events: one per version per step
+    uint32_t max_versions;
+    uint64_t splits;            // times the version count grew
+    uint64_t forked_reductions; // reductions while more than one version lived
+    uint64_t recoveries;        // error recovery events
+    uint64_t scanner_calls;
+    uint64_t scanner_bytes;
+} FileProfile;
+
+typedef struct {
+    const TSLanguage *language;
+    FILE *log;
+
+    // Per-file state while the logger runs
+    FileProfile *file;
+    uint32_t versions;
+
+    // Totals across files, indexed by state or symbol
+    uint64_t *state_steps;
+    uint64_t *state_forked;
+    uint32_t state_count;
+    uint64_t *symbol_forked;
+    uint32_t symbol_count;
+
+    Conflict conflicts[MAX_CONFLICTS];
+    int conflict_count;
+    EventKind events[MAX_EVENT_KINDS];
+    int event_count;
+} Profiler;
+
+// ================================================================
+// grammar.json conflicts
+// ================================================================
+
+static const char *skip_space(const char *p) {
+    while (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t') p++;
+    return p;
+}
+
+// Look up a rule name; hidden rules are named symbols that are not visible
+static TSSymbol symbol_for_name(const TSLanguage *language, const char *name) {
+    TSSymbol symbol = ts_language_symbol_for_name(language, name, (uint32_t)strlen(name), true);
+    if (!symbol) {
+        symbol = ts_language_symbol_for_name(language, name, (uint32_t)strlen(name), false);
+    }
+    return symbol;
+}
+
+// Read "conflicts": [["a", "b"], ...] from grammar.json. Only this one
+// array is needed, so it is found by name rather than parsing the file.
+static void load_conflicts(Profiler *profiler, const char *path) {
+    uint32_t length = 0;
+    char *json = bench_read_file(path, &length);
+    if (!json) {
+        fprintf(stderr, "warning: cannot read %s; conflicts not reported\n", path);
+        return;
+    }
+    const char *p = strstr(json, "\"conflicts\"");
+    if (p) p = strchr(p, '[');
+    if (!p) {
+        free(json);
+        return;
+    }
+    p = skip_space(p + 1);
+    while (*p == '[' && profiler->conflict_count < MAX_CONFLICTS) {
+        Conflict *conflict = &profiler->conflicts[profiler->conflict_count++];
+        p = skip_space(p + 1);
+        while (*p == '"') {
+            const char *end = strchr(p + 1, '"');
+            if (!end) break;
+            if (conflict->count < MAX_CONFLICT_SYMBOLS) {
+                char *name = strndup(p + 1, (size_t)(end - p - 1));
+                conflict->names[conflict->count] = name;
+                conflict->symbols[conflict->count] = symbol_for_name(profiler->language, name);
+                conflict->count++;
+            }
+            p = skip_space(end + 1);
+            if (*p == ',') p = skip_space(p + 1);
+        }
+        if (*p == ']') p = skip_space(p + 1);
+        if (*p == ',') p = skip_space(p + 1);
+    }
+    free(json);
+}
+
+// ================================================================
+// Parse log
+// ================================================================
+
+static bool starts_with(const char *text, const char *prefix) {
+    return strncmp(text, prefix, strlen(prefix)) == 0;
+}
+
+static bool is_recovery(const char *message) {
+    return starts_with(message, "detect_error") || starts_with(message, "recover") ||
+           starts_with(message, "skip_") || starts_with(message, "resume");
+}
+
+static void count_event(Profiler *profiler, const char *message) {
+    size_t length = strcspn(message, " ");
+    if (length >= sizeof(profiler->events[0].name)) length = sizeof(profiler->events[0].name) - 1;
+    for (int i = 0; i < profiler->event_count; i++) {
+        EventKind *kind = &profiler->events[i];
+        if (strlen(kind->name) == length && strncmp(kind->name, message, length) == 0) {
+            kind->count++;
+            return;
+        }
+    }
+    if (profiler->event_count < MAX_EVENT_KINDS) {
+        EventKind *kind = &profiler->events[profiler->event_count++];
+        memcpy(kind->name, message, length);
+        kind->name[length] = '\0';
+        kind->count = 1;
+    }
+}
+
+// Parse events look like "process version:0, version_count:1, state:12,
+// row:0, col:4" and "reduce sym:block, child_count:3"
+static void on_log(void *payload, TSLogType type, const char *message) {
+    Profiler *profiler = payload;
+    if (profiler->log) fprintf(profiler->log, "%s %s\n", type == TSLogTypeLex ? "lex" : "parse", message);
+    if (type != TSLogTypeParse) return;
+
+    FileProfile *file = profiler->file;
+    if (starts_with(message, "process ")) {
+        unsigned version = 0, versions = 0;
+        int state = 0;
+        if (sscanf(message, "process version:%u, version_count:%u, state:%d", &version, &versions, &state) == 3) {
+            file->steps++;
+            if (versions > profiler->versions) file->splits += versions - profiler->versions;
+            profiler->versions = versions;
+            if (versions > file->max_versions) file->max_versions = versions;
+            if (state >= 0 && (uint32_t)state < profiler->state_count) {
+                profiler->state_steps[state]++;
+                if (versions > 1) profiler->state_forked[state]++;
+            }
+        }
+        return;
+    }
+
+    count_event(profiler, message);
+    if (is_recovery(message)) {
+        file->recoveries++;
+    } else if (starts_with(message, "reduce sym:") && profiler->versions > 1) {
+        file->forked_reductions++;
+        const char *name = message + strlen("reduce sym:");
+        char buffer[128];
+        size_t length = strcspn(name, ",");
+        if (length >= sizeof(buffer)) length = sizeof(buffer) - 1;
+        memcpy(buffer, name, length);
+        buffer[length] = '\0';
+        TSSymbol symbol = symbol_for_name(profiler->language, buffer);
+        if (symbol && symbol < profiler->symbol_count) profiler->symbol_forked[symbol]++;
+    }
+}
+
+// ================================================================
+// Profiling
+// ================================================================
+
+static bool profile_file(Profiler *profiler, TSParser *parser, const char *path, FileProfile *file) {
+    uint32_t length = 0;
+    char *source = bench_read_file(path, &length);
+    if (!source) {
+        fprintf(stderr, "warning: cannot read %s\n", path);
+        return false;
+    }
+    memset(file, 0, sizeof(*file));
+    file->bytes = length;
+
+    // Timed without the logger, which costs more than the parse itself
+    ParsleyScannerStats before = *tree_sitter_parsley_external_scanner_stats();
+    double start = bench_now();
+    TSTree *tree = ts_parser_parse_string(parser, NULL, source, length);
+    file->parse_seconds = bench_now() - start;
+    ts_tree_delete(tree);
+
+    const ParsleyScannerStats *after = tree_sitter_parsley_external_scanner_stats();
+    file->scanner_calls = after->calls - before.calls;
+    for (int i = 0; i < PARSLEY_SCANNER_TOKEN_COUNT; i++) {
+        file->scanner_bytes += after->tokens[i].bytes - before.tokens[i].bytes;
+    }
+
+    profiler->file = file;
+    profiler->versions = 1;
+    if (profiler->log) fprintf(profiler->log, "file %s\n", path);
+    ts_parser_set_logger(parser, (TSLogger){.payload = profiler, .log = on_log});
+    tree = ts_parser_parse_string(parser, NULL, source, length);
+    ts_parser_set_logger(parser, (TSLogger){0});
+    ts_tree_delete(tree);
+
+    free(source);
+    return true;
+}
+
+static void print_file_json(const char *path, const FileProfile *file) {
+    printf("{\"file\": ");
+    bench_print_json_string(stdout, path);
+    printf(", \"bytes\": %u, \"parse_us\": %.1f, \"steps\": %llu, \"max_versions\": %u, "
+           "\"splits\": %llu, \"forked_reductions\": %llu, \"recoveries\": %llu, "
+           "\"scanner_calls\": %llu, \"scanner_bytes\": %llu}\n",
+           file->bytes, file->parse_seconds * 1e6, (unsigned long long)file->steps,
+           file->max_versions, (unsigned long long)file->splits,
+           (unsigned long long)file->forked_reductions, (unsigned long long)file->recoveries,
+           (unsigned long long)file->scanner_calls, (unsigned long long)file->scanner_bytes);
+}
+
+static void print_file_text(const char *path, const FileProfile *file) {
+    printf("%-48s %8u %10.1f %8llu %5u %7llu %8llu %6llu %8llu %9llu\n",
+           path, file->bytes, file->parse_seconds * 1e6, (unsigned long long)file->steps,
+           file->max_versions, (unsigned long long)file->splits,
+           (unsigned long long)file->forked_reductions, (unsigned long long)file->recoveries,
+           (unsigned long long)file->scanner_calls, (unsigned long long)file->scanner_bytes);
+}
+
+static uint64_t conflict_forked(const Profiler *profiler, const Conflict *conflict) {
+    uint64_t total = 0;
+    for (int i = 0; i < conflict->count; i++) {
+        TSSymbol symbol = conflict->symbols[i];
+        if (symbol && symbol < profiler->symbol_count) total += profiler->symbol_forked[symbol];
+    }
+    return total;
+}
+
+// Indices of the `top` largest counts, largest first
+static uint32_t top_indices(const uint64_t *counts, uint32_t count, uint32_t *out, uint32_t top) {
+    uint32_t found = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (!counts[i]) continue;
+        uint32_t at;
+        if (found < top) {
+            at = found++;
+        } else if (counts[i] > counts[out[top - 1]]) {
+            at = top - 1;
+        } else {
+            continue;
+        }
+        while (at > 0 && counts[out[at - 1]] < counts[i]) {
+            out[at] = out[at - 1];
+            at--;
+        }
+        out[at] = i;
+    }
+    return found;
+}
+
+static void print_totals(const Profiler *profiler, const FileProfile *total, uint32_t top, bool json) {
+    uint32_t *states = calloc(top, sizeof(uint32_t));
+    uint32_t state_count = top_indices(profiler->state_steps, profiler->state_count, states, top);
+    const ParsleyScannerStats *scanner = tree_sitter_parsley_external_scanner_stats();
+
+    if (json) {
+        printf("{\"total\": {\"bytes\": %u, \"parse_us\": %.1f, \"steps\": %llu, \"max_versions\": %u, "
+               "\"splits\": %llu, \"forked_reductions\": %llu, \"recoveries\": %llu}, \"states\": [",
+               total->bytes, total->parse_seconds * 1e6, (unsigned long long)total->steps,
+               total->max_versions, (unsigned long long)total->splits,
+               (unsigned long long)total->forked_reductions, (unsigned long long)total->recoveries);
+        for (uint32_t i = 0; i < state_count; i++) {
+            printf("%s{\"state\": %u, \"steps\": %llu, \"forked\": %llu}", i ? ", " : "", states[i],
+                   (unsigned long long)profiler->state_steps[states[i]],
+                   (unsigned long long)profiler->state_forked[states[i]]);
+        }
+        printf("], \"conflicts\": [");
+        for (int i = 0; i < profiler->conflict_count; i++) {
+            const Conflict *conflict = &profiler->conflicts[i];
+            printf("%s{\"symbols\": [", i ? ", " : "");
+            for (int j = 0; j < conflict->count; j++) {
+                if (j) printf(", ");
+                bench_print_json_string(stdout, conflict->names[j]);
+            }
+            printf("], \"forked_reductions\": %llu}", (unsigned long long)conflict_forked(profiler, conflict));
+        }
+        printf("], \"events\": {");
+        for (int i = 0; i < profiler->event_count; i++) {
+            if (i) printf(", ");
+            bench_print_json_string(stdout, profiler->events[i].name);
+            printf(": %llu", (unsigned long long)profiler->events[i].count);
+        }
+        printf("}, \"scanner\": {\"calls\": %llu, \"unhandled\": %llu, \"tokens\": [",
+               (unsigned long long)scanner->calls, (unsigned long long)scanner->unhandled);
+        for (int i = 0; i < PARSLEY_SCANNER_TOKEN_COUNT; i++) {
+            const ParsleyScannerTokenStats *token = &scanner->tokens[i];
+            printf("%s{\"token\": \"%s\", \"scans\": %llu, \"produced\": %llu, \"declined\": %llu, \"bytes\": %llu}",
+                   i ? ", " : "", token->name, (unsigned long long)token->scans,
+                   (unsigned long long)token->produced, (unsigned long long)token->declined,
+                   (unsigned long long)token->bytes);
+        }
+        printf("]}}\n");
+        free(states);
+        return;
+    }
+
+    print_file_text("total", total);
+
+    printf("\nhottest parse states\n%8s %10s %10s\n", "state", "steps", "forked");
+    for (uint32_t i = 0; i < state_count; i++) {
+        printf("%8u %10llu %10llu\n", states[i], (unsigned long long)profiler->state_steps[states[i]],
+               (unsigned long long)profiler->state_forked[states[i]]);
+    }
+
+    if (profiler->conflict_count) {
+        printf("\nreductions while split, by conflicts group\n");
+        for (int i = 0; i < profiler->conflict_count; i++) {
+            const Conflict *conflict = &profiler->conflicts[i];
+            printf("%10llu  [", (unsigned long long)conflict_forked(profiler, conflict));
+            for (int j = 0; j < conflict->count; j++) printf("%s%s", j ? ", " : "", conflict->names[j]);
+            printf("]\n");
+        }
+    }
+
+    printf("\nerror recovery\n");
+    bool any = false;
+    for (int i = 0; i < profiler->event_count; i++) {
+        if (is_recovery(profiler->events[i].name)) {
+            printf("%10llu  %s\n", (unsigned long long)profiler->events[i].count, profiler->events[i].name);
+            any = true;
+        }
+    }
+    if (!any) printf("%10s  none\n", "");
+
+    printf("\nexternal scanner: %llu calls, %llu declined without scanning\n",
+           (unsigned long long)scanner->calls, (unsigned long long)scanner->unhandled);
+    printf("%-30s %10s %10s %10s %12s\n", "token", "scans", "produced", "declined", "bytes");
+    for (int i = 0; i < PARSLEY_SCANNER_TOKEN_COUNT; i++) {
+        const ParsleyScannerTokenStats *token = &scanner->tokens[i];
+        printf("%-30s %10llu %10llu %10llu %12llu\n", token->name, (unsigned long long)token->scans,
+               (unsigned long long)token->produced, (unsigned long long)token->declined,
+               (unsigned long long)token->bytes);
+    }
+    free(states);
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: parse-profile [-g grammar.json] [--top N] [--log file] [--json] path...\n");
+}
+
+int main(int argc, char **argv) {
+    bool json = false;
+    uint32_t top = 10;
+    const char *grammar = NULL;
+    const char *log_path = NULL;
+    BenchFileList files = {0};
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (strcmp(argv[i], "--top") == 0 && i + 1 < argc) {
+            top = (uint32_t)atoi(argv[++i]);
+            if (top == 0) top = 1;
+        } else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
+            grammar = argv[++i];
+        } else if (strcmp(argv[i], "--log") == 0 && i + 1 < argc) {
+            log_path = argv[++i];
+        } else if (argv[i][0] == '-') {
+            usage();
+            return 2;
+        } else {
+            bench_collect_sources(&files, argv[i]);
+        }
+    }
+    if (files.count == 0) {
+        usage();
+        return 2;
+    }
+
+    Profiler profiler = {.language = tree_sitter_parsley()};
+    profiler.state_count = ts_language_state_count(profiler.language);
+    profiler.symbol_count = ts_language_symbol_count(profiler.language);
+    profiler.state_steps = calloc(profiler.state_count, sizeof(uint64_t));
+    profiler.state_forked = calloc(profiler.state_count, sizeof(uint64_t));
+    profiler.symbol_forked = calloc(profiler.symbol_count, sizeof(uint64_t));
+    if (grammar) load_conflicts(&profiler, grammar);
+    if (log_path) {
+        profiler.log = fopen(log_path, "w");
+        if (!profiler.log) {
+            fprintf(stderr, "cannot write %s\n", log_path);
+            return 1;
+        }
+    }
+
+    TSParser *parser = ts_parser_new();
+    ts_parser_set_language(parser, profiler.language);
+    tree_sitter_parsley_external_scanner_reset_stats();
+
+    if (!json) {
+        printf("%-48s %8s %10s %8s %5s %7s %8s %6s %8s %9s\n", "file", "bytes", "parse_us", "steps",
+               "vers", "splits", "forked", "recov", "scans", "scan_b");
+    }
+
+    FileProfile total = {0};
+    for (size_t i = 0; i < files.count; i++) {
+        FileProfile file;
+        if (!profile_file(&profiler, parser, files.paths[i], &file)) continue;
+        if (json) {
+            print_file_json(files.paths[i], &file);
+        } else {
+            print_file_text(files.paths[i], &file);
+        }
+        total.parse_seconds += file.parse_seconds;
+        total.bytes += file.bytes;
+        total.steps += file.steps;
+        if (file.max_versions > total.max_versions) total.max_versions = file.max_versions;
+        total.splits += file.splits;
+        total.forked_reductions += file.forked_reductions;
+        total.recoveries += file.recoveries;
+        total.scanner_calls += file.scanner_calls;
+        total.scanner_bytes += file.scanner_bytes;
+    }
+    print_totals(&profiler, &total, top, json);
+
+    ts_parser_delete(parser);
+    if (profiler.log) fclose(profiler.log);
+    for (int i = 0; i < profiler.conflict_count; i++) {
+        for (int j = 0; j < profiler.conflicts[i].count; j++) free(profiler.conflicts[i].names[j]);
+    }
+    free(profiler.state_steps);
+    free(profiler.state_forked);
+    free(profiler.symbol_forked);
+    bench_list_free(&files);
+    return 0;
+}
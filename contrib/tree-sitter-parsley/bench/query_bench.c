@@ -0,0 +1,183 @@
+/**
+ * Query execution benchmark for tree-sitter-parsley
+ *
+ * Parses every .pars/.part file under the given paths once, then runs each
+ * query file over every tree with a TSQueryCursor, draining captures the way
+ * a highlighter does. Reports per query:
+ * - compile time (best of N ts_query_new calls) and pattern count
+ * - execution time over each file (best of N cursor runs) and capture count
+ *
+ * Usage: query-bench [-n iterations] [--json] -q query.scm [-q ...] path...
+ *
+ * --json prints one JSON object per query and file plus one "total" object
+ * per query, with a fixed key order, so runs before and after a query change
+ * can be diffed.
+ */
+
+#include "bench_util.h"
+
+typedef struct {
+    const char *path;
+    char *source;
+    uint32_t length;
+    TSTree *tree;
+} SourceFile;
+
+typedef struct {
+    uint64_t captures;
+    double best_seconds;
+} QueryRun;
+
+// Run query over tree once and count its captures
+static uint64_t run_query(TSQueryCursor *cursor, const TSQuery *query, TSTree *tree) {
+    uint64_t count = 0;
+    TSQueryMatch match;
+    uint32_t capture_index;
+    ts_query_cursor_exec(cursor, query, ts_tree_root_node(tree));
+    while (ts_query_cursor_next_capture(cursor, &match, &capture_index)) {
+        count++;
+    }
+    return count;
+}
+
+static void print_json(const char *query, const char *label, uint32_t bytes, const QueryRun *r) {
+    printf("{\"query\":");
+    bench_print_json_string(stdout, query);
+    printf(",\"file\":");
+    bench_print_json_string(stdout, label);
+    printf(",\"bytes\":%u,\"captures\":%llu,\"best_us\":%.1f}\n",
+           bytes, (unsigned long long)r->captures, r->best_seconds * 1e6);
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: query-bench [-n iterations] [--json] -q query.scm [-q ...] path...\n");
+}
+
+int main(int argc, char **argv) {
+    int iterations = 10;
+    bool json = false;
+    const char **queries = calloc((size_t)argc, sizeof(char *));
+    size_t query_count = 0;
+    BenchFileList paths = {0};
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-q") == 0 && i + 1 < argc) {
+            queries[query_count++] = argv[++i];
+        } else if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (argv[i][0] == '-') {
+            usage();
+            return 2;
+        } else {
+            bench_collect_sources(&paths, argv[i]);
+        }
+    }
+    if (paths.count == 0 || query_count == 0 || iterations < 1) {
+        usage();
+        return 2;
+    }
+
+    TSParser *parser = ts_parser_new();
+    if (!ts_parser_set_language(parser, tree_sitter_parsley())) {
+        fprintf(stderr, "error: incompatible tree-sitter runtime\n");
+        return 1;
+    }
+
+    SourceFile *files = calloc(paths.count, sizeof(SourceFile));
+    size_t file_count = 0;
+    for (size_t i = 0; i < paths.count; i++) {
+        SourceFile *file = &files[file_count];
+        file->source = bench_read_file(paths.paths[i], &file->length);
+        if (!file->source) {
+            fprintf(stderr, "warning: cannot read %s\n", paths.paths[i]);
+            continue;
+        }
+        file->path = paths.paths[i];
+        file->tree = ts_parser_parse_string(parser, NULL, file->source, file->length);
+        file_count++;
+    }
+
+    if (!json) {
+        printf("%-60s %8s %10s %12s %12s %10s\n",
+               "query", "patterns", "compile_us", "captures", "exec_us", "MB/s");
+    }
+
+    TSQueryCursor *cursor = ts_query_cursor_new();
+    int status = 0;
+    for (size_t q = 0; q < query_count; q++) {
+        uint32_t length = 0;
+        char *text = bench_read_file(queries[q], &length);
+        if (!text) {
+            fprintf(stderr, "error: cannot read %s\n", queries[q]);
+            status = 1;
+            continue;
+        }
+
+        TSQuery *query = NULL;
+        double compile_seconds = -1;
+        for (int i = 0; i < iterations; i++) {
+            uint32_t error_offset;
+            TSQueryError error_type;
+            double start = bench_now();
+            TSQuery *compiled = ts_query_new(tree_sitter_parsley(), text, length,
+                                             &error_offset, &error_type);
+            double elapsed = bench_now() - start;
+            if (!compiled) {
+                fprintf(stderr, "error: %s: query error %d at offset %u\n",
+                        queries[q], (int)error_type, error_offset);
+                break;
+            }
+            if (compile_seconds < 0 || elapsed < compile_seconds) compile_seconds = elapsed;
+            if (query) ts_query_delete(query);
+            query = compiled;
+        }
+        free(text);
+        if (!query) {
+            status = 1;
+            continue;
+        }
+
+        QueryRun total = {0};
+        uint64_t total_bytes = 0;
+        for (size_t f = 0; f < file_count; f++) {
+            QueryRun run = {0};
+            run.best_seconds = -1;
+            for (int i = 0; i < iterations; i++) {
+                double start = bench_now();
+                uint64_t captures = run_query(cursor, query, files[f].tree);
+                double elapsed = bench_now() - start;
+                if (run.best_seconds < 0 || elapsed < run.best_seconds) run.best_seconds = elapsed;
+                run.captures = captures;
+            }
+            total.captures += run.captures;
+            total.best_seconds += run.best_seconds;
+            total_bytes += files[f].length;
+            if (json) print_json(queries[q], files[f].path, files[f].length, &run);
+        }
+
+        if (json) {
+            QueryRun compile = {0, compile_seconds};
+            print_json(queries[q], "compile", 0, &compile);
+            print_json(queries[q], "total", (uint32_t)total_bytes, &total);
+        } else {
+            printf("%-60s %8u %10.1f %12llu %12.1f %10.2f\n",
+                   queries[q], ts_query_pattern_count(query), compile_seconds * 1e6,
+                   (unsigned long long)total.captures, total.best_seconds * 1e6,
+                   total.best_seconds > 0 ? total_bytes / total.best_seconds / 1e6 : 0);
+        }
+        ts_query_delete(query);
+    }
+
+    ts_query_cursor_delete(cursor);
+    for (size_t f = 0; f < file_count; f++) {
+        ts_tree_delete(files[f].tree);
+        free(files[f].source);
+    }
+    free(files);
+    free(queries);
+    ts_parser_delete(parser);
+    bench_list_free(&paths);
+    return status;
+}
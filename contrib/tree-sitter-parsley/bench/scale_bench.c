@@ -0,0 +1,397 @@
+/**
+ * Parse-time scaling check for tree-sitter-parsley
+ *
+ * The grammar's `conflicts` and GLR error recovery can make some inputs
+ * parse in worse than linear time: deep nesting that stays ambiguous until
+ * its end, unterminated strings, half-typed tags. This benchmark generates
+ * families of such inputs from shape files (test/scaling/NAME.shape), parses
+ * each family at doubling sizes, and fits parse time against input size on
+ * a log-log scale. A slope of 1 is linear; a family whose slope is above the
+ * limit, or whose parse runs past the time budget, fails the run.
+ *
+ * Usage: scale-bench [-n iterations] [--json] [--limit SLOPE]
+ *                    [--budget-ms MS] [--emit COUNT] shape...
+ *
+ * --emit COUNT prints the input a shape generates at COUNT repeats instead
+ * of timing it, to feed to `tree-sitter parse` or `make profile`.
+ *
+ * Shape format, one directive per line (# starts a comment):
+ *
+ *   prefix "TEXT"    text before the repeats
+ *   open "TEXT"      repeated COUNT times after the prefix
+ *   middle "TEXT"    text after the opening repeats
+ *   close "TEXT"     repeated COUNT times after the middle
+ *   suffix "TEXT"    text at the end
+ *   sizes MIN MAX    repeat counts to try, doubling from MIN (default 64 4096)
+ *   limit SLOPE      this shape's own limit, for a known super-linear shape
+ *                    that must not get worse
+ *
+ * Strings accept \n, \t, \" and \\ escapes.
+ */
+
+#include "bench_util.h"
+
+#include <ctype.h>
+#include <math.h>
+
+#define SHAPE_TEXT_MAX 1024
+#define MAX_SIZES 32
+
+// Sizes whose best parse is faster than this are too noisy to fit
+#define MIN_FIT_SECONDS 20e-6
+
+typedef struct {
+    char prefix[SHAPE_TEXT_MAX], open[SHAPE_TEXT_MAX], middle[SHAPE_TEXT_MAX];
+    char close[SHAPE_TEXT_MAX], suffix[SHAPE_TEXT_MAX];
+    uint32_t min_count, max_count;
+    double limit; // 0 when the shape does not set one
+} Shape;
+
+typedef struct {
+    uint32_t count;
+    uint32_t bytes;
+    double best_seconds;
+    bool has_error;
+} Sample;
+
+typedef struct {
+    Sample samples[MAX_SIZES];
+    int sample_count;
+    double slope; // NAN with fewer than three samples to fit
+    double limit;
+    bool timed_out;
+} ScaleResult;
+
+// ================================================================
+// Shapes
+// ================================================================
+
+// Parse a double-quoted string argument with escapes. Returns false on error.
+static bool parse_string_arg(const char *p, char *out) {
+    while (isspace((unsigned char)*p)) p++;
+    if (*p++ != '"') return false;
+    uint32_t n = 0;
+    while (*p && *p != '"') {
+        char c = *p++;
+        if (c == '\\') {
+            c = *p++;
+            if (c == 'n') c = '\n';
+            else if (c == 't') c = '\t';
+            else if (c != '"' && c != '\\') return false;
+        }
+        if (n + 1 >= SHAPE_TEXT_MAX) return false;
+        out[n++] = c;
+    }
+    if (*p != '"') return false;
+    out[n] = '\0';
+    return true;
+}
+
+static bool read_shape(const char *path, Shape *shape) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "error: cannot read %s\n", path);
+        return false;
+    }
+    memset(shape, 0, sizeof(*shape));
+    shape->min_count = 64;
+    shape->max_count = 4096;
+
+    char line[4 * SHAPE_TEXT_MAX];
+    int line_number = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), file)) {
+        line_number++;
+        char *p = line;
+        while (isspace((unsigned char)*p)) p++;
+        if (*p == '\0' || *p == '#') continue;
+
+        char *arg = p;
+        while (*arg && !isspace((unsigned char)*arg)) arg++;
+        size_t word = (size_t)(arg - p);
+        char *text = NULL;
+        if (word == 6 && strncmp(p, "prefix", word) == 0) text = shape->prefix;
+        else if (word == 4 && strncmp(p, "open", word) == 0) text = shape->open;
+        else if (word == 6 && strncmp(p, "middle", word) == 0) text = shape->middle;
+        else if (word == 5 && strncmp(p, "close", word) == 0) text = shape->close;
+        else if (word == 6 && strncmp(p, "suffix", word) == 0) text = shape->suffix;
+
+        if (text) {
+            ok = parse_string_arg(arg, text);
+        } else if (word == 5 && strncmp(p, "sizes", word) == 0) {
+            unsigned min = 0, max = 0;
+            ok = sscanf(arg, "%u %u", &min, &max) == 2 && min > 0 && max >= min;
+            shape->min_count = min;
+            shape->max_count = max;
+        } else if (word == 5 && strncmp(p, "limit", word) == 0) {
+            ok = sscanf(arg, "%lf", &shape->limit) == 1 && shape->limit > 0;
+        } else {
+            ok = false;
+        }
+        if (!ok) fprintf(stderr, "error: %s:%d: bad directive\n", path, line_number);
+    }
+    fclose(file);
+    if (ok && shape->open[0] == '\0' && shape->close[0] == '\0') {
+        fprintf(stderr, "error: %s: nothing to repeat (no open or close)\n", path);
+        ok = false;
+    }
+    return ok;
+}
+
+// The input `shape` generates at `count` repeats, NUL-terminated
+static char *generate(const Shape *shape, uint32_t count, uint32_t *length) {
+    size_t open = strlen(shape->open), close = strlen(shape->close);
+    size_t size = strlen(shape->prefix) + strlen(shape->middle) + strlen(shape->suffix) +
+                  (open + close) * count;
+    if (size > UINT32_MAX) return NULL;
+    char *text = malloc(size + 1);
+    if (!text) return NULL;
+
+    char *p = text;
+    p = stpcpy(p, shape->prefix);
+    for (uint32_t i = 0; i < count; i++, p += open) memcpy(p, shape->open, open);
+    p = stpcpy(p, shape->middle);
+    for (uint32_t i = 0; i < count; i++, p += close) memcpy(p, shape->close, close);
+    stpcpy(p, shape->suffix);
+    *length = (uint32_t)size;
+    return text;
+}
+
+// ================================================================
+// Timing
+// ================================================================
+
+typedef struct {
+    const char *text;
+    uint32_t length;
+} StringInput;
+
+static const char *read_string(void *payload, uint32_t byte, TSPoint position, uint32_t *bytes_read) {
+    (void)position;
+    const StringInput *input = payload;
+    if (byte >= input->length) {
+        *bytes_read = 0;
+        return "";
+    }
+    *bytes_read = input->length - byte;
+    return input->text + byte;
+}
+
+// The progress callback returns true to abandon the parse
+typedef struct {
+    double deadline;
+    bool expired;
+} Budget;
+
+static bool over_budget(TSParseState *state) {
+    Budget *budget = state->payload;
+    if (bench_now() > budget->deadline) budget->expired = true;
+    return budget->expired;
+}
+
+// Best of `iterations` parses of text. Returns false if a parse ran past the
+// budget, which is what a super-linear shape does at its larger sizes.
+static bool time_parse(
+    TSParser *parser,
+    const char *text,
+    uint32_t length,
+    int iterations,
+    double budget_seconds,
+    Sample *sample
+) {
+    StringInput string = {text, length};
+    TSInput input = {&string, read_string, TSInputEncodingUTF8, NULL};
+    sample->best_seconds = -1;
+    for (int i = 0; i < iterations; i++) {
+        Budget budget = {bench_now() + budget_seconds, false};
+        TSParseOptions options = {&budget, over_budget};
+
+        double start = bench_now();
+        TSTree *tree = ts_parser_parse_with_options(parser, NULL, input, options);
+        double elapsed = bench_now() - start;
+        if (!tree) {
+            ts_parser_reset(parser);
+            return false;
+        }
+        if (sample->best_seconds < 0 || elapsed < sample->best_seconds) {
+            sample->best_seconds = elapsed;
+        }
+        sample->has_error = ts_node_has_error(ts_tree_root_node(tree));
+        ts_tree_delete(tree);
+    }
+    return true;
+}
+
+// Least-squares slope of log(time) against log(bytes) over the samples slow
+// enough to measure
+static double fit_slope(const ScaleResult *r) {
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    int n = 0;
+    for (int i = 0; i < r->sample_count; i++) {
+        const Sample *s = &r->samples[i];
+        if (s->best_seconds < MIN_FIT_SECONDS) continue;
+        double x = log((double)s->bytes), y = log(s->best_seconds);
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+        n++;
+    }
+    if (n < 3) return NAN;
+    return (n * sxy - sx * sy) / (n * sxx - sx * sx);
+}
+
+static bool run_shape(
+    TSParser *parser,
+    const Shape *shape,
+    int iterations,
+    double budget_seconds,
+    ScaleResult *result
+) {
+    memset(result, 0, sizeof(*result));
+    for (uint32_t count = shape->min_count;
+         count <= shape->max_count && result->sample_count < MAX_SIZES;
+         count *= 2) {
+        Sample *sample = &result->samples[result->sample_count];
+        uint32_t length = 0;
+        char *text = generate(shape, count, &length);
+        if (!text) {
+            fprintf(stderr, "error: input too large at %u repeats\n", count);
+            return false;
+        }
+        sample->count = count;
+        sample->bytes = length;
+        bool finished = time_parse(parser, text, length, iterations, budget_seconds, sample);
+        free(text);
+        if (!finished) {
+            result->timed_out = true;
+            break;
+        }
+        result->sample_count++;
+    }
+    result->slope = fit_slope(result);
+    return true;
+}
+
+// ================================================================
+// Output
+// ================================================================
+
+static void print_json(const char *path, const ScaleResult *r, bool failed) {
+    printf("{\"shape\":");
+    bench_print_json_string(stdout, path);
+    if (isnan(r->slope)) {
+        printf(",\"slope\":null");
+    } else {
+        printf(",\"slope\":%.3f", r->slope);
+    }
+    printf(",\"limit\":%.3f,\"timed_out\":%s,\"failed\":%s,\"sizes\":[",
+           r->limit, r->timed_out ? "true" : "false", failed ? "true" : "false");
+    for (int i = 0; i < r->sample_count; i++) {
+        const Sample *s = &r->samples[i];
+        printf("%s{\"count\":%u,\"bytes\":%u,\"best_us\":%.1f,\"has_error\":%s}",
+               i ? "," : "", s->count, s->bytes, s->best_seconds * 1e6,
+               s->has_error ? "true" : "false");
+    }
+    printf("]}\n");
+}
+
+static void print_row(const char *path, const ScaleResult *r, bool failed) {
+    const Sample *last = r->sample_count ? &r->samples[r->sample_count - 1] : NULL;
+    char slope[16];
+    if (isnan(r->slope)) {
+        snprintf(slope, sizeof(slope), "-");
+    } else {
+        snprintf(slope, sizeof(slope), "%.2f", r->slope);
+    }
+    printf("%-44s %6s %6.2f %6d %10u %11.1f %6s  %s\n",
+           path, slope, r->limit, r->sample_count,
+           last ? last->bytes : 0, last ? last->best_seconds * 1e6 : 0,
+           last && last->has_error ? "yes" : "no",
+           r->timed_out ? "FAIL (budget)" : failed ? "FAIL" : "ok");
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "usage: scale-bench [-n iterations] [--json] [--limit SLOPE]\n"
+            "                   [--budget-ms MS] [--emit COUNT] shape...\n");
+}
+
+int main(int argc, char **argv) {
+    int iterations = 5;
+    bool json = false;
+    double limit = 1.25;
+    double budget_seconds = 2.0;
+    long emit = -1;
+    int first_shape = argc;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (strcmp(argv[i], "--limit") == 0 && i + 1 < argc) {
+            limit = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--budget-ms") == 0 && i + 1 < argc) {
+            budget_seconds = atof(argv[++i]) / 1e3;
+        } else if (strcmp(argv[i], "--emit") == 0 && i + 1 < argc) {
+            emit = atol(argv[++i]);
+        } else if (argv[i][0] == '-') {
+            usage();
+            return 2;
+        } else {
+            first_shape = i;
+            break;
+        }
+    }
+    if (first_shape >= argc || iterations < 1 || limit <= 0 || budget_seconds <= 0) {
+        usage();
+        return 2;
+    }
+
+    if (emit >= 0) {
+        for (int i = first_shape; i < argc; i++) {
+            Shape shape;
+            uint32_t length = 0;
+            if (!read_shape(argv[i], &shape)) return 1;
+            char *text = generate(&shape, (uint32_t)emit, &length);
+            if (!text) return 1;
+            fwrite(text, 1, length, stdout);
+            free(text);
+        }
+        return 0;
+    }
+
+    TSParser *parser = ts_parser_new();
+    if (!ts_parser_set_language(parser, tree_sitter_parsley())) {
+        fprintf(stderr, "error: incompatible tree-sitter runtime\n");
+        return 1;
+    }
+
+    if (!json) {
+        printf("%-44s %6s %6s %6s %10s %11s %6s  %s\n",
+               "shape", "slope", "limit", "sizes", "max_bytes", "max_us", "error", "result");
+    }
+
+    int status = 0;
+    for (int i = first_shape; i < argc; i++) {
+        Shape shape;
+        ScaleResult r;
+        if (!read_shape(argv[i], &shape) ||
+            !run_shape(parser, &shape, iterations, budget_seconds, &r)) {
+            status = 1;
+            continue;
+        }
+        r.limit = shape.limit > 0 ? shape.limit : limit;
+        bool failed = r.timed_out || (!isnan(r.slope) && r.slope > r.limit);
+        if (failed) status = 1;
+        if (json) {
+            print_json(argv[i], &r, failed);
+        } else {
+            print_row(argv[i], &r, failed);
+        }
+    }
+
+    ts_parser_delete(parser);
+    return status;
+}
@@ -1,16 +1,111 @@
 {
+  "variables": {
+    # tree-sitter C runtime for parseFiles and MappedFile, taken from the
+    # vendored sources of the tree-sitter package (a peer dependency), so
+    # the addon is built against the runtime version the process also loads
+    "tree_sitter_lib%": "<!(node -p \"require('path').join(require('path').dirname(require.resolve('tree-sitter/package.json')), 'vendor', 'tree-sitter', 'lib')\")",
+    # Link-time optimization for Release builds, which lets the compiler
+    # inline the scanner and runtime calls into parser.c's lexer. Turn it
+    # off for toolchains whose linker lacks LTO support:
+    #   node-gyp rebuild -- -Dlto=false
+    "lto%": "true",
+  },
+  # Shared by the runtime and the addon, so LTO sees both
+  "target_defaults": {
+    # Release is what `npm install` and `npm run prebuild` produce; the
+    # generated tables are large enough that -O3 over the default -O2 is
+    # measurable at parse time
+    "configurations": {
+      "Release": {
+        "cflags": ["-O3"],
+        "cflags_cc": ["-O3"],
+        "xcode_settings": {
+          "GCC_OPTIMIZATION_LEVEL": "3",
+        },
+        "msvs_settings": {
+          "VCCLCompilerTool": {
+            "Optimization": 2,
+            "FavorSizeOrSpeed": 1,
+          },
+        },
+        "conditions": [
+          ["lto=='true'", {
+            "cflags": ["-flto"],
+            "cflags_cc": ["-flto"],
+            "ldflags": ["-flto"],
+            "xcode_settings": {
+              "LLVM_LTO": "YES",
+            },
+            "msvs_settings": {
+              "VCCLCompilerTool": {
+                "WholeProgramOptimization": "true",
+              },
+              "VCLinkerTool": {
+                "LinkTimeCodeGeneration": 1,
+              },
+            },
+          }],
+        ],
+      },
+    },
+  },
   "targets": [
+    {
+      # The addon's one copy of the runtime. Its symbols stay private to the
+      # addon (hidden visibility, and kept out of the dynamic symbol table
+      # on Linux), so they never bind to the tree-sitter package's own copy
+      # loaded in the same process, nor it to them.
+      "target_name": "tree_sitter_runtime",
+      "type": "static_library",
+      "include_dirs": [
+        "<(tree_sitter_lib)/include",
+        "<(tree_sitter_lib)/src",
+      ],
+      "sources": [
+        "<(tree_sitter_lib)/src/lib.c",
+      ],
+      "direct_dependent_settings": {
+        "include_dirs": [
+          "<(tree_sitter_lib)/include",
+        ],
+      },
+      "conditions": [
+        ["OS!='win'", {
+          "cflags_c": [
+            "-std=c11",
+            "-fvisibility=hidden",
+          ],
+          "xcode_settings": {
+            "GCC_SYMBOLS_PRIVATE_EXTERN": "YES",
+          },
+        }, {
+          "cflags_c": [
+            "/std:c11",
+            "/utf-8",
+          ],
+        }],
+      ],
+    },
     {
       "target_name": "tree_sitter_parsley_binding",
       "dependencies": [
         "<!(node -p \"require('node-addon-api').targets\"):node_addon_api_except",
+        "tree_sitter_runtime",
       ],
       "include_dirs": [
         "src",
+        "bindings/c",
       ],
       "sources": [
         "bindings/node/binding.cc",
+        "bindings/node/batch.cc",
+        "bindings/node/mapped.cc",
+        "bindings/c/alloc.c",
         "src/parser.c",
+        "src/scanner.c",
+      ],
+      "defines": [
+        "TREE_SITTER_REUSE_ALLOCATOR",
       ],
       "conditions": [
         ["OS!='win'", {
@@ -23,6 +118,11 @@
             "/utf-8",
           ],
         }],
+        ["OS=='linux'", {
+          "ldflags": [
+            "-Wl,--exclude-libs,ALL",
+          ],
+        }],
       ],
     }
   ]
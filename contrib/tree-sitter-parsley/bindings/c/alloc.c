@@ -0,0 +1,332 @@
+/**
+ * Counting and arena allocation for the tree-sitter runtime (see alloc.h)
+ *
+ * Every block carries a 16-byte header with its size and where it lives, so
+ * free and realloc work on blocks from either place no matter which mode the
+ * calling thread is in. A block stays where it was allocated: a heap block
+ * reallocated inside an arena grows on the heap, and an arena block
+ * reallocated after its arena closed is a use after free, as documented.
+ *
+ * The arena is a bump allocator. The most recent block can grow in place or
+ * be rolled back when freed, which covers the runtime's growing stacks and
+ * short-lived scratch arrays; any other free is a no-op.
+ *
+ * Blocks the runtime allocated before the install have no header, so the
+ * install must not happen once there are any. Until then the runtime
+ * allocates through the watch_* functions below, set up when this file is
+ * loaded: plain malloc, except that they note that the runtime allocated.
+ */
+
+#include "alloc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// From tree_sitter/api.h, declared here so this file builds without the
+// runtime's headers (the Rust crate only links the runtime)
+void ts_set_allocator(
+    void *(*new_malloc)(size_t),
+    void *(*new_calloc)(size_t, size_t),
+    void *(*new_realloc)(void *, size_t),
+    void (*new_free)(void *)
+);
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define THREAD_LOCAL __declspec(thread)
+typedef volatile long AtomicLong;
+#define ATOMIC_LOAD(a) _InterlockedCompareExchange((a), 0, 0)
+#define ATOMIC_LOAD_RELAXED(a) (*(a))
+#define ATOMIC_STORE(a, v) _InterlockedExchange((a), (v))
+#define ATOMIC_CAS(a, expected, desired) \
+    (_InterlockedCompareExchange((a), (desired), (expected)) == (expected))
+#else
+#include <stdatomic.h>
+#define THREAD_LOCAL _Thread_local
+typedef _Atomic long AtomicLong;
+#define ATOMIC_LOAD(a) atomic_load(a)
+#define ATOMIC_LOAD_RELAXED(a) atomic_load_explicit((a), memory_order_relaxed)
+#define ATOMIC_STORE(a, v) atomic_store((a), (v))
+static bool atomic_cas(AtomicLong *a, long expected, long desired) {
+    return atomic_compare_exchange_strong(a, &expected, desired);
+}
+#define ATOMIC_CAS(a, expected, desired) atomic_cas((a), (expected), (desired))
+#endif
+
+#define HEADER_SIZE 16
+#define ALIGNMENT 16
+#define DEFAULT_CHUNK_SIZE (4 * 1024 * 1024)
+
+enum BlockKind {
+    BLOCK_HEAP = 0x68656170,
+    BLOCK_ARENA = 0x6172656e,
+};
+
+typedef struct {
+    size_t size;
+    uint32_t kind;
+} BlockHeader;
+
+// A chunk's blocks follow its header, which is padded to ALIGNMENT
+typedef struct Chunk {
+    struct Chunk *next;  // older chunk
+    size_t capacity;     // bytes after the header
+    size_t used;
+} Chunk;
+
+#define CHUNK_HEADER_SIZE ((sizeof(Chunk) + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1))
+
+typedef struct {
+    Chunk *chunks;       // newest first; allocation only uses the newest
+    size_t chunk_size;
+    BlockHeader *last;   // the newest block, which may grow or roll back
+    size_t live;
+} Arena;
+
+enum InstallState {
+    INSTALL_NONE,
+    INSTALL_RUNNING,   // one thread is in tree_sitter_parsley_alloc_install
+    INSTALL_DONE,
+    INSTALL_REFUSED,   // the runtime had already allocated
+};
+
+static AtomicLong install_state = INSTALL_NONE;
+// Set by the watch_* allocator the first time the runtime allocates
+static AtomicLong runtime_allocated = 0;
+static THREAD_LOCAL TSParsleyAllocStats stats;
+static THREAD_LOCAL Arena *arena = NULL;
+
+static size_t round_up(size_t size) {
+    return (size + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+}
+
+static BlockHeader *header_of(void *ptr) {
+    return (BlockHeader *)((char *)ptr - HEADER_SIZE);
+}
+
+static void *payload_of(BlockHeader *header) {
+    return (char *)header + HEADER_SIZE;
+}
+
+static void account(size_t added, size_t removed) {
+    stats.live_bytes += (int64_t)added - (int64_t)removed;
+    if (stats.live_bytes > stats.peak_bytes) {
+        stats.peak_bytes = stats.live_bytes;
+    }
+}
+
+static char *chunk_data(Chunk *chunk) {
+    return (char *)chunk + CHUNK_HEADER_SIZE;
+}
+
+static void *arena_alloc(size_t size) {
+    size_t needed = HEADER_SIZE + round_up(size);
+    Chunk *chunk = arena->chunks;
+    if (!chunk || chunk->capacity - chunk->used < needed) {
+        size_t capacity = needed > arena->chunk_size ? needed : arena->chunk_size;
+        chunk = malloc(CHUNK_HEADER_SIZE + capacity);
+        if (!chunk) return NULL;
+        chunk->next = arena->chunks;
+        chunk->capacity = capacity;
+        chunk->used = 0;
+        arena->chunks = chunk;
+        stats.arena_reserved += capacity;
+    }
+    BlockHeader *header = (BlockHeader *)(chunk_data(chunk) + chunk->used);
+    header->size = size;
+    header->kind = BLOCK_ARENA;
+    chunk->used += needed;
+    arena->last = header;
+    arena->live += size;
+    account(size, 0);
+    return payload_of(header);
+}
+
+// Whether header is the newest block of the calling thread's arena
+static bool is_last(BlockHeader *header) {
+    return arena && arena->last == header;
+}
+
+static void *heap_alloc(size_t size) {
+    BlockHeader *header = malloc(HEADER_SIZE + size);
+    if (!header) return NULL;
+    header->size = size;
+    header->kind = BLOCK_HEAP;
+    account(size, 0);
+    return payload_of(header);
+}
+
+static void *counting_malloc(size_t size) {
+    stats.allocations++;
+    return arena ? arena_alloc(size) : heap_alloc(size);
+}
+
+static void *counting_calloc(size_t count, size_t size) {
+    if (size && count > SIZE_MAX / size) return NULL;
+    void *ptr = counting_malloc(count * size);
+    if (ptr) memset(ptr, 0, count * size);
+    return ptr;
+}
+
+static void counting_free(void *ptr) {
+    if (!ptr) return;
+    BlockHeader *header = header_of(ptr);
+    if (header->kind == BLOCK_HEAP) {
+        account(0, header->size);
+        free(header);
+        return;
+    }
+    // Arena blocks are released when their arena closes; only the newest
+    // block of this thread's arena can be given back now
+    if (is_last(header)) {
+        arena->chunks->used = (size_t)((char *)header - chunk_data(arena->chunks));
+        arena->last = NULL;
+        arena->live -= header->size;
+        account(0, header->size);
+    }
+}
+
+static void *counting_realloc(void *ptr, size_t size) {
+    if (!ptr) return counting_malloc(size);
+    BlockHeader *header = header_of(ptr);
+    size_t old_size = header->size;
+
+    if (header->kind == BLOCK_HEAP) {
+        BlockHeader *grown = realloc(header, HEADER_SIZE + size);
+        if (!grown) return NULL;
+        if (size > old_size) stats.allocations++;
+        grown->size = size;
+        account(size, old_size);
+        return payload_of(grown);
+    }
+
+    if (is_last(header)) {
+        Chunk *chunk = arena->chunks;
+        size_t offset = (size_t)((char *)header - chunk_data(chunk));
+        size_t needed = HEADER_SIZE + round_up(size);
+        if (chunk->capacity - offset >= needed) {
+            chunk->used = offset + needed;
+            header->size = size;
+            arena->live += size;
+            arena->live -= old_size;
+            account(size, old_size);
+            return ptr;
+        }
+    }
+    if (size <= old_size) {
+        return ptr;
+    }
+
+    void *moved = counting_malloc(size);
+    if (!moved) return NULL;
+    memcpy(moved, ptr, old_size);
+    counting_free(ptr);
+    return moved;
+}
+
+// The runtime's allocator until the install: malloc, noting that it ran.
+// The flag is read before it is written so threads do not keep writing to
+// a shared cache line.
+static void note_runtime_allocated(void) {
+    if (!ATOMIC_LOAD_RELAXED(&runtime_allocated)) {
+        ATOMIC_STORE(&runtime_allocated, 1);
+    }
+}
+
+static void *watch_malloc(size_t size) {
+    note_runtime_allocated();
+    return malloc(size);
+}
+
+static void *watch_calloc(size_t count, size_t size) {
+    note_runtime_allocated();
+    return calloc(count, size);
+}
+
+static void *watch_realloc(void *ptr, size_t size) {
+    note_runtime_allocated();
+    return realloc(ptr, size);
+}
+
+static void watch_runtime(void) {
+    ts_set_allocator(watch_malloc, watch_calloc, watch_realloc, free);
+}
+
+// Run watch_runtime when the library is loaded, before anything can parse
+#if defined(_MSC_VER)
+#pragma section(".CRT$XCU", read)
+__declspec(allocate(".CRT$XCU")) void (*tree_sitter_parsley_alloc_watch)(void) = watch_runtime;
+#ifdef _WIN64
+#pragma comment(linker, "/include:tree_sitter_parsley_alloc_watch")
+#else
+#pragma comment(linker, "/include:_tree_sitter_parsley_alloc_watch")
+#endif
+#else
+__attribute__((constructor)) static void watch_runtime_on_load(void) {
+    watch_runtime();
+}
+#endif
+
+bool tree_sitter_parsley_alloc_install(void) {
+    while (!ATOMIC_CAS(&install_state, INSTALL_NONE, INSTALL_RUNNING)) {
+        long state = ATOMIC_LOAD(&install_state);
+        if (state == INSTALL_DONE) return true;
+        if (state == INSTALL_REFUSED) return false;
+        // Another thread is installing; it finishes in a few instructions
+    }
+    if (ATOMIC_LOAD(&runtime_allocated)) {
+        ATOMIC_STORE(&install_state, INSTALL_REFUSED);
+        return false;
+    }
+    ts_set_allocator(counting_malloc, counting_calloc, counting_realloc, counting_free);
+    ATOMIC_STORE(&install_state, INSTALL_DONE);
+    return true;
+}
+
+static bool is_installed(void) {
+    return ATOMIC_LOAD(&install_state) == INSTALL_DONE;
+}
+
+TSParsleyAllocStats tree_sitter_parsley_alloc_stats(void) {
+    return stats;
+}
+
+void tree_sitter_parsley_free(void *ptr) {
+    if (is_installed()) {
+        counting_free(ptr);
+    } else {
+        free(ptr);
+    }
+}
+
+void tree_sitter_parsley_alloc_reset_peak(void) {
+    stats.peak_bytes = stats.live_bytes;
+}
+
+bool tree_sitter_parsley_arena_begin(size_t chunk_size) {
+    if (!is_installed() || arena) return false;
+    Arena *opened = calloc(1, sizeof(Arena));
+    if (!opened) return false;
+    opened->chunk_size = chunk_size ? chunk_size : DEFAULT_CHUNK_SIZE;
+    arena = opened;
+    return true;
+}
+
+size_t tree_sitter_parsley_arena_end(void) {
+    if (!arena) return 0;
+    size_t released = arena->live;
+    for (Chunk *chunk = arena->chunks; chunk;) {
+        Chunk *next = chunk->next;
+        stats.arena_reserved -= chunk->capacity;
+        free(chunk);
+        chunk = next;
+    }
+    account(0, released);
+    free(arena);
+    arena = NULL;
+    return released;
+}
+
+size_t tree_sitter_parsley_arena_used(void) {
+    return arena ? arena->live : 0;
+}
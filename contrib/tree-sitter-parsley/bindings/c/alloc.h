@@ -0,0 +1,71 @@
+/**
+ * Counting and arena allocation for the tree-sitter runtime
+ *
+ * Shared by the Node addon (bindings/node/batch.cc) and the Rust crate's
+ * `arena` feature. tree_sitter_parsley_alloc_install() routes every runtime
+ * allocation through this file, which keeps per-thread byte counters. A
+ * thread can then open an arena: until it is closed, that thread's
+ * allocations come from large chunks, frees are no-ops, and closing it
+ * releases everything at once. That suits batch jobs that parse many files
+ * and discard every tree.
+ *
+ * Build src/scanner.c with TREE_SITTER_REUSE_ALLOCATOR so the scanner's own
+ * state is allocated here too.
+ */
+
+#ifndef TREE_SITTER_PARSLEY_ALLOC_H_
+#define TREE_SITTER_PARSLEY_ALLOC_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Counters for the calling thread. A block freed on another thread than the
+// one that allocated it is subtracted there, so live_bytes is only exact
+// for work that stays on one thread, as a parse does.
+typedef struct {
+    int64_t live_bytes;      // allocated and not yet freed, arena bytes included
+    int64_t peak_bytes;      // highest live_bytes since the last reset
+    uint64_t allocations;    // malloc, calloc and growing realloc calls
+    size_t arena_reserved;   // bytes held in chunks by the open arena
+} TSParsleyAllocStats;
+
+// Install the allocator with ts_set_allocator. Returns false, and leaves
+// the runtime's allocator alone, if the runtime has already allocated: a
+// block from before would later be freed here without a header. Calling it
+// again after it succeeded returns true. No other thread may use the
+// runtime while it runs.
+bool tree_sitter_parsley_alloc_install(void);
+
+TSParsleyAllocStats tree_sitter_parsley_alloc_stats(void);
+
+// Free a block the runtime handed to the caller, such as the string from
+// ts_node_string or the array from ts_tree_get_changed_ranges. Once the
+// allocator is installed those carry its header, so plain free() is wrong.
+void tree_sitter_parsley_free(void *ptr);
+
+// Start a new peak measurement from the current live size.
+void tree_sitter_parsley_alloc_reset_peak(void);
+
+// Open an arena on the calling thread, reserving memory in chunks of at
+// least chunk_size bytes (0 for the default). Returns false if the
+// allocator is not installed or the thread already has an arena open.
+bool tree_sitter_parsley_arena_begin(size_t chunk_size);
+
+// Close the calling thread's arena and release every block allocated from
+// it. Every parser, tree and cursor created while it was open must already
+// be deleted or never be used again. Returns the bytes released.
+size_t tree_sitter_parsley_arena_end(void);
+
+// Bytes handed out by the calling thread's open arena and not rolled back.
+size_t tree_sitter_parsley_arena_used(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TREE_SITTER_PARSLEY_ALLOC_H_
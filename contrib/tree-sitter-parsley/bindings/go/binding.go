@@ -0,0 +1,18 @@
+// Package tree_sitter_parsley provides the Parsley grammar for
+// github.com/tree-sitter/go-tree-sitter, plus a Documents store that keeps one
+// tree per file and reparses incrementally when a file is saved.
+package tree_sitter_parsley
+
+// #cgo CFLAGS: -std=c11 -fPIC
+// #include "../../src/parser.c"
+// #include "../../src/scanner.c"
+import "C"
+
+import "unsafe"
+
+// Language returns the tree-sitter language for Parsley.
+//
+// Wrap it with tree_sitter.NewLanguage to use it with a Parser.
+func Language() unsafe.Pointer {
+	return unsafe.Pointer(C.tree_sitter_parsley())
+}
@@ -0,0 +1,15 @@
+package tree_sitter_parsley_test
+
+import (
+	"testing"
+
+	tree_sitter_parsley "github.com/sambeau/tree-sitter-parsley/bindings/go"
+	tree_sitter "github.com/tree-sitter/go-tree-sitter"
+)
+
+func TestCanLoadGrammar(t *testing.T) {
+	language := tree_sitter.NewLanguage(tree_sitter_parsley.Language())
+	if language == nil {
+		t.Errorf("Error loading Parsley grammar")
+	}
+}
@@ -0,0 +1,185 @@
+package tree_sitter_parsley
+
+import (
+	"sync"
+
+	tree_sitter "github.com/tree-sitter/go-tree-sitter"
+)
+
+// Documents keeps the latest source and tree for each file, so a save only
+// reparses the regions that changed.
+//
+// File watchers report whole new contents rather than edits, so Update works
+// out the edit itself: the span between the longest common prefix and suffix
+// of the old and new source. That single edit is exact for the usual save
+// (one region typed or pasted) and still correct, just less incremental, for
+// scattered changes.
+//
+// Documents is safe for concurrent use. Update and Tree return copies of the
+// stored tree, so a later Update, Remove or Close never frees a tree a
+// caller is still reading. The caller owns each copy and must Close it.
+type Documents struct {
+	mu       sync.Mutex
+	language *tree_sitter.Language
+	parser   *tree_sitter.Parser
+	docs     map[string]*document
+}
+
+type document struct {
+	source []byte
+	tree   *tree_sitter.Tree
+}
+
+// NewDocuments creates an empty store.
+func NewDocuments() *Documents {
+	language := tree_sitter.NewLanguage(Language())
+	parser := tree_sitter.NewParser()
+	if err := parser.SetLanguage(language); err != nil {
+		// Only possible if the generated parser's ABI is not supported
+		// by the linked runtime
+		panic(err)
+	}
+	return &Documents{
+		language: language,
+		parser:   parser,
+		docs:     make(map[string]*document),
+	}
+}
+
+// Update sets the source for path and returns its tree along with the
+// ranges whose syntax changed since the previous version. The first Update
+// for a path parses from scratch and reports the whole file as changed.
+// The tree is a copy that the caller must Close.
+func (d *Documents) Update(path string, source []byte) (*tree_sitter.Tree, []tree_sitter.Range) {
+	d.mu.Lock()
+	defer d.mu.Unlock()
+
+	// The store keeps source for later diffs; the caller may reuse theirs
+	source = append([]byte(nil), source...)
+
+	doc, ok := d.docs[path]
+	if !ok {
+		tree := d.parser.Parse(source, nil)
+		d.docs[path] = &document{source: source, tree: tree}
+		return tree.Clone(), []tree_sitter.Range{wholeRange(source)}
+	}
+
+	edit, changed := diffEdit(doc.source, source)
+	if !changed {
+		return doc.tree.Clone(), nil
+	}
+
+	doc.tree.Edit(&edit)
+	tree := d.parser.Parse(source, doc.tree)
+	ranges := doc.tree.ChangedRanges(tree)
+	doc.tree.Close()
+	doc.tree = tree
+	doc.source = source
+	return tree.Clone(), ranges
+}
+
+// Tree returns a copy of the current tree, which the caller must Close, and
+// the source for path, or nil if the path has not been added.
+func (d *Documents) Tree(path string) (*tree_sitter.Tree, []byte) {
+	d.mu.Lock()
+	defer d.mu.Unlock()
+
+	doc, ok := d.docs[path]
+	if !ok {
+		return nil, nil
+	}
+	return doc.tree.Clone(), doc.source
+}
+
+// Remove forgets path and frees its tree.
+func (d *Documents) Remove(path string) {
+	d.mu.Lock()
+	defer d.mu.Unlock()
+
+	if doc, ok := d.docs[path]; ok {
+		doc.tree.Close()
+		delete(d.docs, path)
+	}
+}
+
+// Close frees every tree and the parser.
+func (d *Documents) Close() {
+	d.mu.Lock()
+	defer d.mu.Unlock()
+
+	for path, doc := range d.docs {
+		doc.tree.Close()
+		delete(d.docs, path)
+	}
+	d.parser.Close()
+}
+
+// diffEdit describes the change from old to new as one edit covering
+// everything between their common prefix and common suffix.
+func diffEdit(old, new []byte) (tree_sitter.InputEdit, bool) {
+	prefix := 0
+	for prefix < len(old) && prefix < len(new) && old[prefix] == new[prefix] {
+		prefix++
+	}
+	if prefix == len(old) && prefix == len(new) {
+		return tree_sitter.InputEdit{}, false
+	}
+	// Start the edit on a character boundary, not inside a UTF-8 sequence
+	for prefix > 0 && isContinuation(old, prefix) {
+		prefix--
+	}
+
+	suffix := 0
+	for suffix < len(old)-prefix && suffix < len(new)-prefix &&
+		old[len(old)-1-suffix] == new[len(new)-1-suffix] {
+		suffix++
+	}
+
+	for suffix > 0 && isContinuation(old, len(old)-suffix) {
+		suffix--
+	}
+
+	oldEnd := len(old) - suffix
+	newEnd := len(new) - suffix
+	start := pointAt(old, prefix)
+	return tree_sitter.InputEdit{
+		StartByte:      uint(prefix),
+		OldEndByte:     uint(oldEnd),
+		NewEndByte:     uint(newEnd),
+		StartPosition:  start,
+		OldEndPosition: advancePoint(start, old[prefix:oldEnd]),
+		NewEndPosition: advancePoint(start, new[prefix:newEnd]),
+	}, true
+}
+
+// isContinuation reports whether source[offset] continues a UTF-8 sequence.
+func isContinuation(source []byte, offset int) bool {
+	return offset < len(source) && source[offset]&0xC0 == 0x80
+}
+
+// pointAt returns the row/column (in bytes) of offset in source.
+func pointAt(source []byte, offset int) tree_sitter.Point {
+	return advancePoint(tree_sitter.Point{}, source[:offset])
+}
+
+// advancePoint moves point past text.
+func advancePoint(point tree_sitter.Point, text []byte) tree_sitter.Point {
+	for _, b := range text {
+		if b == '\n' {
+			point.Row++
+			point.Column = 0
+		} else {
+			point.Column++
+		}
+	}
+	return point
+}
+
+func wholeRange(source []byte) tree_sitter.Range {
+	return tree_sitter.Range{
+		StartByte:  0,
+		EndByte:    uint(len(source)),
+		StartPoint: tree_sitter.Point{},
+		EndPoint:   pointAt(source, len(source)),
+	}
+}
@@ -0,0 +1,106 @@
+package tree_sitter_parsley
+
+import (
+	"testing"
+
+	tree_sitter "github.com/tree-sitter/go-tree-sitter"
+)
+
+func TestDiffEdit(t *testing.T) {
+	tests := []struct {
+		name     string
+		old, new string
+		want     tree_sitter.InputEdit
+		changed  bool
+	}{
+		{"unchanged", "let x = 1\n", "let x = 1\n", tree_sitter.InputEdit{}, false},
+		{
+			"insert on second line",
+			"let x = 1\nlet y = 2\n",
+			"let x = 1\nlet y = 22\n",
+			tree_sitter.InputEdit{
+				StartByte: 19, OldEndByte: 19, NewEndByte: 20,
+				StartPosition:  tree_sitter.Point{Row: 1, Column: 9},
+				OldEndPosition: tree_sitter.Point{Row: 1, Column: 9},
+				NewEndPosition: tree_sitter.Point{Row: 1, Column: 10},
+			},
+			true,
+		},
+		{
+			"replace across lines",
+			"a\nbb\nc",
+			"a\nX\nY\nc",
+			tree_sitter.InputEdit{
+				StartByte: 2, OldEndByte: 4, NewEndByte: 5,
+				StartPosition:  tree_sitter.Point{Row: 1, Column: 0},
+				OldEndPosition: tree_sitter.Point{Row: 1, Column: 2},
+				NewEndPosition: tree_sitter.Point{Row: 2, Column: 1},
+			},
+			true,
+		},
+		{
+			"multibyte character stays whole",
+			"\"é\"",
+			"\"è\"",
+			tree_sitter.InputEdit{
+				StartByte: 1, OldEndByte: 3, NewEndByte: 3,
+				StartPosition:  tree_sitter.Point{Row: 0, Column: 1},
+				OldEndPosition: tree_sitter.Point{Row: 0, Column: 3},
+				NewEndPosition: tree_sitter.Point{Row: 0, Column: 3},
+			},
+			true,
+		},
+	}
+
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			got, changed := diffEdit([]byte(tt.old), []byte(tt.new))
+			if changed != tt.changed {
+				t.Fatalf("changed = %v, want %v", changed, tt.changed)
+			}
+			if got != tt.want {
+				t.Errorf("diffEdit() = %+v, want %+v", got, tt.want)
+			}
+		})
+	}
+}
+
+func TestDocumentsUpdate(t *testing.T) {
+	docs := NewDocuments()
+	defer docs.Close()
+
+	first, ranges := docs.Update("a.pars", []byte("let x = 1\nlet y = 2\n"))
+	defer first.Close()
+	if first.RootNode().HasError() {
+		t.Fatalf("unexpected parse error: %s", first.RootNode().ToSexp())
+	}
+	if len(ranges) != 1 || ranges[0].EndByte != 20 {
+		t.Fatalf("first update ranges = %+v, want the whole file", ranges)
+	}
+
+	unchanged, ranges := docs.Update("a.pars", []byte("let x = 1\nlet y = 2\n"))
+	unchanged.Close()
+	if ranges != nil {
+		t.Errorf("unchanged update ranges = %+v, want none", ranges)
+	}
+
+	tree, ranges := docs.Update("a.pars", []byte("let x = 1\nlet y = \"two\"\n"))
+	defer tree.Close()
+	if tree.RootNode().HasError() {
+		t.Fatalf("unexpected parse error: %s", tree.RootNode().ToSexp())
+	}
+	// The first tree is the caller's copy, so the reparse did not free it
+	if end := first.RootNode().EndByte(); end != 20 {
+		t.Errorf("first tree ends at byte %d after a later Update, want 20", end)
+	}
+	for _, r := range ranges {
+		if r.StartByte < 10 {
+			t.Errorf("changed range %+v reaches into the untouched first line", r)
+		}
+	}
+
+	docs.Remove("a.pars")
+	if tree, _ := docs.Tree("a.pars"); tree != nil {
+		t.Errorf("Tree after Remove = %v, want nil", tree)
+	}
+}
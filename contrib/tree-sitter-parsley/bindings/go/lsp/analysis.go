@@ -0,0 +1,329 @@
+package lsp
+
+import (
+	"sort"
+	"strconv"
+	"strings"
+	"unicode/utf8"
+
+	tree_sitter "github.com/tree-sitter/go-tree-sitter"
+)
+
+// Semantic token legend. Captures from highlights.scm map onto these types;
+// a capture without an entry falls back to its parent name ("function.call"
+// to "function"), as in basil/highlight.
+var (
+	tokenTypes = []string{
+		"namespace", "type", "class", "parameter", "variable", "property",
+		"function", "method", "keyword", "comment", "string", "number",
+		"regexp", "operator",
+	}
+	tokenModifiers = []string{"readonly", "defaultLibrary"}
+)
+
+const (
+	modReadonly = 1 << iota
+	modDefaultLibrary
+)
+
+type tokenClass struct {
+	typ  string // "" claims the node but emits no token
+	mods uint
+}
+
+var captureTokens = map[string]tokenClass{
+	"keyword":            {typ: "keyword"},
+	"query":              {typ: "keyword"},
+	"schema":             {typ: "keyword"},
+	"insert":             {typ: "keyword"},
+	"update":             {typ: "keyword"},
+	"delete":             {typ: "keyword"},
+	"transaction":        {typ: "keyword"},
+	"string":             {typ: "string"},
+	"string.escape":      {},
+	"string.regexp":      {typ: "regexp"},
+	"number":             {typ: "number"},
+	"constant.builtin":   {typ: "keyword"},
+	"comment":            {typ: "comment"},
+	"function":           {typ: "function"},
+	"function.method":    {typ: "method"},
+	"function.builtin":   {typ: "function", mods: modDefaultLibrary},
+	"variable":           {typ: "variable"},
+	"variable.builtin":   {typ: "variable", mods: modReadonly | modDefaultLibrary},
+	"variable.parameter": {typ: "parameter"},
+	"property":           {typ: "property"},
+	"attribute":          {typ: "property"},
+	"type":               {typ: "type"},
+	"module":             {typ: "namespace"},
+	// LSP has no type for markup; tag names take class so themes colour
+	// them apart from variables and schema field types
+	"tag":         {typ: "class"},
+	"operator":    {typ: "operator"},
+	"punctuation": {},
+}
+
+// tokenIndex returns the legend index and modifiers for a capture, or -1
+// for a capture that emits no token.
+func tokenIndex(capture string) (int, uint) {
+	for {
+		if class, ok := captureTokens[capture]; ok {
+			for i, typ := range tokenTypes {
+				if typ == class.typ {
+					return i, class.mods
+				}
+			}
+			return -1, 0
+		}
+		dot := strings.LastIndexByte(capture, '.')
+		if dot < 0 {
+			return -1, 0
+		}
+		capture = capture[:dot]
+	}
+}
+
+func nodeSpan(node *tree_sitter.Node) span {
+	return span{
+		start: node.StartByte(), end: node.EndByte(),
+		startPoint: node.StartPosition(), endPoint: node.EndPosition(),
+	}
+}
+
+// cursorFor returns a query cursor limited to region. The range is widened
+// by a byte on each side because tree-sitter and intersects disagree about
+// nodes that only touch the region; collectors filter with intersects.
+func cursorFor(region span) *tree_sitter.QueryCursor {
+	cursor := tree_sitter.NewQueryCursor()
+	start := region.start
+	if start > 0 {
+		start--
+	}
+	cursor.SetByteRange(start, region.end+1)
+	return cursor
+}
+
+// collectTokens highlights region. When patterns capture the same node the
+// earliest in highlights.scm wins, as in tree-sitter's own highlighter.
+func (s *Server) collectTokens(tree *tree_sitter.Tree, source []byte, region span) []item {
+	cursor := cursorFor(region)
+	defer cursor.Close()
+
+	best := map[[2]uint]item{}
+	captures := cursor.Captures(s.highlights, tree.RootNode(), source)
+	for match, index := captures.Next(); match != nil; match, index = captures.Next() {
+		capture := match.Captures[index]
+		it := item{span: nodeSpan(&capture.Node), pattern: match.PatternIndex}
+		if it.start == it.end || !it.intersects(region) {
+			continue
+		}
+		it.kind, it.mods = s.tokenKinds[capture.Index], s.tokenMods[capture.Index]
+		key := [2]uint{it.start, it.end}
+		if old, ok := best[key]; !ok || it.pattern < old.pattern {
+			best[key] = it
+		}
+	}
+
+	items := make([]item, 0, len(best))
+	for _, it := range best {
+		if it.kind >= 0 {
+			items = append(items, it)
+		}
+	}
+	return items
+}
+
+// collectFolds returns the folds.scm nodes in region that span lines.
+func (s *Server) collectFolds(tree *tree_sitter.Tree, source []byte, region span) []item {
+	cursor := cursorFor(region)
+	defer cursor.Close()
+
+	var items []item
+	captures := cursor.Captures(s.folds, tree.RootNode(), source)
+	for match, index := captures.Next(); match != nil; match, index = captures.Next() {
+		it := item{span: nodeSpan(&match.Captures[index].Node)}
+		if it.endPoint.Row > it.startPoint.Row && it.intersects(region) {
+			items = append(items, it)
+		}
+	}
+	return items
+}
+
+// collectSymbols returns the tags.scm definitions in region. As in
+// bindings/go/symbols, the first pattern to tag a name wins.
+func (s *Server) collectSymbols(tree *tree_sitter.Tree, source []byte, region span) []item {
+	cursor := cursorFor(region)
+	defer cursor.Close()
+
+	best := map[uint]item{} // by name start byte
+	matches := cursor.Matches(s.tags, tree.RootNode(), source)
+	for match := matches.Next(); match != nil; match = matches.Next() {
+		var it item
+		var name *tree_sitter.Node
+		kind := -1
+		for i := range match.Captures {
+			c := &match.Captures[i]
+			if uint(c.Index) == s.tagName {
+				name = &c.Node
+			} else if k := s.symbolKinds[c.Index]; k >= 0 {
+				kind = k
+				it.span = nodeSpan(&c.Node)
+			}
+		}
+		if name == nil || kind < 0 || !it.intersects(region) {
+			continue
+		}
+		it.kind = kind
+		it.pattern = match.PatternIndex
+		it.name = nodeSpan(name)
+		it.text = name.Utf8Text(source)
+		if old, ok := best[it.name.start]; !ok || it.pattern < old.pattern {
+			best[it.name.start] = it
+		}
+	}
+
+	items := make([]item, 0, len(best))
+	for _, it := range best {
+		items = append(items, it)
+	}
+	return items
+}
+
+// symbolKind maps a tags.scm capture to an LSP symbol kind; references and
+// @name give -1.
+func symbolKind(capture string) int {
+	switch capture {
+	case "definition.function":
+		return symbolFunction
+	case "definition.class":
+		return symbolClass
+	case "definition.module":
+		return symbolModule
+	case "definition.constant":
+		return symbolConstant
+	}
+	return -1
+}
+
+// diagnostics reports every ERROR and MISSING node. Subtrees without errors
+// are skipped whole, so a clean file costs one check of the root.
+func diagnostics(d *document) []Diagnostic {
+	found := []Diagnostic{}
+	var visit func(node *tree_sitter.Node)
+	visit = func(node *tree_sitter.Node) {
+		switch {
+		case node.IsMissing():
+			found = append(found, Diagnostic{
+				Range:    d.rangeOf(nodeSpan(node)),
+				Severity: severityError,
+				Source:   "parsley",
+				Message:  "missing " + strconv.Quote(node.Kind()),
+			})
+			return
+		case node.IsError():
+			found = append(found, Diagnostic{
+				Range:    d.rangeOf(nodeSpan(node)),
+				Severity: severityError,
+				Source:   "parsley",
+				Message:  unexpected(node.Utf8Text(d.source)),
+			})
+			return
+		case !node.HasError():
+			return
+		}
+		for i := uint(0); i < node.ChildCount(); i++ {
+			visit(node.Child(i))
+		}
+	}
+	visit(d.tree.RootNode())
+	return found
+}
+
+// unexpected describes an error node by the start of its text.
+func unexpected(text string) string {
+	const limit = 32
+	if newline := strings.IndexByte(text, '\n'); newline >= 0 {
+		text = text[:newline]
+	}
+	text = strings.TrimSpace(text)
+	if text == "" {
+		return "syntax error"
+	}
+	if len(text) > limit {
+		cut := limit
+		for cut > 0 && !utf8.RuneStart(text[cut]) {
+			cut--
+		}
+		text = text[:cut] + "…"
+	}
+	return "syntax error: unexpected " + strconv.Quote(text)
+}
+
+// documentSymbols nests the cached definitions by containment, so a
+// function's local definitions appear under it.
+func documentSymbols(d *document) []DocumentSymbol {
+	type node struct {
+		symbol   DocumentSymbol
+		span     span
+		children []int
+	}
+	var nodes []node
+	var roots, stack []int
+	for _, it := range d.symbols.items {
+		for len(stack) > 0 {
+			top := nodes[stack[len(stack)-1]].span
+			// Siblings can share a span: let {a, b} = ... defines two names
+			if top.end > it.start && top != it.span {
+				break
+			}
+			stack = stack[:len(stack)-1]
+		}
+		nodes = append(nodes, node{
+			symbol: DocumentSymbol{
+				Name:           it.text,
+				Kind:           it.kind,
+				Range:          d.rangeOf(it.span),
+				SelectionRange: d.rangeOf(it.name),
+			},
+			span: it.span,
+		})
+		index := len(nodes) - 1
+		if len(stack) > 0 {
+			parent := stack[len(stack)-1]
+			nodes[parent].children = append(nodes[parent].children, index)
+		} else {
+			roots = append(roots, index)
+		}
+		stack = append(stack, index)
+	}
+
+	var build func(indexes []int) []DocumentSymbol
+	build = func(indexes []int) []DocumentSymbol {
+		symbols := make([]DocumentSymbol, 0, len(indexes))
+		for _, i := range indexes {
+			symbol := nodes[i].symbol
+			if len(nodes[i].children) > 0 {
+				symbol.Children = build(nodes[i].children)
+			}
+			symbols = append(symbols, symbol)
+		}
+		return symbols
+	}
+	return build(roots)
+}
+
+// foldingRanges returns one fold per start line, the outermost. The closing
+// line stays visible, so a fold ends on the line before its node does.
+func foldingRanges(d *document) []FoldingRange {
+	folds := []FoldingRange{}
+	last := -1
+	for _, it := range d.folds.items {
+		start, end := it.startPoint.Row, it.endPoint.Row-1
+		if end <= start || int(start) == last {
+			continue
+		}
+		folds = append(folds, FoldingRange{StartLine: start, EndLine: end})
+		last = int(start)
+	}
+	sort.SliceStable(folds, func(i, j int) bool { return folds[i].StartLine < folds[j].StartLine })
+	return folds
+}
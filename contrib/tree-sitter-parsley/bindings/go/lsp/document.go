@@ -0,0 +1,229 @@
+package lsp
+
+import (
+	"sort"
+	"unicode/utf8"
+
+	tree_sitter "github.com/tree-sitter/go-tree-sitter"
+)
+
+// Position encodings the server can negotiate
+const (
+	encodingUTF16 = "utf-16"
+	encodingUTF8  = "utf-8"
+)
+
+// A document is one open file: its text, a line index into it, its tree and
+// the cached results of each query layer.
+type document struct {
+	uri      string
+	version  int
+	encoding string
+
+	source []byte
+	lines  []uint // byte offset of the start of each line
+	tree   *tree_sitter.Tree
+
+	tokens, folds, symbols *layer
+
+	// Where the text may no longer be formatted: everything edited since a
+	// formatting request found nothing to do. Deletions leave empty spans,
+	// which still mark their statement.
+	unformatted []span
+
+	// The last semanticTokens result, kept so the next request can be
+	// answered with a delta
+	resultID string
+	data     []uint
+}
+
+func newDocument(s *Server, item TextDocumentItem) *document {
+	d := &document{
+		uri:      item.URI,
+		version:  item.Version,
+		encoding: s.encoding,
+		source:   []byte(item.Text),
+		tokens:   &layer{collect: s.collectTokens},
+		folds:    &layer{collect: s.collectFolds},
+		symbols:  &layer{collect: s.collectSymbols},
+	}
+	d.lines = append(d.lines, 0)
+	for i, b := range d.source {
+		if b == '\n' {
+			d.lines = append(d.lines, uint(i)+1)
+		}
+	}
+	d.tree = s.parser.Parse(d.source, nil)
+	whole := span{start: 0, end: uint(len(d.source)), endPoint: d.point(uint(len(d.source)))}
+	for _, l := range d.layers() {
+		l.stale = append(l.stale, whole)
+	}
+	d.unformatted = []span{whole}
+	return d
+}
+
+func (d *document) layers() []*layer {
+	return []*layer{d.tokens, d.folds, d.symbols}
+}
+
+func (d *document) close() {
+	if d.tree != nil {
+		d.tree.Close()
+		d.tree = nil
+	}
+}
+
+// change applies one didChange event. The tree and every layer are edited
+// to match, but nothing is reparsed: a didChange can carry several events,
+// and reparse runs once after all of them.
+func (d *document) change(event TextDocumentContentChangeEvent) {
+	start, end := uint(0), uint(len(d.source))
+	if event.Range != nil {
+		start, end = d.offset(event.Range.Start), d.offset(event.Range.End)
+		if end < start {
+			start, end = end, start
+		}
+	}
+	text := []byte(event.Text)
+
+	edit := tree_sitter.InputEdit{
+		StartByte:      start,
+		OldEndByte:     end,
+		NewEndByte:     start + uint(len(text)),
+		StartPosition:  d.point(start),
+		OldEndPosition: d.point(end),
+	}
+	d.splice(start, end, text)
+	edit.NewEndPosition = d.point(edit.NewEndByte)
+
+	d.tree.Edit(&edit)
+	for _, l := range d.layers() {
+		l.edit(&edit)
+	}
+	// Typing leaves a span per keystroke, side by side
+	d.unformatted = joinSpans(editSpans(d.unformatted, &edit))
+}
+
+// reparse parses the edited source against the edited tree and marks the
+// ranges whose syntax changed as stale in every layer.
+func (d *document) reparse(parser *tree_sitter.Parser) {
+	tree := parser.Parse(d.source, d.tree)
+	changed := d.tree.ChangedRanges(tree)
+	d.tree.Close()
+	d.tree = tree
+	for _, l := range d.layers() {
+		for _, r := range changed {
+			l.stale = append(l.stale, span{
+				start: r.StartByte, end: r.EndByte,
+				startPoint: r.StartPoint, endPoint: r.EndPoint,
+			})
+		}
+	}
+}
+
+// splice replaces source[start:end] with text and updates the line index,
+// shifting the lines after the edit rather than rescanning the file.
+func (d *document) splice(start, end uint, text []byte) {
+	startRow, endRow := d.row(start), d.row(end)
+	newEnd := start + uint(len(text))
+
+	lines := make([]uint, 0, len(d.lines))
+	lines = append(lines, d.lines[:startRow+1]...)
+	for i, b := range text {
+		if b == '\n' {
+			lines = append(lines, start+uint(i)+1)
+		}
+	}
+	for _, offset := range d.lines[endRow+1:] {
+		lines = append(lines, offset-end+newEnd)
+	}
+	d.lines = lines
+
+	source := make([]byte, 0, uint(len(d.source))-(end-start)+uint(len(text)))
+	source = append(source, d.source[:start]...)
+	source = append(source, text...)
+	source = append(source, d.source[end:]...)
+	d.source = source
+}
+
+// row returns the line containing offset.
+func (d *document) row(offset uint) uint {
+	return uint(sort.Search(len(d.lines), func(i int) bool { return d.lines[i] > offset }) - 1)
+}
+
+// point returns the tree-sitter point (row, byte column) of offset.
+func (d *document) point(offset uint) tree_sitter.Point {
+	row := d.row(offset)
+	return tree_sitter.Point{Row: row, Column: offset - d.lines[row]}
+}
+
+// line returns the bytes of row without its line ending.
+func (d *document) line(row uint) []byte {
+	if row >= uint(len(d.lines)) {
+		return nil
+	}
+	end := uint(len(d.source))
+	if row+1 < uint(len(d.lines)) {
+		end = d.lines[row+1] - 1
+	}
+	line := d.source[d.lines[row]:end]
+	if n := len(line); n > 0 && line[n-1] == '\r' {
+		line = line[:n-1]
+	}
+	return line
+}
+
+// offset converts an LSP position to a byte offset, clamping positions past
+// the end of a line or of the file as the specification asks.
+func (d *document) offset(p Position) uint {
+	if p.Line >= uint(len(d.lines)) {
+		return uint(len(d.source))
+	}
+	line := d.line(p.Line)
+	if d.encoding == encodingUTF8 {
+		return d.lines[p.Line] + min(p.Character, uint(len(line)))
+	}
+	column, units := 0, uint(0)
+	for column < len(line) && units < p.Character {
+		r, size := utf8.DecodeRune(line[column:])
+		units += utf16Len(r)
+		column += size
+	}
+	return d.lines[p.Line] + uint(column)
+}
+
+// position converts a tree-sitter point to an LSP position.
+func (d *document) position(p tree_sitter.Point) Position {
+	return Position{Line: p.Row, Character: d.units(p.Row, p.Column)}
+}
+
+func (d *document) rangeOf(s span) Range {
+	return Range{Start: d.position(s.startPoint), End: d.position(s.endPoint)}
+}
+
+// units returns the length of the first column bytes of row in the
+// negotiated encoding.
+func (d *document) units(row, column uint) uint {
+	if d.encoding == encodingUTF8 {
+		return column
+	}
+	line := d.line(row)
+	return utf16Count(line[:min(column, uint(len(line)))])
+}
+
+func utf16Len(r rune) uint {
+	if r >= 0x10000 {
+		return 2
+	}
+	return 1
+}
+
+func utf16Count(text []byte) uint {
+	n := uint(0)
+	for len(text) > 0 {
+		r, size := utf8.DecodeRune(text)
+		n += utf16Len(r)
+		text = text[size:]
+	}
+	return n
+}
@@ -0,0 +1,28 @@
+package lsp
+
+// A Span is the bytes source[Start:End] of a document.
+type Span struct {
+	Start, End int
+}
+
+// A Replacement replaces the bytes of its span with Text.
+type Replacement struct {
+	Span
+	Text string
+}
+
+// A Formatter formats documents for formatting and rangeFormatting requests.
+//
+// pars fmt builds on Basil's own parser, so its Formatter lives in the basil
+// module next to this one (basil/lower, installed by basil/cmd/parsley-ls),
+// and this package does not depend on Basil.
+type Formatter interface {
+	// FormatRange formats the top-level statements of source that overlap or
+	// touch any of spans. The replacements are in order and do not overlap.
+	// A document with a syntax error is not formatted: its errors are
+	// returned instead.
+	FormatRange(uri string, source []byte, spans []Span) ([]Replacement, []string)
+
+	// Remove forgets what the formatter keeps for a closed document.
+	Remove(uri string)
+}
@@ -0,0 +1,94 @@
+package lsp
+
+import (
+	"bufio"
+	"encoding/json"
+	"errors"
+	"fmt"
+	"io"
+	"net/textproto"
+	"strconv"
+	"strings"
+	"sync"
+)
+
+// maxMessage bounds a single message body. A whole 10k-line part sent on
+// didOpen is well under a megabyte; anything near this is a framing error.
+const maxMessage = 64 << 20
+
+// conn reads and writes LSP base-protocol messages: a Content-Length
+// header, a blank line and a JSON body.
+type conn struct {
+	r *textproto.Reader
+
+	mu sync.Mutex // writes may come from the read loop and from tests
+	w  *bufio.Writer
+}
+
+func newConn(r io.Reader, w io.Writer) *conn {
+	return &conn{r: textproto.NewReader(bufio.NewReader(r)), w: bufio.NewWriter(w)}
+}
+
+// read returns the next message body. io.EOF means the client closed the
+// stream between messages.
+func (c *conn) read() ([]byte, error) {
+	header, err := c.r.ReadMIMEHeader()
+	if err != nil {
+		if errors.Is(err, io.EOF) && len(header) == 0 {
+			return nil, io.EOF
+		}
+		return nil, fmt.Errorf("reading header: %w", err)
+	}
+	value := strings.TrimSpace(header.Get("Content-Length"))
+	length, err := strconv.Atoi(value)
+	if err != nil || length < 0 || length > maxMessage {
+		return nil, fmt.Errorf("bad Content-Length %q", value)
+	}
+	body := make([]byte, length)
+	if _, err := io.ReadFull(c.r.R, body); err != nil {
+		return nil, fmt.Errorf("reading body: %w", err)
+	}
+	return body, nil
+}
+
+func (c *conn) write(m *message) error {
+	m.JSONRPC = "2.0"
+	body, err := json.Marshal(m)
+	if err != nil {
+		return err
+	}
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	if _, err := fmt.Fprintf(c.w, "Content-Length: %d\r\n\r\n", len(body)); err != nil {
+		return err
+	}
+	if _, err := c.w.Write(body); err != nil {
+		return err
+	}
+	return c.w.Flush()
+}
+
+func (c *conn) reply(id *json.RawMessage, result any) error {
+	raw, err := json.Marshal(result)
+	if err != nil {
+		return err
+	}
+	return c.write(&message{ID: id, Result: raw})
+}
+
+func (c *conn) replyError(id *json.RawMessage, err *responseError) error {
+	if id == nil {
+		// Errors in messages without a usable id are reported with id null
+		null := json.RawMessage("null")
+		id = &null
+	}
+	return c.write(&message{ID: id, Error: err})
+}
+
+func (c *conn) notify(method string, params any) error {
+	raw, err := json.Marshal(params)
+	if err != nil {
+		return err
+	}
+	return c.write(&message{Method: method, Params: raw})
+}
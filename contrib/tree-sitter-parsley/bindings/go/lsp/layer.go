@@ -0,0 +1,242 @@
+package lsp
+
+import (
+	"sort"
+
+	tree_sitter "github.com/tree-sitter/go-tree-sitter"
+)
+
+// A span is a byte range of a document with the points at its ends.
+type span struct {
+	start, end           uint
+	startPoint, endPoint tree_sitter.Point
+}
+
+func (s span) intersects(r span) bool {
+	return s.end > r.start && s.start < r.end
+}
+
+// An item is one cached query result: a semantic token, a fold or a
+// symbol. Items do not point into the tree, so they outlive reparses.
+type item struct {
+	span
+	kind    int  // token type index or symbol kind
+	mods    uint // token modifier bits
+	pattern uint
+
+	// Symbols only: the name node and its text
+	name span
+	text string
+}
+
+// A layer caches one query's results for a document and keeps them in step
+// with edits, so a request after a keystroke only queries the regions the
+// keystroke touched:
+//
+//   - edit shifts the items after an edit and drops the items it overlaps
+//     (or touches, since typing at either end of a token changes it),
+//     recording the region they now cover as stale
+//   - the ranges tree-sitter reports as changed by the reparse are added to
+//     the stale regions too
+//   - refresh reruns the query over the stale regions only and replaces the
+//     items that intersect them
+//
+// A large node such as a fold that encloses an edit intersects the stale
+// region, so it is found again and its new extent replaces the old one.
+type layer struct {
+	collect func(tree *tree_sitter.Tree, source []byte, region span) []item
+	items   []item // ordered by start, then by end descending
+	stale   []span
+}
+
+func (l *layer) edit(e *tree_sitter.InputEdit) {
+	// Regions already stale move with the text first, so the ones added
+	// below, which are already in post-edit coordinates, are not moved twice
+	l.stale = editSpans(l.stale, e)
+
+	kept := l.items[:0]
+	for _, it := range l.items {
+		switch {
+		case it.end < e.StartByte:
+			kept = append(kept, it)
+		case it.start > e.OldEndByte:
+			it.span = shiftSpan(it.span, e)
+			if it.text != "" {
+				it.name = shiftSpan(it.name, e)
+			}
+			kept = append(kept, it)
+		default:
+			l.stale = append(l.stale, cover(it.span, e))
+		}
+	}
+	l.items = kept
+}
+
+// refresh brings the layer up to date with tree, which must be the tree
+// the pending edits were reparsed into.
+func (l *layer) refresh(tree *tree_sitter.Tree, source []byte) {
+	if len(l.stale) == 0 {
+		return
+	}
+	regions := mergeSpans(l.stale)
+	l.stale = l.stale[:0]
+
+	var fresh []item
+	for _, r := range regions {
+		fresh = append(fresh, l.collect(tree, source, r)...)
+	}
+	sortItems(fresh)
+
+	items := make([]item, 0, len(l.items)+len(fresh))
+	for _, it := range l.items {
+		if !intersectsAny(it.span, regions) {
+			items = append(items, it)
+		}
+	}
+	// A node that crosses two regions is collected from both
+	for i, it := range fresh {
+		if i == 0 || !sameItem(fresh[i-1], it) {
+			items = append(items, it)
+		}
+	}
+	sortItems(items)
+	l.items = items
+}
+
+// within returns the items that intersect r, in order.
+func (l *layer) within(r span) []item {
+	var found []item
+	for _, it := range l.items {
+		if it.start >= r.end {
+			break
+		}
+		if it.intersects(r) {
+			found = append(found, it)
+		}
+	}
+	return found
+}
+
+func sortItems(items []item) {
+	sort.SliceStable(items, func(i, j int) bool {
+		a, b := items[i], items[j]
+		if a.start != b.start {
+			return a.start < b.start
+		}
+		if a.end != b.end {
+			return a.end > b.end
+		}
+		return a.pattern < b.pattern
+	})
+}
+
+func sameItem(a, b item) bool {
+	return a.span == b.span && a.kind == b.kind && a.name == b.name
+}
+
+// mergeSpans sorts spans and joins the ones that overlap or touch. Empty
+// spans, left by pure deletions, need no requery of their own: the items
+// they touched were dropped with their extents already marked stale.
+func mergeSpans(spans []span) []span {
+	sort.Slice(spans, func(i, j int) bool { return spans[i].start < spans[j].start })
+	var merged []span
+	for _, s := range spans {
+		if s.start == s.end {
+			continue
+		}
+		if n := len(merged); n > 0 && s.start <= merged[n-1].end {
+			if s.end > merged[n-1].end {
+				merged[n-1].end, merged[n-1].endPoint = s.end, s.endPoint
+			}
+			continue
+		}
+		merged = append(merged, s)
+	}
+	return merged
+}
+
+// joinSpans is mergeSpans for spans where an empty span still counts.
+func joinSpans(spans []span) []span {
+	sort.Slice(spans, func(i, j int) bool { return spans[i].start < spans[j].start })
+	merged := spans[:0]
+	for _, s := range spans {
+		if n := len(merged); n > 0 && s.start <= merged[n-1].end {
+			if s.end > merged[n-1].end {
+				merged[n-1].end, merged[n-1].endPoint = s.end, s.endPoint
+			}
+			continue
+		}
+		merged = append(merged, s)
+	}
+	return merged
+}
+
+// intersectsAny reports whether s intersects one of regions, which are
+// sorted and disjoint.
+func intersectsAny(s span, regions []span) bool {
+	i := sort.Search(len(regions), func(i int) bool { return regions[i].end > s.start })
+	return i < len(regions) && regions[i].start < s.end
+}
+
+// editSpans moves spans with the text an edit leaves around them, widening
+// the ones it overlaps, and adds the edit's own span.
+func editSpans(spans []span, e *tree_sitter.InputEdit) []span {
+	for i, s := range spans {
+		switch {
+		case s.end < e.StartByte:
+		case s.start > e.OldEndByte:
+			spans[i] = shiftSpan(s, e)
+		default:
+			spans[i] = cover(s, e)
+		}
+	}
+	return append(spans, span{
+		start: e.StartByte, end: e.NewEndByte,
+		startPoint: e.StartPosition, endPoint: e.NewEndPosition,
+	})
+}
+
+// shiftSpan moves a span that starts after an edit to where the edit left it.
+func shiftSpan(s span, e *tree_sitter.InputEdit) span {
+	return span{
+		start: shiftByte(s.start, e), end: shiftByte(s.end, e),
+		startPoint: shiftPoint(s.startPoint, e), endPoint: shiftPoint(s.endPoint, e),
+	}
+}
+
+// cover returns the span that the text of s, which an edit overlapped,
+// occupies after the edit.
+func cover(s span, e *tree_sitter.InputEdit) span {
+	out := span{
+		start: e.StartByte, end: e.NewEndByte,
+		startPoint: e.StartPosition, endPoint: e.NewEndPosition,
+	}
+	if s.start < e.StartByte {
+		out.start, out.startPoint = s.start, s.startPoint
+	}
+	if s.end > e.OldEndByte {
+		out.end, out.endPoint = shiftByte(s.end, e), shiftPoint(s.endPoint, e)
+	}
+	return out
+}
+
+// shiftByte and shiftPoint move a position at or after the old end of an
+// edit; positions before the edit do not move.
+func shiftByte(b uint, e *tree_sitter.InputEdit) uint {
+	if b < e.OldEndByte {
+		return b
+	}
+	return b - e.OldEndByte + e.NewEndByte
+}
+
+func shiftPoint(p tree_sitter.Point, e *tree_sitter.InputEdit) tree_sitter.Point {
+	old, new := e.OldEndPosition, e.NewEndPosition
+	switch {
+	case p.Row < old.Row || (p.Row == old.Row && p.Column < old.Column):
+		return p
+	case p.Row == old.Row:
+		return tree_sitter.Point{Row: new.Row, Column: p.Column - old.Column + new.Column}
+	default:
+		return tree_sitter.Point{Row: p.Row - old.Row + new.Row, Column: p.Column}
+	}
+}
@@ -0,0 +1,394 @@
+// Package lsp is a language server for Parsley built on the tree-sitter
+// grammar, for editors that only have the TextMate grammar
+// (.vscode-extension) or use tree-sitter for highlighting alone (Zed).
+//
+// Documents are synced incrementally: each didChange event edits the tree
+// in place (ts_tree_edit) and the file is reparsed against it, so a
+// keystroke costs a parse of the region it touched. The server provides
+// diagnostics for ERROR and MISSING nodes, document symbols from
+// queries/tags.scm, folding ranges from queries/folds.scm and semantic
+// tokens from queries/highlights.scm. Symbols, folds and tokens are cached
+// per document and only requeried where an edit or the reparse changed
+// something (see layer), which keeps a 10k-line part interactive.
+//
+// Formatting goes through a Formatter set with SetFormatter. parsley-ls uses
+// pars fmt's, through basil/lower: a formatting request reformats only the
+// top-level statements edited since the document was last formatted, and
+// rangeFormatting the statements the range touches. Without a Formatter the
+// server does not offer formatting.
+package lsp
+
+import (
+	"encoding/json"
+	"errors"
+	"fmt"
+	"io"
+	"slices"
+	"strconv"
+
+	tree_sitter_parsley "github.com/sambeau/tree-sitter-parsley/bindings/go"
+	"github.com/sambeau/tree-sitter-parsley/queries"
+	tree_sitter "github.com/tree-sitter/go-tree-sitter"
+)
+
+// Server serves one client over one connection. It handles messages one at
+// a time, in order, and is not safe for concurrent use.
+type Server struct {
+	parser     *tree_sitter.Parser
+	highlights *tree_sitter.Query
+	folds      *tree_sitter.Query
+	tags       *tree_sitter.Query
+	formatter  Formatter // nil if formatting is not offered
+
+	// Per capture index of each query
+	tokenKinds  []int
+	tokenMods   []uint
+	symbolKinds []int
+	tagName     uint
+
+	conn        *conn
+	encoding    string
+	docs        map[string]*document
+	initialized bool
+	shutdown    bool
+	results     int // semantic token result ids handed out
+}
+
+// NewServer compiles the bundled queries and returns a server with no
+// open documents.
+func NewServer() *Server {
+	language := tree_sitter.NewLanguage(tree_sitter_parsley.Language())
+	parser := tree_sitter.NewParser()
+	if err := parser.SetLanguage(language); err != nil {
+		// Only possible if the generated parser's ABI is not supported
+		// by the linked runtime
+		panic(err)
+	}
+	s := &Server{
+		parser:     parser,
+		highlights: mustQuery(language, queries.Highlights),
+		folds:      mustQuery(language, queries.Folds),
+		tags:       mustQuery(language, queries.Tags),
+		encoding:   encodingUTF16,
+		docs:       make(map[string]*document),
+	}
+	for _, name := range s.highlights.CaptureNames() {
+		kind, mods := tokenIndex(name)
+		s.tokenKinds = append(s.tokenKinds, kind)
+		s.tokenMods = append(s.tokenMods, mods)
+	}
+	for i, name := range s.tags.CaptureNames() {
+		s.symbolKinds = append(s.symbolKinds, symbolKind(name))
+		if name == "name" {
+			s.tagName = uint(i)
+		}
+	}
+	return s
+}
+
+func mustQuery(language *tree_sitter.Language, source string) *tree_sitter.Query {
+	query, err := tree_sitter.NewQuery(language, source)
+	if err != nil {
+		// The bundled queries are compiled by this package's tests, so
+		// this only happens if a query and the grammar disagree
+		panic(err.Error())
+	}
+	return query
+}
+
+// Close frees every open document, the parser and the queries.
+func (s *Server) Close() {
+	for uri, d := range s.docs {
+		d.close()
+		delete(s.docs, uri)
+	}
+	s.parser.Close()
+	s.highlights.Close()
+	s.folds.Close()
+	s.tags.Close()
+}
+
+// SetFormatter sets the formatter for formatting and rangeFormatting
+// requests. Call it before Serve; the server does not close it.
+func (s *Server) SetFormatter(f Formatter) {
+	s.formatter = f
+}
+
+// errExitWithoutShutdown is returned by Serve when the client sends exit
+// before shutdown, which the specification treats as a failure.
+var errExitWithoutShutdown = errors.New("lsp: exit without shutdown")
+
+// Serve reads messages from r and writes replies and notifications to w
+// until the client sends exit or closes r.
+func (s *Server) Serve(r io.Reader, w io.Writer) error {
+	s.conn = newConn(r, w)
+	for {
+		body, err := s.conn.read()
+		if errors.Is(err, io.EOF) {
+			return nil
+		}
+		if err != nil {
+			return err
+		}
+		var m message
+		if err := json.Unmarshal(body, &m); err != nil {
+			if err := s.conn.replyError(nil, &responseError{Code: codeParseError, Message: err.Error()}); err != nil {
+				return err
+			}
+			continue
+		}
+		if m.Method == "exit" {
+			if !s.shutdown {
+				return errExitWithoutShutdown
+			}
+			return nil
+		}
+		if err := s.handle(&m); err != nil {
+			return err
+		}
+	}
+}
+
+// handle dispatches one message. Only write errors are returned: a request
+// that fails gets an error reply, and a failed notification is logged to the
+// client.
+func (s *Server) handle(m *message) error {
+	if m.Method == "" {
+		return nil // a response; the server sends no requests
+	}
+	if m.ID == nil {
+		if err := s.notification(m.Method, m.Params); err != nil {
+			return s.conn.notify("window/logMessage", map[string]any{"type": 1, "message": err.Error()})
+		}
+		return nil
+	}
+
+	result, err := s.request(m.Method, m.Params)
+	if err != nil {
+		var rerr *responseError
+		if !errors.As(err, &rerr) {
+			rerr = &responseError{Code: codeInvalidParams, Message: err.Error()}
+		}
+		return s.conn.replyError(m.ID, rerr)
+	}
+	return s.conn.reply(m.ID, result)
+}
+
+func (s *Server) request(method string, params json.RawMessage) (any, error) {
+	if method == "initialize" {
+		return s.initialize(params)
+	}
+	if !s.initialized {
+		return nil, &responseError{Code: codeServerNotInitialized, Message: "server not initialized"}
+	}
+	if s.shutdown {
+		return nil, &responseError{Code: codeInvalidRequest, Message: "server is shutting down"}
+	}
+
+	switch method {
+	case "shutdown":
+		s.shutdown = true
+		return nil, nil
+	case "textDocument/documentSymbol":
+		return withDocument(s, params, func(d *document, _ TextDocumentParams) any {
+			d.symbols.refresh(d.tree, d.source)
+			return documentSymbols(d)
+		})
+	case "textDocument/foldingRange":
+		return withDocument(s, params, func(d *document, _ TextDocumentParams) any {
+			d.folds.refresh(d.tree, d.source)
+			return foldingRanges(d)
+		})
+	case "textDocument/semanticTokens/full":
+		return withDocument(s, params, func(d *document, _ TextDocumentParams) any {
+			return s.fullTokens(d)
+		})
+	case "textDocument/semanticTokens/full/delta":
+		return withDocument(s, params, func(d *document, p SemanticTokensDeltaParams) any {
+			old, oldID := d.data, d.resultID
+			full := s.fullTokens(d)
+			if oldID == "" || p.PreviousResultID != oldID {
+				return full
+			}
+			return SemanticTokensDelta{ResultID: full.ResultID, Edits: diffTokens(old, full.Data)}
+		})
+	case "textDocument/semanticTokens/range":
+		return withDocument(s, params, func(d *document, p SemanticTokensRangeParams) any {
+			d.tokens.refresh(d.tree, d.source)
+			start, end := d.offset(p.Range.Start), d.offset(p.Range.End)
+			region := span{start: start, end: end, startPoint: d.point(start), endPoint: d.point(end)}
+			return SemanticTokens{Data: encode(d, flatten(d.tokens.within(region)))}
+		})
+	case "textDocument/formatting", "textDocument/rangeFormatting":
+		return withDocument(s, params, func(d *document, p DocumentFormattingParams) any {
+			return s.format(d, p.Range)
+		})
+	}
+	return nil, &responseError{Code: codeMethodNotFound, Message: "method not found: " + method}
+}
+
+// withDocument decodes params for a request about one document and calls
+// f with the document. A document the client never opened has no symbols,
+// folds or tokens, hence the null result rather than an error.
+func withDocument[P any](s *Server, raw json.RawMessage, f func(*document, P) any) (any, error) {
+	var params P
+	if err := json.Unmarshal(raw, &params); err != nil {
+		return nil, err
+	}
+	var uri struct {
+		TextDocument TextDocumentIdentifier `json:"textDocument"`
+	}
+	if err := json.Unmarshal(raw, &uri); err != nil {
+		return nil, err
+	}
+	d := s.docs[uri.TextDocument.URI]
+	if d == nil {
+		return nil, nil
+	}
+	return f(d, params), nil
+}
+
+func (s *Server) initialize(raw json.RawMessage) (any, error) {
+	var params InitializeParams
+	if err := json.Unmarshal(raw, &params); err != nil {
+		return nil, err
+	}
+	// UTF-8 positions are byte columns, tree-sitter's own, so take them
+	// when the client offers them
+	if slices.Contains(params.Capabilities.General.PositionEncodings, encodingUTF8) {
+		s.encoding = encodingUTF8
+	}
+	s.initialized = true
+
+	var result InitializeResult
+	result.ServerInfo.Name = "parsley-ls"
+	result.Capabilities = ServerCapabilities{
+		PositionEncoding: s.encoding,
+		TextDocumentSync: map[string]any{
+			"openClose": true,
+			"change":    2, // incremental
+		},
+		DocumentSymbolProvider: true,
+		FoldingRangeProvider:   true,
+		SemanticTokensProvider: map[string]any{
+			"legend": SemanticTokensLegend{TokenTypes: tokenTypes, TokenModifiers: tokenModifiers},
+			"range":  true,
+			"full":   map[string]any{"delta": true},
+		},
+		DocumentFormattingProvider:      s.formatter != nil,
+		DocumentRangeFormattingProvider: s.formatter != nil,
+	}
+	return result, nil
+}
+
+func (s *Server) notification(method string, raw json.RawMessage) error {
+	if !s.initialized {
+		return nil // dropped, as the specification asks
+	}
+	switch method {
+	case "textDocument/didOpen":
+		var params DidOpenTextDocumentParams
+		if err := json.Unmarshal(raw, &params); err != nil {
+			return err
+		}
+		if old := s.docs[params.TextDocument.URI]; old != nil {
+			old.close()
+		}
+		d := newDocument(s, params.TextDocument)
+		s.docs[d.uri] = d
+		return s.publish(d)
+
+	case "textDocument/didChange":
+		var params DidChangeTextDocumentParams
+		if err := json.Unmarshal(raw, &params); err != nil {
+			return err
+		}
+		d := s.docs[params.TextDocument.URI]
+		if d == nil {
+			return fmt.Errorf("didChange for %s, which is not open", params.TextDocument.URI)
+		}
+		for _, change := range params.ContentChanges {
+			d.change(change)
+		}
+		d.version = params.TextDocument.Version
+		d.reparse(s.parser)
+		return s.publish(d)
+
+	case "textDocument/didClose":
+		var params DidCloseTextDocumentParams
+		if err := json.Unmarshal(raw, &params); err != nil {
+			return err
+		}
+		if d := s.docs[params.TextDocument.URI]; d != nil {
+			d.close()
+			delete(s.docs, d.uri)
+			if s.formatter != nil {
+				s.formatter.Remove(d.uri)
+			}
+			// Clear the closed file's diagnostics
+			return s.conn.notify("textDocument/publishDiagnostics",
+				PublishDiagnosticsParams{URI: d.uri, Diagnostics: []Diagnostic{}})
+		}
+	}
+	// initialized, $/cancelRequest, $/setTrace and the rest need no action
+	return nil
+}
+
+func (s *Server) publish(d *document) error {
+	version := d.version
+	return s.conn.notify("textDocument/publishDiagnostics", PublishDiagnosticsParams{
+		URI:         d.uri,
+		Version:     &version,
+		Diagnostics: diagnostics(d),
+	})
+}
+
+// fullTokens encodes every token in d and remembers the result for the
+// next delta request.
+func (s *Server) fullTokens(d *document) SemanticTokens {
+	d.tokens.refresh(d.tree, d.source)
+	s.results++
+	d.resultID = strconv.Itoa(s.results)
+	d.data = encode(d, flatten(d.tokens.items))
+	return SemanticTokens{ResultID: d.resultID, Data: d.data}
+}
+
+// format returns the edits that format the statements r touches or, for a
+// whole-document request, the statements edited since the document was last
+// found formatted. A document with a syntax error is left alone, since its
+// diagnostics already say why.
+func (s *Server) format(d *document, r *Range) []TextEdit {
+	if s.formatter == nil {
+		return nil
+	}
+	var spans []Span
+	if r != nil {
+		spans = append(spans, Span{Start: int(d.offset(r.Start)), End: int(d.offset(r.End))})
+	} else {
+		for _, u := range d.unformatted {
+			spans = append(spans, Span{Start: int(u.start), End: int(u.end)})
+		}
+	}
+	replacements, errs := s.formatter.FormatRange(d.uri, d.source, spans)
+	if len(errs) > 0 {
+		return nil
+	}
+	// The edits are only known to be applied once the client sends them back
+	// as a didChange, which marks their spans again; the request after that
+	// finds them formatted
+	if r == nil && len(replacements) == 0 {
+		d.unformatted = d.unformatted[:0]
+	}
+
+	edits := make([]TextEdit, 0, len(replacements))
+	for _, rep := range replacements {
+		edits = append(edits, TextEdit{
+			Range: Range{
+				Start: d.position(d.point(uint(rep.Start))),
+				End:   d.position(d.point(uint(rep.End))),
+			},
+			NewText: rep.Text,
+		})
+	}
+	return edits
+}
@@ -0,0 +1,502 @@
+package lsp
+
+import (
+	"bytes"
+	"encoding/json"
+	"errors"
+	"fmt"
+	"io"
+	"math/rand"
+	"reflect"
+	"regexp"
+	"strings"
+	"testing"
+	"unicode/utf8"
+
+	tree_sitter "github.com/tree-sitter/go-tree-sitter"
+)
+
+const page = `// page
+let greet = fn(name) {
+  let msg = "Hello, " + name
+  msg
+}
+export title = "Basil"
+@schema User {
+  name: string
+}
+let items = [
+  1,
+  2,
+]
+<div class="x">
+  greet(` + "`world {title}`" + `)
+</div>
+`
+
+// session frames messages for Serve. An id of 0 makes a notification.
+type session struct {
+	in bytes.Buffer
+}
+
+func (c *session) send(id int, method string, params any) {
+	m := map[string]any{"jsonrpc": "2.0", "method": method, "params": params}
+	if id != 0 {
+		m["id"] = id
+	}
+	body, _ := json.Marshal(m)
+	fmt.Fprintf(&c.in, "Content-Length: %d\r\n\r\n%s", len(body), body)
+}
+
+// run serves the session and returns the replies by id and the
+// notifications in order.
+func (c *session) run(t *testing.T) (map[int]json.RawMessage, []message) {
+	t.Helper()
+	s := NewServer()
+	defer s.Close()
+	var out bytes.Buffer
+	if err := s.Serve(&c.in, &out); err != nil {
+		t.Fatalf("Serve: %v", err)
+	}
+
+	replies := map[int]json.RawMessage{}
+	var notes []message
+	reader := newConn(&out, io.Discard)
+	for {
+		body, err := reader.read()
+		if errors.Is(err, io.EOF) {
+			break
+		}
+		if err != nil {
+			t.Fatal(err)
+		}
+		var m message
+		if err := json.Unmarshal(body, &m); err != nil {
+			t.Fatal(err)
+		}
+		if m.Method != "" {
+			notes = append(notes, m)
+			continue
+		}
+		var id int
+		json.Unmarshal(*m.ID, &id)
+		if m.Error != nil {
+			t.Fatalf("request %d failed: %s", id, m.Error.Message)
+		}
+		replies[id] = m.Result
+	}
+	return replies, notes
+}
+
+func open(c *session, uri, text string) {
+	c.send(0, "textDocument/didOpen", map[string]any{
+		"textDocument": map[string]any{"uri": uri, "languageId": "parsley", "version": 1, "text": text},
+	})
+}
+
+func TestServe(t *testing.T) {
+	const uri = "file:///page.pars"
+	var c session
+	c.send(1, "initialize", map[string]any{"capabilities": map[string]any{}})
+	c.send(0, "initialized", map[string]any{})
+	open(&c, uri, page)
+	doc := map[string]any{"textDocument": map[string]any{"uri": uri}}
+	c.send(2, "textDocument/documentSymbol", doc)
+	c.send(3, "textDocument/foldingRange", doc)
+	c.send(4, "textDocument/semanticTokens/full", doc)
+	// Break the file: drop the closing brace of greet's body
+	c.send(0, "textDocument/didChange", map[string]any{
+		"textDocument": map[string]any{"uri": uri, "version": 2},
+		"contentChanges": []map[string]any{{
+			"range": Range{Start: Position{Line: 4, Character: 0}, End: Position{Line: 4, Character: 1}},
+			"text":  "",
+		}},
+	})
+	c.send(5, "textDocument/semanticTokens/full/delta", map[string]any{
+		"textDocument": map[string]any{"uri": uri}, "previousResultId": "1",
+	})
+	c.send(6, "shutdown", nil)
+	c.send(0, "exit", nil)
+	replies, notes := c.run(t)
+
+	var init InitializeResult
+	json.Unmarshal(replies[1], &init)
+	if init.Capabilities.PositionEncoding != encodingUTF16 {
+		t.Errorf("position encoding = %q, want utf-16 for a client that offers none", init.Capabilities.PositionEncoding)
+	}
+
+	var symbols []DocumentSymbol
+	json.Unmarshal(replies[2], &symbols)
+	got := map[string]int{}
+	var walk func([]DocumentSymbol)
+	walk = func(list []DocumentSymbol) {
+		for _, s := range list {
+			got[s.Name] = s.Kind
+			walk(s.Children)
+		}
+	}
+	walk(symbols)
+	want := map[string]int{"greet": symbolFunction, "title": symbolConstant, "User": symbolClass, "items": symbolConstant}
+	for name, kind := range want {
+		if got[name] != kind {
+			t.Errorf("symbol %s: kind %d, want %d (all: %v)", name, got[name], kind, got)
+		}
+	}
+
+	var folds []FoldingRange
+	json.Unmarshal(replies[3], &folds)
+	starts := map[uint]bool{}
+	for _, f := range folds {
+		starts[f.StartLine] = true
+	}
+	for _, line := range []uint{1, 6, 9, 13} {
+		if !starts[line] {
+			t.Errorf("no fold starting on line %d: %v", line, folds)
+		}
+	}
+
+	var tokens SemanticTokens
+	json.Unmarshal(replies[4], &tokens)
+	if tokens.ResultID != "1" || len(tokens.Data) == 0 || len(tokens.Data)%5 != 0 {
+		t.Errorf("semantic tokens: result %q with %d integers", tokens.ResultID, len(tokens.Data))
+	}
+	var delta SemanticTokensDelta
+	json.Unmarshal(replies[5], &delta)
+	if delta.ResultID != "2" || delta.Edits == nil {
+		t.Errorf("delta: %s", replies[5])
+	}
+	if string(replies[6]) != "null" {
+		t.Errorf("shutdown result = %s, want null", replies[6])
+	}
+
+	// One publishDiagnostics per didOpen and didChange
+	var published []PublishDiagnosticsParams
+	for _, n := range notes {
+		if n.Method == "textDocument/publishDiagnostics" {
+			var p PublishDiagnosticsParams
+			json.Unmarshal(n.Params, &p)
+			published = append(published, p)
+		}
+	}
+	if len(published) != 2 {
+		t.Fatalf("got %d publishDiagnostics, want 2", len(published))
+	}
+	if len(published[0].Diagnostics) != 0 {
+		t.Errorf("clean file has diagnostics: %+v", published[0].Diagnostics)
+	}
+	if len(published[1].Diagnostics) == 0 || *published[1].Version != 2 {
+		t.Errorf("broken file: %+v", published[1])
+	}
+}
+
+func TestExitWithoutShutdown(t *testing.T) {
+	var c session
+	c.send(1, "initialize", map[string]any{"capabilities": map[string]any{}})
+	c.send(0, "exit", nil)
+	s := NewServer()
+	defer s.Close()
+	if err := s.Serve(&c.in, io.Discard); err != errExitWithoutShutdown {
+		t.Errorf("Serve = %v, want %v", err, errExitWithoutShutdown)
+	}
+}
+
+// snapshot is everything the cached layers produce for a document.
+type snapshot struct {
+	Tokens      []uint
+	Folds       []FoldingRange
+	Symbols     []DocumentSymbol
+	Diagnostics []Diagnostic
+}
+
+func take(s *Server, d *document) snapshot {
+	d.symbols.refresh(d.tree, d.source)
+	d.folds.refresh(d.tree, d.source)
+	return snapshot{
+		Tokens:      s.fullTokens(d).Data,
+		Folds:       foldingRanges(d),
+		Symbols:     documentSymbols(d),
+		Diagnostics: diagnostics(d),
+	}
+}
+
+// TestIncrementalMatchesFull checks that after every edit the cached layers
+// match a document opened with the edited text.
+func TestIncrementalMatchesFull(t *testing.T) {
+	s := NewServer()
+	defer s.Close()
+
+	at := func(line, char uint) Position { return Position{Line: line, Character: char} }
+	edits := []struct {
+		name   string
+		change TextDocumentContentChangeEvent
+	}{
+		{"extend an identifier", TextDocumentContentChangeEvent{Range: &Range{at(1, 9), at(1, 9)}, Text: "ing"}},
+		{"insert a function", TextDocumentContentChangeEvent{Range: &Range{at(5, 0), at(5, 0)}, Text: "let shout = fn(x) {\n  x.toUpper()\n}\n"}},
+		{"insert a line above", TextDocumentContentChangeEvent{Range: &Range{at(0, 0), at(0, 0)}, Text: "let s = \"done\"\n"}},
+		{"edit inside a string", TextDocumentContentChangeEvent{Range: &Range{at(0, 9), at(0, 13)}, Text: "finished ✓"}},
+		{"join two lines", TextDocumentContentChangeEvent{Range: &Range{at(3, 28), at(4, 2)}, Text: "; "}},
+		{"delete a block", TextDocumentContentChangeEvent{Range: &Range{at(12, 0), at(16, 0)}, Text: ""}},
+		{"non-ASCII text", TextDocumentContentChangeEvent{Range: &Range{at(8, 16), at(8, 21)}, Text: "Bäsil 🌿"}},
+		{"replace everything", TextDocumentContentChangeEvent{Text: page}},
+	}
+
+	d := newDocument(s, TextDocumentItem{URI: "file:///a.pars", Text: page})
+	defer d.close()
+	take(s, d)
+	for _, e := range edits {
+		d.change(e.change)
+		d.reparse(s.parser)
+		got := take(s, d)
+
+		fresh := newDocument(s, TextDocumentItem{URI: "file:///b.pars", Text: string(d.source)})
+		want := take(s, fresh)
+		fresh.close()
+		if !reflect.DeepEqual(got, want) {
+			t.Errorf("%s: incremental result differs from a fresh parse of\n%s\ngot  %+v\nwant %+v", e.name, d.source, got, want)
+		}
+	}
+}
+
+// applyEdits applies a formatting result the way a client does, as one
+// didChange.
+func applyEdits(s *Server, d *document, edits []TextEdit) {
+	for i := len(edits) - 1; i >= 0; i-- {
+		d.change(TextDocumentContentChangeEvent{Range: &edits[i].Range, Text: edits[i].NewText})
+	}
+	d.reparse(s.parser)
+}
+
+// lineFormatter stands in for pars fmt: a line is a statement, and
+// formatting it collapses its runs of spaces. Source containing "!!" has a
+// syntax error.
+type lineFormatter struct {
+	removed []string
+}
+
+func (f *lineFormatter) FormatRange(uri string, source []byte, spans []Span) ([]Replacement, []string) {
+	if bytes.Contains(source, []byte("!!")) {
+		return nil, []string{"syntax error"}
+	}
+	var replacements []Replacement
+	for start := 0; start < len(source); {
+		end := len(source)
+		if i := bytes.IndexByte(source[start:], '\n'); i >= 0 {
+			end = start + i
+		}
+		for _, s := range spans {
+			if s.Start <= end && s.End >= start {
+				line := string(source[start:end])
+				if formatted := strings.Join(strings.Fields(line), " "); formatted != line {
+					replacements = append(replacements, Replacement{Span{start, end}, formatted})
+				}
+				break
+			}
+		}
+		start = end + 1
+	}
+	return replacements, nil
+}
+
+func (f *lineFormatter) Remove(uri string) {
+	f.removed = append(f.removed, uri)
+}
+
+func TestFormatting(t *testing.T) {
+	s := NewServer()
+	defer s.Close()
+	s.SetFormatter(&lineFormatter{})
+
+	// Non-ASCII text before the end of an edit exercises position encoding
+	d := newDocument(s, TextDocumentItem{URI: "file:///f.pars", Text: "let s  = \"🌿\"  \nlet f = fn(x) {x*2}\nlet b =  f( t )\n"})
+	defer d.close()
+
+	applyEdits(s, d, s.format(d, nil))
+	if got, want := string(d.source), "let s = \"🌿\"\nlet f = fn(x) {x*2}\nlet b = f( t )\n"; got != want {
+		t.Fatalf("formatting gives\n%q\nwant\n%q", got, want)
+	}
+	if edits := s.format(d, nil); len(edits) != 0 || len(d.unformatted) != 0 {
+		t.Fatalf("formatting formatted text = %+v, unformatted %+v; want nothing to do", edits, d.unformatted)
+	}
+
+	// Only the edited statement is formatted again
+	d.change(TextDocumentContentChangeEvent{
+		Range: &Range{Start: Position{Line: 2, Character: 0}, End: Position{Line: 2, Character: 5}},
+		Text:  "let   b",
+	})
+	d.reparse(s.parser)
+	edits := s.format(d, nil)
+	if len(edits) != 1 || edits[0].Range.Start.Line != 2 {
+		t.Errorf("edits = %+v, want one on line 2", edits)
+	}
+	applyEdits(s, d, edits)
+	if got, want := string(d.source), "let s = \"🌿\"\nlet f = fn(x) {x*2}\nlet b = f( t )\n"; got != want {
+		t.Errorf("formatting an edit gives\n%q\nwant\n%q", got, want)
+	}
+
+	// A range formats the statements it touches and nothing else
+	d.change(TextDocumentContentChangeEvent{Text: "let  a=1\nlet  b=2\n"})
+	d.reparse(s.parser)
+	at := Position{Line: 1, Character: 4}
+	applyEdits(s, d, s.format(d, &Range{Start: at, End: at}))
+	if got, want := string(d.source), "let  a=1\nlet b=2\n"; got != want {
+		t.Errorf("rangeFormatting gives %q, want %q", got, want)
+	}
+
+	// A document with a syntax error is left alone
+	d.change(TextDocumentContentChangeEvent{Text: "let  a=!!\n"})
+	d.reparse(s.parser)
+	if edits := s.format(d, nil); len(edits) != 0 {
+		t.Errorf("formatting a syntax error gives %+v, want no edits", edits)
+	}
+}
+
+func TestFormattingNeedsFormatter(t *testing.T) {
+	s := NewServer()
+	defer s.Close()
+	d := newDocument(s, TextDocumentItem{URI: "file:///f.pars", Text: "let  a=1\n"})
+	defer d.close()
+	if edits := s.format(d, nil); edits != nil {
+		t.Errorf("formatting without a formatter gives %+v, want nil", edits)
+	}
+	result, _ := s.initialize(json.RawMessage(`{}`))
+	if caps := result.(InitializeResult).Capabilities; caps.DocumentFormattingProvider || caps.DocumentRangeFormattingProvider {
+		t.Error("expected no formatting capabilities without a formatter")
+	}
+}
+
+// TestLayerEdits drives a layer with random batches of edits and checks it
+// against collecting from scratch. Words stand in for query results: a word
+// only changes when an edit touches it, so no reparse ranges are needed.
+func TestLayerEdits(t *testing.T) {
+	s := NewServer()
+	defer s.Close()
+	word := regexp.MustCompile(`[a-zé]+|[0-9]+`)
+	words := func(d **document) func(*tree_sitter.Tree, []byte, span) []item {
+		return func(_ *tree_sitter.Tree, source []byte, region span) []item {
+			var items []item
+			for _, m := range word.FindAllIndex(source, -1) {
+				start, end := uint(m[0]), uint(m[1])
+				it := item{span: span{start: start, end: end, startPoint: (*d).point(start), endPoint: (*d).point(end)}}
+				if it.intersects(region) {
+					items = append(items, it)
+				}
+			}
+			return items
+		}
+	}
+	opened := func(text string) *document {
+		var d *document
+		d = newDocument(s, TextDocumentItem{Text: text})
+		d.tokens.collect = words(&d)
+		d.tokens.refresh(nil, d.source)
+		return d
+	}
+
+	const text = "let foo = 12 + bar\nlet qux = fn(a) {\n  a + b\n}\né\n"
+	inserts := []string{"", "x", " ", "\n", "1", "ab\ncd", "é", "q2", "zz ", "\r\n"}
+	rng := rand.New(rand.NewSource(1))
+	d := opened(text)
+	for i := 0; i < 2000; i++ {
+		n := len(d.source)
+		a, b := rng.Intn(n+1), rng.Intn(n+1)
+		if a > b {
+			a, b = b, a
+		}
+		for a > 0 && a < n && !utf8.RuneStart(d.source[a]) {
+			a--
+		}
+		for b > a && b < n && !utf8.RuneStart(d.source[b]) {
+			b--
+		}
+		d.change(TextDocumentContentChangeEvent{
+			Range: &Range{d.position(d.point(uint(a))), d.position(d.point(uint(b)))},
+			Text:  inserts[rng.Intn(len(inserts))],
+		})
+		if rng.Intn(3) == 0 {
+			continue // let a batch of edits pile up before refreshing
+		}
+		d.tokens.refresh(nil, d.source)
+		want := opened(string(d.source))
+		if !reflect.DeepEqual(d.lines, want.lines) {
+			t.Fatalf("edit %d: line index %v, want %v", i, d.lines, want.lines)
+		}
+		if !reflect.DeepEqual(d.tokens.items, want.tokens.items) {
+			t.Fatalf("edit %d: %q\ngot  %v\nwant %v", i, d.source, d.tokens.items, want.tokens.items)
+		}
+		want.close()
+		if len(d.source) > 400 {
+			d.close()
+			d = opened(text)
+		}
+	}
+	d.close()
+}
+
+func TestPositions(t *testing.T) {
+	s := NewServer()
+	defer s.Close()
+	d := newDocument(s, TextDocumentItem{Text: "let é = \"😀x\"\r\nnext\n"})
+	defer d.close()
+
+	// é is two bytes and one UTF-16 unit, 😀 four bytes and two units
+	tests := []struct {
+		pos    Position
+		offset uint
+	}{
+		{Position{0, 4}, 4},
+		{Position{0, 5}, 6},
+		{Position{0, 9}, 10},
+		{Position{0, 11}, 14},
+		{Position{0, 99}, 16}, // clamped before \r\n
+		{Position{1, 2}, 20},
+		{Position{5, 0}, 23},
+	}
+	for _, tt := range tests {
+		if got := d.offset(tt.pos); got != tt.offset {
+			t.Errorf("offset(%v) = %d, want %d", tt.pos, got, tt.offset)
+		}
+	}
+	if got := d.position(d.point(14)); got != (Position{0, 11}) {
+		t.Errorf("position of byte 14 = %v, want 0:11", got)
+	}
+
+	d.encoding = encodingUTF8
+	if got := d.offset(Position{0, 10}); got != 10 {
+		t.Errorf("utf-8 offset = %d, want 10", got)
+	}
+}
+
+func TestDiffTokens(t *testing.T) {
+	old := []uint{0, 0, 3, 8, 0, 0, 4, 5, 4, 0}
+	new := []uint{0, 0, 3, 8, 0, 0, 4, 6, 4, 0, 1, 0, 2, 8, 0}
+	got := diffTokens(old, new)
+	want := []SemanticTokensEdit{{Start: 7, DeleteCount: 2, Data: []uint{6, 4, 0, 1, 0, 2, 8}}}
+	if !reflect.DeepEqual(got, want) {
+		t.Errorf("diffTokens = %+v, want %+v", got, want)
+	}
+	if got := diffTokens(old, old); len(got) != 0 {
+		t.Errorf("no change gave edits %+v", got)
+	}
+}
+
+// BenchmarkKeystroke types one character into a 10k-line part and asks for
+// the semantic-token delta, as an editor does after each keystroke.
+func BenchmarkKeystroke(b *testing.B) {
+	text := strings.Repeat(page, 10000/strings.Count(page, "\n")+1)
+	s := NewServer()
+	defer s.Close()
+	d := newDocument(s, TextDocumentItem{URI: "file:///big.part", Text: text})
+	defer d.close()
+	s.fullTokens(d)
+
+	line := uint(5000)
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		at := Position{Line: line, Character: 0}
+		d.change(TextDocumentContentChangeEvent{Range: &Range{at, at}, Text: " "})
+		d.reparse(s.parser)
+		old := d.data
+		diffTokens(old, s.fullTokens(d).Data)
+		diagnostics(d)
+	}
+}
@@ -0,0 +1,134 @@
+package lsp
+
+import tree_sitter "github.com/tree-sitter/go-tree-sitter"
+
+// A mark is a position in both coordinate systems the tokens need.
+type mark struct {
+	offset uint
+	point  tree_sitter.Point
+}
+
+// A segment is a piece of one token that no other token covers.
+type segment struct {
+	start, end mark
+	kind       int
+	mods       uint
+}
+
+// flatten turns nested tokens (an interpolation inside a template string)
+// into segments that do not overlap, the inner token winning, because LSP
+// semantic tokens cannot nest. items must be ordered as in a layer.
+func flatten(items []item) []segment {
+	var segments []segment
+	var stack []item
+	var pos mark
+
+	emit := func(it item, end mark) {
+		start := pos
+		if start.offset < it.start {
+			start = mark{it.start, it.startPoint}
+		}
+		if end.offset > start.offset {
+			segments = append(segments, segment{start: start, end: end, kind: it.kind, mods: it.mods})
+		}
+		pos = end
+	}
+	pop := func() {
+		top := stack[len(stack)-1]
+		emit(top, mark{top.end, top.endPoint})
+		stack = stack[:len(stack)-1]
+	}
+
+	for _, it := range items {
+		for len(stack) > 0 && stack[len(stack)-1].end <= it.start {
+			pop()
+		}
+		if len(stack) > 0 {
+			top := stack[len(stack)-1]
+			if it.end > top.end {
+				continue // crosses the end of the token it starts in
+			}
+			emit(top, mark{it.start, it.startPoint})
+		}
+		pos = mark{it.start, it.startPoint}
+		stack = append(stack, it)
+	}
+	for len(stack) > 0 {
+		pop()
+	}
+	return segments
+}
+
+// encode returns the relative five-integer encoding of segments. Multiline
+// segments are split at line ends, since clients are not required to
+// support tokens that span lines.
+func encode(d *document, segments []segment) []uint {
+	data := make([]uint, 0, len(segments)*5)
+	var prevRow, prevChar uint
+
+	// Columns are converted to the negotiated encoding incrementally, so a
+	// long line with many tokens is scanned once rather than per token
+	var row, column, units uint
+	toUnits := func(r, c uint) uint {
+		if d.encoding == encodingUTF8 {
+			return c
+		}
+		if r != row || c < column {
+			row, column, units = r, 0, 0
+		}
+		line := d.line(r)
+		units += utf16Count(line[min(column, uint(len(line))):min(c, uint(len(line)))])
+		column = c
+		return units
+	}
+
+	add := func(r, startColumn, endColumn uint, s segment) {
+		if endColumn <= startColumn {
+			return
+		}
+		start := toUnits(r, startColumn)
+		length := toUnits(r, endColumn) - start
+		deltaChar := start
+		if r == prevRow {
+			deltaChar = start - prevChar
+		}
+		data = append(data, r-prevRow, deltaChar, length, uint(s.kind), s.mods)
+		prevRow, prevChar = r, start
+	}
+
+	for _, s := range segments {
+		first, last := s.start.point, s.end.point
+		if first.Row == last.Row {
+			add(first.Row, first.Column, last.Column, s)
+			continue
+		}
+		add(first.Row, first.Column, uint(len(d.line(first.Row))), s)
+		for r := first.Row + 1; r < last.Row; r++ {
+			add(r, 0, uint(len(d.line(r))), s)
+		}
+		add(last.Row, 0, last.Column, s)
+	}
+	return data
+}
+
+// diffTokens describes the change from old to new as one edit between their
+// common prefix and suffix, which for a keystroke is a few tokens.
+func diffTokens(old, new []uint) []SemanticTokensEdit {
+	prefix := 0
+	for prefix < len(old) && prefix < len(new) && old[prefix] == new[prefix] {
+		prefix++
+	}
+	if prefix == len(old) && prefix == len(new) {
+		return []SemanticTokensEdit{}
+	}
+	suffix := 0
+	for suffix < len(old)-prefix && suffix < len(new)-prefix &&
+		old[len(old)-1-suffix] == new[len(new)-1-suffix] {
+		suffix++
+	}
+	return []SemanticTokensEdit{{
+		Start:       uint(prefix),
+		DeleteCount: uint(len(old) - prefix - suffix),
+		Data:        append([]uint{}, new[prefix:len(new)-suffix]...),
+	}}
+}
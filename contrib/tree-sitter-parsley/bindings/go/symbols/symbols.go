@@ -0,0 +1,405 @@
+// Package symbols keeps a workspace index of the names Parsley files define
+// and call, built from queries/tags.scm, so editors and tools can jump to a
+// definition in another file without parsing the whole project first.
+//
+// The index lives in one JSON file. Each entry records the file's size,
+// modification time and content hash: Scan skips files whose size and time
+// are unchanged, rehashes the rest, and only reparses a file whose hash is
+// new. Opening a large project therefore costs a directory walk, and a save
+// costs one parse.
+package symbols
+
+import (
+	"crypto/sha256"
+	"encoding/hex"
+	"encoding/json"
+	"errors"
+	"io/fs"
+	"os"
+	"path/filepath"
+	"sort"
+	"strings"
+	"sync"
+
+	tree_sitter_parsley "github.com/sambeau/tree-sitter-parsley/bindings/go"
+	"github.com/sambeau/tree-sitter-parsley/queries"
+	tree_sitter "github.com/tree-sitter/go-tree-sitter"
+)
+
+// version is the index file format; files written with another version are
+// ignored and rebuilt. Bump it when Symbol or tags.scm changes meaning.
+const version = 1
+
+// A Symbol is one tagged name: a definition (let, export, schema, import
+// alias) or a reference (a call, an import source).
+type Symbol struct {
+	Name       string `json:"name"`
+	Kind       string `json:"kind"` // function, class, module, constant or call
+	Definition bool   `json:"definition,omitempty"`
+	Row        uint   `json:"row"`    // zero-based
+	Column     uint   `json:"column"` // in bytes
+	StartByte  uint   `json:"start"`
+	EndByte    uint   `json:"end"`
+}
+
+// A Location is a Symbol and the workspace-relative path it was found in.
+type Location struct {
+	Path string `json:"path"`
+	Symbol
+}
+
+// Stats reports what a Scan did.
+type Stats struct {
+	Files   int // Parsley files in the workspace
+	Read    int // files whose size or time changed and were rehashed
+	Parsed  int // files whose content hash was new
+	Removed int // entries for files that no longer exist
+}
+
+type entry struct {
+	Hash    string   `json:"hash"`
+	Size    int64    `json:"size"`
+	ModTime int64    `json:"mtime"` // UnixNano
+	Symbols []Symbol `json:"symbols"`
+}
+
+type indexFile struct {
+	Version int               `json:"version"`
+	Files   map[string]*entry `json:"files"`
+}
+
+// Index is the symbol index for one workspace. It is safe for concurrent use.
+type Index struct {
+	path string
+
+	mu     sync.Mutex
+	files  map[string]*entry
+	dirty  bool
+	tagger *tagger
+}
+
+// Open loads the index stored at path. A missing, unreadable or outdated
+// index file is not an error: the index is a cache, so it starts empty and
+// the next Scan fills it.
+func Open(path string) (*Index, error) {
+	ix := &Index{path: path, files: map[string]*entry{}}
+	data, err := os.ReadFile(path)
+	if errors.Is(err, fs.ErrNotExist) {
+		return ix, nil
+	}
+	if err != nil {
+		return nil, err
+	}
+	var stored indexFile
+	if json.Unmarshal(data, &stored) == nil && stored.Version == version && stored.Files != nil {
+		ix.files = stored.Files
+	}
+	return ix, nil
+}
+
+// Save writes the index back to its file if anything changed since it was
+// opened or last saved. The file is replaced atomically, so a reader never
+// sees a partial index.
+func (ix *Index) Save() error {
+	ix.mu.Lock()
+	defer ix.mu.Unlock()
+	if !ix.dirty {
+		return nil
+	}
+	data, err := json.Marshal(indexFile{Version: version, Files: ix.files})
+	if err != nil {
+		return err
+	}
+	if err := os.MkdirAll(filepath.Dir(ix.path), 0o755); err != nil {
+		return err
+	}
+	tmp, err := os.CreateTemp(filepath.Dir(ix.path), ".symbols-*")
+	if err != nil {
+		return err
+	}
+	if _, err := tmp.Write(data); err != nil {
+		tmp.Close()
+		os.Remove(tmp.Name())
+		return err
+	}
+	if err := tmp.Close(); err != nil {
+		os.Remove(tmp.Name())
+		return err
+	}
+	if err := os.Rename(tmp.Name(), ix.path); err != nil {
+		os.Remove(tmp.Name())
+		return err
+	}
+	ix.dirty = false
+	return nil
+}
+
+// Close frees the parser and query. The index can still be read and saved.
+func (ix *Index) Close() {
+	ix.mu.Lock()
+	defer ix.mu.Unlock()
+	if ix.tagger != nil {
+		ix.tagger.close()
+		ix.tagger = nil
+	}
+}
+
+// Scan brings the index up to date with the .pars and .part files under
+// root, skipping hidden directories and node_modules. Paths are stored
+// relative to root with forward slashes.
+func (ix *Index) Scan(root string) (Stats, error) {
+	var stats Stats
+	seen := map[string]bool{}
+	err := filepath.WalkDir(root, func(path string, d fs.DirEntry, err error) error {
+		if err != nil {
+			return err
+		}
+		if d.IsDir() {
+			name := d.Name()
+			if path != root && (strings.HasPrefix(name, ".") || name == "node_modules") {
+				return filepath.SkipDir
+			}
+			return nil
+		}
+		if ext := filepath.Ext(path); ext != ".pars" && ext != ".part" {
+			return nil
+		}
+		info, err := d.Info()
+		if err != nil {
+			return err
+		}
+		rel, err := filepath.Rel(root, path)
+		if err != nil {
+			return err
+		}
+		rel = filepath.ToSlash(rel)
+		seen[rel] = true
+		stats.Files++
+
+		ix.mu.Lock()
+		old := ix.files[rel]
+		ix.mu.Unlock()
+		if old != nil && old.Size == info.Size() && old.ModTime == info.ModTime().UnixNano() {
+			return nil
+		}
+
+		source, err := os.ReadFile(path)
+		if err != nil {
+			return err
+		}
+		stats.Read++
+		if ix.update(rel, source, info.Size(), info.ModTime().UnixNano()) {
+			stats.Parsed++
+		}
+		return nil
+	})
+	if err != nil {
+		return stats, err
+	}
+
+	ix.mu.Lock()
+	for path := range ix.files {
+		if !seen[path] {
+			delete(ix.files, path)
+			ix.dirty = true
+			stats.Removed++
+		}
+	}
+	ix.mu.Unlock()
+	return stats, nil
+}
+
+// Update indexes source as the contents of path, for callers such as an
+// editor that have unsaved text rather than a file. It reports whether the
+// source was parsed, which it is not when its hash matches the indexed one.
+func (ix *Index) Update(path string, source []byte) bool {
+	return ix.update(path, source, -1, 0)
+}
+
+func (ix *Index) update(path string, source []byte, size, modTime int64) bool {
+	sum := sha256.Sum256(source)
+	hash := hex.EncodeToString(sum[:])
+
+	ix.mu.Lock()
+	defer ix.mu.Unlock()
+	ix.dirty = true
+	if old := ix.files[path]; old != nil && old.Hash == hash {
+		old.Size, old.ModTime = size, modTime
+		return false
+	}
+	// A copied or reverted file has the hash of an entry we already have
+	for _, other := range ix.files {
+		if other.Hash == hash {
+			ix.files[path] = &entry{Hash: hash, Size: size, ModTime: modTime, Symbols: other.Symbols}
+			return false
+		}
+	}
+	if ix.tagger == nil {
+		ix.tagger = newTagger()
+	}
+	ix.files[path] = &entry{Hash: hash, Size: size, ModTime: modTime, Symbols: ix.tagger.tag(source)}
+	return true
+}
+
+// Remove drops path from the index.
+func (ix *Index) Remove(path string) {
+	ix.mu.Lock()
+	defer ix.mu.Unlock()
+	if _, ok := ix.files[path]; ok {
+		delete(ix.files, path)
+		ix.dirty = true
+	}
+}
+
+// Symbols returns the symbols indexed for path, in source order.
+func (ix *Index) Symbols(path string) []Symbol {
+	ix.mu.Lock()
+	defer ix.mu.Unlock()
+	if e := ix.files[path]; e != nil {
+		return append([]Symbol(nil), e.Symbols...)
+	}
+	return nil
+}
+
+// Definitions returns every definition of name in the workspace, ordered by
+// path and position.
+func (ix *Index) Definitions(name string) []Location {
+	return ix.find(name, true)
+}
+
+// References returns every indexed reference to name (calls and import
+// sources), ordered by path and position.
+func (ix *Index) References(name string) []Location {
+	return ix.find(name, false)
+}
+
+// find scans every entry; the index holds a few symbols per line of source,
+// so even a large workspace is a short loop and needs no name table to keep
+// in step with updates.
+func (ix *Index) find(name string, definition bool) []Location {
+	ix.mu.Lock()
+	defer ix.mu.Unlock()
+	var found []Location
+	for path, e := range ix.files {
+		for _, s := range e.Symbols {
+			if s.Name == name && s.Definition == definition {
+				found = append(found, Location{Path: path, Symbol: s})
+			}
+		}
+	}
+	sort.Slice(found, func(i, j int) bool {
+		if found[i].Path != found[j].Path {
+			return found[i].Path < found[j].Path
+		}
+		return found[i].StartByte < found[j].StartByte
+	})
+	return found
+}
+
+// tagger runs queries/tags.scm. It is not safe for concurrent use; Index
+// only calls it with its lock held.
+type tagger struct {
+	parser *tree_sitter.Parser
+	query  *tree_sitter.Query
+	name   uint // capture index of @name
+	kinds  []string
+}
+
+func newTagger() *tagger {
+	language := tree_sitter.NewLanguage(tree_sitter_parsley.Language())
+	query, err := tree_sitter.NewQuery(language, queries.Tags)
+	if err != nil {
+		// The bundled query is compiled by this package's tests, so this
+		// only happens if tags.scm and the grammar disagree
+		panic(err.Error())
+	}
+	parser := tree_sitter.NewParser()
+	if err := parser.SetLanguage(language); err != nil {
+		panic(err)
+	}
+	t := &tagger{parser: parser, query: query}
+	t.kinds = query.CaptureNames()
+	for i, capture := range t.kinds {
+		if capture == "name" {
+			t.name = uint(i)
+		}
+	}
+	return t
+}
+
+func (t *tagger) close() {
+	t.parser.Close()
+	t.query.Close()
+}
+
+// tag returns the symbols in source. When patterns tag the same name the
+// earliest in tags.scm wins, as in tree-sitter's own tagger, so a let bound
+// to fn(...) is a function and not also a constant.
+func (t *tagger) tag(source []byte) []Symbol {
+	tree := t.parser.Parse(source, nil)
+	if tree == nil {
+		return nil
+	}
+	defer tree.Close()
+
+	cursor := tree_sitter.NewQueryCursor()
+	defer cursor.Close()
+
+	type tagged struct {
+		Symbol
+		pattern uint
+	}
+	best := map[[2]uint]tagged{} // by name start byte and definition
+	matches := cursor.Matches(t.query, tree.RootNode(), source)
+	for match := matches.Next(); match != nil; match = matches.Next() {
+		var name *tree_sitter.Node
+		var capture string
+		for i := range match.Captures {
+			c := &match.Captures[i]
+			if uint(c.Index) == t.name {
+				name = &c.Node
+			} else {
+				capture = t.kinds[c.Index]
+			}
+		}
+		role, kind, ok := strings.Cut(capture, ".")
+		if name == nil || !ok {
+			continue
+		}
+		s := tagged{
+			Symbol: Symbol{
+				Name:       name.Utf8Text(source),
+				Kind:       kind,
+				Definition: role == "definition",
+				Row:        name.StartPosition().Row,
+				Column:     name.StartPosition().Column,
+				StartByte:  name.StartByte(),
+				EndByte:    name.EndByte(),
+			},
+			pattern: match.PatternIndex,
+		}
+		if kind == "module" && !s.Definition {
+			// import sources are strings and paths; index the path itself
+			s.Name = strings.Trim(s.Name, "\"'`")
+		}
+		key := [2]uint{s.StartByte, 0}
+		if s.Definition {
+			key[1] = 1
+		}
+		if old, ok := best[key]; !ok || s.pattern < old.pattern {
+			best[key] = s
+		}
+	}
+
+	symbols := make([]Symbol, 0, len(best))
+	for _, s := range best {
+		symbols = append(symbols, s.Symbol)
+	}
+	sort.Slice(symbols, func(i, j int) bool {
+		if symbols[i].StartByte != symbols[j].StartByte {
+			return symbols[i].StartByte < symbols[j].StartByte
+		}
+		return symbols[i].Definition
+	})
+	return symbols
+}
@@ -0,0 +1,142 @@
+package symbols_test
+
+import (
+	"os"
+	"path/filepath"
+	"testing"
+	"time"
+
+	"github.com/sambeau/tree-sitter-parsley/bindings/go/symbols"
+)
+
+const lib = `// helpers
+let format = fn(x) { x.toString() }
+export greet = fn(name) { "Hello, " + format(name) }
+export title = "Basil"
+@schema User {
+  name: string
+}
+`
+
+const page = `let {greet} = import @./lib.pars
+import @std/math as m
+<p>greet("world")</p>
+`
+
+func write(t *testing.T, path, source string) {
+	t.Helper()
+	if err := os.MkdirAll(filepath.Dir(path), 0o755); err != nil {
+		t.Fatal(err)
+	}
+	if err := os.WriteFile(path, []byte(source), 0o644); err != nil {
+		t.Fatal(err)
+	}
+}
+
+func kinds(syms []symbols.Symbol) map[string]string {
+	got := map[string]string{}
+	for _, s := range syms {
+		if s.Definition {
+			got[s.Name] = s.Kind
+		} else {
+			got[s.Name+"()"] = s.Kind
+		}
+	}
+	return got
+}
+
+func TestTags(t *testing.T) {
+	ix, err := symbols.Open(filepath.Join(t.TempDir(), "symbols.json"))
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer ix.Close()
+	ix.Update("lib.pars", []byte(lib))
+
+	got := kinds(ix.Symbols("lib.pars"))
+	want := map[string]string{
+		"format":     "function",
+		"greet":      "function",
+		"title":      "constant",
+		"User":       "class",
+		"format()":   "call",
+		"toString()": "call",
+	}
+	for name, kind := range want {
+		if got[name] != kind {
+			t.Errorf("%s: kind %q, want %q (all: %v)", name, got[name], kind, got)
+		}
+	}
+}
+
+func TestScanIsIncremental(t *testing.T) {
+	root := t.TempDir()
+	store := filepath.Join(root, ".basil", "symbols.json")
+	write(t, filepath.Join(root, "lib.pars"), lib)
+	write(t, filepath.Join(root, "pages", "index.part"), page)
+	write(t, filepath.Join(root, "node_modules", "x.pars"), lib)
+
+	ix, err := symbols.Open(store)
+	if err != nil {
+		t.Fatal(err)
+	}
+	stats, err := ix.Scan(root)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if stats != (symbols.Stats{Files: 2, Read: 2, Parsed: 2}) {
+		t.Fatalf("first scan: %+v", stats)
+	}
+	if err := ix.Save(); err != nil {
+		t.Fatal(err)
+	}
+	ix.Close()
+
+	// A reopened index only rereads what changed, and only reparses what
+	// has new content
+	ix, err = symbols.Open(store)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer ix.Close()
+	defs := ix.Definitions("greet")
+	if len(defs) != 1 || defs[0].Path != "lib.pars" || defs[0].Row != 2 {
+		t.Fatalf("greet definitions = %+v", defs)
+	}
+	if refs := ix.References("greet"); len(refs) != 1 || refs[0].Path != "pages/index.part" {
+		t.Fatalf("greet references = %+v", refs)
+	}
+
+	if stats, _ := ix.Scan(root); stats != (symbols.Stats{Files: 2}) {
+		t.Fatalf("unchanged scan: %+v", stats)
+	}
+
+	later := time.Now().Add(time.Minute)
+	os.Chtimes(filepath.Join(root, "lib.pars"), later, later)
+	write(t, filepath.Join(root, "copy.pars"), page)
+	if stats, _ := ix.Scan(root); stats != (symbols.Stats{Files: 3, Read: 2}) {
+		t.Fatalf("touched and copied scan: %+v", stats)
+	}
+
+	write(t, filepath.Join(root, "lib.pars"), lib+"export farewell = fn() { \"bye\" }\n")
+	os.Remove(filepath.Join(root, "copy.pars"))
+	if stats, _ := ix.Scan(root); stats != (symbols.Stats{Files: 2, Read: 1, Parsed: 1, Removed: 1}) {
+		t.Fatalf("edited scan: %+v", stats)
+	}
+	if defs := ix.Definitions("farewell"); len(defs) != 1 {
+		t.Fatalf("farewell definitions = %+v", defs)
+	}
+}
+
+func TestOutdatedIndexIsRebuilt(t *testing.T) {
+	store := filepath.Join(t.TempDir(), "symbols.json")
+	write(t, store, `{"version": 0, "files": {"old.pars": {"hash": "x"}}}`)
+	ix, err := symbols.Open(store)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer ix.Close()
+	if syms := ix.Symbols("old.pars"); syms != nil {
+		t.Fatalf("expected an empty index, got %+v", syms)
+	}
+}
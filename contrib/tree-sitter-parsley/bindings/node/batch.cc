@@ -0,0 +1,503 @@
+// Batch parsing for workspace indexing
+//
+// parseFiles(inputs, options?) parses a list of files off the JS main thread
+// and resolves with one compact result per input:
+//
+//   inputs   array of file paths (string) or sources (Buffer)
+//   options  { threads?: number, outline?: boolean, sexp?: boolean,
+//              memory?: boolean, arena?: boolean | number,
+//              timeout?: number, signal?: AbortSignal }
+//
+//   result   { path?, error?, timedOut?, cancelled?, hasError, outline?,
+//              sexp?, memory? }
+//   outline  [{ kind, name, startIndex, endIndex, startPosition: { row, column } }]
+//   memory   { treeBytes, peakBytes, parserBytes, arenaBytes? }
+//
+// Files are parsed in parallel on a pool of native threads, each with its own
+// TSParser. Trees never leave the worker: results carry only the outline
+// (exports, functions, schemas) and, if asked, the tree's S-expression, so
+// nothing has to be rebuilt on the JS side. Buffer inputs are read in place
+// and path inputs are memory-mapped (mapped_file.h), so neither is copied.
+// To keep a file's tree for incremental reparses, use MappedFile (mapped.cc).
+//
+// The addon's runtime allocates through bindings/c/alloc.c, installed when
+// the module loads. `memory` reports, per file, the bytes the tree held,
+// the parse's peak, and what the worker's parser and cursor keep between
+// files. `arena` gives each worker thread an arena instead: the parser,
+// cursor and every tree come from it, frees cost nothing, and the whole
+// arena is released at once whenever it passes the limit (a number of
+// bytes, or 64 MiB for true) and at the end of the batch. In arena mode
+// treeBytes counts every byte the parse took from the arena, garbage
+// included, and arenaBytes is the arena's size after the file.
+//
+// `timeout` is a budget in milliseconds for each file's parse, and `signal`
+// abandons the batch: the runtime's progress callback checks both, so a
+// pathological file or a batch superseded by a newer edit stops within a
+// few microseconds of parsing rather than at the end. A file stopped that
+// way gets { error, timedOut: true } or { error, cancelled: true }, as do the
+// files that had not started when the signal fired; the files already done
+// keep their results.
+
+#include <napi.h>
+#include <tree_sitter/api.h>
+
+#include "alloc.h"
+#include "mapped_file.h"
+#include "parse_budget.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" const TSLanguage *tree_sitter_parsley();
+
+namespace {
+
+// Outline entries: the @name capture names the item, the other capture's
+// name is the item's kind
+const char OUTLINE_QUERY[] = R"scm(
+(export_statement
+  name: (identifier) @name) @export
+
+(export_statement
+  pattern: (identifier) @name) @export
+
+(export_statement
+  pattern: (dictionary_pattern
+    (identifier) @name)) @export
+
+(let_statement
+  pattern: (identifier) @name
+  value: (function_expression)) @function
+
+(assignment_statement
+  left: (identifier) @name
+  right: (function_expression)) @function
+
+(schema_declaration
+  name: (identifier) @name) @schema
+)scm";
+
+#define DEFAULT_ARENA_LIMIT (64u * 1024 * 1024)
+
+struct BatchOptions {
+  unsigned threads = 0;
+  bool outline = true;
+  bool sexp = false;
+  bool memory = false;
+  size_t arena_limit = 0;  // 0 for no arena
+  double timeout_ms = 0;   // 0 for no budget
+};
+
+struct BatchInput {
+  std::string path;            // empty for Buffer inputs
+  const char *data = nullptr;  // Buffer contents, kept alive by the worker
+  size_t length = 0;
+};
+
+struct OutlineItem {
+  std::string kind;
+  std::string name;
+  uint32_t start_byte;
+  uint32_t end_byte;
+  TSPoint start_point;
+};
+
+struct MemoryUsage {
+  int64_t tree_bytes = 0;
+  int64_t peak_bytes = 0;
+  int64_t parser_bytes = 0;
+  size_t arena_bytes = 0;
+};
+
+struct BatchOutput {
+  std::string error;
+  bool timed_out = false;
+  bool cancelled = false;
+  bool has_error = false;
+  std::string sexp;
+  std::vector<OutlineItem> outline;
+  MemoryUsage memory;
+};
+
+// A worker thread's parser and cursor, and the thread's live bytes from
+// before they were created
+struct WorkerState {
+  TSParser *parser = nullptr;
+  TSQueryCursor *cursor = nullptr;
+  int64_t baseline = 0;
+};
+
+// Set by the signal's abort listener, which can outlive the worker
+using CancelFlag = std::shared_ptr<std::atomic<bool>>;
+
+// A TSInput over a Buffer, handed to tree-sitter whole
+struct BufferInput {
+  const char *data;
+  uint32_t length;
+
+  TSInput Input() {
+    TSInput input = {};
+    input.payload = this;
+    input.read = Read;
+    input.encoding = TSInputEncodingUTF8;
+    return input;
+  }
+
+  static const char *Read(void *payload, uint32_t byte_index, TSPoint position,
+                          uint32_t *bytes_read) {
+    (void)position;
+    const BufferInput *buffer = static_cast<const BufferInput *>(payload);
+    if (byte_index >= buffer->length) {
+      *bytes_read = 0;
+      return "";
+    }
+    *bytes_read = buffer->length - byte_index;
+    return buffer->data + byte_index;
+  }
+};
+
+class BatchWorker : public Napi::AsyncWorker {
+ public:
+  BatchWorker(Napi::Env env, std::vector<BatchInput> inputs, BatchOptions options)
+      : Napi::AsyncWorker(env),
+        deferred_(Napi::Promise::Deferred::New(env)),
+        inputs_(std::move(inputs)),
+        outputs_(inputs_.size()),
+        options_(options),
+        cancelled_(std::make_shared<std::atomic<bool>>(false)) {}
+
+  ~BatchWorker() override {
+    if (query_) ts_query_delete(query_);
+  }
+
+  Napi::Promise Promise() { return deferred_.Promise(); }
+
+  // Keep a Buffer input alive until the batch finishes
+  void Retain(Napi::Buffer<char> buffer) {
+    buffers_.push_back(Napi::Persistent(buffer));
+  }
+
+  // Abandon the batch when signal aborts
+  void CancelOn(Napi::Object signal) {
+    if (signal.Get("aborted").ToBoolean()) {
+      cancelled_->store(true);
+      return;
+    }
+    CancelFlag cancelled = cancelled_;
+    Napi::Function listener = Napi::Function::New(
+        Env(), [cancelled](const Napi::CallbackInfo &) { cancelled->store(true); }, "onabort");
+    signal.Get("addEventListener").As<Napi::Function>().Call(
+        signal, {Napi::String::New(Env(), "abort"), listener});
+    signal_ = Napi::Persistent(signal);
+    listener_ = Napi::Persistent(listener);
+  }
+
+  void Execute() override {
+    if (options_.outline) {
+      uint32_t error_offset;
+      TSQueryError error_type;
+      query_ = ts_query_new(tree_sitter_parsley(), OUTLINE_QUERY,
+                            sizeof(OUTLINE_QUERY) - 1, &error_offset, &error_type);
+      if (!query_) {
+        SetError("outline query failed to compile at offset " +
+                 std::to_string(error_offset));
+        return;
+      }
+    }
+
+    unsigned threads = options_.threads;
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+    if (threads > inputs_.size()) threads = static_cast<unsigned>(inputs_.size());
+
+    // The calling libuv thread works too, so start threads - 1 more
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < threads; i++) {
+      pool.emplace_back([this, &next] { Work(next); });
+    }
+    Work(next);
+    for (auto &thread : pool) thread.join();
+  }
+
+  void OnOK() override {
+    Napi::Env env = Env();
+    Napi::Array results = Napi::Array::New(env, outputs_.size());
+    for (size_t i = 0; i < outputs_.size(); i++) {
+      results[i] = ToObject(env, inputs_[i], outputs_[i]);
+    }
+    StopListening();
+    deferred_.Resolve(results);
+  }
+
+  void OnError(const Napi::Error &error) override {
+    StopListening();
+    deferred_.Reject(error.Value());
+  }
+
+ private:
+  void StopListening() {
+    if (signal_.IsEmpty()) return;
+    Napi::Object signal = signal_.Value();
+    signal.Get("removeEventListener").As<Napi::Function>().Call(
+        signal, {Napi::String::New(Env(), "abort"), listener_.Value()});
+    signal_.Reset();
+    listener_.Reset();
+  }
+
+  void Work(std::atomic<size_t> &next) {
+    WorkerState state = OpenWorker();
+    for (size_t i = next++; i < inputs_.size(); i = next++) {
+      Parse(state, inputs_[i], outputs_[i]);
+      if (options_.arena_limit &&
+          tree_sitter_parsley_arena_used() > options_.arena_limit) {
+        CloseWorker(state);
+        state = OpenWorker();
+      }
+    }
+    CloseWorker(state);
+  }
+
+  WorkerState OpenWorker() {
+    WorkerState state;
+    if (options_.arena_limit) tree_sitter_parsley_arena_begin(0);
+    state.baseline = tree_sitter_parsley_alloc_stats().live_bytes;
+    state.parser = ts_parser_new();
+    ts_parser_set_language(state.parser, tree_sitter_parsley());
+    state.cursor = ts_query_cursor_new();
+    return state;
+  }
+
+  void CloseWorker(WorkerState &state) {
+    ts_query_cursor_delete(state.cursor);
+    ts_parser_delete(state.parser);
+    if (options_.arena_limit) tree_sitter_parsley_arena_end();
+    state = WorkerState();
+  }
+
+  void Parse(WorkerState &state, const BatchInput &input, BatchOutput &output) {
+    TSParser *parser = state.parser;
+    TSQueryCursor *cursor = state.cursor;
+    MappedFile file;
+    const char *source = input.data;
+    size_t length = input.length;
+
+    if (cancelled_->load()) {
+      output.error = "cancelled";
+      output.cancelled = true;
+      return;
+    }
+    if (!input.path.empty()) {
+      if (!file.Open(input.path)) {
+        output.error = file.error();
+        return;
+      }
+      source = file.data();
+      length = file.length();
+    }
+    if (length > UINT32_MAX) {
+      output.error = "source is larger than 4 GiB";
+      return;
+    }
+
+    int64_t before = tree_sitter_parsley_alloc_stats().live_bytes;
+    tree_sitter_parsley_alloc_reset_peak();
+    BufferInput buffer{source, static_cast<uint32_t>(length)};
+    TSInput ts_input = input.path.empty() ? buffer.Input() : file.Input();
+    ParseBudget budget{cancelled_.get(), options_.timeout_ms > 0, {}, false};
+    if (budget.has_deadline) {
+      budget.deadline = std::chrono::steady_clock::now() +
+          std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+              std::chrono::duration<double, std::milli>(options_.timeout_ms));
+    }
+    TSParseOptions parse_options = {&budget, OverBudget};
+    TSTree *tree = ts_parser_parse_with_options(parser, nullptr, ts_input, parse_options);
+    if (!tree) {
+      // A halted parse is kept for resuming; the next file starts afresh
+      ts_parser_reset(parser);
+      if (budget.timed_out) {
+        output.error = "timed out";
+        output.timed_out = true;
+      } else if (cancelled_->load()) {
+        output.error = "cancelled";
+        output.cancelled = true;
+      } else {
+        output.error = "parse failed";
+      }
+      return;
+    }
+    TSParsleyAllocStats parsed = tree_sitter_parsley_alloc_stats();
+    output.memory.tree_bytes = parsed.live_bytes - before;
+    output.memory.peak_bytes = parsed.peak_bytes - before;
+    TSNode root = ts_tree_root_node(tree);
+    output.has_error = ts_node_has_error(root);
+
+    if (options_.sexp) {
+      char *sexp = ts_node_string(root);
+      output.sexp = sexp;
+      tree_sitter_parsley_free(sexp);
+    }
+
+    if (query_) {
+      ts_query_cursor_exec(cursor, query_, root);
+      TSQueryMatch match;
+      while (ts_query_cursor_next_match(cursor, &match)) {
+        OutlineItem item{};
+        for (uint16_t c = 0; c < match.capture_count; c++) {
+          TSNode node = match.captures[c].node;
+          uint32_t name_length;
+          const char *capture = ts_query_capture_name_for_id(
+              query_, match.captures[c].index, &name_length);
+          if (std::string(capture, name_length) == "name") {
+            uint32_t start = ts_node_start_byte(node);
+            item.name.assign(source + start, ts_node_end_byte(node) - start);
+          } else {
+            item.kind.assign(capture, name_length);
+            item.start_byte = ts_node_start_byte(node);
+            item.end_byte = ts_node_end_byte(node);
+            item.start_point = ts_node_start_point(node);
+          }
+        }
+        output.outline.push_back(std::move(item));
+      }
+    }
+
+    ts_tree_delete(tree);
+    output.memory.parser_bytes =
+        tree_sitter_parsley_alloc_stats().live_bytes - state.baseline;
+    output.memory.arena_bytes = tree_sitter_parsley_arena_used();
+  }
+
+  Napi::Object ToObject(Napi::Env env, const BatchInput &input,
+                        const BatchOutput &output) {
+    Napi::Object result = Napi::Object::New(env);
+    if (!input.path.empty()) result["path"] = Napi::String::New(env, input.path);
+    if (!output.error.empty()) {
+      result["error"] = Napi::String::New(env, output.error);
+      if (output.timed_out) result["timedOut"] = Napi::Boolean::New(env, true);
+      if (output.cancelled) result["cancelled"] = Napi::Boolean::New(env, true);
+      return result;
+    }
+    result["hasError"] = Napi::Boolean::New(env, output.has_error);
+    if (options_.sexp) result["sexp"] = Napi::String::New(env, output.sexp);
+    if (options_.outline) {
+      Napi::Array outline = Napi::Array::New(env, output.outline.size());
+      for (size_t i = 0; i < output.outline.size(); i++) {
+        const OutlineItem &item = output.outline[i];
+        Napi::Object position = Napi::Object::New(env);
+        position["row"] = Napi::Number::New(env, item.start_point.row);
+        position["column"] = Napi::Number::New(env, item.start_point.column);
+        Napi::Object entry = Napi::Object::New(env);
+        entry["kind"] = Napi::String::New(env, item.kind);
+        entry["name"] = Napi::String::New(env, item.name);
+        entry["startIndex"] = Napi::Number::New(env, item.start_byte);
+        entry["endIndex"] = Napi::Number::New(env, item.end_byte);
+        entry["startPosition"] = position;
+        outline[i] = entry;
+      }
+      result["outline"] = outline;
+    }
+    if (options_.memory) {
+      const MemoryUsage &usage = output.memory;
+      Napi::Object memory = Napi::Object::New(env);
+      memory["treeBytes"] = Napi::Number::New(env, static_cast<double>(usage.tree_bytes));
+      memory["peakBytes"] = Napi::Number::New(env, static_cast<double>(usage.peak_bytes));
+      memory["parserBytes"] = Napi::Number::New(env, static_cast<double>(usage.parser_bytes));
+      if (options_.arena_limit) {
+        memory["arenaBytes"] = Napi::Number::New(env, static_cast<double>(usage.arena_bytes));
+      }
+      result["memory"] = memory;
+    }
+    return result;
+  }
+
+  Napi::Promise::Deferred deferred_;
+  std::vector<BatchInput> inputs_;
+  std::vector<BatchOutput> outputs_;
+  std::vector<Napi::Reference<Napi::Buffer<char>>> buffers_;
+  BatchOptions options_;
+  CancelFlag cancelled_;
+  Napi::ObjectReference signal_;
+  Napi::FunctionReference listener_;
+  TSQuery *query_ = nullptr;
+};
+
+BatchOptions ReadOptions(const Napi::Value &value) {
+  BatchOptions options;
+  if (value.IsUndefined()) return options;
+  if (!value.IsObject()) {
+    throw Napi::TypeError::New(value.Env(), "options must be an object");
+  }
+  Napi::Object object = value.As<Napi::Object>();
+  if (object.Has("threads")) {
+    options.threads = object.Get("threads").ToNumber().Uint32Value();
+  }
+  if (object.Has("outline")) {
+    options.outline = object.Get("outline").ToBoolean();
+  }
+  if (object.Has("sexp")) {
+    options.sexp = object.Get("sexp").ToBoolean();
+  }
+  if (object.Has("memory")) {
+    options.memory = object.Get("memory").ToBoolean();
+  }
+  if (object.Has("timeout")) {
+    double timeout = object.Get("timeout").ToNumber().DoubleValue();
+    options.timeout_ms = timeout > 0 ? timeout : 0;
+  }
+  if (object.Has("arena")) {
+    Napi::Value arena = object.Get("arena");
+    if (arena.IsNumber()) {
+      double limit = arena.As<Napi::Number>().DoubleValue();
+      options.arena_limit = limit >= 1 ? static_cast<size_t>(limit) : 0;
+    } else if (arena.ToBoolean()) {
+      options.arena_limit = DEFAULT_ARENA_LIMIT;
+    }
+  }
+  return options;
+}
+
+}  // namespace
+
+Napi::Value ParseFiles(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  if (info.Length() < 1 || !info[0].IsArray()) {
+    throw Napi::TypeError::New(env, "parseFiles expects an array of paths or Buffers");
+  }
+  Napi::Array list = info[0].As<Napi::Array>();
+  BatchOptions options = ReadOptions(info[1]);
+
+  std::vector<BatchInput> inputs(list.Length());
+  std::vector<Napi::Buffer<char>> buffers;
+  for (uint32_t i = 0; i < list.Length(); i++) {
+    Napi::Value item = list[i];
+    if (item.IsString()) {
+      inputs[i].path = item.As<Napi::String>().Utf8Value();
+    } else if (item.IsBuffer()) {
+      Napi::Buffer<char> buffer = item.As<Napi::Buffer<char>>();
+      inputs[i].data = buffer.Data();
+      inputs[i].length = buffer.Length();
+      buffers.push_back(buffer);
+    } else {
+      throw Napi::TypeError::New(env, "parseFiles inputs must be paths or Buffers");
+    }
+  }
+
+  Napi::Value signal = env.Undefined();
+  if (info[1].IsObject()) signal = info[1].As<Napi::Object>().Get("signal");
+  if (!signal.IsUndefined() && !signal.IsObject()) {
+    throw Napi::TypeError::New(env, "signal must be an AbortSignal");
+  }
+
+  auto *worker = new BatchWorker(env, std::move(inputs), options);
+  for (auto &buffer : buffers) worker->Retain(buffer);
+  if (signal.IsObject()) worker->CancelOn(signal.As<Napi::Object>());
+  Napi::Promise promise = worker->Promise();
+  worker->Queue();
+  return promise;
+}
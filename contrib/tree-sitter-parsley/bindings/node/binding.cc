@@ -4,10 +4,29 @@ typedef struct TSLanguage TSLanguage;
 
 extern "C" TSLanguage *tree_sitter_parsley();
 
+#include "alloc.h"
+
+Napi::Value ParseFiles(const Napi::CallbackInfo &info);
+Napi::Function DefineMappedFile(Napi::Env env);
+
 Napi::Object Init(Napi::Env env, Napi::Object exports) {
   exports["name"] = Napi::String::New(env, "parsley");
   auto language = Napi::External<TSLanguage>::New(env, tree_sitter_parsley());
   exports["language"] = language;
+
+  // Before anything can allocate: the scanner's state comes from the same
+  // allocator (TREE_SITTER_REUSE_ALLOCATOR), even for parsers made by the
+  // tree-sitter package, so it has to be in place before the first one
+  if (!tree_sitter_parsley_alloc_install()) {
+    throw Napi::Error::New(env, "the tree-sitter runtime allocated before the "
+                                "addon could install its allocator");
+  }
+
+  // Native batch parsing on a thread pool (batch.cc)
+  exports["parseFiles"] = Napi::Function::New(env, ParseFiles, "parseFiles");
+
+  // A mapped file and its tree, for incremental reparsing (mapped.cc)
+  exports["MappedFile"] = DefineMappedFile(env);
   return exports;
 }
 
@@ -0,0 +1,289 @@
+// Memory-mapped documents for incremental reparsing
+//
+// new MappedFile(path) maps the file (mapped_file.h), parses it and keeps
+// both the mapping and the tree, like the Rust crate's MappedFile:
+//
+//   file.path, file.length   the mapped path and its size in bytes
+//   file.hasError            whether the current tree has syntax errors
+//   file.edit(edit)          record an edit in the tree, with the fields
+//                            of tree-sitter's Tree.edit: startIndex,
+//                            oldEndIndex, newEndIndex, startPosition,
+//                            oldEndPosition, newEndPosition
+//   file.reparse(options?)   map the file again and parse it against the
+//                            edited tree; returns the changed ranges as
+//                            [{ startIndex, endIndex, startPosition,
+//                               endPosition }]
+//                            options: { timeoutMicros?, signal? }
+//   file.text(start, end)    UTF-8 text of a byte range of the mapping
+//                            (of a copy, if the file has shrunk since it
+//                            was mapped)
+//   file.sexp()              the tree as an S-expression
+//   file.close()             release the tree and the mapping now rather
+//                            than when the object is collected
+//
+// Parsing runs on the calling thread. A reparse after a small edit only
+// relexes the edited region, and the source is read straight from the
+// mapping, so nothing is copied into a JS string. Every edit made since the
+// last parse must be passed to edit() before reparse(), or the old tree is
+// reused for text that has moved.
+//
+// `timeoutMicros` is a budget for the reparse in microseconds, checked from
+// the runtime's progress callback like parseFiles' `timeout`. `signal` is an
+// AbortSignal; the parse runs on the calling thread, so an abort can only
+// land before it starts, and an aborted signal skips the reparse. A stopped
+// reparse throws an Error with `timedOut: true` or `cancelled: true` and
+// keeps the edited tree, so a later reparse() picks up the same edits.
+
+#include <napi.h>
+#include <tree_sitter/api.h>
+
+#include "alloc.h"
+#include "mapped_file.h"
+#include "parse_budget.h"
+
+#include <chrono>
+#include <string>
+
+extern "C" const TSLanguage *tree_sitter_parsley();
+
+namespace {
+
+TSPoint ReadPoint(Napi::Object edit, const char *name) {
+  Napi::Value value = edit.Get(name);
+  if (!value.IsObject()) {
+    throw Napi::TypeError::New(edit.Env(), std::string("edit.") + name +
+                                               " must be { row, column }");
+  }
+  Napi::Object point = value.As<Napi::Object>();
+  return {point.Get("row").ToNumber().Uint32Value(),
+          point.Get("column").ToNumber().Uint32Value()};
+}
+
+uint32_t ReadIndex(Napi::Object edit, const char *name) {
+  Napi::Value value = edit.Get(name);
+  if (!value.IsNumber()) {
+    throw Napi::TypeError::New(edit.Env(), std::string("edit.") + name +
+                                               " must be a number");
+  }
+  return value.As<Napi::Number>().Uint32Value();
+}
+
+Napi::Object PointObject(Napi::Env env, TSPoint point) {
+  Napi::Object object = Napi::Object::New(env);
+  object["row"] = Napi::Number::New(env, point.row);
+  object["column"] = Napi::Number::New(env, point.column);
+  return object;
+}
+
+// An Error for a reparse that was stopped, flagged with `flag: true`
+Napi::Error Stopped(Napi::Env env, const char *message, const char *flag) {
+  Napi::Error error = Napi::Error::New(env, message);
+  error.Value().Set(flag, Napi::Boolean::New(env, true));
+  return error;
+}
+
+class MappedDocument : public Napi::ObjectWrap<MappedDocument> {
+ public:
+  static Napi::Function Define(Napi::Env env) {
+    return DefineClass(env, "MappedFile", {
+        InstanceAccessor<&MappedDocument::Path>("path"),
+        InstanceAccessor<&MappedDocument::Length>("length"),
+        InstanceAccessor<&MappedDocument::HasError>("hasError"),
+        InstanceMethod<&MappedDocument::Edit>("edit"),
+        InstanceMethod<&MappedDocument::Reparse>("reparse"),
+        InstanceMethod<&MappedDocument::Text>("text"),
+        InstanceMethod<&MappedDocument::SExp>("sexp"),
+        InstanceMethod<&MappedDocument::Close>("close"),
+    });
+  }
+
+  explicit MappedDocument(const Napi::CallbackInfo &info)
+      : Napi::ObjectWrap<MappedDocument>(info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsString()) {
+      throw Napi::TypeError::New(env, "MappedFile expects a path");
+    }
+    path_ = info[0].As<Napi::String>().Utf8Value();
+    if (!file_.Open(path_)) {
+      throw Napi::Error::New(env, file_.error());
+    }
+    parser_ = ts_parser_new();
+    ts_parser_set_language(parser_, tree_sitter_parsley());
+    try {
+      tree_ = Parse(env, nullptr);
+    } catch (...) {
+      // The destructor does not run for a constructor that throws
+      Release();
+      throw;
+    }
+  }
+
+  ~MappedDocument() override { Release(); }
+
+ private:
+  // Parse the current mapping, reusing old_tree if given, within budget if
+  // given
+  TSTree *Parse(Napi::Env env, const TSTree *old_tree,
+                ParseBudget *budget = nullptr) {
+    if (!file_.Check()) {
+      throw Napi::Error::New(env, file_.error());
+    }
+    if (file_.length() > UINT32_MAX) {
+      throw Napi::Error::New(env, "source is larger than 4 GiB");
+    }
+    TSTree *tree;
+    if (budget) {
+      TSParseOptions options = {budget, OverBudget};
+      tree = ts_parser_parse_with_options(parser_, old_tree, file_.Input(), options);
+    } else {
+      tree = ts_parser_parse(parser_, old_tree, file_.Input());
+    }
+    if (!tree) {
+      // A halted parse is kept for resuming; the next one starts afresh
+      ts_parser_reset(parser_);
+      if (budget && budget->timed_out) throw Stopped(env, "timed out", "timedOut");
+      throw Napi::Error::New(env, "parse failed");
+    }
+    return tree;
+  }
+
+  // The budget for reparse(options), or false if there is none
+  static bool ReadBudget(const Napi::Value &value, ParseBudget &budget) {
+    Napi::Env env = value.Env();
+    if (value.IsUndefined()) return false;
+    if (!value.IsObject()) {
+      throw Napi::TypeError::New(env, "reparse options must be an object");
+    }
+    Napi::Object options = value.As<Napi::Object>();
+    Napi::Value signal = options.Get("signal");
+    if (!signal.IsUndefined()) {
+      if (!signal.IsObject()) {
+        throw Napi::TypeError::New(env, "options.signal must be an AbortSignal");
+      }
+      if (signal.As<Napi::Object>().Get("aborted").ToBoolean()) {
+        throw Stopped(env, "cancelled", "cancelled");
+      }
+    }
+    Napi::Value timeout = options.Get("timeoutMicros");
+    if (timeout.IsUndefined()) return false;
+    double micros = timeout.ToNumber().DoubleValue();
+    if (!(micros > 0)) return false;
+    budget = {nullptr, true,
+              std::chrono::steady_clock::now() +
+                  std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                      std::chrono::duration<double, std::micro>(micros)),
+              false};
+    return true;
+  }
+
+  void Release() {
+    if (tree_) ts_tree_delete(tree_);
+    if (parser_) ts_parser_delete(parser_);
+    tree_ = nullptr;
+    parser_ = nullptr;
+    file_.Close();
+  }
+
+  void CheckOpen(Napi::Env env) {
+    if (!tree_) throw Napi::Error::New(env, "MappedFile is closed");
+  }
+
+  Napi::Value Path(const Napi::CallbackInfo &info) {
+    return Napi::String::New(info.Env(), path_);
+  }
+
+  Napi::Value Length(const Napi::CallbackInfo &info) {
+    return Napi::Number::New(info.Env(), static_cast<double>(file_.length()));
+  }
+
+  Napi::Value HasError(const Napi::CallbackInfo &info) {
+    CheckOpen(info.Env());
+    return Napi::Boolean::New(info.Env(), ts_node_has_error(ts_tree_root_node(tree_)));
+  }
+
+  Napi::Value Edit(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+    CheckOpen(env);
+    if (info.Length() < 1 || !info[0].IsObject()) {
+      throw Napi::TypeError::New(env, "edit expects an edit object");
+    }
+    Napi::Object edit = info[0].As<Napi::Object>();
+    TSInputEdit input_edit;
+    input_edit.start_byte = ReadIndex(edit, "startIndex");
+    input_edit.old_end_byte = ReadIndex(edit, "oldEndIndex");
+    input_edit.new_end_byte = ReadIndex(edit, "newEndIndex");
+    input_edit.start_point = ReadPoint(edit, "startPosition");
+    input_edit.old_end_point = ReadPoint(edit, "oldEndPosition");
+    input_edit.new_end_point = ReadPoint(edit, "newEndPosition");
+    ts_tree_edit(tree_, &input_edit);
+    return env.Undefined();
+  }
+
+  Napi::Value Reparse(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+    CheckOpen(env);
+    ParseBudget budget{};
+    bool has_budget =
+        ReadBudget(info.Length() > 0 ? info[0] : env.Undefined(), budget);
+    // Open() drops the old mapping first; the tree holds no pointers into it
+    if (!file_.Open(path_)) {
+      throw Napi::Error::New(env, file_.error());
+    }
+    TSTree *tree = Parse(env, tree_, has_budget ? &budget : nullptr);
+
+    uint32_t count = 0;
+    TSRange *ranges = ts_tree_get_changed_ranges(tree_, tree, &count);
+    ts_tree_delete(tree_);
+    tree_ = tree;
+
+    Napi::Array changed = Napi::Array::New(env, count);
+    for (uint32_t i = 0; i < count; i++) {
+      Napi::Object range = Napi::Object::New(env);
+      range["startIndex"] = Napi::Number::New(env, ranges[i].start_byte);
+      range["endIndex"] = Napi::Number::New(env, ranges[i].end_byte);
+      range["startPosition"] = PointObject(env, ranges[i].start_point);
+      range["endPosition"] = PointObject(env, ranges[i].end_point);
+      changed[i] = range;
+    }
+    tree_sitter_parsley_free(ranges);
+    return changed;
+  }
+
+  Napi::Value Text(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+    CheckOpen(env);
+    if (!file_.Check()) {
+      throw Napi::Error::New(env, file_.error());
+    }
+    size_t length = file_.length();
+    size_t start = info.Length() > 0 ? info[0].ToNumber().Uint32Value() : 0;
+    size_t end = info.Length() > 1 ? info[1].ToNumber().Uint32Value() : length;
+    if (end > length) end = length;
+    if (start >= end) return Napi::String::New(env, "");
+    return Napi::String::New(env, file_.data() + start, end - start);
+  }
+
+  Napi::Value SExp(const Napi::CallbackInfo &info) {
+    CheckOpen(info.Env());
+    char *sexp = ts_node_string(ts_tree_root_node(tree_));
+    Napi::String result = Napi::String::New(info.Env(), sexp);
+    tree_sitter_parsley_free(sexp);
+    return result;
+  }
+
+  Napi::Value Close(const Napi::CallbackInfo &info) {
+    Release();
+    return info.Env().Undefined();
+  }
+
+  std::string path_;
+  MappedFile file_;
+  TSParser *parser_ = nullptr;
+  TSTree *tree_ = nullptr;
+};
+
+}  // namespace
+
+Napi::Function DefineMappedFile(Napi::Env env) {
+  return MappedDocument::Define(env);
+}
@@ -0,0 +1,188 @@
+// Read-only memory-mapped source files for the native parse paths
+//
+// The file is mapped instead of read, and tree-sitter pulls UTF-8 chunks
+// straight out of the mapping through a TSInput callback: no read buffer, no
+// JS string and no transcoding, so a large generated data module costs its
+// page cache and nothing more. Windows falls back to reading the file.
+//
+// Reading a page of the mapping past the end of the file raises SIGBUS, so
+// a file truncated after it was mapped would crash the process. Check()
+// looks at the file's size again and, if it has shrunk, swaps the mapping
+// for a copy of what the file holds now; call it before each parse.
+
+#ifndef TREE_SITTER_PARSLEY_MAPPED_FILE_H_
+#define TREE_SITTER_PARSLEY_MAPPED_FILE_H_
+
+#include <tree_sitter/api.h>
+
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+#include <fstream>
+#include <iterator>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Largest slice handed to tree-sitter per read callback
+#define MAPPED_FILE_CHUNK_SIZE (64 * 1024)
+
+class MappedFile {
+ public:
+  MappedFile() = default;
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  ~MappedFile() { Close(); }
+
+  // Map `path`. Returns false and sets error() if it cannot be opened.
+  bool Open(const std::string &path) {
+    Close();
+    path_ = path;
+#ifdef _WIN32
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+      error_ = "cannot read " + path;
+      return false;
+    }
+    contents_.assign(std::istreambuf_iterator<char>(file),
+                     std::istreambuf_iterator<char>());
+    data_ = contents_.data();
+    length_ = contents_.size();
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      error_ = "cannot read " + path;
+      return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+      close(fd);
+      error_ = "cannot stat " + path;
+      return false;
+    }
+    length_ = static_cast<size_t>(info.st_size);
+    // mmap rejects empty mappings; an empty file is just an empty source
+    if (length_ > 0) {
+      void *map = mmap(nullptr, length_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (map == MAP_FAILED) {
+        close(fd);
+        error_ = "cannot map " + path;
+        return false;
+      }
+      madvise(map, length_, MADV_SEQUENTIAL);
+      data_ = static_cast<const char *>(map);
+      mapped_ = true;
+      // Kept open for Check()
+      fd_ = fd;
+      return true;
+    }
+    close(fd);
+#endif
+    return true;
+  }
+
+  // Make sure every byte of data() can be read: if the file is now shorter
+  // than the mapping, replace the mapping with a copy of the file's current
+  // contents. Returns false and sets error() if the file cannot be read.
+  // A file that shrinks while a parse is running can still fault; callers
+  // that replace files by renaming never hit either case.
+  bool Check() {
+#ifndef _WIN32
+    if (!mapped_) return true;
+    struct stat info;
+    if (fstat(fd_, &info) != 0) {
+      error_ = "cannot stat " + path_;
+      return false;
+    }
+    if (static_cast<size_t>(info.st_size) >= length_) return true;
+
+    std::string contents(static_cast<size_t>(info.st_size), '\0');
+    size_t done = 0;
+    while (done < contents.size()) {
+      ssize_t n = pread(fd_, &contents[done], contents.size() - done,
+                        static_cast<off_t>(done));
+      if (n < 0 && errno == EINTR) continue;
+      if (n < 0) {
+        error_ = "cannot read " + path_;
+        return false;
+      }
+      if (n == 0) break;  // shrank again since the fstat
+      done += static_cast<size_t>(n);
+    }
+    contents.resize(done);
+    Unmap();
+    contents_ = std::move(contents);
+    data_ = contents_.data();
+    length_ = contents_.size();
+#endif
+    return true;
+  }
+
+  void Close() {
+#ifndef _WIN32
+    Unmap();
+#endif
+    contents_.clear();
+    data_ = nullptr;
+    length_ = 0;
+  }
+
+  const char *data() const { return data_; }
+  size_t length() const { return length_; }
+  const std::string &error() const { return error_; }
+
+  // A TSInput reading the mapping in MAPPED_FILE_CHUNK_SIZE slices. Valid
+  // for as long as the file stays mapped.
+  TSInput Input() const {
+    TSInput input = {};
+    input.payload = const_cast<MappedFile *>(this);
+    input.read = Read;
+    input.encoding = TSInputEncodingUTF8;
+    return input;
+  }
+
+ private:
+#ifndef _WIN32
+  void Unmap() {
+    if (mapped_) {
+      munmap(const_cast<char *>(data_), length_);
+      close(fd_);
+    }
+    mapped_ = false;
+    fd_ = -1;
+  }
+#endif
+
+  static const char *Read(void *payload, uint32_t byte_index, TSPoint position,
+                          uint32_t *bytes_read) {
+    (void)position;
+    const MappedFile *file = static_cast<const MappedFile *>(payload);
+    if (byte_index >= file->length_) {
+      *bytes_read = 0;
+      return "";
+    }
+    size_t remaining = file->length_ - byte_index;
+    *bytes_read = static_cast<uint32_t>(
+        remaining < MAPPED_FILE_CHUNK_SIZE ? remaining : MAPPED_FILE_CHUNK_SIZE);
+    return file->data_ + byte_index;
+  }
+
+  const char *data_ = nullptr;
+  size_t length_ = 0;
+  bool mapped_ = false;
+  std::string path_;
+  std::string error_;
+  // Windows always reads the file into contents_; elsewhere it holds the
+  // copy Check() falls back to
+  std::string contents_;
+#ifndef _WIN32
+  int fd_ = -1;
+#endif
+};
+
+#endif  // TREE_SITTER_PARSLEY_MAPPED_FILE_H_
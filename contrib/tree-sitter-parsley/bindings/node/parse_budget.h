@@ -0,0 +1,36 @@
+// Time budgets and cancellation for the native parse paths
+//
+// parseFiles (batch.cc) and MappedFile.reparse (mapped.cc) pass a
+// ParseBudget as the payload of ts_parser_parse_with_options' progress
+// callback. The runtime calls it every few hundred operations, so a parse
+// that runs out of time or is cancelled stops within microseconds and
+// returns NULL.
+
+#ifndef TREE_SITTER_PARSLEY_PARSE_BUDGET_H_
+#define TREE_SITTER_PARSLEY_PARSE_BUDGET_H_
+
+#include <tree_sitter/api.h>
+
+#include <atomic>
+#include <chrono>
+
+// What the progress callback checks during one parse
+struct ParseBudget {
+  const std::atomic<bool> *cancelled;  // nullptr if nothing can cancel it
+  bool has_deadline;
+  std::chrono::steady_clock::time_point deadline;
+  bool timed_out;
+};
+
+inline bool OverBudget(TSParseState *state) {
+  ParseBudget *budget = static_cast<ParseBudget *>(state->payload);
+  if (budget->cancelled && budget->cancelled->load(std::memory_order_relaxed)) {
+    return true;
+  }
+  if (budget->has_deadline && std::chrono::steady_clock::now() > budget->deadline) {
+    budget->timed_out = true;
+  }
+  return budget->timed_out;
+}
+
+#endif  // TREE_SITTER_PARSLEY_PARSE_BUDGET_H_
@@ -0,0 +1,142 @@
+//! Counting and arena allocation for the tree-sitter runtime
+//! (`bindings/c/alloc.c`), for batch jobs that need to see and bound what
+//! parsing costs.
+//!
+//! [`install`] routes every runtime allocation through a counting
+//! allocator; [`stats`] then reports the calling thread's live and peak
+//! bytes, so the bytes a tree holds are the change in `live_bytes` across a
+//! parse. An [`Arena`] makes the thread's allocations come from large chunks
+//! instead: frees cost nothing, and dropping the arena releases everything
+//! allocated while it was open.
+//!
+//! ```no_run
+//! # let paths: Vec<std::path::PathBuf> = vec![];
+//! unsafe { tree_sitter_parsley::alloc::install() }.unwrap();
+//!
+//! for batch in paths.chunks(1000) {
+//!     // Safety: the parser and trees are dropped before the arena
+//!     let arena = unsafe { tree_sitter_parsley::alloc::Arena::open(0) }.unwrap();
+//!     let mut parser = tree_sitter::Parser::new();
+//!     parser.set_language(&tree_sitter_parsley::LANGUAGE.into()).unwrap();
+//!     for path in batch {
+//!         let source = std::fs::read(path).unwrap();
+//!         let tree = parser.parse(&source, None).unwrap();
+//!         // ... index the tree into owned data ...
+//!     }
+//!     drop(parser);
+//!     println!("batch used {} bytes", arena.close());
+//! }
+//! ```
+
+use std::fmt;
+use std::marker::PhantomData;
+
+/// Allocation counters for the calling thread.
+///
+/// A block freed on another thread is subtracted there, so `live_bytes` is
+/// only exact for work that stays on one thread, as a parse does.
+#[repr(C)]
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct AllocStats {
+    /// Bytes allocated and not yet freed, arena bytes included.
+    pub live_bytes: i64,
+    /// The highest `live_bytes` since the last [`reset_peak`].
+    pub peak_bytes: i64,
+    /// Allocation calls, counting reallocations that grow a block.
+    pub allocations: u64,
+    /// Bytes held in chunks by the open arena.
+    pub arena_reserved: usize,
+}
+
+extern "C" {
+    fn tree_sitter_parsley_alloc_install() -> bool;
+    fn tree_sitter_parsley_alloc_stats() -> AllocStats;
+    fn tree_sitter_parsley_alloc_reset_peak();
+    fn tree_sitter_parsley_arena_begin(chunk_size: usize) -> bool;
+    fn tree_sitter_parsley_arena_end() -> usize;
+    fn tree_sitter_parsley_arena_used() -> usize;
+}
+
+/// Returned by [`install`] when the runtime allocated before it was called.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub struct AlreadyAllocated;
+
+impl fmt::Display for AlreadyAllocated {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.write_str("the tree-sitter runtime allocated before alloc::install")
+    }
+}
+
+impl std::error::Error for AlreadyAllocated {}
+
+/// Installs the counting allocator in the tree-sitter runtime. Calling it
+/// again after it succeeded does nothing.
+///
+/// Fails, leaving the runtime's allocator as it was, once any `Parser`,
+/// `Tree`, `Query` or `QueryCursor` has been created: a block allocated
+/// before would later be freed by an allocator that does not know it.
+///
+/// # Safety
+///
+/// No other thread may use the runtime while it runs.
+pub unsafe fn install() -> Result<(), AlreadyAllocated> {
+    if tree_sitter_parsley_alloc_install() {
+        Ok(())
+    } else {
+        Err(AlreadyAllocated)
+    }
+}
+
+/// The calling thread's counters.
+pub fn stats() -> AllocStats {
+    unsafe { tree_sitter_parsley_alloc_stats() }
+}
+
+/// Starts a new peak measurement from the current live size.
+pub fn reset_peak() {
+    unsafe { tree_sitter_parsley_alloc_reset_peak() }
+}
+
+/// An arena open on the current thread. Dropping it, or [`Arena::close`],
+/// releases every block allocated on this thread while it was open.
+pub struct Arena {
+    // Arenas are per thread, so the guard must stay on its thread
+    _thread: PhantomData<*const ()>,
+}
+
+impl Arena {
+    /// Opens an arena that reserves memory in chunks of at least
+    /// `chunk_size` bytes (0 for 4 MiB). Returns `None` if [`install`] has
+    /// not been called or this thread already has an arena open.
+    ///
+    /// # Safety
+    ///
+    /// Every parser, tree and query cursor created on this thread while the
+    /// arena is open must be dropped before the arena, and must not move to
+    /// another thread that outlives it.
+    pub unsafe fn open(chunk_size: usize) -> Option<Arena> {
+        tree_sitter_parsley_arena_begin(chunk_size).then_some(Arena {
+            _thread: PhantomData,
+        })
+    }
+
+    /// Bytes handed out by the arena so far.
+    pub fn used(&self) -> usize {
+        unsafe { tree_sitter_parsley_arena_used() }
+    }
+
+    /// Closes the arena and returns the bytes it released.
+    pub fn close(self) -> usize {
+        let released = unsafe { tree_sitter_parsley_arena_end() };
+        std::mem::forget(self);
+        released
+    }
+}
+
+impl Drop for Arena {
+    fn drop(&mut self) {
+        unsafe {
+            tree_sitter_parsley_arena_end();
+        }
+    }
+}
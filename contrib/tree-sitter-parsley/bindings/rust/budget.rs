@@ -0,0 +1,149 @@
+//! Parsing under a time budget, with cancellation.
+//!
+//! An editor that reparses on every keystroke, or a server handed a 1 MB
+//! generated file, needs to give up on a parse that is no longer wanted. A
+//! [`Budget`] carries a deadline, a [`CancellationToken`], or both.
+//! [`parse`] checks them from the runtime's progress callback, so a parse
+//! stops within microseconds of its budget running out instead of running to
+//! the end.
+//!
+//! ```no_run
+//! use std::time::Duration;
+//! use tree_sitter_parsley::budget::{self, Budget, CancellationToken};
+//!
+//! let mut parser = tree_sitter::Parser::new();
+//! parser.set_language(&tree_sitter_parsley::LANGUAGE.into()).unwrap();
+//!
+//! // One token per edit: a newer edit cancels the parse of the last one
+//! let token = CancellationToken::new();
+//! let limits = Budget::new().timeout(Duration::from_millis(50)).cancel_on(&token);
+//! # let source = b"let x = 1";
+//! match budget::parse(&mut parser, source, None, &limits) {
+//!     Ok(tree) => { /* use the new tree */ }
+//!     Err(stopped) => eprintln!("kept the previous tree: {stopped}"),
+//! }
+//! ```
+
+use std::fmt;
+use std::ops::ControlFlow;
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::Arc;
+use std::time::{Duration, Instant};
+
+use tree_sitter::{ParseOptions, ParseState, Parser, Tree};
+
+/// A flag shared between the code that starts parses and the code that
+/// wants them stopped. Clones share the flag.
+#[derive(Clone, Debug, Default)]
+pub struct CancellationToken(Arc<AtomicBool>);
+
+impl CancellationToken {
+    /// A token that has not been cancelled.
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Stops every parse using this token, from any thread.
+    pub fn cancel(&self) {
+        self.0.store(true, Ordering::Relaxed);
+    }
+
+    pub fn is_cancelled(&self) -> bool {
+        self.0.load(Ordering::Relaxed)
+    }
+}
+
+/// Limits on one parse. The timeout counts from the start of each parse.
+#[derive(Clone, Debug, Default)]
+pub struct Budget {
+    timeout: Option<Duration>,
+    token: Option<CancellationToken>,
+}
+
+impl Budget {
+    /// No limits.
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Stop a parse that takes longer than `timeout`.
+    pub fn timeout(mut self, timeout: Duration) -> Self {
+        self.timeout = Some(timeout);
+        self
+    }
+
+    /// Stop a parse once `token` is cancelled.
+    pub fn cancel_on(mut self, token: &CancellationToken) -> Self {
+        self.token = Some(token.clone());
+        self
+    }
+
+    /// Whether the budget's token has been cancelled.
+    pub fn is_cancelled(&self) -> bool {
+        self.token
+            .as_ref()
+            .is_some_and(CancellationToken::is_cancelled)
+    }
+}
+
+/// Why [`parse`] gave up.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum Stopped {
+    /// The parse ran past the budget's timeout.
+    TimedOut,
+    /// The budget's token was cancelled.
+    Cancelled,
+}
+
+impl fmt::Display for Stopped {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.write_str(match self {
+            Stopped::TimedOut => "parse timed out",
+            Stopped::Cancelled => "parse cancelled",
+        })
+    }
+}
+
+impl std::error::Error for Stopped {}
+
+/// Parses `source` within `budget`, reusing `old_tree` as
+/// [`Parser::parse`] does. A parse that is stopped returns why, and the
+/// parser is reset, so the next call starts a new parse rather than
+/// resuming this one; the caller keeps whatever tree it had before.
+pub fn parse(
+    parser: &mut Parser,
+    source: &[u8],
+    old_tree: Option<&Tree>,
+    budget: &Budget,
+) -> Result<Tree, Stopped> {
+    if budget.is_cancelled() {
+        return Err(Stopped::Cancelled);
+    }
+    let deadline = budget.timeout.map(|timeout| Instant::now() + timeout);
+    let mut timed_out = false;
+    let mut progress = |_: &ParseState| {
+        if budget.is_cancelled() {
+            return ControlFlow::Break(());
+        }
+        if deadline.is_some_and(|deadline| Instant::now() > deadline) {
+            timed_out = true;
+            return ControlFlow::Break(());
+        }
+        ControlFlow::Continue(())
+    };
+    let options = ParseOptions::new().progress_callback(&mut progress);
+
+    let mut read = |offset: usize, _| source.get(offset..).unwrap_or(&[]);
+    let tree = parser.parse_with_options(&mut read, old_tree, Some(options));
+    match tree {
+        Some(tree) => Ok(tree),
+        None => {
+            parser.reset();
+            Err(if timed_out {
+                Stopped::TimedOut
+            } else {
+                Stopped::Cancelled
+            })
+        }
+    }
+}
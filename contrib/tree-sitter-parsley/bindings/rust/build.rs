@@ -15,5 +15,12 @@ fn main() {
         println!("cargo:rerun-if-changed={}", scanner_path.to_str().unwrap());
     }
 
+    // The counting and arena allocator; the scanner allocates through it too
+    if std::env::var_os("CARGO_FEATURE_ARENA").is_some() {
+        let alloc_path = std::path::Path::new("bindings/c/alloc.c");
+        c_config.file(alloc_path).define("TREE_SITTER_REUSE_ALLOCATOR", None);
+        println!("cargo:rerun-if-changed={}", alloc_path.to_str().unwrap());
+    }
+
     c_config.compile("tree-sitter-parsley");
 }
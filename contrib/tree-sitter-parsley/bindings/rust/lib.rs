@@ -22,6 +22,25 @@
 
 use tree_sitter_language::LanguageFn;
 
+#[cfg(feature = "arena")]
+pub mod alloc;
+
+#[cfg(feature = "budget")]
+pub mod budget;
+
+#[cfg(feature = "mmap")]
+mod mapped;
+#[cfg(feature = "mmap")]
+pub use mapped::MappedFile;
+
+#[cfg(feature = "queries")]
+mod queries;
+#[cfg(feature = "queries")]
+pub use queries::{highlights_query, injections_query, tags_query};
+
+#[cfg(feature = "workspace")]
+pub mod workspace;
+
 extern "C" {
     fn tree_sitter_parsley() -> *const ();
 }
@@ -34,11 +53,160 @@ pub const LANGUAGE: LanguageFn = unsafe { LanguageFn::from_raw(tree_sitter_parsl
 /// The content of the [`queries/highlights.scm`][] file.
 pub const HIGHLIGHTS_QUERY: &str = include_str!("../../queries/highlights.scm");
 
+/// The content of the [`queries/injections.scm`][] file.
+pub const INJECTIONS_QUERY: &str = include_str!("../../queries/injections.scm");
+
+/// The content of the [`queries/injections-per-tag.scm`][] file: the same
+/// injections, parsed one tag at a time instead of combined per file.
+pub const INJECTIONS_PER_TAG_QUERY: &str = include_str!("../../queries/injections-per-tag.scm");
+
+/// The content of the [`queries/tags.scm`][] file.
+pub const TAGS_QUERY: &str = include_str!("../../queries/tags.scm");
+
+/// The content of the [`queries/locals.scm`][] file.
+pub const LOCALS_QUERY: &str = include_str!("../../queries/locals.scm");
+
+/// The content of the [`queries/folds.scm`][] file.
+pub const FOLDS_QUERY: &str = include_str!("../../queries/folds.scm");
+
 /// The tree-sitter node types as JSON.
 pub const NODE_TYPES: &str = include_str!("../../src/node-types.json");
 
 #[cfg(test)]
 mod tests {
+    #[cfg(feature = "mmap")]
+    #[test]
+    fn test_parse_mapped_file() {
+        let path = std::env::temp_dir().join("tree-sitter-parsley-mapped.pars");
+        std::fs::write(&path, "let x = 42\n").unwrap();
+
+        let mut parser = tree_sitter::Parser::new();
+        parser.set_language(&super::LANGUAGE.into()).unwrap();
+        let mut file = super::MappedFile::open(&path).unwrap();
+        let tree = file.parse(&mut parser, None).unwrap().unwrap();
+        assert!(!tree.root_node().has_error());
+        assert_eq!(tree.root_node().end_byte(), file.source().len());
+
+        // Truncated under the mapping: parse reads a copy instead of faulting
+        std::fs::OpenOptions::new()
+            .write(true)
+            .open(&path)
+            .unwrap()
+            .set_len(5)
+            .unwrap();
+        let tree = file.parse(&mut parser, None).unwrap().unwrap();
+        assert_eq!(file.source(), b"let x");
+        assert_eq!(tree.root_node().end_byte(), 5);
+
+        std::fs::remove_file(&path).unwrap();
+    }
+
+    #[cfg(feature = "workspace")]
+    #[test]
+    fn test_parse_workspace() {
+        use super::workspace::{parse_workspace, Output, Parse, WorkspaceOptions};
+
+        let dir = std::env::temp_dir().join("tree-sitter-parsley-workspace");
+        std::fs::create_dir_all(&dir).unwrap();
+        let mut paths: Vec<_> = (0..20)
+            .map(|i| {
+                let path = dir.join(format!("m{i}.pars"));
+                let source = format!("let f{i} = fn(x) {{ x }}\nexport c{i} = 1\n");
+                std::fs::write(&path, source).unwrap();
+                path
+            })
+            .collect();
+        paths.insert(3, dir.join("missing.pars"));
+
+        let options = WorkspaceOptions {
+            threads: 4,
+            output: Output::Outline,
+            ..Default::default()
+        };
+        let files = parse_workspace(&paths, &options);
+        assert_eq!(files.len(), paths.len());
+        for (file, path) in files.iter().zip(&paths) {
+            assert_eq!(&file.path, path, "files come back in order");
+            let Ok(Parse::Outline { symbols, has_error }) = &file.result else {
+                assert!(file.result.is_err() && path.ends_with("missing.pars"));
+                continue;
+            };
+            assert!(!has_error);
+            let outline: Vec<_> = symbols.iter().map(|s| (s.kind, s.name.clone())).collect();
+            let i = &path.file_stem().unwrap().to_str().unwrap()[1..];
+            assert_eq!(outline, [("function", format!("f{i}")), ("constant", format!("c{i}"))]);
+            assert!(file.timings.parse > std::time::Duration::ZERO);
+        }
+
+        // Parsers go back to the pool for the next run
+        assert!(super::workspace::ParserPool::shared().idle() >= 1);
+        let options = WorkspaceOptions {
+            output: Output::Tree,
+            ..options
+        };
+        let Ok(Parse::Tree { tree, .. }) = &parse_workspace(&paths[..1], &options)[0].result else {
+            panic!("expected a tree");
+        };
+        assert!(!tree.root_node().has_error());
+
+        std::fs::remove_dir_all(&dir).unwrap();
+    }
+
+    #[cfg(feature = "budget")]
+    #[test]
+    fn test_budget_stops_parse() {
+        use super::budget::{self, Budget, CancellationToken, Stopped};
+        use std::time::Duration;
+
+        let mut parser = tree_sitter::Parser::new();
+        parser.set_language(&super::LANGUAGE.into()).unwrap();
+        let source = "let xs = [{a: 1}, {b: `t {x}`}]\n".repeat(50_000);
+
+        let token = CancellationToken::new();
+        token.cancel();
+        let cancelled = Budget::new().cancel_on(&token);
+        let result = budget::parse(&mut parser, source.as_bytes(), None, &cancelled);
+        assert_eq!(result.err(), Some(Stopped::Cancelled));
+
+        let tight = Budget::new().timeout(Duration::from_nanos(1));
+        let result = budget::parse(&mut parser, source.as_bytes(), None, &tight);
+        assert_eq!(result.err(), Some(Stopped::TimedOut));
+
+        // The stopped parse is not resumed: a new source parses in full
+        let tree = budget::parse(&mut parser, b"let x = 1", None, &Budget::new()).unwrap();
+        assert_eq!(tree.root_node().end_byte(), 9);
+        assert!(!tree.root_node().has_error());
+    }
+
+    // The bundled queries ship pre-validated: a query that no longer matches
+    // the grammar fails here rather than at an embedder's startup
+    #[test]
+    fn test_bundled_queries_compile() {
+        for (name, language, source) in [
+            ("highlights", super::LANGUAGE, super::HIGHLIGHTS_QUERY),
+            ("injections", super::LANGUAGE, super::INJECTIONS_QUERY),
+            ("per-tag injections", super::LANGUAGE, super::INJECTIONS_PER_TAG_QUERY),
+            ("tags", super::LANGUAGE, super::TAGS_QUERY),
+            ("locals", super::LANGUAGE, super::LOCALS_QUERY),
+            ("folds", super::LANGUAGE, super::FOLDS_QUERY),
+        ] {
+            if let Err(error) = tree_sitter::Query::new(&language.into(), source) {
+                panic!("{name} query: {error}");
+            }
+        }
+    }
+
+    #[cfg(feature = "queries")]
+    #[test]
+    fn test_compiled_queries_are_shared() {
+        let first = super::highlights_query() as *const tree_sitter::Query;
+        let other = std::thread::spawn(|| super::highlights_query() as *const _ as usize)
+            .join()
+            .unwrap();
+        assert_eq!(first as usize, other);
+        assert!(super::injections_query().pattern_count() > 0);
+    }
+
     #[test]
     fn test_can_load_grammar() {
         let mut parser = tree_sitter::Parser::new();
@@ -0,0 +1,150 @@
+//! Memory-mapped source files.
+//!
+//! [`MappedFile`] maps a `.pars` file read-only and feeds tree-sitter from the
+//! mapping in UTF-8 chunks. The source is never read into a buffer or copied
+//! into a `String`. The mapping outlives the parse, so a tree and the
+//! [`MappedFile`] it came from can be kept together for incremental reparses
+//! and for reading node text.
+//!
+//! ```no_run
+//! # fn main() -> std::io::Result<()> {
+//! use tree_sitter_parsley::MappedFile;
+//!
+//! let mut parser = tree_sitter::Parser::new();
+//! parser.set_language(&tree_sitter_parsley::LANGUAGE.into()).unwrap();
+//!
+//! let mut file = MappedFile::open("data/catalogue.pars")?;
+//! let mut tree = file.parse(&mut parser, None)?.unwrap();
+//!
+//! // Later, after the file changed on disk:
+//! file.remap()?;
+//! # let edit = tree_sitter::InputEdit {
+//! #     start_byte: 0, old_end_byte: 0, new_end_byte: 0,
+//! #     start_position: Default::default(),
+//! #     old_end_position: Default::default(),
+//! #     new_end_position: Default::default(),
+//! # };
+//! tree.edit(&edit);
+//! let tree = file.parse(&mut parser, Some(&tree))?.unwrap();
+//! # Ok(())
+//! # }
+//! ```
+
+use std::fs::File;
+use std::io::{self, Read, Seek, SeekFrom};
+use std::path::{Path, PathBuf};
+
+use memmap2::Mmap;
+use tree_sitter::{Parser, Tree};
+
+/// Largest slice handed to tree-sitter per read callback.
+const CHUNK_SIZE: usize = 64 * 1024;
+
+/// A read-only memory-mapped source file. See the [module docs](self).
+///
+/// Like any file mapping, the contents change if the file is rewritten in
+/// place. Reading a page past the end of a file that was truncated after it
+/// was mapped raises SIGBUS, so [`MappedFile::parse`] first calls
+/// [`MappedFile::check`], which falls back to a copy of the file if it has
+/// shrunk. Editors and Basil's watcher replace files by renaming, which
+/// leaves the old mapping intact until [`MappedFile::remap`] is called.
+pub struct MappedFile {
+    path: PathBuf,
+    source: Source,
+}
+
+enum Source {
+    // Zero-length mappings are rejected
+    Empty,
+    // The file stays open so check() can look at its size again
+    Mapped { file: File, map: Mmap },
+    // What a file that shrank under its mapping held at the time
+    Copied(Vec<u8>),
+}
+
+impl MappedFile {
+    /// Map the file at `path`.
+    pub fn open(path: impl AsRef<Path>) -> io::Result<Self> {
+        let path = path.as_ref().to_path_buf();
+        let source = Self::map(&path)?;
+        Ok(Self { path, source })
+    }
+
+    /// Map the file again, picking up changes made since it was opened.
+    ///
+    /// Call [`Tree::edit`] on the old tree before reparsing it against the
+    /// new contents.
+    pub fn remap(&mut self) -> io::Result<()> {
+        self.source = Self::map(&self.path)?;
+        Ok(())
+    }
+
+    /// The path this file was mapped from.
+    pub fn path(&self) -> &Path {
+        &self.path
+    }
+
+    /// The mapped source, for reading node text with
+    /// [`Node::utf8_text`](tree_sitter::Node::utf8_text). Call
+    /// [`MappedFile::check`] first if the file may have been truncated since
+    /// the last parse.
+    pub fn source(&self) -> &[u8] {
+        match &self.source {
+            Source::Empty => &[],
+            Source::Mapped { map, .. } => map,
+            Source::Copied(bytes) => bytes,
+        }
+    }
+
+    /// Make sure every byte of [`MappedFile::source`] can be read. If the
+    /// file is now shorter than the mapping, the mapping is replaced with a
+    /// copy of what the file holds. A file that shrinks while a parse is
+    /// running can still fault.
+    pub fn check(&mut self) -> io::Result<()> {
+        let Source::Mapped { file, map } = &self.source else {
+            return Ok(());
+        };
+        let len = file.metadata()?.len();
+        if len >= map.len() as u64 {
+            return Ok(());
+        }
+        let mut file = file;
+        file.seek(SeekFrom::Start(0))?;
+        let mut bytes = Vec::with_capacity(len as usize);
+        file.take(len).read_to_end(&mut bytes)?;
+        self.source = Source::Copied(bytes);
+        Ok(())
+    }
+
+    /// Parse the mapped source, reusing `old_tree` for an incremental
+    /// reparse. Fails only if [`MappedFile::check`] does.
+    pub fn parse(
+        &mut self,
+        parser: &mut Parser,
+        old_tree: Option<&Tree>,
+    ) -> io::Result<Option<Tree>> {
+        self.check()?;
+        let source = self.source();
+        let mut read = move |offset: usize, _| chunk(source, offset);
+        Ok(parser.parse_with_options(&mut read, old_tree, None))
+    }
+
+    fn map(path: &Path) -> io::Result<Source> {
+        let file = File::open(path)?;
+        if file.metadata()?.len() == 0 {
+            return Ok(Source::Empty);
+        }
+        // SAFETY: the mapping is read-only; see the type-level note on
+        // files that change underneath it.
+        let map = unsafe { Mmap::map(&file)? };
+        #[cfg(unix)]
+        map.advise(memmap2::Advice::Sequential)?;
+        Ok(Source::Mapped { file, map })
+    }
+}
+
+/// The slice of `source` starting at `offset`, at most [`CHUNK_SIZE`] long.
+fn chunk(source: &[u8], offset: usize) -> &[u8] {
+    let end = source.len().min(offset.saturating_add(CHUNK_SIZE));
+    source.get(offset..end).unwrap_or(&[])
+}
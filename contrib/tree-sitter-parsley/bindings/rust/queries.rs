@@ -0,0 +1,43 @@
+//! Compiled queries, shared by every highlighter in the process.
+//!
+//! Compiling a query analyses every pattern against the parse tables, which
+//! costs far more than a typical highlight run. Each accessor compiles its
+//! query the first time it is called and hands out the same [`Query`] from
+//! then on; `Query` is `Send + Sync`, so one copy serves every thread. Give
+//! each thread its own `QueryCursor`.
+//!
+//! The bundled queries are checked against the grammar by this crate's
+//! tests, so compiling them cannot fail for a published version.
+
+use std::sync::OnceLock;
+
+use tree_sitter::Query;
+use tree_sitter_language::LanguageFn;
+
+fn compiled(
+    cell: &'static OnceLock<Query>,
+    language: LanguageFn,
+    source: &str,
+) -> &'static Query {
+    cell.get_or_init(|| {
+        Query::new(&language.into(), source).expect("bundled query does not match the grammar")
+    })
+}
+
+/// [`HIGHLIGHTS_QUERY`](crate::HIGHLIGHTS_QUERY), compiled once.
+pub fn highlights_query() -> &'static Query {
+    static QUERY: OnceLock<Query> = OnceLock::new();
+    compiled(&QUERY, crate::LANGUAGE, crate::HIGHLIGHTS_QUERY)
+}
+
+/// [`INJECTIONS_QUERY`](crate::INJECTIONS_QUERY), compiled once.
+pub fn injections_query() -> &'static Query {
+    static QUERY: OnceLock<Query> = OnceLock::new();
+    compiled(&QUERY, crate::LANGUAGE, crate::INJECTIONS_QUERY)
+}
+
+/// [`TAGS_QUERY`](crate::TAGS_QUERY), compiled once.
+pub fn tags_query() -> &'static Query {
+    static QUERY: OnceLock<Query> = OnceLock::new();
+    compiled(&QUERY, crate::LANGUAGE, crate::TAGS_QUERY)
+}
@@ -0,0 +1,42 @@
+//! The counting allocator replaces the runtime's allocator for the whole
+//! process, so it is tested in a binary of its own.
+
+use tree_sitter_parsley::alloc;
+
+const SOURCE: &str = "let xs = [1, 2, 3]\nexport greeting = \"hello\"\nlet f = fn(a) { a + 1 }\n";
+
+#[test]
+fn test_counts_and_releases_memory() {
+    unsafe { alloc::install() }.expect("nothing has parsed yet");
+    let language = tree_sitter_parsley::LANGUAGE.into();
+    let source = SOURCE.repeat(200);
+
+    // On the heap a tree holds its bytes until it is dropped
+    let mut parser = tree_sitter::Parser::new();
+    parser.set_language(&language).unwrap();
+    let before = alloc::stats().live_bytes;
+    let tree = parser.parse(&source, None).unwrap();
+    let tree_bytes = alloc::stats().live_bytes - before;
+    assert!(!tree.root_node().has_error());
+    assert!(tree_bytes > 0);
+    drop(tree);
+    assert!(alloc::stats().live_bytes < before + tree_bytes);
+    drop(parser);
+
+    // In an arena nothing is released until the arena closes
+    let arena = unsafe { alloc::Arena::open(0) }.expect("arena");
+    assert!(unsafe { alloc::Arena::open(0) }.is_none(), "one arena per thread");
+    let mut parser = tree_sitter::Parser::new();
+    parser.set_language(&language).unwrap();
+    for _ in 0..5 {
+        let tree = parser.parse(&source, None).unwrap();
+        assert!(!tree.root_node().has_error());
+    }
+    drop(parser);
+    assert!(arena.used() as i64 > tree_bytes);
+
+    let live = alloc::stats().live_bytes;
+    let released = arena.close();
+    assert_eq!(alloc::stats().live_bytes, live - released as i64);
+    assert_eq!(alloc::stats().arena_reserved, 0);
+}
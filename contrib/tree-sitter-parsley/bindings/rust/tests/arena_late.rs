@@ -0,0 +1,20 @@
+//! Installing the counting allocator after the runtime has allocated must
+//! fail, so this runs in a binary of its own, where nothing installs it first.
+
+use tree_sitter_parsley::alloc;
+
+#[test]
+fn test_install_after_parsing_fails() {
+    let mut parser = tree_sitter::Parser::new();
+    parser
+        .set_language(&tree_sitter_parsley::LANGUAGE.into())
+        .unwrap();
+    let tree = parser.parse("let x = 1\n", None).unwrap();
+
+    assert_eq!(unsafe { alloc::install() }, Err(alloc::AlreadyAllocated));
+    assert!(unsafe { alloc::Arena::open(0) }.is_none());
+
+    // The runtime still frees what it allocated before
+    drop(tree);
+    drop(parser);
+}
@@ -0,0 +1,321 @@
+//! Parsing many files at once, for lint and CI tools.
+//!
+//! A [`ParserPool`] keeps parsers between calls, so a long-running tool does
+//! not pay for a new `Parser` per file. [`parse_workspace`] spreads a list
+//! of paths over one thread per core. Each worker takes one parser from the
+//! pool and one `QueryCursor` for the whole run, and reports how long every
+//! file took to read, parse and outline.
+//!
+//! ```no_run
+//! use tree_sitter_parsley::workspace::{parse_workspace, Output, Parse, WorkspaceOptions};
+//!
+//! # let paths: Vec<std::path::PathBuf> = vec![];
+//! let options = WorkspaceOptions { output: Output::Outline, ..Default::default() };
+//! for file in parse_workspace(&paths, &options) {
+//!     match file.result {
+//!         Ok(Parse::Outline { symbols, has_error }) => {
+//!             for symbol in symbols {
+//!                 println!("{}: {} {}", file.path.display(), symbol.kind, symbol.name);
+//!             }
+//!             if has_error {
+//!                 eprintln!("{}: syntax error", file.path.display());
+//!             }
+//!         }
+//!         Ok(Parse::Tree { .. }) => unreachable!(),
+//!         Err(error) => eprintln!("{}: {error}", file.path.display()),
+//!     }
+//!     eprintln!("{}: parsed in {:?}", file.path.display(), file.timings.parse);
+//! }
+//! ```
+
+use std::collections::HashSet;
+use std::io;
+use std::ops::{Deref, DerefMut};
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::{Mutex, OnceLock};
+use std::thread;
+use std::time::{Duration, Instant};
+
+use tree_sitter::{Language, Parser, QueryCursor, Range, StreamingIterator, Tree};
+
+use crate::budget::{self, Budget, Stopped};
+
+/// Parsers for one language, kept between uses.
+///
+/// `Parser` is `Send` but not `Sync`: a parser serves one thread at a time,
+/// and [`ParserPool::get`] hands each caller its own until the
+/// [`PooledParser`] is dropped.
+pub struct ParserPool {
+    language: Language,
+    idle: Mutex<Vec<Parser>>,
+}
+
+impl ParserPool {
+    /// An empty pool of parsers for `language`.
+    pub fn new(language: Language) -> Self {
+        Self {
+            language,
+            idle: Mutex::new(Vec::new()),
+        }
+    }
+
+    /// The process-wide pool of Parsley parsers, used by [`parse_workspace`].
+    pub fn shared() -> &'static ParserPool {
+        static POOL: OnceLock<ParserPool> = OnceLock::new();
+        POOL.get_or_init(|| ParserPool::new(crate::LANGUAGE.into()))
+    }
+
+    /// An idle parser, or a new one if every parser is in use.
+    pub fn get(&self) -> PooledParser<'_> {
+        let idle = self.idle.lock().unwrap_or_else(|e| e.into_inner()).pop();
+        let parser = idle.unwrap_or_else(|| {
+            let mut parser = Parser::new();
+            parser
+                .set_language(&self.language)
+                .expect("the pool's language is not supported by the linked runtime");
+            parser
+        });
+        PooledParser {
+            pool: self,
+            parser: Some(parser),
+        }
+    }
+
+    /// Parsers waiting to be reused.
+    pub fn idle(&self) -> usize {
+        self.idle.lock().unwrap_or_else(|e| e.into_inner()).len()
+    }
+}
+
+/// A parser borrowed from a [`ParserPool`]. Dropping it resets the parser
+/// and returns it to the pool.
+pub struct PooledParser<'a> {
+    pool: &'a ParserPool,
+    // Only None while being dropped
+    parser: Option<Parser>,
+}
+
+impl Deref for PooledParser<'_> {
+    type Target = Parser;
+
+    fn deref(&self) -> &Parser {
+        self.parser.as_ref().unwrap()
+    }
+}
+
+impl DerefMut for PooledParser<'_> {
+    fn deref_mut(&mut self) -> &mut Parser {
+        self.parser.as_mut().unwrap()
+    }
+}
+
+impl Drop for PooledParser<'_> {
+    fn drop(&mut self) {
+        if let Some(mut parser) = self.parser.take() {
+            // A parse cut short leaves its state behind for the next one
+            parser.reset();
+            self.pool
+                .idle
+                .lock()
+                .unwrap_or_else(|e| e.into_inner())
+                .push(parser);
+        }
+    }
+}
+
+/// What [`parse_workspace`] keeps of each file.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub enum Output {
+    /// The source and its tree.
+    Tree,
+    /// Only the definitions `queries/tags.scm` finds, so the source and the
+    /// tree are dropped as soon as a file is done.
+    #[default]
+    Outline,
+}
+
+/// Options for [`parse_workspace`].
+#[derive(Clone, Debug, Default)]
+pub struct WorkspaceOptions {
+    /// Worker threads; 0 for one per core.
+    pub threads: usize,
+    /// What to keep of each file.
+    pub output: Output,
+    /// Budget for each file's parse. A file that runs past it, or is
+    /// reached after `budget`'s token is cancelled, gets an error of kind
+    /// `TimedOut` or `Interrupted` and the run moves on.
+    pub budget: Budget,
+}
+
+/// How long one file took at each step.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct Timings {
+    pub read: Duration,
+    pub parse: Duration,
+    /// Zero for [`Output::Tree`].
+    pub outline: Duration,
+}
+
+impl Timings {
+    /// The time spent on the file in all.
+    pub fn total(&self) -> Duration {
+        self.read + self.parse + self.outline
+    }
+}
+
+/// A definition in a file's outline.
+#[derive(Clone, Debug, PartialEq, Eq)]
+pub struct Symbol {
+    pub name: String,
+    /// The tags.scm kind: `function`, `class`, `module` or `constant`.
+    pub kind: &'static str,
+    /// The whole definition.
+    pub range: Range,
+    /// Just the name.
+    pub name_range: Range,
+}
+
+/// One file's parse.
+pub enum Parse {
+    /// For [`Output::Tree`].
+    Tree { source: Vec<u8>, tree: Tree },
+    /// For [`Output::Outline`]. `has_error` is set when the file has a
+    /// syntax error; the symbols are those found around it.
+    Outline {
+        symbols: Vec<Symbol>,
+        has_error: bool,
+    },
+}
+
+/// A file [`parse_workspace`] was given, with its parse or the error that
+/// stopped it being read.
+pub struct ParsedFile {
+    pub path: PathBuf,
+    pub result: io::Result<Parse>,
+    pub timings: Timings,
+}
+
+/// Parses every file in `paths` on a pool of threads and returns them in
+/// the same order. A file that cannot be read, or runs out of budget, gets
+/// its error and does not stop the others; once the budget's token is
+/// cancelled the remaining files fail at once, so the run returns quickly.
+pub fn parse_workspace<P: AsRef<Path> + Sync>(
+    paths: &[P],
+    options: &WorkspaceOptions,
+) -> Vec<ParsedFile> {
+    let threads = match options.threads {
+        0 => thread::available_parallelism().map_or(1, |n| n.get()),
+        n => n,
+    }
+    .min(paths.len());
+    let next = AtomicUsize::new(0);
+
+    let mut files: Vec<(usize, ParsedFile)> = thread::scope(|scope| {
+        let workers: Vec<_> = (0..threads)
+            .map(|_| {
+                scope.spawn(|| {
+                    let mut parser = ParserPool::shared().get();
+                    let mut cursor = QueryCursor::new();
+                    let mut done = Vec::new();
+                    loop {
+                        let i = next.fetch_add(1, Ordering::Relaxed);
+                        let Some(path) = paths.get(i) else { break };
+                        let path = path.as_ref();
+                        done.push((i, parse_file(&mut parser, &mut cursor, path, options)));
+                    }
+                    done
+                })
+            })
+            .collect();
+        workers
+            .into_iter()
+            .flat_map(|worker| worker.join().expect("workspace worker panicked"))
+            .collect()
+    });
+    files.sort_unstable_by_key(|(i, _)| *i);
+    files.into_iter().map(|(_, file)| file).collect()
+}
+
+fn parse_file(
+    parser: &mut Parser,
+    cursor: &mut QueryCursor,
+    path: &Path,
+    options: &WorkspaceOptions,
+) -> ParsedFile {
+    let mut timings = Timings::default();
+    let result = (|| -> io::Result<Parse> {
+        if options.budget.is_cancelled() {
+            return Err(stopped(Stopped::Cancelled));
+        }
+        let start = Instant::now();
+        let source = std::fs::read(path)?;
+        timings.read = start.elapsed();
+
+        let start = Instant::now();
+        let tree = budget::parse(parser, &source, None, &options.budget).map_err(stopped)?;
+        timings.parse = start.elapsed();
+
+        Ok(match options.output {
+            Output::Tree => Parse::Tree { source, tree },
+            Output::Outline => {
+                let start = Instant::now();
+                let symbols = outline(cursor, &tree, &source);
+                timings.outline = start.elapsed();
+                Parse::Outline {
+                    symbols,
+                    has_error: tree.root_node().has_error(),
+                }
+            }
+        })
+    })();
+    ParsedFile {
+        path: path.to_path_buf(),
+        result,
+        timings,
+    }
+}
+
+fn stopped(reason: Stopped) -> io::Error {
+    let kind = match reason {
+        Stopped::TimedOut => io::ErrorKind::TimedOut,
+        Stopped::Cancelled => io::ErrorKind::Interrupted,
+    };
+    io::Error::new(kind, reason)
+}
+
+/// The definitions in `tree`, in source order. A name tagged by several
+/// patterns is listed once, for the first of them, as tags.scm intends.
+fn outline(cursor: &mut QueryCursor, tree: &Tree, source: &[u8]) -> Vec<Symbol> {
+    let query = crate::tags_query();
+    let names = query.capture_names();
+    let Some(name_index) = query.capture_index_for_name("name") else {
+        return Vec::new();
+    };
+
+    let mut seen = HashSet::new();
+    let mut symbols = Vec::new();
+    let mut matches = cursor.matches(query, tree.root_node(), source);
+    while let Some(m) = matches.next() {
+        let Some(name) = m.captures.iter().find(|c| c.index == name_index) else {
+            continue;
+        };
+        let Some(definition) = m.captures.iter().find_map(|c| {
+            let kind = names[c.index as usize].strip_prefix("definition.")?;
+            Some((kind, c.node))
+        }) else {
+            continue;
+        };
+        if !seen.insert(name.node.id()) {
+            continue;
+        }
+        symbols.push(Symbol {
+            name: name.node.utf8_text(source).unwrap_or_default().to_string(),
+            kind: definition.0,
+            range: definition.1.range(),
+            name_range: name.node.range(),
+        });
+    }
+    symbols.sort_by_key(|s| s.name_range.start_byte);
+    symbols
+}
@@ -0,0 +1,292 @@
+/**
+ * Incremental Parsley highlighting in the browser, on the WebAssembly build of
+ * the grammar (`npm run build:wasm`) and web-tree-sitter.
+ *
+ * A Buffer keeps one tree per editor buffer. On each change it diffs the new
+ * text against the old, edits and reparses the tree incrementally, and
+ * re-renders only the lines covered by the edit and by the tree's changed
+ * ranges. Output is one HTML string per line, with highlight.js class names
+ * (hljs-keyword, hljs-string, ...) so existing highlight.js themes apply.
+ *
+ *   const highlighter = await createHighlighter({
+ *     wasm: "/tree-sitter-parsley.wasm",
+ *     highlights: "/queries/highlights.scm",
+ *   });
+ *   const buffer = highlighter.open(textarea.value);
+ *   attach(buffer, textarea, codeElement);
+ */
+
+import { Parser, Language, Query } from "web-tree-sitter";
+
+// Capture names in queries/highlights.scm mapped to highlight.js classes, as
+// in basil/highlight. A capture without an entry falls back to its
+// parent name; an empty class claims the node but adds no markup.
+const CLASSES = {
+  keyword: "hljs-keyword",
+  string: "hljs-string",
+  "string.escape": "hljs-char escape_",
+  "string.regexp": "hljs-regexp",
+  "string.special": "hljs-symbol",
+  "string.special.url": "hljs-link",
+  number: "hljs-number",
+  "constant.builtin": "hljs-literal",
+  comment: "hljs-comment",
+  function: "hljs-title function_",
+  "function.builtin": "hljs-built_in",
+  variable: "",
+  "variable.builtin": "hljs-variable language_",
+  "variable.parameter": "hljs-params",
+  property: "hljs-property",
+  attribute: "hljs-attr",
+  tag: "hljs-name",
+  type: "hljs-type",
+  module: "hljs-title class_",
+  operator: "hljs-operator",
+  punctuation: "hljs-punctuation",
+  "punctuation.special": "hljs-subst",
+};
+
+function classFor(capture) {
+  for (;;) {
+    if (capture in CLASSES) return CLASSES[capture];
+    const dot = capture.lastIndexOf(".");
+    if (dot < 0) return "";
+    capture = capture.slice(0, dot);
+  }
+}
+
+const ESCAPES = { "&": "&amp;", "<": "&lt;", ">": "&gt;", '"': "&quot;", "'": "&#39;" };
+
+function escape(text) {
+  return text.replace(/[&<>"']/g, (c) => ESCAPES[c]);
+}
+
+async function load(source) {
+  if (typeof source !== "string") return source;
+  const response = await fetch(source);
+  if (!response.ok) throw new Error(`cannot load ${source}: ${response.status}`);
+  return source.endsWith(".scm") ? response.text() : new Uint8Array(await response.arrayBuffer());
+}
+
+/**
+ * Load the grammar and compile the highlights query.
+ *
+ * @param {object} options
+ * @param {string|Uint8Array} options.wasm - URL or bytes of tree-sitter-parsley.wasm
+ * @param {string} options.highlights - URL of highlights.scm, or the query itself
+ * @param {object} [options.runtime] - passed to Parser.init (e.g. locateFile)
+ */
+export async function createHighlighter({ wasm, highlights, runtime } = {}) {
+  await Parser.init(runtime);
+  const language = await Language.load(await load(wasm));
+  const source = /\.scm(\?|$)/.test(highlights) ? await load(highlights) : highlights;
+  return new Highlighter(language, new Query(language, source));
+}
+
+export class Highlighter {
+  constructor(language, query) {
+    this.language = language;
+    this.query = query;
+    this.classes = new Map(query.captureNames.map((name) => [name, classFor(name)]));
+  }
+
+  /** Start tracking an editor buffer holding text. */
+  open(text) {
+    return new Buffer(this, text);
+  }
+
+  /** Highlight text in one go, for static code blocks. */
+  html(text) {
+    const buffer = this.open(text);
+    const lines = buffer.lines.join("\n");
+    buffer.close();
+    return lines;
+  }
+}
+
+export class Buffer {
+  constructor(highlighter, text) {
+    this.highlighter = highlighter;
+    this.parser = new Parser();
+    this.parser.setLanguage(highlighter.language);
+    this.text = text;
+    this.tree = this.parser.parse(text);
+    this.lineStarts = lineStarts(text);
+    this.lines = this.render(0, this.lineStarts.length - 1);
+  }
+
+  /**
+   * Replace the buffer's text and re-highlight what changed.
+   *
+   * Returns the patch to apply to the rendered lines: remove `deleted` lines
+   * at index `start` and insert `lines` there. Lines outside the patch are
+   * unchanged apart from their position. null means the text is the same.
+   */
+  update(text) {
+    const old = this.text;
+    if (text === old) return null;
+
+    let start = 0;
+    const shortest = Math.min(old.length, text.length);
+    while (start < shortest && old.charCodeAt(start) === text.charCodeAt(start)) start++;
+    let oldEnd = old.length;
+    let newEnd = text.length;
+    while (oldEnd > start && newEnd > start && old.charCodeAt(oldEnd - 1) === text.charCodeAt(newEnd - 1)) {
+      oldEnd--;
+      newEnd--;
+    }
+
+    const oldStarts = this.lineStarts;
+    const newStarts = lineStarts(text);
+    const edit = {
+      startIndex: start,
+      oldEndIndex: oldEnd,
+      newEndIndex: newEnd,
+      startPosition: position(oldStarts, start),
+      oldEndPosition: position(oldStarts, oldEnd),
+      newEndPosition: position(newStarts, newEnd),
+    };
+    this.tree.edit(edit);
+    const tree = this.parser.parse(text, this.tree);
+
+    // Rows to re-render, in the new text: the edit itself plus every range
+    // whose syntax changed (a new quote restyles the rest of the line, an
+    // opened tag the lines below it)
+    let first = edit.startPosition.row;
+    let last = edit.newEndPosition.row;
+    for (const range of this.tree.getChangedRanges(tree)) {
+      first = Math.min(first, range.startPosition.row);
+      last = Math.max(last, range.endPosition.row);
+    }
+    last = Math.min(last, newStarts.length - 1);
+
+    this.tree.delete();
+    this.tree = tree;
+    this.text = text;
+    this.lineStarts = newStarts;
+
+    // Rows after the edit keep their content and move by the change in line
+    // count, so the old rows being replaced end at last - delta
+    const delta = newStarts.length - oldStarts.length;
+    const deleted = last - delta - first + 1;
+    const lines = this.render(first, last);
+    this.lines.splice(first, deleted, ...lines);
+    return { start: first, deleted, lines };
+  }
+
+  /** Free the tree and parser. */
+  close() {
+    this.tree.delete();
+    this.parser.delete();
+  }
+
+  // Highlight rows first..last (inclusive) and return one HTML string each.
+  // Spans are closed at each line end, so every line stands alone.
+  render(first, last) {
+    const { query, classes } = this.highlighter;
+    const from = this.lineStarts[first];
+    const to = last + 1 < this.lineStarts.length ? this.lineStarts[last + 1] - 1 : this.text.length;
+    const captures = query.captures(this.tree.rootNode, {
+      startPosition: { row: first, column: 0 },
+      endPosition: { row: last + 1, column: 0 },
+    });
+
+    const spans = [];
+    for (const capture of captures) {
+      const start = Math.max(capture.node.startIndex, from);
+      const end = Math.min(capture.node.endIndex, to);
+      if (start >= end) continue;
+      spans.push({ start, end, pattern: capture.patternIndex ?? 0, class: classes.get(capture.name) });
+    }
+    // Outer spans first; for the same node, the earliest pattern wins
+    spans.sort((a, b) => a.start - b.start || b.end - a.end || a.pattern - b.pattern);
+
+    const lines = [];
+    const stack = [];
+    let line = "";
+    let pos = from;
+    const open = (s) => s.class && `<span class="${s.class}">`;
+    const close = (s) => (s.class ? "</span>" : "");
+    const text = (until) => {
+      while (pos < until) {
+        const newline = this.text.indexOf("\n", pos);
+        if (newline < 0 || newline >= until) {
+          line += escape(this.text.slice(pos, until));
+          pos = until;
+          return;
+        }
+        line += escape(this.text.slice(pos, newline));
+        for (let i = stack.length - 1; i >= 0; i--) line += close(stack[i]);
+        lines.push(line);
+        line = stack.map(open).join("");
+        pos = newline + 1;
+      }
+    };
+    const closeBefore = (offset) => {
+      while (stack.length && stack[stack.length - 1].end <= offset) {
+        text(stack[stack.length - 1].end);
+        line += close(stack.pop());
+      }
+    };
+
+    for (const s of spans) {
+      closeBefore(s.start);
+      const top = stack[stack.length - 1];
+      if (top && (s.end > top.end || (s.start === top.start && s.end === top.end))) continue;
+      text(s.start);
+      line += open(s);
+      stack.push(s);
+    }
+    closeBefore(to);
+    text(to);
+    lines.push(line);
+    return lines;
+  }
+}
+
+function lineStarts(text) {
+  const starts = [0];
+  for (let i = text.indexOf("\n"); i >= 0; i = text.indexOf("\n", i + 1)) starts.push(i + 1);
+  return starts;
+}
+
+// web-tree-sitter measures indices and columns in UTF-16 code units, the same
+// units as JS string offsets
+function position(starts, index) {
+  let low = 0;
+  let high = starts.length - 1;
+  while (low < high) {
+    const mid = (low + high + 1) >> 1;
+    if (starts[mid] <= index) low = mid;
+    else high = mid - 1;
+  }
+  return { row: low, column: index - starts[low] };
+}
+
+/**
+ * Keep code (a <code> inside a <pre>) highlighted as textarea is edited.
+ * Each line is a <span class="line"> child, and an input event replaces only
+ * the children in the buffer's patch. onUpdate, if given, is called with each
+ * patch and the milliseconds spent reparsing and re-rendering.
+ */
+export function attach(buffer, textarea, code, onUpdate) {
+  const lineElement = (html) => {
+    const span = document.createElement("span");
+    span.className = "line";
+    span.innerHTML = html + "\n";
+    return span;
+  };
+  code.replaceChildren(...buffer.lines.map(lineElement));
+  const onInput = () => {
+    const start = performance.now();
+    const patch = buffer.update(textarea.value);
+    if (!patch) return;
+    for (let i = 0; i < patch.deleted; i++) code.children[patch.start].remove();
+    const lines = document.createDocumentFragment();
+    lines.append(...patch.lines.map(lineElement));
+    code.insertBefore(lines, code.children[patch.start] ?? null);
+    onUpdate?.(patch, performance.now() - start);
+  };
+  textarea.addEventListener("input", onInput);
+  return () => textarea.removeEventListener("input", onInput);
+}
@@ -0,0 +1,63 @@
+// Run with `npm run test:wasm` after `npm run build:wasm`.
+
+import assert from "node:assert/strict";
+import { existsSync, readFileSync } from "node:fs";
+import { test } from "node:test";
+
+import { createHighlighter } from "./highlight.mjs";
+
+const wasm = new URL("../../tree-sitter-parsley.wasm", import.meta.url);
+const highlights = new URL("../../queries/highlights.scm", import.meta.url);
+
+const highlighter = existsSync(wasm)
+  ? await createHighlighter({ wasm: readFileSync(wasm), highlights: readFileSync(highlights, "utf8") })
+  : null;
+const skip = highlighter ? false : "tree-sitter-parsley.wasm not built";
+
+const strip = (lines) => lines.join("\n").replace(/<[^>]*>/g, "").replace(/&lt;/g, "<").replace(/&gt;/g, ">")
+  .replace(/&quot;/g, '"').replace(/&#39;/g, "'").replace(/&amp;/g, "&");
+
+test("highlights keywords and strings", { skip }, () => {
+  const html = highlighter.html('let greeting = "hi"');
+  assert.match(html, /<span class="hljs-keyword">let<\/span>/);
+  assert.match(html, /<span class="hljs-string">&quot;hi&quot;<\/span>/);
+});
+
+test("every line closes its own spans", { skip }, () => {
+  const buffer = highlighter.open('let s = "one\ntwo"\n<div>\n  {s}\n</div>');
+  for (const line of buffer.lines) {
+    assert.equal(line.split("<span").length, line.split("</span>").length, line);
+  }
+  buffer.close();
+});
+
+test("updates match a fresh highlight", { skip }, () => {
+  const edits = [
+    "let x = 1\nlet y = 2\n",
+    "let x = 1\nlet y = \"2\n",          // unterminated string restyles the rest
+    "let x = 1\nlet y = \"2\"\nlet z = 3\n",
+    "<ul>\n  for (i in [1]) {\n    <li>i</li>\n  }\n</ul>\n",
+    "<ul>\n  for (i in [1, 2]) {\n    <li class=\"a\">i</li>\n  }\n</ul>\n",
+    "",
+    "// done",
+  ];
+  const buffer = highlighter.open(edits[0]);
+  for (const text of edits.slice(1)) {
+    const before = buffer.lines.slice();
+    const patch = buffer.update(text);
+    before.splice(patch.start, patch.deleted, ...patch.lines);
+    assert.deepEqual(before, buffer.lines, "patch applied to the old lines");
+    assert.equal(strip(buffer.lines), text);
+    assert.equal(buffer.lines.join("\n"), highlighter.html(text), JSON.stringify(text));
+  }
+  buffer.close();
+});
+
+test("only the edited lines are re-rendered", { skip }, () => {
+  const lines = Array.from({ length: 200 }, (_, i) => `let v${i} = ${i}`);
+  const buffer = highlighter.open(lines.join("\n"));
+  lines[100] = "let v100 = 1000";
+  const patch = buffer.update(lines.join("\n"));
+  assert.ok(patch.lines.length <= 2, `re-rendered ${patch.lines.length} lines`);
+  buffer.close();
+});
@@ -0,0 +1,5 @@
+module github.com/sambeau/tree-sitter-parsley
+
+go 1.24.1
+
+require github.com/tree-sitter/go-tree-sitter v0.25.0
@@ -0,0 +1,18 @@
+; Fold queries for Parsley: regions an editor can collapse
+; (nvim-treesitter folding, bindings/go/lsp folding ranges)
+;
+; Only nodes that span more than one line make a fold.
+
+[
+  (block)
+  (dictionary_literal)
+  (array_literal)
+  (arguments)
+  (parameter_list)
+  (tag_expression)
+  (schema_declaration)
+  (query_expression)
+  (mutation_expression)
+  (template_string)
+  (raw_string)
+] @fold
@@ -1,3 +1,8 @@
+; Tokens that only occur in one rule ("@query", "/>", "fn", ...) are matched
+; on their own rather than under their parent node. A parent-anchored pattern
+; keeps a cursor state open across the parent's whole subtree, which is the
+; main cost of running this query on large files (bench/query_bench.c).
+
 ; Keywords
 [
   "let"
@@ -50,8 +55,9 @@
 (path_template) @string.special.path
 
 ; Schema declarations
+"@schema" @keyword
+
 (schema_declaration
-  "@schema" @keyword
   name: (identifier) @type)
 
 ; Schema fields
@@ -151,16 +157,17 @@
 (attribute_name) @attribute
 
 ; Tag punctuation
-(self_closing_tag "/>" @punctuation.bracket)
+"/>" @punctuation.bracket
+"</" @punctuation.bracket
 (open_tag ">" @punctuation.bracket)
-(close_tag ["</" ">"] @punctuation.bracket)
+(close_tag ">" @punctuation.bracket)
 
 ; Style/script tags
 (style_tag) @tag
 (script_tag) @tag
 
 ; Functions
-(function_expression ["fn" "function"] @keyword.function)
+["fn" "function"] @keyword.function
 
 (call_expression
   function: (identifier) @function.call)
@@ -195,7 +202,7 @@
 ; ==================== Query DSL ====================
 
 ; Query expression keyword
-(query_expression "@query" @function.builtin)
+"@query" @function.builtin
 
 ; Query source table
 (query_source
@@ -250,7 +257,7 @@
 (query_condition_group ["not" "!" "and" "or"] @keyword.operator)
 
 ; Mutation expressions
-(mutation_expression ["@insert" "@update" "@delete" "@transaction"] @function.builtin)
+["@insert" "@update" "@delete" "@transaction"] @function.builtin
 
 ; Comments
 (comment) @comment
@@ -0,0 +1,26 @@
+; Language injection queries for Parsley, one injected document per tag
+;
+; Same languages as injections.scm, without injection.combined: each <style>,
+; <script> or <SQL> tag is parsed on its own, so an edit only reparses the tag
+; it is in. The quantified capture takes every raw_text chunk of the tag (large
+; bodies and @{} interpolations split the text into several) into the one
+; match. Editors that build an injection from all of a match's content nodes
+; (Zed, Neovim) parse the whole tag body as one document.
+;
+; Choose this file over injections.scm for pages with many small tags; see
+; bench/injection_bench.c for a comparison on bench/injections/tag_heavy.pars.
+
+; CSS injection in style tags
+(style_tag
+  (raw_text)+ @injection.content
+  (#set! injection.language "css"))
+
+; JavaScript injection in script tags
+(script_tag
+  (raw_text)+ @injection.content
+  (#set! injection.language "javascript"))
+
+; SQL in <SQL> tags
+(sql_tag
+  (raw_text)+ @injection.content
+  (#set! injection.language "sql"))
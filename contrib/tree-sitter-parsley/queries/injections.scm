@@ -1,6 +1,10 @@
 ; Language injection queries for Parsley
 ; Inject CSS grammar into <style> tag raw text content
 ; Inject JavaScript grammar into <script> tag raw text content
+; Inject SQL grammar into <SQL> tag raw text content
+; Large bodies arrive as several raw_text chunks; injection.combined joins them,
+; and every tag of one language in the file, into a single injected document.
+; injections-per-tag.scm parses each tag on its own instead.
 
 ; CSS injection in style tags
 (style_tag
@@ -13,3 +17,9 @@
   (raw_text) @injection.content
   (#set! injection.language "javascript")
   (#set! injection.combined))
+
+; SQL in <SQL> tags
+(sql_tag
+  (raw_text) @injection.content
+  (#set! injection.language "sql")
+  (#set! injection.combined))
@@ -0,0 +1,50 @@
+; Scope queries for Parsley: where names are bound and where they are used
+; (tree-sitter locals, used to tell a reference to a local apart from a
+; reference to something defined in another file)
+
+; Scopes
+(block) @local.scope
+(function_expression) @local.scope
+(for_expression) @local.scope
+
+; Definitions
+(let_statement
+  pattern: (identifier) @local.definition)
+
+(export_statement
+  name: (identifier) @local.definition)
+
+(export_statement
+  pattern: (identifier) @local.definition)
+
+(schema_declaration
+  name: (identifier) @local.definition)
+
+(import_expression
+  alias: (identifier) @local.definition)
+
+; Parameters: fn(a, b = 1, [c, d], {e, f: g}). A query cannot ask for a
+; child without a field, so this also takes a default that is a bare name
+; (fn(a = b)); defaults are rarely bare names, and b still resolves when it
+; is defined further out.
+(parameter_list
+  (identifier) @local.definition)
+
+; Loop variables: for (k, v in d), for (x in xs)
+(for_expression
+  key: (identifier) @local.definition)
+
+(for_expression
+  variable: (identifier) @local.definition)
+
+; Destructuring: [a, ...rest], {a, b: c, d as e}. For the same reason the
+; dictionary pattern also takes the keys b and d, which name fields rather
+; than bindings; that only matters when a key shadows an outer name.
+(array_pattern
+  (identifier) @local.definition)
+
+(dictionary_pattern
+  (identifier) @local.definition)
+
+; References
+(identifier) @local.reference
@@ -0,0 +1,40 @@
+// Package queries embeds the grammar's tree-sitter queries, so Go code can
+// load them without locating this directory at run time.
+package queries
+
+import _ "embed"
+
+// Highlights is queries/highlights.scm.
+//
+//go:embed highlights.scm
+var Highlights string
+
+// Injections is queries/injections.scm.
+//
+//go:embed injections.scm
+var Injections string
+
+// InjectionsPerTag is queries/injections-per-tag.scm.
+//
+//go:embed injections-per-tag.scm
+var InjectionsPerTag string
+
+// Tags is queries/tags.scm.
+//
+//go:embed tags.scm
+var Tags string
+
+// Locals is queries/locals.scm.
+//
+//go:embed locals.scm
+var Locals string
+
+// Folds is queries/folds.scm.
+//
+//go:embed folds.scm
+var Folds string
+
+// Search is queries/search.scm.
+//
+//go:embed search.scm
+var Search string
@@ -0,0 +1,37 @@
+; Search queries for Parsley: the text Basil's full-text search indexes for a
+; .pars or .part file (server/search, basil/searchtext)
+;
+; A node matched by several patterns counts once, for the first of them.
+
+; Exported names, which rank like headings
+(export_statement
+  name: (identifier) @export)
+
+(export_statement
+  pattern: (identifier) @export)
+
+(export_statement
+  pattern: (dictionary_pattern
+    (identifier) @export))
+
+(export_statement
+  value: (schema_declaration
+    name: (identifier) @export))
+
+; Tables: the source a query or mutation starts from, @query(Users | ...)
+(query_source
+  table: (identifier) @table)
+
+(mutation_expression) @table
+
+; Text a reader sees: strings (markup text is strings inside tags) and
+; comments
+[
+  (string)
+  (template_string)
+  (raw_string)
+  (comment)
+] @text
+
+; Every other name
+(identifier) @identifier
@@ -0,0 +1,56 @@
+; Tag queries for Parsley: definitions and references for code navigation
+; (tree-sitter tags, GitHub symbol search, bindings/go/symbols)
+;
+; When several patterns tag the same name, the first one wins, so the
+; function forms come before the plain bindings they would also match.
+
+; Functions: let f = fn(...) {...}, export f = fn(...) {...}, f = fn(...) {...}
+(let_statement
+  pattern: (identifier) @name
+  value: (function_expression)) @definition.function
+
+(export_statement
+  name: (identifier) @name
+  value: (function_expression)) @definition.function
+
+(export_statement
+  pattern: (identifier) @name
+  value: (function_expression)) @definition.function
+
+(assignment_statement
+  left: (identifier) @name
+  right: (function_expression)) @definition.function
+
+; Schemas: @schema Name { ... }
+(schema_declaration
+  name: (identifier) @name) @definition.class
+
+; Modules bound by import: import @std/table as t, let lib = import @./lib
+(import_expression
+  alias: (identifier) @name) @definition.module
+
+(let_statement
+  pattern: (identifier) @name
+  value: (import_expression)) @definition.module
+
+; Other exported and top-level bindings
+(export_statement
+  name: (identifier) @name) @definition.constant
+
+(export_statement
+  pattern: (identifier) @name) @definition.constant
+
+(source_file
+  (let_statement
+    pattern: (identifier) @name) @definition.constant)
+
+; References
+(call_expression
+  function: (identifier) @name) @reference.call
+
+(call_expression
+  function: (member_expression
+    property: (identifier) @name)) @reference.call
+
+(import_expression
+  source: (_) @name) @reference.module
@@ -2,15 +2,19 @@
  * External scanner for Parsley tree-sitter grammar
  *
  * Handles context-sensitive tokenization that the pure JS grammar cannot express:
- * 1. Raw text tags: <style> and <script> content as raw text with @{} interpolation
+ * raw text tags, <style>, <script> and <SQL> content as raw text, with @{}
+ * interpolation in style/script
  *
  * The key insight is that tree-sitter's valid_symbols array tells us what tokens
- * are valid at the current parse position. If RAW_TEXT is valid, we must be inside
- * a style/script tag (since that's the only place we declared it in the grammar).
+ * are valid at the current parse position. RAW_TEXT is only valid inside a raw
+ * text tag, and RAW_TEXT_INTERPOLATION_START only inside <style> and <script>,
+ * so the pair tells <SQL> apart from the other two. <style> and <script> look
+ * the same from here, so either of their closing tags ends their text.
  *
  * Reference: pkg/parsley/lexer/lexer.go (nextTagContentToken, readRawTagText)
  */
 
+#include "tree_sitter/alloc.h"
 #include "tree_sitter/parser.h"
 #include <string.h>
 #include <stdbool.h>
@@ -20,26 +24,65 @@
 // These must match the order in grammar.js externals array
 enum TokenType {
     RAW_TEXT,
-    RAW_TEXT_INTERPOLATION_START,
-    ERROR_SENTINEL
+    RAW_TEXT_INTERPOLATION_START
+};
+
+// Which kind of raw text tag the scanner is in (Scanner.raw_text_mode)
+enum RawTextMode {
+    RAW_TEXT_NONE,
+    RAW_TEXT_INTERPOLATED,  // <style> or <script>
+    RAW_TEXT_SQL,
+    RAW_TEXT_MODE_COUNT
+};
+
+// Raw text is emitted in bounded chunks so that an edit inside a large (or
+// unterminated) <script> only relexes the chunk it touches. Boundaries are
+// chosen by content, not by distance from the chunk start: the text is cut
+// into segments ending at a newline, ";" or "}", and a chunk may end after
+// a segment whose hash has the low RAW_TEXT_CHUNK_MASK bits clear, once it
+// is past the soft limit. An edit therefore only moves the boundaries near
+// it, and the lexer is back on the old boundaries, so the old chunks can be
+// reused, at the next boundary after the edit. The hard limit cuts text
+// with no such boundary, such as one long string. injection.combined
+// stitches the chunks back together.
+#define RAW_TEXT_CHUNK_SOFT_LIMIT 256
+#define RAW_TEXT_CHUNK_HARD_LIMIT 4096
+#define RAW_TEXT_CHUNK_MASK 0x1f
+
+// Closing tags and interpolation for each raw text mode
+#define RAW_TEXT_MAX_CLOSING_TAGS 2
+
+typedef struct {
+    // Tag names after "</" that end the text, matched case-sensitively and
+    // followed directly by ">", as the grammar's closing tag tokens are
+    const char *closing[RAW_TEXT_MAX_CLOSING_TAGS];
+    bool interpolation;     // whether @{ starts an interpolation
+} RawTextTag;
+
+static const RawTextTag RAW_TEXT_TAGS[RAW_TEXT_MODE_COUNT] = {
+    [RAW_TEXT_INTERPOLATED] = {{"style", "script"}, true},
+    // No interpolation in SQL for safety - parameters come from attributes
+    [RAW_TEXT_SQL]          = {{"SQL", NULL},       false},
 };
 
 // Scanner state - tracks which raw text tag we're in
 typedef struct {
-    // 0 = not in raw text, 1 = in <style>, 2 = in <script>
+    // One of RawTextMode: the mode of the last raw text scan. It is set from
+    // valid_symbols on every scan, so nothing depends on the serialized value.
     uint8_t raw_text_mode;
 } Scanner;
 
-// Create a new scanner instance
+// Create a new scanner instance. ts_calloc is the runtime's allocator when
+// built with TREE_SITTER_REUSE_ALLOCATOR (bindings/c/alloc.h), else calloc.
 void *tree_sitter_parsley_external_scanner_create(void) {
-    Scanner *scanner = (Scanner *)calloc(1, sizeof(Scanner));
+    Scanner *scanner = (Scanner *)ts_calloc(1, sizeof(Scanner));
     return scanner;
 }
 
 // Destroy the scanner instance
 void tree_sitter_parsley_external_scanner_destroy(void *payload) {
     Scanner *scanner = (Scanner *)payload;
-    free(scanner);
+    ts_free(scanner);
 }
 
 // Serialize scanner state for tree-sitter's GLR backtracking
@@ -59,75 +102,186 @@ void tree_sitter_parsley_external_scanner_deserialize(
     unsigned length
 ) {
     Scanner *scanner = (Scanner *)payload;
-    if (length >= 1) {
+    if (length >= 1 && (uint8_t)buffer[0] < RAW_TEXT_MODE_COUNT) {
         scanner->raw_text_mode = (uint8_t)buffer[0];
     } else {
-        scanner->raw_text_mode = 0;
+        scanner->raw_text_mode = RAW_TEXT_NONE;
+    }
+}
+
+// ================================================================
+// Instrumentation (-DTREE_SITTER_PARSLEY_SCANNER_STATS, see scanner_stats.h)
+// ================================================================
+
+#ifdef TREE_SITTER_PARSLEY_SCANNER_STATS
+#include "scanner_stats.h"
+
+static ParsleyScannerStats stats = {
+    .tokens = {
+        [RAW_TEXT]                     = {.name = "raw_text"},
+        [RAW_TEXT_INTERPOLATION_START] = {.name = "raw_text_interpolation_start"},
+    },
+};
+
+// The token the current scan is trying for (-1 for none) and the bytes it
+// has advanced over so far
+static int stats_attempt;
+static uint64_t stats_bytes;
+
+const ParsleyScannerStats *tree_sitter_parsley_external_scanner_stats(void) {
+    return &stats;
+}
+
+void tree_sitter_parsley_external_scanner_reset_stats(void) {
+    stats.calls = 0;
+    stats.unhandled = 0;
+    for (int i = 0; i < PARSLEY_SCANNER_TOKEN_COUNT; i++) {
+        stats.tokens[i].scans = 0;
+        stats.tokens[i].produced = 0;
+        stats.tokens[i].declined = 0;
+        stats.tokens[i].bytes = 0;
     }
 }
 
+// UTF-8 length of a lookahead code point
+static uint64_t utf8_length(int32_t c) {
+    return c < 0x80 ? 1 : c < 0x800 ? 2 : c < 0x10000 ? 3 : 4;
+}
+
+#define STATS_ATTEMPT(token) (stats_attempt = (token))
+#define STATS_ADVANCE(lexer) (stats_bytes += utf8_length((lexer)->lookahead))
+#else
+#define STATS_ATTEMPT(token) ((void)0)
+#define STATS_ADVANCE(lexer) ((void)0)
+#endif
+
 // Helper: advance the lexer (include character in token)
 static void advance(TSLexer *lexer) {
+    STATS_ADVANCE(lexer);
     lexer->advance(lexer, false);
 }
 
-// Helper: check if next chars match a string (case-insensitive for tag names)
-static bool lookahead_matches_string(TSLexer *lexer, const char *str) {
-    for (size_t i = 0; str[i] != '\0'; i++) {
-        int32_t c = lexer->lookahead;
-        char expected = str[i];
-        
-        // Case-insensitive comparison for letters
-        if (c >= 'A' && c <= 'Z') c = c + ('a' - 'A');
-        if (expected >= 'A' && expected <= 'Z') expected = expected + ('a' - 'A');
-        
-        if (c != expected) {
+// Helper: after "</", check whether the lexer is at one of `tag`'s closing
+// tags: its name directly followed by ">". Consumes the characters it
+// compares while some name still matches, so a failed probe never consumes
+// a character that could start the next candidate; callers only rely on the
+// mark set before the "<".
+static bool at_closing_tag(TSLexer *lexer, const RawTextTag *tag) {
+    bool live[RAW_TEXT_MAX_CLOSING_TAGS];
+    for (size_t n = 0; n < RAW_TEXT_MAX_CLOSING_TAGS; n++) {
+        live[n] = tag->closing[n] != NULL;
+    }
+    for (size_t i = 0;; i++) {
+        bool any = false;
+        for (size_t n = 0; n < RAW_TEXT_MAX_CLOSING_TAGS; n++) {
+            if (!live[n]) {
+                continue;
+            }
+            char expected = tag->closing[n][i];
+            if (expected == '\0' && lexer->lookahead == '>') {
+                return true;
+            }
+            live[n] = expected != '\0' && lexer->lookahead == expected;
+            any = any || live[n];
+        }
+        if (!any) {
             return false;
         }
         advance(lexer);
     }
-    return true;
+}
+
+// Helper: work out which kind of raw text tag we are in.
+// RAW_TEXT_INTERPOLATION_START is only valid in <style> and <script>; a
+// RAW_TEXT without it is <SQL>.
+static uint8_t raw_text_mode_for(const bool *valid_symbols) {
+    if (valid_symbols[RAW_TEXT_INTERPOLATION_START]) {
+        return RAW_TEXT_INTERPOLATED;
+    }
+    if (valid_symbols[RAW_TEXT]) {
+        return RAW_TEXT_SQL;
+    }
+    return RAW_TEXT_NONE;
 }
 
 /**
- * Scan for raw text content in <style> or <script> tags
+ * Scan for raw text content in <style>, <script> or <SQL> tags
  *
  * In raw text mode:
- * - Everything is literal text until we see the matching </style> or </script>, or @{
- * - `@{` triggers interpolation (return RAW_TEXT for content before it)
+ * - Everything is literal text until we see a closing tag of this mode, or @{
+ * - At the closing tag the scan returns the text before it, or declines if
+ *   there is none, and the grammar's closing tag token takes over
+ * - `@{` triggers interpolation (return RAW_TEXT for content before it),
+ *   except in <SQL> where it is plain text
  * - `{` and `}` are literal (NOT Parsley blocks/dicts)
  * - `//` comments are preserved (valid JS, harmless in CSS)
- * - `</` inside JS strings like '</div>' should NOT end the tag
+ * - `</` inside JS strings like '</div>' should NOT end the tag, and neither
+ *   does `</SQL>` inside a <script> or `</script>` inside a <SQL>
  *
- * We detect which tag we're in by scanning backwards or by looking at what
- * the grammar tells us via valid_symbols.
+ * Only `@` and `<` can start a token boundary, so runs of ordinary text are
+ * consumed with a bare advance() per character: no eof() callback and no
+ * mark_end() per character. The token end is marked only at a candidate
+ * boundary, at a chunk boundary, and once more at EOF. How much that saves
+ * in the runtime has not been measured; bench/parse_bench.c on a file
+ * with a large inline <script> is the way to find out.
  */
-static bool scan_raw_text(Scanner *scanner, TSLexer *lexer, const bool *valid_symbols) {
+static bool scan_raw_text(TSLexer *lexer, const RawTextTag *tag) {
     bool has_content = false;
-    
-    // Determine which close tag to look for
-    // We need to detect this from context. The grammar structure tells us:
-    // - If we're in style_tag rule, look for </style>
-    // - If we're in script_tag rule, look for </script>
-    // 
-    // Since both use the same external token, we look for either.
-    // The close tag literal in the grammar will handle the final match.
-    
+    uint32_t length = 0;
+    // Hash of the current segment, for content-defined chunk boundaries
+    uint32_t hash = 0;
+
     while (true) {
-        // EOF
-        if (lexer->eof(lexer)) {
-            break;
+        // The hard limit applies to every character, whatever follows, so
+        // no run of text (terminators, "<" or "@" included) outgrows it
+        if (length >= RAW_TEXT_CHUNK_HARD_LIMIT) {
+            lexer->mark_end(lexer);
+            lexer->result_symbol = RAW_TEXT;
+            return true;
         }
-        
+
+        // Fast path: ordinary raw text, up to the next candidate boundary.
+        // The runtime reports EOF as a zero lookahead.
         int32_t c = lexer->lookahead;
-        
+        if (c != '@' && c != '<' && c != 0) {
+            advance(lexer);
+            length++;
+            has_content = true;
+            hash = hash * 31 + (uint32_t)c;
+            if (c == '\n' || c == ';' || c == '}') {
+                // End of a segment: a chunk boundary if its hash says so
+                if (length >= RAW_TEXT_CHUNK_SOFT_LIMIT &&
+                    (hash & RAW_TEXT_CHUNK_MASK) == 0) {
+                    lexer->mark_end(lexer);
+                    lexer->result_symbol = RAW_TEXT;
+                    return true;
+                }
+                hash = 0;
+            }
+            continue;
+        }
+
+        if (c == 0) {
+            // EOF
+            if (lexer->eof(lexer)) {
+                break;
+            }
+            // Literal NUL byte inside the raw text
+            advance(lexer);
+            length++;
+            has_content = true;
+            continue;
+        }
+
         // Check for @{ interpolation start
         if (c == '@') {
-            // Mark position before @
-            lexer->mark_end(lexer);
+            // Mark position before @ so accumulated content can be returned
+            if (has_content) {
+                lexer->mark_end(lexer);
+            }
             advance(lexer);
-            
-            if (lexer->lookahead == '{') {
+
+            if (tag->interpolation && lexer->lookahead == '{') {
                 // Found @{ - if we have content, return it first
                 if (has_content) {
                     lexer->result_symbol = RAW_TEXT;
@@ -140,185 +294,61 @@ static bool scan_raw_text(Scanner *scanner, TSLexer *lexer, const bool *valid_sy
                 return true;
             }
             // Not @{, this @ is part of raw text - continue
+            length++;
             has_content = true;
-            lexer->mark_end(lexer);
             continue;
         }
-        
-        // Check for closing tag </style> or </script>
-        if (c == '<') {
-            // Mark position before <
-            lexer->mark_end(lexer);
-            
-            // Save position to potentially backtrack
+
+        // Check for a closing tag of this mode
+        // Mark position before <
+        lexer->mark_end(lexer);
+        advance(lexer);
+
+        if (lexer->lookahead == '/') {
             advance(lexer);
-            
-            if (lexer->lookahead == '/') {
-                advance(lexer);
-                
-                // Check if this is </style>, </script>, or </SQL>
-                // We need to peek ahead without consuming if it doesn't match
-                
-                // Check for 'SQL' (case-sensitive, uppercase only)
-                if (lexer->lookahead == 'S') {
-                    advance(lexer);
-                    if (lexer->lookahead == 'Q') {
-                        advance(lexer);
-                        if (lexer->lookahead == 'L') {
-                            advance(lexer);
-                            // Check for end of tag name
-                            if (lexer->lookahead == '>' || lexer->lookahead == ' ' ||
-                                lexer->lookahead == '\t' || lexer->lookahead == '\n' ||
-                                lexer->lookahead == '\r') {
-                                // Found </SQL>!
-                                if (has_content) {
-                                    // Return accumulated content, let grammar handle close tag
-                                    lexer->result_symbol = RAW_TEXT;
-                                    return true;
-                                }
-                                // No content - decline and let grammar handle </SQL>
-                                return false;
-                            }
-                        }
-                    }
-                    // Not SQL, but started with 'S' - could still be 'style' or 'script'
-                    // Check for 'style' (already consumed 'S')
-                    if (lexer->lookahead == 't' || lexer->lookahead == 'T') {
-                        // Likely 'style'
-                        advance(lexer);
-                        if ((lexer->lookahead == 'y' || lexer->lookahead == 'Y')) {
-                            advance(lexer);
-                            if ((lexer->lookahead == 'l' || lexer->lookahead == 'L')) {
-                                advance(lexer);
-                                if ((lexer->lookahead == 'e' || lexer->lookahead == 'E')) {
-                                    advance(lexer);
-                                    // Check for end of tag name
-                                    if (lexer->lookahead == '>' || lexer->lookahead == ' ' ||
-                                        lexer->lookahead == '\t' || lexer->lookahead == '\n' ||
-                                        lexer->lookahead == '\r') {
-                                        // Found </style>!
-                                        if (has_content) {
-                                            lexer->result_symbol = RAW_TEXT;
-                                            return true;
-                                        }
-                                        return false;
-                                    }
-                                }
-                            }
-                        }
-                    } else if (lexer->lookahead == 'c' || lexer->lookahead == 'C') {
-                        // Likely 'script'
-                        advance(lexer);
-                        if ((lexer->lookahead == 'r' || lexer->lookahead == 'R')) {
-                            advance(lexer);
-                            if ((lexer->lookahead == 'i' || lexer->lookahead == 'I')) {
-                                advance(lexer);
-                                if ((lexer->lookahead == 'p' || lexer->lookahead == 'P')) {
-                                    advance(lexer);
-                                    if ((lexer->lookahead == 't' || lexer->lookahead == 'T')) {
-                                        advance(lexer);
-                                        // Check for end of tag name
-                                        if (lexer->lookahead == '>' || lexer->lookahead == ' ' ||
-                                            lexer->lookahead == '\t' || lexer->lookahead == '\n' ||
-                                            lexer->lookahead == '\r') {
-                                            // Found </script>!
-                                            if (has_content) {
-                                                lexer->result_symbol = RAW_TEXT;
-                                                return true;
-                                            }
-                                            return false;
-                                        }
-                                    }
-                                }
-                            }
-                        }
-                    }
-                } else if (lexer->lookahead == 's') {
-                    // Lowercase 's' - check for 'style' or 'script' (case-insensitive)
-                    // Could be style or script
-                    advance(lexer);
-                    
-                    if (lexer->lookahead == 't' || lexer->lookahead == 'T') {
-                        // Likely 'style'
-                        advance(lexer);
-                        if ((lexer->lookahead == 'y' || lexer->lookahead == 'Y')) {
-                            advance(lexer);
-                            if ((lexer->lookahead == 'l' || lexer->lookahead == 'L')) {
-                                advance(lexer);
-                                if ((lexer->lookahead == 'e' || lexer->lookahead == 'E')) {
-                                    advance(lexer);
-                                    // Check for end of tag name
-                                    if (lexer->lookahead == '>' || lexer->lookahead == ' ' ||
-                                        lexer->lookahead == '\t' || lexer->lookahead == '\n' ||
-                                        lexer->lookahead == '\r') {
-                                        // Found </style>!
-                                        if (has_content) {
-                                            // Return accumulated content, let grammar handle close tag
-                                            lexer->result_symbol = RAW_TEXT;
-                                            return true;
-                                        }
-                                        // No content - decline and let grammar handle </style>
-                                        return false;
-                                    }
-                                }
-                            }
-                        }
-                    } else if (lexer->lookahead == 'c' || lexer->lookahead == 'C') {
-                        // Likely 'script'
-                        advance(lexer);
-                        if ((lexer->lookahead == 'r' || lexer->lookahead == 'R')) {
-                            advance(lexer);
-                            if ((lexer->lookahead == 'i' || lexer->lookahead == 'I')) {
-                                advance(lexer);
-                                if ((lexer->lookahead == 'p' || lexer->lookahead == 'P')) {
-                                    advance(lexer);
-                                    if ((lexer->lookahead == 't' || lexer->lookahead == 'T')) {
-                                        advance(lexer);
-                                        // Check for end of tag name
-                                        if (lexer->lookahead == '>' || lexer->lookahead == ' ' ||
-                                            lexer->lookahead == '\t' || lexer->lookahead == '\n' ||
-                                            lexer->lookahead == '\r') {
-                                            // Found </script>!
-                                            if (has_content) {
-                                                // Return accumulated content, let grammar handle close tag
-                                                lexer->result_symbol = RAW_TEXT;
-                                                return true;
-                                            }
-                                            // No content - decline and let grammar handle </script>
-                                            return false;
-                                        }
-                                    }
-                                }
-                            }
-                        }
-                    }
+            if (at_closing_tag(lexer, tag)) {
+                if (has_content) {
+                    // Return accumulated content (marked before <), let
+                    // the grammar handle the closing tag
+                    lexer->result_symbol = RAW_TEXT;
+                    return true;
                 }
-                
-                // Not </style>, </script>, or </SQL>, this is raw text content
-                // (like '</div>' or '</li>' in JavaScript strings)
-                has_content = true;
-                lexer->mark_end(lexer);
-                continue;
+                // No content - decline and let the grammar handle it
+                return false;
             }
-            
-            // Not </, this < is part of raw text (like < operator in JS)
-            has_content = true;
-            lexer->mark_end(lexer);
-            continue;
         }
-        
-        // Any other character is raw text
-        advance(lexer);
+
+        // Not a closing tag, this is raw text content (like < operators
+        // or '</div>' in JavaScript strings). The probe may have consumed a
+        // few more characters; counting only the < is close enough here.
+        length++;
         has_content = true;
-        lexer->mark_end(lexer);
     }
-    
-    // Return accumulated content at EOF
+
+    // Return accumulated content at EOF. A failed probe may have left the
+    // mark behind the current position, so mark the true end here.
     if (has_content) {
+        lexer->mark_end(lexer);
         lexer->result_symbol = RAW_TEXT;
         return true;
     }
-    
+
+    return false;
+}
+
+// Pick the token to scan for from valid_symbols and scan it
+static bool scan(Scanner *scanner, TSLexer *lexer, const bool *valid_symbols) {
+
+    // If RAW_TEXT or RAW_TEXT_INTERPOLATION_START is valid, we're inside a
+    // style/script/SQL tag and should scan for raw text content
+    uint8_t mode = raw_text_mode_for(valid_symbols);
+    if (mode != RAW_TEXT_NONE) {
+        scanner->raw_text_mode = mode;
+        STATS_ATTEMPT(RAW_TEXT);
+        return scan_raw_text(lexer, &RAW_TEXT_TAGS[mode]);
+    }
+
+    // For all other cases, decline and let the grammar handle it
     return false;
 }
 
@@ -336,13 +366,26 @@ bool tree_sitter_parsley_external_scanner_scan(
     const bool *valid_symbols
 ) {
     Scanner *scanner = (Scanner *)payload;
-    
-    // If RAW_TEXT or RAW_TEXT_INTERPOLATION_START is valid, we're inside a 
-    // style/script tag and should scan for raw text content
-    if (valid_symbols[RAW_TEXT] || valid_symbols[RAW_TEXT_INTERPOLATION_START]) {
-        return scan_raw_text(scanner, lexer, valid_symbols);
+#ifdef TREE_SITTER_PARSLEY_SCANNER_STATS
+    stats_attempt = -1;
+    stats_bytes = 0;
+    bool found = scan(scanner, lexer, valid_symbols);
+
+    stats.calls++;
+    if (stats_attempt < 0) {
+        stats.unhandled++;
+        return found;
     }
-    
-    // For all other cases, decline and let the grammar handle it
-    return false;
-}
\ No newline at end of file
+    ParsleyScannerTokenStats *attempted = &stats.tokens[stats_attempt];
+    attempted->scans++;
+    attempted->bytes += stats_bytes;
+    if (found) {
+        stats.tokens[lexer->result_symbol].produced++;
+    } else {
+        attempted->declined++;
+    }
+    return found;
+#else
+    return scan(scanner, lexer, valid_symbols);
+#endif
+}
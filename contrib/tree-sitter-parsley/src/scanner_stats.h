@@ -0,0 +1,42 @@
+/**
+ * Counters kept by the external scanner in an instrumentation build
+ *
+ * Compile src/scanner.c with -DTREE_SITTER_PARSLEY_SCANNER_STATS to turn
+ * them on (bench/parse_profile.c does). Ordinary builds keep no counters
+ * and do not export these functions.
+ *
+ * The counters are process-wide rather than per parser, and not
+ * synchronized: the instrumentation build is for single-threaded profiling.
+ */
+
+#ifndef TREE_SITTER_PARSLEY_SCANNER_STATS_H_
+#define TREE_SITTER_PARSLEY_SCANNER_STATS_H_
+
+#include <stdint.h>
+
+// One entry per external token, in grammar.js externals order
+#define PARSLEY_SCANNER_TOKEN_COUNT 2
+
+typedef struct {
+    const char *name;   // token name as in grammar.js externals
+    uint64_t scans;     // scans that tried to produce this token
+    uint64_t produced;  // tokens of this type returned
+    uint64_t declined;  // scans for this token that returned no token
+    uint64_t bytes;     // bytes advanced over by those scans, including
+                        // lookahead past the token end and declined scans
+} ParsleyScannerTokenStats;
+
+// A raw text scan may return the interpolation start instead of the body
+// token it tried for, so scans == produced + declined holds for the sum over
+// all tokens rather than for each one.
+typedef struct {
+    uint64_t calls;      // every call to the scan function
+    uint64_t unhandled;  // calls where no external token applied (declined
+                         // without scanning)
+    ParsleyScannerTokenStats tokens[PARSLEY_SCANNER_TOKEN_COUNT];
+} ParsleyScannerStats;
+
+const ParsleyScannerStats *tree_sitter_parsley_external_scanner_stats(void);
+void tree_sitter_parsley_external_scanner_reset_stats(void);
+
+#endif // TREE_SITTER_PARSLEY_SCANNER_STATS_H_
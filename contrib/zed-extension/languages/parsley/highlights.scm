@@ -1,3 +1,8 @@
+; Tokens that only occur in one rule ("@query", "/>", "fn", ...) are matched
+; on their own rather than under their parent node. A parent-anchored pattern
+; keeps a cursor state open across the parent's whole subtree, which is the
+; main cost of running this query on large files (bench/query_bench.c).
+
 ; Keywords
 [
   "let"
@@ -49,8 +54,9 @@
 (path_template) @string.special.path
 
 ; Schema declarations
+"@schema" @keyword
+
 (schema_declaration
-  "@schema" @keyword
   name: (identifier) @type)
 
 ; Schema fields
@@ -63,8 +69,7 @@
   name: (identifier) @property)
 
 ; Table expressions
-(table_expression
-  "@table" @keyword)
+"@table" @keyword
 
 ; Arithmetic operators
 [
@@ -151,11 +156,11 @@
 ; Tag punctuation
 ; The ">" in open tags and "/>" in self-closing tags
 (open_tag ">" @tag)
-(self_closing_tag "/>" @tag)
+"/>" @tag
 (close_tag) @tag
 
 ; Functions
-(function_expression ["fn" "function"] @keyword.function)
+["fn" "function"] @keyword.function
 
 (call_expression
   function: (identifier) @function.call)
@@ -193,7 +198,7 @@
 ; ==================== Query DSL ====================
 
 ; Query expression keyword
-(query_expression "@query" @function.builtin)
+"@query" @function.builtin
 
 ; Query source table
 (query_source
@@ -248,7 +253,7 @@
 (query_condition_group ["not" "!" "and" "or"] @keyword.operator)
 
 ; Mutation expressions
-(mutation_expression ["@insert" "@update" "@delete" "@transaction"] @function.builtin)
+["@insert" "@update" "@delete" "@transaction"] @function.builtin
 
 ; Identifiers (lowest priority - catch-all)
 (identifier) @variable
@@ -1,6 +1,8 @@
 ; Language injection queries for Parsley
 ; Inject CSS grammar into <style> tag raw text content
 ; Inject JavaScript grammar into <script> tag raw text content
+; Inject SQL grammar into <SQL> tag raw text content
+; Large bodies arrive as several raw_text chunks; injection.combined joins them
 
 ; CSS injection in style tags
 (style_tag
@@ -13,3 +15,9 @@
   (raw_text) @injection.content
   (#set! injection.language "javascript")
   (#set! injection.combined))
+
+; SQL in <SQL> tags
+(sql_tag
+  (raw_text) @injection.content
+  (#set! injection.language "SQL")
+  (#set! injection.combined))
@@ -9,3 +9,13 @@
 (assignment_statement
   left: (identifier) @name
   right: (function_expression)) @item
+
+; Functions defined with let: let name = fn(...)
+(let_statement
+  pattern: (identifier) @name
+  value: (function_expression)) @item
+
+; Schemas
+(schema_declaration
+  "@schema" @context
+  name: (identifier) @name) @item
@@ -4,6 +4,7 @@ import (
 	"fmt"
 	"os"
 	"strings"
+	"time"
 
 	"github.com/sambeau/basil/pkg/parsley/ast"
 	perrors "github.com/sambeau/basil/pkg/parsley/errors"
@@ -52,6 +53,7 @@ func applyMethodWithThis(fn *Function, args []Object, thisObj *Dictionary, env *
 		extendedEnv.AssetBundle = env.AssetBundle
 		extendedEnv.AssetRegistry = env.AssetRegistry
 		extendedEnv.FragmentCache = env.FragmentCache
+		extendedEnv.Profiler = env.requestProfiler()
 		extendedEnv.BasilCtx = env.BasilCtx
 		extendedEnv.DevLog = env.DevLog
 		extendedEnv.HandlerPath = env.HandlerPath
@@ -80,6 +82,7 @@ func ApplyFunctionWithEnv(fn Object, args []Object, env *Environment) Object {
 			extendedEnv.AssetBundle = env.AssetBundle
 			extendedEnv.AssetRegistry = env.AssetRegistry
 			extendedEnv.FragmentCache = env.FragmentCache
+			extendedEnv.Profiler = env.requestProfiler()
 			extendedEnv.BasilCtx = env.BasilCtx
 			extendedEnv.DevLog = env.DevLog
 			extendedEnv.HandlerPath = env.HandlerPath
@@ -280,6 +283,10 @@ func importModule(pathStr string, env *Environment) Object {
 	moduleCache.mu.RLock()
 	if cached, ok := moduleCache.modules[absPath]; ok {
 		moduleCache.mu.RUnlock()
+		if prof := env.requestProfiler(); prof != nil {
+			prof.ImportStart(absPath)
+			prof.ImportEnd(absPath, 0, 0, true)
+		}
 		return cached
 	}
 	moduleCache.mu.RUnlock()
@@ -288,6 +295,14 @@ func importModule(pathStr string, env *Environment) Object {
 	rootEnv.importStack[absPath] = true
 	defer delete(rootEnv.importStack, absPath)
 
+	// Report the import to the profiler however it ends
+	var parseTime, evalTime time.Duration
+	prof := env.requestProfiler()
+	if prof != nil {
+		prof.ImportStart(absPath)
+		defer func() { prof.ImportEnd(absPath, parseTime, evalTime, false) }()
+	}
+
 	// Read the file
 	content, err := os.ReadFile(absPath)
 	if err != nil {
@@ -298,9 +313,11 @@ func importModule(pathStr string, env *Environment) Object {
 	}
 
 	// Parse the module (with filename for error reporting)
+	parseStart := time.Now()
 	l := lexer.NewWithFilename(string(content), absPath)
 	p := parser.New(l)
 	program := p.ParseProgram()
+	parseTime = time.Since(parseStart)
 
 	// Check for parse errors using structured errors
 	if errs := p.StructuredErrors(); len(errs) > 0 {
@@ -344,7 +361,13 @@ func importModule(pathStr string, env *Environment) Object {
 	}
 
 	// Evaluate the module
+	// The module is cached for later requests, so it only reports to this
+	// request's profiler while it is evaluated
+	evalStart := time.Now()
+	moduleEnv.Profiler = prof
 	result := Eval(program, moduleEnv)
+	moduleEnv.Profiler = nil
+	evalTime = time.Since(evalStart)
 
 	// Check for errors during module evaluation
 	if isError(result) {
@@ -193,7 +193,11 @@ func evalCacheTag(node *ast.TagPairExpression, env *Environment) Object {
 	}
 
 	// Check cache for hit
-	if cached, hit := env.FragmentCache.Get(fullKey); hit {
+	cached, hit := env.FragmentCache.Get(fullKey)
+	if prof := env.requestProfiler(); prof != nil {
+		prof.FragmentCache(fullKey, hit)
+	}
+	if hit {
 		// Cache hit - return cached HTML without evaluating children
 		return &String{Value: cached}
 	}
@@ -42,6 +42,25 @@ type FragmentCacher interface {
 	Invalidate(key string)
 }
 
+// Profiler receives request timings for the DevTools profile page.
+// This allows the server package to collect them without creating a
+// circular dependency. All calls for one request come from the goroutine
+// evaluating it.
+//
+// A Profiler belongs to one request, so it is not copied into enclosed
+// environments, which closures and cached modules outlive the request in.
+// The evaluator finds it with requestProfiler.
+type Profiler interface {
+	// ImportStart marks the start of an import of the module at path.
+	ImportStart(path string)
+	// ImportEnd closes the last ImportStart with the time spent lexing and
+	// parsing the module and evaluating it. Both are zero when the module
+	// came from the module cache.
+	ImportEnd(path string, parse, eval time.Duration, cached bool)
+	// FragmentCache records a <basil.cache.Cache> lookup.
+	FragmentCache(key string, hit bool)
+}
+
 // AssetRegistrar is the interface for public asset registration in the evaluator.
 // This allows the server package to provide asset registry implementation without
 // creating a circular dependency.
@@ -656,6 +675,7 @@ type Environment struct {
 	BasilCtx      Object          // Basil server context (request, db, auth, etc.)
 	ServerDB      *DBConnection   // Server-level database connection (set at startup, available to modules)
 	FragmentCache FragmentCacher  // Fragment cache for <basil.cache.Cache> (nil if not available)
+	Profiler      Profiler        // Request profiler for DevTools (nil when profiling is off); read with requestProfiler
 	AssetRegistry AssetRegistrar  // Asset registry for publicUrl() (nil if not available)
 	AssetBundle   AssetBundler    // Asset bundle for <Css/> and <Script/> tags (nil if not available)
 	BasilJSURL    string          // URL for basil.js prelude script (for <BasilJS/> tag)
@@ -737,6 +757,21 @@ func NewEnclosedEnvironment(outer *Environment) *Environment {
 	return env
 }
 
+// requestProfiler returns the profiler of the request evaluating e: the
+// closest one set on e or its outer environments. Profilers are only set
+// on a request's root environment, on a module's environment while it is
+// evaluated, and on the environment of a call made with the caller's
+// context, so a function kept by a cached module reports to the request
+// calling it and not to the one that imported it.
+func (e *Environment) requestProfiler() Profiler {
+	for env := e; env != nil; env = env.outer {
+		if env.Profiler != nil {
+			return env.Profiler
+		}
+	}
+	return nil
+}
+
 // Get retrieves a value from the environment
 func (e *Environment) Get(name string) (Object, bool) {
 	value, ok := e.store[name]
@@ -7,6 +7,7 @@ import (
 	"unicode"
 
 	"github.com/sambeau/basil/pkg/parsley/ast"
+	"github.com/sambeau/basil/pkg/parsley/highlight"
 	"github.com/yuin/goldmark"
 	gmast "github.com/yuin/goldmark/ast"
 	"github.com/yuin/goldmark/extension"
@@ -819,14 +820,28 @@ func renderHTMLNode(buf *strings.Builder, node *Dictionary, env *Environment) {
 
 	case "code_block", "fenced_code_block":
 		lang := getDictString(node, "language", env)
+		code := getDictString(node, "code", env)
+		highlighted, ok := "", false
+		if highlight.IsParsley(lang) {
+			highlighted, ok = highlight.HTML(code)
+		}
 		buf.WriteString("<pre><code")
 		if lang != "" {
 			buf.WriteString(` class="language-`)
 			buf.WriteString(htmlEscape(lang))
+			if ok {
+				// Same classes highlight.js would produce; data-highlighted
+				// stops it highlighting the block again on the client
+				buf.WriteString(` hljs" data-highlighted="yes`)
+			}
 			buf.WriteString(`"`)
 		}
 		buf.WriteString(">")
-		buf.WriteString(htmlEscape(getDictString(node, "code", env)))
+		if ok {
+			buf.WriteString(highlighted)
+		} else {
+			buf.WriteString(htmlEscape(code))
+		}
 		buf.WriteString("</code></pre>\n")
 
 	case "html_block", "raw_html":
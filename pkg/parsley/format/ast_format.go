@@ -129,59 +129,75 @@ func FormatProgram(prog *ast.Program) string {
 	return p.String()
 }
 
+// FormatGap returns what FormatProgram writes before statement i: the
+// separator after statement i-1 (with its trailing comment, which the lexer
+// attaches to statement i's first token), blank lines and statement i's
+// leading comments. FormatGap(prog, len(prog.Statements)) is "".
+//
+// A top-level statement always starts at column 0 with no indentation, so
+// FormatProgram is exactly the gaps and FormatNode of each statement in
+// turn. Range formatting relies on that to reformat only some statements.
+func FormatGap(prog *ast.Program, i int) string {
+	if prog == nil || i < 0 || i >= len(prog.Statements) {
+		return ""
+	}
+	p := NewPrinter()
+	p.formatGap(prog, i)
+	return p.String()
+}
+
 // formatProgram formats a program with proper spacing between statements
 func (p *Printer) formatProgram(prog *ast.Program) {
 	for i, stmt := range prog.Statements {
-		tok := getStatementToken(stmt)
-
-		// For the first statement, handle leading comments and blank lines
-		if i == 0 {
-			// Output any leading comments for this statement
-			p.writeComments(tok)
+		p.formatGap(prog, i)
+		p.formatStatement(stmt)
+	}
+}
 
-			// If there was a blank line between comments and code, preserve it
-			if tok != nil && tok.BlankLinesBefore > 0 && len(tok.LeadingComments) > 0 {
-				p.newline()
-			}
+// formatGap writes the spacing and comments before statement i
+func (p *Printer) formatGap(prog *ast.Program, i int) {
+	stmt := prog.Statements[i]
+	tok := getStatementToken(stmt)
 
-			p.formatStatement(stmt)
-			continue
-		}
+	// For the first statement, handle leading comments and blank lines
+	if i == 0 {
+		// Output any leading comments for this statement
+		p.writeComments(tok)
 
-		// For subsequent statements:
-		// 1. First, output trailing comment from previous statement (on same line)
-		if tok != nil && tok.TrailingComment != "" {
-			p.write(" ")
-			p.write(tok.TrailingComment)
+		// If there was a blank line between comments and code, preserve it
+		if tok != nil && tok.BlankLinesBefore > 0 && len(tok.LeadingComments) > 0 {
+			p.newline()
 		}
+		return
+	}
 
-		// 2. Newline after previous statement
+	// Add extra blank line for visual separation after functions/schemas
+	// Only if this statement doesn't already have a blank line from source
+	if needsBlankLineAfter(prog.Statements[i-1]) && (tok == nil || tok.BlankLinesBefore == 0) {
 		p.newline()
+	}
 
-		// 3. Blank line separator if needed
-		if tok != nil && tok.BlankLinesBefore > 0 {
-			// Source had a blank line - output it
-			p.newline()
-		} else if needsBlankLineBefore(stmt, prog.Statements[i-1]) {
-			// Fallback: Add blank line BEFORE certain statements (like exported function defs)
-			p.newline()
-		}
-
-		// 4. Output any leading comments for this statement
-		p.writeComments(tok)
+	// For subsequent statements:
+	// 1. First, output trailing comment from previous statement (on same line)
+	if tok != nil && tok.TrailingComment != "" {
+		p.write(" ")
+		p.write(tok.TrailingComment)
+	}
 
-		// 5. Format the statement
-		p.formatStatement(stmt)
+	// 2. Newline after previous statement
+	p.newline()
 
-		// Add extra blank line for visual separation after functions/schemas (but not at end)
-		// Only if next statement doesn't already have a blank line from source
-		if i < len(prog.Statements)-1 && needsBlankLineAfter(stmt) {
-			nextTok := getStatementToken(prog.Statements[i+1])
-			if nextTok == nil || nextTok.BlankLinesBefore == 0 {
-				p.newline()
-			}
-		}
+	// 3. Blank line separator if needed
+	if tok != nil && tok.BlankLinesBefore > 0 {
+		// Source had a blank line - output it
+		p.newline()
+	} else if needsBlankLineBefore(stmt, prog.Statements[i-1]) {
+		// Fallback: Add blank line BEFORE certain statements (like exported function defs)
+		p.newline()
 	}
+
+	// 4. Output any leading comments for this statement
+	p.writeComments(tok)
 }
 
 // needsBlankLineBefore determines if a statement needs an extra blank line before it
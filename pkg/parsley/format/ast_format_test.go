@@ -1,6 +1,7 @@
 package format
 
 import (
+	"strings"
 	"testing"
 
 	"github.com/sambeau/basil/pkg/parsley/lexer"
@@ -736,3 +737,36 @@ func TestFormatTagPairAttributesMultiline(t *testing.T) {
 		t.Errorf("expected:\n%s\ngot:\n%s", expected, result)
 	}
 }
+
+// Range formatting reassembles FormatProgram from FormatGap and FormatNode,
+// so the pieces must add up to the whole-program output byte for byte.
+func TestFormatGapsMakeUpProgram(t *testing.T) {
+	inputs := []string{
+		"let x = 1",
+		"// header\n\nlet x = 1 // one\n// two\nlet y = 2",
+		"let f = fn(a) { a * 2 }\nlet g = fn(b) {\n\tlet c = b\n\tc\n}\nlet z = f(1)",
+		"@schema User {\n\tname: string\n}\nlet u = 1\n\n\nexport greet = fn(name) { name }",
+		"let a = 1\nexport let b = fn() { a }\nexport c = 3",
+		"<div class=\"x\">\n\t<p>\"hi\"</p>\n</div>\nlet n = 2 // trailing\n",
+	}
+	for _, input := range inputs {
+		l := lexer.New(input)
+		p := parser.New(l)
+		program := p.ParseProgram()
+		if len(p.Errors()) > 0 {
+			t.Fatalf("parser errors for input %q: %v", input, p.Errors())
+		}
+
+		var pieces strings.Builder
+		for i, stmt := range program.Statements {
+			pieces.WriteString(FormatGap(program, i))
+			pieces.WriteString(FormatNode(stmt))
+		}
+		if want := FormatProgram(program); pieces.String() != want {
+			t.Errorf("gaps and statements of %q:\n%q\nwant:\n%q", input, pieces.String(), want)
+		}
+	}
+	if got := FormatGap(nil, 0); got != "" {
+		t.Errorf("FormatGap(nil, 0) = %q", got)
+	}
+}
@@ -0,0 +1,114 @@
+// Package highlight renders Parsley source as syntax-highlighted HTML for the
+// markdown renderer and the dev error pages, caching the result by content
+// hash so the same snippet is only highlighted once.
+//
+// Basil itself stays free of cgo, so this package does not highlight
+// anything on its own: a highlighter is installed with Register. The
+// tree-sitter grammar in contrib/tree-sitter-parsley provides one built on
+// its highlights.scm (basil/highlight). Until one is registered, HTML
+// and Lines report false and callers fall back to escaped plain text, which
+// the client-side highlight.js grammar can still pick up.
+package highlight
+
+import (
+	"container/list"
+	"crypto/sha256"
+	"strings"
+	"sync"
+)
+
+// Func turns Parsley source into HTML. The result must be the escaped source
+// text with markup added, and no element may span a newline, so that the
+// output can be split into lines.
+type Func func(source string) string
+
+// cacheSize bounds the number of highlighted snippets kept in memory. Docs
+// pages have a few hundred distinct samples at most; error pages add one
+// entry per file that failed.
+const cacheSize = 1024
+
+var (
+	mu          sync.Mutex
+	highlighter Func
+	generation  int // bumped by Register, so a result from the old highlighter is not cached
+	entries     = make(map[[sha256.Size]byte]*list.Element)
+	order       = list.New() // most recently used at the front
+)
+
+type entry struct {
+	key  [sha256.Size]byte
+	html string
+}
+
+// Register installs fn as the Parsley highlighter and clears the cache.
+// Passing nil turns highlighting off again.
+func Register(fn Func) {
+	mu.Lock()
+	defer mu.Unlock()
+	highlighter = fn
+	generation++
+	entries = make(map[[sha256.Size]byte]*list.Element)
+	order.Init()
+}
+
+// Enabled reports whether a highlighter is registered.
+func Enabled() bool {
+	mu.Lock()
+	defer mu.Unlock()
+	return highlighter != nil
+}
+
+// IsParsley reports whether a code block language tag names Parsley.
+func IsParsley(language string) bool {
+	switch strings.ToLower(language) {
+	case "parsley", "pars", "part":
+		return true
+	}
+	return false
+}
+
+// HTML returns the highlighted HTML for source. ok is false when no
+// highlighter is registered.
+func HTML(source string) (html string, ok bool) {
+	key := sha256.Sum256([]byte(source))
+
+	mu.Lock()
+	fn, gen := highlighter, generation
+	if fn == nil {
+		mu.Unlock()
+		return "", false
+	}
+	if elem, found := entries[key]; found {
+		order.MoveToFront(elem)
+		html = elem.Value.(*entry).html
+		mu.Unlock()
+		return html, true
+	}
+	mu.Unlock()
+
+	// Highlight outside the lock; two renders racing on a new snippet both
+	// do the work, which is cheaper than serialising every miss
+	html = fn(source)
+
+	mu.Lock()
+	defer mu.Unlock()
+	if _, found := entries[key]; !found && gen == generation {
+		entries[key] = order.PushFront(&entry{key: key, html: html})
+		if order.Len() > cacheSize {
+			oldest := order.Back()
+			order.Remove(oldest)
+			delete(entries, oldest.Value.(*entry).key)
+		}
+	}
+	return html, true
+}
+
+// Lines returns the highlighted HTML for source split into lines, one per
+// line of source. ok is false when no highlighter is registered.
+func Lines(source string) (lines []string, ok bool) {
+	html, ok := HTML(source)
+	if !ok {
+		return nil, false
+	}
+	return strings.Split(html, "\n"), true
+}
@@ -0,0 +1,110 @@
+package highlight
+
+import (
+	"fmt"
+	"strings"
+	"testing"
+)
+
+func countingHighlighter(calls *int) Func {
+	return func(source string) string {
+		*calls++
+		return `<span class="hljs-keyword">` + strings.ReplaceAll(source, "\n", "</span>\n<span class=\"hljs-keyword\">") + `</span>`
+	}
+}
+
+func TestHTMLWithoutHighlighter(t *testing.T) {
+	Register(nil)
+	if _, ok := HTML("let x = 1"); ok {
+		t.Fatal("expected no highlighting without a registered highlighter")
+	}
+	if Enabled() {
+		t.Fatal("expected Enabled to be false")
+	}
+}
+
+func TestHTMLCachesByContent(t *testing.T) {
+	calls := 0
+	Register(countingHighlighter(&calls))
+	defer Register(nil)
+
+	first, ok := HTML("let x = 1")
+	if !ok {
+		t.Fatal("expected highlighting")
+	}
+	second, _ := HTML("let x = " + "1")
+	if first != second {
+		t.Errorf("cached result differs: %q vs %q", first, second)
+	}
+	if calls != 1 {
+		t.Errorf("expected 1 highlighter call, got %d", calls)
+	}
+
+	HTML("let y = 2")
+	if calls != 2 {
+		t.Errorf("expected a new snippet to be highlighted, got %d calls", calls)
+	}
+}
+
+func TestRegisterClearsCache(t *testing.T) {
+	calls := 0
+	Register(countingHighlighter(&calls))
+	HTML("let x = 1")
+	Register(countingHighlighter(&calls))
+	defer Register(nil)
+	HTML("let x = 1")
+	if calls != 2 {
+		t.Errorf("expected the new highlighter to run, got %d calls", calls)
+	}
+}
+
+func TestCacheEvictsLeastRecentlyUsed(t *testing.T) {
+	calls := 0
+	Register(countingHighlighter(&calls))
+	defer Register(nil)
+
+	HTML("keep")
+	for i := 0; i < cacheSize; i++ {
+		HTML("keep") // stays at the front
+		HTML(fmt.Sprintf("let x%d = %d", i, i))
+	}
+	if len(entries) != cacheSize {
+		t.Errorf("expected cache to hold %d entries, got %d", cacheSize, len(entries))
+	}
+	before := calls
+	HTML("keep")
+	if calls != before {
+		t.Error("recently used snippet was evicted")
+	}
+	HTML("let x0 = 0")
+	if calls != before+1 {
+		t.Error("least recently used snippet was not evicted")
+	}
+}
+
+func TestLines(t *testing.T) {
+	calls := 0
+	Register(countingHighlighter(&calls))
+	defer Register(nil)
+
+	lines, ok := Lines("let x = 1\nx")
+	if !ok || len(lines) != 2 {
+		t.Fatalf("expected 2 lines, got %v", lines)
+	}
+	if lines[1] != `<span class="hljs-keyword">x</span>` {
+		t.Errorf("unexpected second line %q", lines[1])
+	}
+}
+
+func TestIsParsley(t *testing.T) {
+	for _, lang := range []string{"parsley", "Parsley", "pars", "part"} {
+		if !IsParsley(lang) {
+			t.Errorf("expected %q to be Parsley", lang)
+		}
+	}
+	for _, lang := range []string{"", "go", "js", "html"} {
+		if IsParsley(lang) {
+			t.Errorf("expected %q not to be Parsley", lang)
+		}
+	}
+}
@@ -480,6 +480,24 @@ func NewWithFilename(input string, filename string) *Lexer {
 	return l
 }
 
+// NewAt creates a lexer for input that continues a larger source just after
+// one of its tokens. line and column are the position of the character before
+// input[0] (column counts characters, as the lexer does), and after is the
+// type of the token that ended there. Tokens then carry the same positions and
+// trivia as they would when lexing the whole source, which lets callers
+// re-parse one statement of a file on its own.
+func NewAt(input string, filename string, line, column int, after TokenType) *Lexer {
+	l := &Lexer{
+		filename:      filename,
+		input:         input,
+		line:          line,
+		column:        column,
+		lastTokenType: after,
+	}
+	l.readChar()
+	return l
+}
+
 // LexerState holds the state of a lexer for save/restore
 type LexerState struct {
 	position               int
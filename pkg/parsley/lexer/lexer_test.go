@@ -253,3 +253,29 @@ func TestStyleTagAllowsInterpolation(t *testing.T) {
 		t.Fatalf("Expected LBRACE (interpolation start) in style tag, got %s", tok.Type)
 	}
 }
+
+func TestNewAtMatchesWholeSource(t *testing.T) {
+	// Lexing the second statement on its own, from where it starts, should
+	// give the same tokens as lexing the whole source
+	source := "let a = 1 // one\n\nlet b = é / 2\n"
+	split := strings.Index(source, " // one")
+
+	whole := New(source)
+	for tok := whole.NextToken(); tok.Literal != "1"; tok = whole.NextToken() {
+	}
+
+	part := NewAt(source[split:], "<input>", 1, split, INT)
+	for {
+		want := whole.NextToken()
+		got := part.NextToken()
+		if got.Type != want.Type || got.Literal != want.Literal ||
+			got.Line != want.Line || got.Column != want.Column ||
+			got.BlankLinesBefore != want.BlankLinesBefore ||
+			got.TrailingComment != want.TrailingComment {
+			t.Fatalf("NewAt token = %+v, want %+v", got, want)
+		}
+		if want.Type == EOF {
+			break
+		}
+	}
+}
@@ -0,0 +1,48 @@
+package parser
+
+import (
+	"io/fs"
+	"os"
+	"path/filepath"
+	"strings"
+	"testing"
+
+	"github.com/sambeau/basil/pkg/parsley/lexer"
+)
+
+// Every Parsley source the tree-sitter differential harness
+// (contrib/tree-sitter-parsley/basil/differential) also parses, so Go-side
+// allocation numbers can be read next to its tree-sitter timings
+var fixtureRoots = []string{"../tests/test_fixtures", "../../../examples"}
+
+func BenchmarkParseProgram_Fixtures(b *testing.B) {
+	var files []string
+	for _, root := range fixtureRoots {
+		filepath.WalkDir(root, func(path string, entry fs.DirEntry, err error) error {
+			if err == nil && !entry.IsDir() && (strings.HasSuffix(path, ".pars") || strings.HasSuffix(path, ".part")) {
+				files = append(files, path)
+			}
+			return nil
+		})
+	}
+	if len(files) == 0 {
+		b.Skip("no fixtures found")
+	}
+
+	for _, file := range files {
+		source, err := os.ReadFile(file)
+		if err != nil {
+			b.Fatal(err)
+		}
+		input := string(source)
+		name, _ := filepath.Rel("../../..", file)
+		b.Run(name, func(b *testing.B) {
+			b.ReportAllocs()
+			b.SetBytes(int64(len(input)))
+			for b.Loop() {
+				p := New(lexer.New(input))
+				p.ParseProgram()
+			}
+		})
+	}
+}
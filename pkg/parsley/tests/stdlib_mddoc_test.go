@@ -6,6 +6,7 @@ import (
 	"testing"
 
 	"github.com/sambeau/basil/pkg/parsley/evaluator"
+	"github.com/sambeau/basil/pkg/parsley/highlight"
 	"github.com/sambeau/basil/pkg/parsley/lexer"
 	"github.com/sambeau/basil/pkg/parsley/parser"
 )
@@ -105,6 +106,45 @@ func TestMdDocToHTML(t *testing.T) {
 	}
 }
 
+// TestMdDocToHTMLHighlightsParsley tests that Parsley code blocks go through
+// the registered highlighter and other languages are left to the client
+func TestMdDocToHTMLHighlightsParsley(t *testing.T) {
+	highlight.Register(func(source string) string {
+		return `<span class="hljs-keyword">` + source + `</span>`
+	})
+	defer highlight.Register(nil)
+
+	input := "let {mdDoc} = import @std/mdDoc; let doc = mdDoc(\"```parsley\\nlet\\n```\\n\\n```go\\nvar\\n```\"); doc.toHTML()"
+
+	l := lexer.New(input)
+	p := parser.New(l)
+	program := p.ParseProgram()
+
+	if len(p.Errors()) > 0 {
+		t.Fatalf("parser errors: %v", p.Errors())
+	}
+
+	env := evaluator.NewEnvironment()
+	result := evaluator.Eval(program, env)
+
+	if result.Type() == evaluator.ERROR_OBJ {
+		t.Fatalf("evaluation error: %s", result.Inspect())
+	}
+
+	str, ok := result.(*evaluator.String)
+	if !ok {
+		t.Fatalf("expected STRING, got %s", result.Type())
+	}
+
+	parsley := `<pre><code class="language-parsley hljs" data-highlighted="yes"><span class="hljs-keyword">let`
+	if !strings.Contains(str.Value, parsley) {
+		t.Errorf("expected highlighted Parsley block, got: %s", str.Value)
+	}
+	if !strings.Contains(str.Value, `<pre><code class="language-go">var`) {
+		t.Errorf("expected plain Go block, got: %s", str.Value)
+	}
+}
+
 // TestMdDocHeadings tests headings extraction
 func TestMdDocHeadings(t *testing.T) {
 	input := `let {mdDoc} = import @std/mdDoc; let doc = mdDoc("# Title"); doc.headings().length()`
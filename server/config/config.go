@@ -240,6 +240,7 @@ type DevConfig struct {
 	LogMaxSize     string `yaml:"log_max_size"`     // Maximum log database size (default: "10MB")
 	LogTruncatePct int    `yaml:"log_truncate_pct"` // Percentage to delete when truncating (default: 25)
 	Cache          bool   `yaml:"cache"`            // Enable response caching in dev mode (default: false)
+	Profile        bool   `yaml:"profile"`          // Serve the /__/profile page outside dev mode too (default: false)
 }
 
 // StaticRoute maps URL paths to static files/directories
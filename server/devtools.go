@@ -13,6 +13,7 @@ import (
 	"time"
 
 	"github.com/sambeau/basil/pkg/parsley/evaluator"
+	"github.com/sambeau/basil/pkg/parsley/highlight"
 	"github.com/sambeau/basil/pkg/parsley/parsley"
 )
 
@@ -78,14 +79,14 @@ func newDevToolsHandler(s *Server) *devToolsHandler {
 
 // ServeHTTP handles requests to /__/* routes.
 func (h *devToolsHandler) ServeHTTP(w http.ResponseWriter, r *http.Request) {
-	// Not in dev mode - return 404
-	if !h.server.config.Server.Dev {
+	path := r.URL.Path
+
+	// Not in dev mode - return 404, except for the profile page when dev.profile is set
+	if !h.server.config.Server.Dev && (h.server.profiler == nil || strings.TrimSuffix(path, "/") != "/__/profile") {
 		http.NotFound(w, r)
 		return
 	}
 
-	path := r.URL.Path
-
 	switch {
 	case path == "/__" || path == "/__/":
 		h.handleDevToolsWithPrelude(w, r, "index.pars")
@@ -99,6 +100,8 @@ func (h *devToolsHandler) ServeHTTP(w http.ResponseWriter, r *http.Request) {
 		route := strings.TrimPrefix(path, "/__/logs/")
 		route = strings.TrimSuffix(route, "/")
 		h.serveLogs(w, r, route)
+	case path == "/__/profile" || path == "/__/profile/":
+		h.serveProfile(w, r)
 	case path == "/__/db" || path == "/__/db/":
 		h.handleDevToolsWithPrelude(w, r, "db.pars")
 	case path == "/__/db/download" || path == "/__/db/download/":
@@ -160,6 +163,20 @@ func (h *devToolsHandler) serveLogs(w http.ResponseWriter, r *http.Request, rout
 	h.handleDevToolsWithPrelude(w, r, "logs.pars")
 }
 
+// serveProfile serves the request profile page.
+func (h *devToolsHandler) serveProfile(w http.ResponseWriter, r *http.Request) {
+	// Check for ?clear query param
+	if r.URL.Query().Has("clear") {
+		if h.server.profiler != nil {
+			h.server.profiler.clear()
+		}
+		http.Redirect(w, r, "/__/profile", http.StatusSeeOther)
+		return
+	}
+
+	h.handleDevToolsWithPrelude(w, r, "profile.pars")
+}
+
 // serveLogsPoll serves the logs polling endpoint for live refresh.
 // Returns JSON with the current log sequence number.
 func (h *devToolsHandler) serveLogsPoll(w http.ResponseWriter, r *http.Request) {
@@ -1040,12 +1057,14 @@ func (h *devToolsHandler) createDevToolsEnv(path string, r *http.Request) *evalu
 		// Convert to Parsley-friendly format
 		logsArray := make([]any, len(entries))
 		for i, e := range entries {
+			callHTML, _ := highlight.HTML(e.CallRepr)
 			logsArray[i] = map[string]any{
 				"level":     e.Level,
 				"filename":  filepath.Base(e.Filename),
 				"line":      e.Line,
 				"timestamp": e.Timestamp.Format("2006-01-02 15:04:05"),
 				"call":      e.CallRepr,
+				"call_html": callHTML,
 				"value":     e.ValueRepr,
 			}
 		}
@@ -1171,6 +1190,10 @@ func (h *devToolsHandler) createDevToolsEnv(path string, r *http.Request) *evalu
 			}
 		}
 
+	case path == "/__/profile" || path == "/__/profile/":
+		// Profile page - recent requests, a flame graph and per-module totals
+		h.addProfileData(devtoolsMap, r)
+
 	case path == "/__/env" || path == "/__/env/":
 		// Environment info page - organized by section with descriptions
 		cfg := h.server.config
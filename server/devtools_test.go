@@ -2,6 +2,7 @@ package server
 
 import (
 	"bytes"
+	"fmt"
 	"mime/multipart"
 	"net/http"
 	"net/http/httptest"
@@ -10,6 +11,7 @@ import (
 	"strings"
 	"testing"
 
+	"github.com/sambeau/basil/server/auth"
 	"github.com/sambeau/basil/server/config"
 )
 
@@ -482,6 +484,165 @@ func TestDevToolsEnvNoSecrets(t *testing.T) {
 	}
 }
 
+func TestDevToolsProfile(t *testing.T) {
+	tmpDir := t.TempDir()
+	if err := os.WriteFile(filepath.Join(tmpDir, "lib.pars"), []byte(`export greeting = "Hello"`), 0644); err != nil {
+		t.Fatalf("failed to write module: %v", err)
+	}
+	scriptPath := filepath.Join(tmpDir, "index.pars")
+	if err := os.WriteFile(scriptPath, []byte("let {greeting} = import @./lib.pars\ngreeting"), 0644); err != nil {
+		t.Fatalf("failed to write script: %v", err)
+	}
+
+	cfg := config.Defaults()
+	cfg.BaseDir = tmpDir
+	cfg.Server.Dev = true
+	cfg.Routes = []config.Route{{Path: "/hello", Handler: scriptPath}}
+
+	var stdout, stderr bytes.Buffer
+	s, err := New(cfg, "", "test", "test-commit", &stdout, &stderr)
+	if err != nil {
+		t.Fatalf("failed to create server: %v", err)
+	}
+	defer s.Close()
+
+	w := httptest.NewRecorder()
+	s.mux.ServeHTTP(w, httptest.NewRequest("GET", "/hello", nil))
+	if !strings.Contains(w.Body.String(), "Hello") {
+		t.Fatalf("expected handler output, got: %s", w.Body.String())
+	}
+
+	// The request's handler and import are on the profile page
+	handler := newDevToolsHandler(s)
+	w = httptest.NewRecorder()
+	handler.ServeHTTP(w, httptest.NewRequest("GET", "/__/profile", nil))
+
+	if w.Code != http.StatusOK {
+		t.Fatalf("expected status 200, got %d: %s", w.Code, w.Body.String())
+	}
+	body := w.Body.String()
+	for _, want := range []string{"GET /hello", "index.pars", "import lib.pars", "flame-frame"} {
+		if !strings.Contains(body, want) {
+			t.Errorf("expected profile page to contain %q", want)
+		}
+	}
+
+	// One request's flame graph
+	id := s.profiler.requests()[0].ID
+	w = httptest.NewRecorder()
+	handler.ServeHTTP(w, httptest.NewRequest("GET", fmt.Sprintf("/__/profile?request=%d", id), nil))
+	if !strings.Contains(w.Body.String(), "Show all") {
+		t.Error("expected a single request's profile to link back to all requests")
+	}
+
+	// Clearing drops the recorded requests
+	w = httptest.NewRecorder()
+	handler.ServeHTTP(w, httptest.NewRequest("GET", "/__/profile?clear", nil))
+	if w.Code != http.StatusSeeOther {
+		t.Errorf("expected redirect after clear, got %d", w.Code)
+	}
+	if n := len(s.profiler.requests()); n != 0 {
+		t.Errorf("expected no requests after clear, got %d", n)
+	}
+}
+
+func TestDevToolsProfileOutsideDevMode(t *testing.T) {
+	tmpDir := t.TempDir()
+
+	cfg := config.Defaults()
+	cfg.BaseDir = tmpDir
+	cfg.Server.Dev = false
+	cfg.Dev.Profile = true
+	cfg.Auth.Enabled = true
+
+	var stdout, stderr bytes.Buffer
+	s, err := New(cfg, "", "test", "test-commit", &stdout, &stderr)
+	if err != nil {
+		t.Fatalf("failed to create server: %v", err)
+	}
+	defer s.Close()
+
+	sessionFor := func(role string) *http.Cookie {
+		user, err := s.authDB.CreateUserWithRole(role, role+"@test.com", role)
+		if err != nil {
+			t.Fatalf("CreateUserWithRole failed: %v", err)
+		}
+		session, err := s.authDB.CreateSession(user.ID, 0)
+		if err != nil {
+			t.Fatalf("CreateSession failed: %v", err)
+		}
+		return &http.Cookie{Name: auth.SessionCookieName, Value: session.ID}
+	}
+	get := func(path string, cookie *http.Cookie) *httptest.ResponseRecorder {
+		req := httptest.NewRequest("GET", path, nil)
+		if cookie != nil {
+			req.AddCookie(cookie)
+		}
+		w := httptest.NewRecorder()
+		s.mux.ServeHTTP(w, req)
+		return w
+	}
+
+	// Signed-out visitors are sent to log in, and cannot clear
+	for _, path := range []string{"/__/profile", "/__/profile?clear"} {
+		if w := get(path, nil); w.Code != http.StatusFound {
+			t.Errorf("expected a login redirect for %s without a session, got %d", path, w.Code)
+		}
+	}
+
+	// Non-admins are refused
+	editor := sessionFor(auth.RoleEditor)
+	for _, path := range []string{"/__/profile", "/__/profile?clear"} {
+		if w := get(path, editor); w.Code != http.StatusForbidden {
+			t.Errorf("expected 403 for %s as an editor, got %d", path, w.Code)
+		}
+	}
+
+	// Admins get the page and can clear it
+	admin := sessionFor(auth.RoleAdmin)
+	if w := get("/__/profile", admin); w.Code != http.StatusOK {
+		t.Errorf("expected the profile page for an admin, got %d", w.Code)
+	}
+	if w := get("/__/profile?clear", admin); w.Code != http.StatusSeeOther {
+		t.Errorf("expected redirect after clear for an admin, got %d", w.Code)
+	}
+
+	// The other DevTools pages stay dev-only
+	for _, path := range []string{"/__", "/__/logs", "/__/env"} {
+		if w := get(path, admin); w.Code != http.StatusNotFound {
+			t.Errorf("expected 404 for %s outside dev mode, got %d", path, w.Code)
+		}
+	}
+}
+
+func TestDevToolsProfileOutsideDevModeNeedsAuth(t *testing.T) {
+	tmpDir := t.TempDir()
+
+	cfg := config.Defaults()
+	cfg.BaseDir = tmpDir
+	cfg.Server.Dev = false
+	cfg.Dev.Profile = true
+
+	var stdout, stderr bytes.Buffer
+	s, err := New(cfg, "", "test", "test-commit", &stdout, &stderr)
+	if err != nil {
+		t.Fatalf("failed to create server: %v", err)
+	}
+	defer s.Close()
+
+	// Without auth there is no one to restrict the page to, so it is not served
+	for _, path := range []string{"/__/profile", "/__/profile?clear"} {
+		w := httptest.NewRecorder()
+		s.mux.ServeHTTP(w, httptest.NewRequest("GET", path, nil))
+		if w.Code == http.StatusOK || w.Code == http.StatusSeeOther {
+			t.Errorf("expected %s to be unavailable without auth, got %d", path, w.Code)
+		}
+	}
+	if !strings.Contains(stderr.String(), "/__/profile is not served") {
+		t.Error("expected a warning that the profile page is not served")
+	}
+}
+
 func TestDevToolsDBFileDownload(t *testing.T) {
 	tmpDir := t.TempDir()
 
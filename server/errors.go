@@ -7,11 +7,13 @@ import (
 	"io"
 	"net/http"
 	"os"
+	"path/filepath"
 	"regexp"
 	"strconv"
 	"strings"
 
 	"github.com/sambeau/basil/pkg/parsley/evaluator"
+	"github.com/sambeau/basil/pkg/parsley/highlight"
 	"github.com/sambeau/basil/pkg/parsley/parsley"
 )
 
@@ -19,6 +21,7 @@ import (
 type SourceLine struct {
 	Number  int
 	Content string
+	HTML    string // highlighted Content; empty if no highlighter is registered
 	IsError bool
 }
 
@@ -181,6 +184,7 @@ func (s *Server) createErrorEnv(r *http.Request, code int, err error) *evaluator
 					linesArray[i] = map[string]any{
 						"number":   sl.Number,
 						"content":  sl.Content,
+						"html":     sl.HTML,
 						"is_error": sl.IsError,
 					}
 				}
@@ -358,9 +362,34 @@ func (s *Server) getSourceContext(filePath string, errorLine, contextLines int)
 		lineNum++
 	}
 
+	highlightSourceLines(filePath, lines)
 	return lines
 }
 
+// highlightSourceLines fills in the HTML of lines from a Parsley file. The
+// whole file is highlighted, so strings and tags that start above the context
+// window are still coloured correctly; the result is cached by content, so
+// reloading an error page for an unchanged file does not highlight it again.
+func highlightSourceLines(filePath string, lines []SourceLine) {
+	ext := strings.TrimPrefix(filepath.Ext(filePath), ".")
+	if len(lines) == 0 || !highlight.IsParsley(ext) || !highlight.Enabled() {
+		return
+	}
+	source, err := os.ReadFile(filePath)
+	if err != nil {
+		return
+	}
+	highlighted, ok := highlight.Lines(string(source))
+	if !ok {
+		return
+	}
+	for i := range lines {
+		if n := lines[i].Number - 1; n < len(highlighted) {
+			lines[i].HTML = highlighted[n]
+		}
+	}
+}
+
 // renderPreludeError renders an error page from the prelude
 // Returns true if successfully rendered, false if fallback needed
 func (s *Server) renderPreludeError(w http.ResponseWriter, r *http.Request, code int, err error) bool {
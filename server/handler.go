@@ -125,6 +125,9 @@ func newParsleyHandler(s *Server, route config.Route, cache *scriptCache) (*pars
 func (h *parsleyHandler) ServeHTTP(w http.ResponseWriter, r *http.Request) {
 	// Check if this is a Part request with _view parameter
 	if isPartRequest(r) {
+		prof := h.server.profiler.start(r, h.scriptPath, r.URL.Query().Get("_view"))
+		defer h.server.profiler.finish(prof)
+
 		// Verify the handler is actually a .part file
 		if !strings.HasSuffix(h.scriptPath, ".part") {
 			http.Error(w, "Not Found", http.StatusNotFound)
@@ -166,12 +169,15 @@ func (h *parsleyHandler) ServeHTTP(w http.ResponseWriter, r *http.Request) {
 		if h.server.devLog != nil {
 			env.DevLog = h.server.devLog
 		}
+		if prof != nil {
+			env.Profiler = prof
+		}
 
 		// Inject @params for Part requests
 		env.Set("@params", buildParams(r, env))
 
 		// Handle the Part request
-		h.handlePartRequest(w, r, h.scriptPath, env)
+		h.handlePartRequest(w, r, h.scriptPath, env, prof)
 		return
 	}
 
@@ -197,8 +203,13 @@ func (h *parsleyHandler) ServeHTTP(w http.ResponseWriter, r *http.Request) {
 		}
 	}
 
+	prof := h.server.profiler.start(r, h.scriptPath, "")
+	defer h.server.profiler.finish(prof)
+
 	// Get compiled AST (from cache in production, fresh parse in dev)
+	prof.Begin("parse")
 	program, err := h.cache.getAST(h.scriptPath)
+	prof.End()
 	if err != nil {
 		h.server.logError("failed to load script: %v", err)
 		// Check if it's a structured parse error
@@ -328,8 +339,15 @@ func (h *parsleyHandler) ServeHTTP(w http.ResponseWriter, r *http.Request) {
 	scriptLogger := &scriptLogCapture{output: make([]string, 0)}
 	env.Logger = scriptLogger
 
+	// Record imports and fragment cache lookups for DevTools profiling
+	if prof != nil {
+		env.Profiler = prof
+	}
+
 	// Execute the pre-compiled AST
+	prof.Begin("eval")
 	result := evaluator.Eval(program, env)
+	prof.End()
 
 	// Check for runtime errors
 	if result != nil && result.Type() == evaluator.ERROR_OBJ {
@@ -373,7 +391,9 @@ func (h *parsleyHandler) ServeHTTP(w http.ResponseWriter, r *http.Request) {
 	responseMeta := extractResponseMeta(env, h.server.config.Server.Dev)
 
 	// Handle the response (with caching if enabled)
+	prof.Begin("write")
 	h.writeResponseWithCache(w, r, &parsley.Result{Value: result}, responseMeta, env)
+	prof.End()
 }
 
 // responseMeta holds response metadata set by the script via basil.http.response
@@ -34,7 +34,8 @@ func (h *parsleyHandler) logPartError(scriptPath, viewName, errMsg string) {
 
 // handlePartRequest handles requests for Part views
 // Returns HTML fragment (no wrapper div - JS will replace innerHTML)
-func (h *parsleyHandler) handlePartRequest(w http.ResponseWriter, r *http.Request, scriptPath string, env *evaluator.Environment) {
+// prof records the parse, eval and view timings (nil unless profiling is on)
+func (h *parsleyHandler) handlePartRequest(w http.ResponseWriter, r *http.Request, scriptPath string, env *evaluator.Environment, prof *requestProfile) {
 	// Extract view name from query params
 	viewName := r.URL.Query().Get("_view")
 	if viewName == "" {
@@ -51,9 +52,11 @@ func (h *parsleyHandler) handlePartRequest(w http.ResponseWriter, r *http.Reques
 		return
 	}
 
+	prof.Begin("parse")
 	l := lexer.NewWithFilename(string(content), scriptPath)
 	p := parser.New(l)
 	program := p.ParseProgram()
+	prof.End()
 
 	if len(p.Errors()) > 0 {
 		errMsg := fmt.Sprintf("Parse error: %s", p.Errors()[0])
@@ -63,7 +66,9 @@ func (h *parsleyHandler) handlePartRequest(w http.ResponseWriter, r *http.Reques
 	}
 
 	// Execute the Part file to get exports
+	prof.Begin("eval")
 	result := evaluator.Eval(program, env)
+	prof.End()
 	if result.Type() == evaluator.ERROR_OBJ {
 		errObj := result.(*evaluator.Error)
 		h.logPartError(scriptPath, viewName, errObj.Message)
@@ -99,7 +104,9 @@ func (h *parsleyHandler) handlePartRequest(w http.ResponseWriter, r *http.Reques
 
 	// Call the view function with props using ApplyFunctionWithEnv
 	// This properly handles all parameter types including destructuring patterns like fn({width})
+	prof.Begin("view")
 	result = evaluator.ApplyFunctionWithEnv(fnObj, []evaluator.Object{props}, env)
+	prof.End()
 
 	// Unwrap return values
 	if retVal, ok := result.(*evaluator.ReturnValue); ok {
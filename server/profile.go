@@ -0,0 +1,532 @@
+package server
+
+import (
+	"fmt"
+	"net/http"
+	"path/filepath"
+	"sort"
+	"strconv"
+	"strings"
+	"sync"
+	"time"
+)
+
+// profileRequests is how many recent requests the profile page keeps.
+const profileRequests = 200
+
+// profileMaxFrames bounds the aggregate flame graph. Frames past it are
+// dropped, leaving their time as their parent's self time.
+const profileMaxFrames = 5000
+
+// profiler records where handler time goes for the DevTools profile page:
+// lex/parse and evaluation per handler, Part and imported module, module
+// cache hits, and fragment cache hits and misses. Recording costs a few
+// clock reads and small allocations per request, so it can stay enabled in
+// staging (dev.profile in the config).
+type profiler struct {
+	baseDir string
+
+	mu      sync.Mutex
+	recent  []*requestProfile // ring buffer of finished requests
+	next    int               // index in recent to overwrite next
+	seq     uint64            // ID of the last request started
+	root    *profileFrame     // every request since the last clear, merged by stack
+	frames  int               // frames under root
+	modules map[string]*moduleStats
+}
+
+// profileFrame is one node of a flame graph: a handler, a phase or an
+// import, with the time spent in it including its children.
+type profileFrame struct {
+	Name     string
+	Time     time.Duration
+	Calls    int
+	Children []*profileFrame
+}
+
+// moduleStats accumulates the imports of one module across requests.
+type moduleStats struct {
+	Imports   int
+	CacheHits int
+	Parse     time.Duration
+	Eval      time.Duration
+}
+
+// moduleProfile is one import during a request.
+type moduleProfile struct {
+	Path   string
+	Parse  time.Duration
+	Eval   time.Duration
+	Cached bool
+}
+
+// requestProfile collects the timings of one request. It implements
+// evaluator.Profiler. Its methods are safe to call on a nil receiver, so
+// handlers can use it unconditionally when profiling is off, and they
+// ignore calls once the request is finished, so a profile on the page
+// never changes under it.
+type requestProfile struct {
+	ID             uint64
+	Method         string
+	Path           string
+	Start          time.Time
+	Root           *profileFrame // the handler; Time is the whole request
+	Modules        []moduleProfile
+	FragmentHits   int
+	FragmentMisses int
+
+	profiler *profiler
+	mu       sync.Mutex // guards the fields above until done
+	done     bool
+	stack    []openFrame
+}
+
+type openFrame struct {
+	frame *profileFrame
+	start time.Time
+}
+
+// newProfiler creates a profiler naming files relative to baseDir.
+func newProfiler(baseDir string) *profiler {
+	return &profiler{
+		baseDir: baseDir,
+		recent:  make([]*requestProfile, 0, profileRequests),
+		root:    &profileFrame{Name: "all requests"},
+		modules: make(map[string]*moduleStats),
+	}
+}
+
+// start begins profiling a request to the handler at scriptPath. view names
+// the Part view for Part requests. Returns nil when p is nil.
+func (p *profiler) start(r *http.Request, scriptPath, view string) *requestProfile {
+	if p == nil {
+		return nil
+	}
+	name := p.name(scriptPath)
+	if view != "" {
+		name += " (" + view + ")"
+	}
+
+	p.mu.Lock()
+	p.seq++
+	id := p.seq
+	p.mu.Unlock()
+
+	now := time.Now()
+	root := &profileFrame{Name: name, Calls: 1}
+	return &requestProfile{
+		ID:       id,
+		Method:   r.Method,
+		Path:     r.URL.Path,
+		Start:    now,
+		Root:     root,
+		profiler: p,
+		stack:    []openFrame{{frame: root, start: now}},
+	}
+}
+
+// finish closes any frames still open, then adds rp to the recent
+// requests and the aggregates.
+func (p *profiler) finish(rp *requestProfile) {
+	if p == nil || rp == nil {
+		return
+	}
+	rp.mu.Lock()
+	for len(rp.stack) > 0 {
+		rp.end()
+	}
+	rp.stack = nil
+	rp.done = true
+	rp.mu.Unlock()
+
+	p.mu.Lock()
+	defer p.mu.Unlock()
+
+	if len(p.recent) < profileRequests {
+		p.recent = append(p.recent, rp)
+	} else {
+		p.recent[p.next] = rp
+	}
+	p.next = (p.next + 1) % profileRequests
+
+	p.root.Time += rp.Root.Time
+	p.root.Calls++
+	p.merge(p.root, rp.Root)
+
+	for _, m := range rp.Modules {
+		stats := p.modules[m.Path]
+		if stats == nil {
+			stats = &moduleStats{}
+			p.modules[m.Path] = stats
+		}
+		stats.Imports++
+		if m.Cached {
+			stats.CacheHits++
+		}
+		stats.Parse += m.Parse
+		stats.Eval += m.Eval
+	}
+}
+
+// merge adds src as a child of dst, combining it with a child of the same
+// name. Caller must hold the lock.
+func (p *profiler) merge(dst, src *profileFrame) {
+	d := dst.child(src.Name)
+	if d == nil {
+		if p.frames >= profileMaxFrames {
+			return
+		}
+		d = &profileFrame{Name: src.Name}
+		dst.Children = append(dst.Children, d)
+		p.frames++
+	}
+	d.Time += src.Time
+	d.Calls += src.Calls
+	for _, c := range src.Children {
+		p.merge(d, c)
+	}
+}
+
+// clear discards every recorded request.
+func (p *profiler) clear() {
+	p.mu.Lock()
+	defer p.mu.Unlock()
+	p.recent = p.recent[:0]
+	p.next = 0
+	p.root = &profileFrame{Name: "all requests"}
+	p.frames = 0
+	p.modules = make(map[string]*moduleStats)
+}
+
+// requests returns the recent requests, newest first.
+func (p *profiler) requests() []*requestProfile {
+	p.mu.Lock()
+	defer p.mu.Unlock()
+	out := make([]*requestProfile, 0, len(p.recent))
+	for i := 1; i <= len(p.recent); i++ {
+		out = append(out, p.recent[(p.next-i+len(p.recent))%len(p.recent)])
+	}
+	return out
+}
+
+// request returns the recent request with the given ID, or nil.
+func (p *profiler) request(id uint64) *requestProfile {
+	p.mu.Lock()
+	defer p.mu.Unlock()
+	for _, rp := range p.recent {
+		if rp.ID == id {
+			return rp
+		}
+	}
+	return nil
+}
+
+// aggregate returns a copy of the merged flame graph and the module
+// statistics by path.
+func (p *profiler) aggregate() (*profileFrame, map[string]moduleStats) {
+	p.mu.Lock()
+	defer p.mu.Unlock()
+	modules := make(map[string]moduleStats, len(p.modules))
+	for path, stats := range p.modules {
+		modules[path] = *stats
+	}
+	return p.root.copy(), modules
+}
+
+// name returns path relative to the config directory when it is inside it.
+func (p *profiler) name(path string) string {
+	if rel, err := filepath.Rel(p.baseDir, path); err == nil && !strings.HasPrefix(rel, "..") {
+		return filepath.ToSlash(rel)
+	}
+	return path
+}
+
+// Begin opens a frame called name inside the current one.
+func (rp *requestProfile) Begin(name string) {
+	if rp == nil {
+		return
+	}
+	rp.mu.Lock()
+	defer rp.mu.Unlock()
+	rp.push(&profileFrame{Name: name, Calls: 1}, time.Now())
+}
+
+// End closes the frame opened last.
+func (rp *requestProfile) End() {
+	if rp == nil {
+		return
+	}
+	rp.mu.Lock()
+	defer rp.mu.Unlock()
+	rp.end()
+}
+
+func (rp *requestProfile) end() {
+	if len(rp.stack) == 0 {
+		return
+	}
+	top := rp.stack[len(rp.stack)-1]
+	rp.stack = rp.stack[:len(rp.stack)-1]
+	// Import frames have no start; ImportEnd sets their time
+	if !top.start.IsZero() {
+		top.frame.Time += time.Since(top.start)
+	}
+}
+
+// ImportStart implements evaluator.Profiler. Imports made while the
+// module is evaluated become its children.
+func (rp *requestProfile) ImportStart(path string) {
+	if rp == nil {
+		return
+	}
+	rp.mu.Lock()
+	defer rp.mu.Unlock()
+	rp.push(&profileFrame{Name: "import " + rp.profiler.name(path), Calls: 1}, time.Time{})
+}
+
+// ImportEnd implements evaluator.Profiler. It splits the import's frame
+// into parse and eval, with nested imports under eval. A cached import
+// is only counted, as it takes no time worth drawing.
+func (rp *requestProfile) ImportEnd(path string, parse, eval time.Duration, cached bool) {
+	if rp == nil {
+		return
+	}
+	rp.mu.Lock()
+	defer rp.mu.Unlock()
+	// Only an import frame, which has no start, is closed here
+	if len(rp.stack) < 2 || !rp.stack[len(rp.stack)-1].start.IsZero() {
+		return
+	}
+	frame := rp.stack[len(rp.stack)-1].frame
+	rp.stack = rp.stack[:len(rp.stack)-1]
+	rp.Modules = append(rp.Modules, moduleProfile{Path: rp.profiler.name(path), Parse: parse, Eval: eval, Cached: cached})
+
+	if cached {
+		parent := rp.stack[len(rp.stack)-1].frame
+		parent.Children = parent.Children[:len(parent.Children)-1]
+		return
+	}
+	frame.Time = parse + eval
+	frame.Children = []*profileFrame{
+		{Name: "parse", Time: parse, Calls: 1},
+		{Name: "eval", Time: eval, Calls: 1, Children: frame.Children},
+	}
+}
+
+// FragmentCache implements evaluator.Profiler.
+func (rp *requestProfile) FragmentCache(key string, hit bool) {
+	if rp == nil {
+		return
+	}
+	rp.mu.Lock()
+	defer rp.mu.Unlock()
+	if rp.done {
+		return
+	}
+	if hit {
+		rp.FragmentHits++
+	} else {
+		rp.FragmentMisses++
+	}
+}
+
+// phase returns the total time of the handler's phase called name.
+func (rp *requestProfile) phase(name string) time.Duration {
+	var total time.Duration
+	for _, c := range rp.Root.Children {
+		if c.Name == name {
+			total += c.Time
+		}
+	}
+	return total
+}
+
+// moduleHits counts the request's imports served from the module cache.
+func (rp *requestProfile) moduleHits() int {
+	hits := 0
+	for _, m := range rp.Modules {
+		if m.Cached {
+			hits++
+		}
+	}
+	return hits
+}
+
+func (rp *requestProfile) push(frame *profileFrame, start time.Time) {
+	// Finished profiles take no more frames
+	if len(rp.stack) == 0 {
+		return
+	}
+	parent := rp.stack[len(rp.stack)-1].frame
+	parent.Children = append(parent.Children, frame)
+	rp.stack = append(rp.stack, openFrame{frame: frame, start: start})
+}
+
+// child returns f's child called name, or nil.
+func (f *profileFrame) child(name string) *profileFrame {
+	for _, c := range f.Children {
+		if c.Name == name {
+			return c
+		}
+	}
+	return nil
+}
+
+func (f *profileFrame) copy() *profileFrame {
+	c := &profileFrame{Name: f.Name, Time: f.Time, Calls: f.Calls}
+	for _, child := range f.Children {
+		c.Children = append(c.Children, child.copy())
+	}
+	return c
+}
+
+// flameFrames lays out the frames under root as an icicle graph for the
+// profile page: each frame's depth, and its left edge and width as a
+// percentage of root's time. Frames narrower than 0.1% are left out.
+func flameFrames(root *profileFrame) (frames []any, depth int) {
+	if root.Time <= 0 {
+		return []any{}, 0
+	}
+	var walk func(f *profileFrame, level int, left float64)
+	walk = func(f *profileFrame, level int, left float64) {
+		width := float64(f.Time) / float64(root.Time) * 100
+		if width < 0.1 {
+			return
+		}
+		self := f.Time
+		for _, c := range f.Children {
+			self -= c.Time
+		}
+		frames = append(frames, map[string]any{
+			"name":  f.Name,
+			"depth": level,
+			"class": fmt.Sprintf("flame-frame flame-depth-%d", level%4),
+			"top":   fmt.Sprintf("%drem", level*2),
+			"left":  fmt.Sprintf("%.3f%%", left),
+			"width": fmt.Sprintf("%.3f%%", width),
+			"total": formatProfileDuration(f.Time),
+			"self":  formatProfileDuration(max(self, 0)),
+			"calls": f.Calls,
+		})
+		depth = max(depth, level+1)
+
+		// Largest children first, as flame graphs are usually drawn
+		children := append([]*profileFrame(nil), f.Children...)
+		sort.SliceStable(children, func(i, j int) bool { return children[i].Time > children[j].Time })
+		for _, c := range children {
+			walk(c, level+1, left)
+			left += float64(c.Time) / float64(root.Time) * 100
+		}
+	}
+	walk(root, 0, 0)
+	return frames, depth
+}
+
+// formatProfileDuration formats d in milliseconds for the profile page.
+func formatProfileDuration(d time.Duration) string {
+	return fmt.Sprintf("%.2f ms", float64(d)/float64(time.Millisecond))
+}
+
+// addProfileData adds the profile page's data to devtoolsMap: the recent
+// requests, and the flame graph and module totals of the request picked
+// with ?request=ID, or of every request when none is.
+func (h *devToolsHandler) addProfileData(devtoolsMap map[string]any, r *http.Request) {
+	p := h.server.profiler
+	devtoolsMap["enabled"] = p != nil
+	devtoolsMap["clear_url"] = "/__/profile?clear"
+
+	stats := h.server.fragmentCache.Stats()
+	devtoolsMap["fragments"] = map[string]any{
+		"hits":     stats.Hits,
+		"misses":   stats.Misses,
+		"entries":  stats.Entries,
+		"hit_rate": fmt.Sprintf("%.1f%%", stats.HitRate()),
+		"dev_mode": stats.DevMode,
+	}
+
+	if p == nil {
+		devtoolsMap["requests"] = []any{}
+		devtoolsMap["request_count"] = 0
+		devtoolsMap["frames"] = []any{}
+		devtoolsMap["modules"] = []any{}
+		return
+	}
+
+	var selected *requestProfile
+	if id, err := strconv.ParseUint(r.URL.Query().Get("request"), 10, 64); err == nil {
+		selected = p.request(id)
+	}
+
+	recent := p.requests()
+	requests := make([]any, len(recent))
+	for i, rp := range recent {
+		requests[i] = map[string]any{
+			"id":              rp.ID,
+			"url":             fmt.Sprintf("/__/profile?request=%d", rp.ID),
+			"selected":        rp == selected,
+			"method":          rp.Method,
+			"path":            rp.Path,
+			"handler":         rp.Root.Name,
+			"timestamp":       rp.Start.Format("2006-01-02 15:04:05"),
+			"total":           formatProfileDuration(rp.Root.Time),
+			"parse":           formatProfileDuration(rp.phase("parse")),
+			"eval":            formatProfileDuration(rp.phase("eval") + rp.phase("view")),
+			"imports":         len(rp.Modules),
+			"module_hits":     rp.moduleHits(),
+			"fragment_hits":   rp.FragmentHits,
+			"fragment_misses": rp.FragmentMisses,
+		}
+	}
+	devtoolsMap["requests"] = requests
+	devtoolsMap["request_count"] = len(recent)
+
+	var root *profileFrame
+	var modules map[string]moduleStats
+	devtoolsMap["all"] = selected == nil
+	if selected != nil {
+		root = selected.Root
+		modules = make(map[string]moduleStats)
+		for _, m := range selected.Modules {
+			stats := modules[m.Path]
+			stats.Imports++
+			if m.Cached {
+				stats.CacheHits++
+			}
+			stats.Parse += m.Parse
+			stats.Eval += m.Eval
+			modules[m.Path] = stats
+		}
+		devtoolsMap["title"] = selected.Method + " " + selected.Path
+	} else {
+		root, modules = p.aggregate()
+		devtoolsMap["title"] = fmt.Sprintf("All %d requests", root.Calls)
+	}
+
+	frames, depth := flameFrames(root)
+	devtoolsMap["frames"] = frames
+	devtoolsMap["flame_height"] = fmt.Sprintf("%drem", depth*2)
+
+	paths := make([]string, 0, len(modules))
+	for path := range modules {
+		paths = append(paths, path)
+	}
+	sort.Slice(paths, func(i, j int) bool {
+		a, b := modules[paths[i]], modules[paths[j]]
+		if a.Parse+a.Eval != b.Parse+b.Eval {
+			return a.Parse+a.Eval > b.Parse+b.Eval
+		}
+		return paths[i] < paths[j]
+	})
+	moduleRows := make([]any, len(paths))
+	for i, path := range paths {
+		m := modules[path]
+		moduleRows[i] = map[string]any{
+			"path":       path,
+			"imports":    m.Imports,
+			"cache_hits": m.CacheHits,
+			"parse":      formatProfileDuration(m.Parse),
+			"eval":       formatProfileDuration(m.Eval),
+		}
+	}
+	devtoolsMap["modules"] = moduleRows
+}
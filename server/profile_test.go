@@ -0,0 +1,189 @@
+package server
+
+import (
+	"net/http/httptest"
+	"sync"
+	"testing"
+	"time"
+)
+
+func TestProfilerNestsImports(t *testing.T) {
+	p := newProfiler("/site")
+	rp := p.start(httptest.NewRequest("GET", "/users", nil), "/site/users.pars", "")
+
+	rp.Begin("eval")
+	rp.ImportStart("/site/lib/page.pars")
+	rp.ImportStart("/site/lib/nav.pars")
+	rp.ImportEnd("/site/lib/nav.pars", 1*time.Millisecond, 2*time.Millisecond, false)
+	rp.ImportEnd("/site/lib/page.pars", 1*time.Millisecond, 5*time.Millisecond, false)
+	rp.ImportStart("/site/lib/page.pars")
+	rp.ImportEnd("/site/lib/page.pars", 0, 0, true)
+	rp.FragmentCache("/users:nav", true)
+	rp.FragmentCache("/users:list", false)
+	rp.End()
+	p.finish(rp)
+
+	if rp.Root.Name != "users.pars" {
+		t.Errorf("root = %q, want users.pars", rp.Root.Name)
+	}
+	eval := rp.Root.child("eval")
+	if eval == nil || len(eval.Children) != 1 {
+		t.Fatalf("expected eval with one import (the cached one is not drawn), got %+v", eval)
+	}
+	page := eval.Children[0]
+	if page.Name != "import lib/page.pars" || page.Time != 6*time.Millisecond {
+		t.Errorf("page frame = %q %v, want import lib/page.pars 6ms", page.Name, page.Time)
+	}
+	nav := page.child("eval").child("import lib/nav.pars")
+	if nav == nil || nav.Time != 3*time.Millisecond {
+		t.Fatalf("expected nav import under page's eval, got %+v", page.child("eval"))
+	}
+	if nav.child("parse").Time != time.Millisecond {
+		t.Errorf("nav parse = %v, want 1ms", nav.child("parse").Time)
+	}
+
+	if len(rp.Modules) != 3 || rp.moduleHits() != 1 {
+		t.Errorf("modules = %d (%d cached), want 3 (1 cached)", len(rp.Modules), rp.moduleHits())
+	}
+	if rp.FragmentHits != 1 || rp.FragmentMisses != 1 {
+		t.Errorf("fragments = %d/%d, want 1/1", rp.FragmentHits, rp.FragmentMisses)
+	}
+
+	_, modules := p.aggregate()
+	if m := modules["lib/page.pars"]; m.Imports != 2 || m.CacheHits != 1 || m.Eval != 5*time.Millisecond {
+		t.Errorf("page stats = %+v, want 2 imports, 1 cache hit, 5ms eval", m)
+	}
+}
+
+func TestProfilerAggregatesByStack(t *testing.T) {
+	p := newProfiler("/site")
+	for i := 0; i < 3; i++ {
+		rp := p.start(httptest.NewRequest("GET", "/", nil), "/site/index.pars", "")
+		rp.Begin("parse")
+		rp.End()
+		rp.Begin("eval")
+		rp.End()
+		p.finish(rp)
+	}
+
+	root, _ := p.aggregate()
+	if root.Calls != 3 || len(root.Children) != 1 {
+		t.Fatalf("expected 3 requests under one handler, got %d under %d", root.Calls, len(root.Children))
+	}
+	index := root.Children[0]
+	if index.Calls != 3 || index.child("eval").Calls != 3 || len(index.Children) != 2 {
+		t.Errorf("expected parse and eval merged across requests, got %+v", index)
+	}
+}
+
+func TestProfilerKeepsRecentRequests(t *testing.T) {
+	p := newProfiler("/site")
+	for i := 0; i < profileRequests+5; i++ {
+		p.finish(p.start(httptest.NewRequest("GET", "/", nil), "/site/index.pars", ""))
+	}
+
+	recent := p.requests()
+	if len(recent) != profileRequests {
+		t.Fatalf("kept %d requests, want %d", len(recent), profileRequests)
+	}
+	if recent[0].ID != profileRequests+5 || recent[len(recent)-1].ID != 6 {
+		t.Errorf("expected newest first, got IDs %d..%d", recent[0].ID, recent[len(recent)-1].ID)
+	}
+	if p.request(1) != nil || p.request(6) == nil {
+		t.Error("expected only the oldest requests to be dropped")
+	}
+
+	p.clear()
+	if len(p.requests()) != 0 {
+		t.Error("expected clear to drop every request")
+	}
+}
+
+func TestProfilerNilIsNoop(t *testing.T) {
+	var p *profiler
+	rp := p.start(httptest.NewRequest("GET", "/", nil), "/site/index.pars", "")
+	if rp != nil {
+		t.Fatal("expected a nil profiler to start nothing")
+	}
+	rp.Begin("eval")
+	rp.ImportStart("/site/lib.pars")
+	rp.ImportEnd("/site/lib.pars", 0, 0, false)
+	rp.FragmentCache("key", true)
+	rp.End()
+	p.finish(rp)
+}
+
+func TestProfilerIgnoresFinishedRequests(t *testing.T) {
+	p := newProfiler("/site")
+	rp := p.start(httptest.NewRequest("GET", "/", nil), "/site/index.pars", "")
+	rp.Begin("eval")
+	rp.ImportStart("/site/lib.pars")
+	rp.ImportEnd("/site/lib.pars", 0, 0, true)
+	p.finish(rp)
+
+	// A function kept by a cached module can still hold the profile
+	var wg sync.WaitGroup
+	for i := 0; i < 4; i++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			rp.ImportStart("/site/nav.pars")
+			rp.FragmentCache("key", true)
+			rp.ImportEnd("/site/nav.pars", 0, 0, true)
+			rp.ImportEnd("/site/nav.pars", time.Millisecond, time.Millisecond, false)
+		}()
+	}
+	wg.Wait()
+
+	if len(rp.Modules) != 1 || rp.FragmentHits != 0 {
+		t.Errorf("expected no writes after finish, got %d modules and %d fragment hits", len(rp.Modules), rp.FragmentHits)
+	}
+	if eval := rp.Root.child("eval"); eval == nil || len(eval.Children) != 0 {
+		t.Errorf("expected eval without frames, got %+v", eval)
+	}
+}
+
+func TestProfilerImportEndNeedsImportFrame(t *testing.T) {
+	p := newProfiler("/site")
+	rp := p.start(httptest.NewRequest("GET", "/", nil), "/site/index.pars", "")
+	rp.Begin("eval")
+	// An ImportEnd without its ImportStart leaves the eval frame open
+	rp.ImportEnd("/site/lib.pars", 0, 0, true)
+	rp.ImportStart("/site/lib.pars")
+	rp.ImportEnd("/site/lib.pars", 0, 0, false)
+	rp.End()
+	p.finish(rp)
+
+	eval := rp.Root.child("eval")
+	if eval == nil || len(eval.Children) != 1 || len(rp.Modules) != 1 {
+		t.Fatalf("expected one import under eval, got %+v with %d modules", eval, len(rp.Modules))
+	}
+}
+
+func TestFlameFrames(t *testing.T) {
+	root := &profileFrame{Name: "index.pars", Time: 10 * time.Millisecond, Calls: 1, Children: []*profileFrame{
+		{Name: "parse", Time: 4 * time.Millisecond, Calls: 1},
+		{Name: "eval", Time: 6 * time.Millisecond, Calls: 1},
+		{Name: "write", Time: time.Microsecond, Calls: 1},
+	}}
+
+	frames, depth := flameFrames(root)
+	if depth != 2 {
+		t.Errorf("depth = %d, want 2", depth)
+	}
+	// write is under 0.1% of the request and left out
+	if len(frames) != 3 {
+		t.Fatalf("got %d frames, want 3", len(frames))
+	}
+	eval := frames[1].(map[string]any)
+	if eval["name"] != "eval" || eval["left"] != "0.000%" || eval["width"] != "60.000%" {
+		t.Errorf("expected the larger child first at the left edge, got %v", eval)
+	}
+	parse := frames[2].(map[string]any)
+	if parse["left"] != "60.000%" || parse["top"] != "2rem" {
+		t.Errorf("expected parse after eval on the second row, got %v", parse)
+	}
+	if self := frames[0].(map[string]any)["self"]; self != "0.00 ms" {
+		t.Errorf("root self = %v, want 0.00 ms", self)
+	}
+}
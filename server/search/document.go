@@ -19,6 +19,7 @@ type Document struct {
 	// Internal fields
 	Path  string // File path (empty for manual docs)
 	Mtime int64  // Modification time (0 for manual docs)
+	Hash  string // SHA-256 of the file's content (empty for manual docs)
 }
 
 // Validate checks if the document has all required fields
@@ -101,10 +102,10 @@ func (idx *FTS5Index) IndexDocument(doc *Document) error {
 	}
 
 	insertMeta := `
-		INSERT OR REPLACE INTO search_metadata(url, path, mtime, indexed_at, source)
-		VALUES (?, ?, ?, ?, ?)
+		INSERT OR REPLACE INTO search_metadata(url, path, mtime, indexed_at, source, hash)
+		VALUES (?, ?, ?, ?, ?, ?)
 	`
-	if _, err := tx.Exec(insertMeta, doc.URL, doc.Path, doc.Mtime, time.Now().Unix(), source); err != nil {
+	if _, err := tx.Exec(insertMeta, doc.URL, doc.Path, doc.Mtime, time.Now().Unix(), source, doc.Hash); err != nil {
 		return fmt.Errorf("failed to insert metadata: %w", err)
 	}
 
@@ -232,8 +233,8 @@ func (idx *FTS5Index) BatchIndex(docs []*Document) error {
 	defer ftsStmt.Close()
 
 	metaStmt, err := tx.Prepare(`
-		INSERT OR REPLACE INTO search_metadata(url, path, mtime, indexed_at, source)
-		VALUES (?, ?, ?, ?, ?)
+		INSERT OR REPLACE INTO search_metadata(url, path, mtime, indexed_at, source, hash)
+		VALUES (?, ?, ?, ?, ?, ?)
 	`)
 	if err != nil {
 		return fmt.Errorf("failed to prepare metadata statement: %w", err)
@@ -272,7 +273,7 @@ func (idx *FTS5Index) BatchIndex(docs []*Document) error {
 		if doc.Path == "" {
 			source = "manual"
 		}
-		if _, err := metaStmt.Exec(doc.URL, doc.Path, doc.Mtime, indexedAt, source); err != nil {
+		if _, err := metaStmt.Exec(doc.URL, doc.Path, doc.Mtime, indexedAt, source, doc.Hash); err != nil {
 			return fmt.Errorf("failed to insert metadata for %s: %w", doc.URL, err)
 		}
 	}
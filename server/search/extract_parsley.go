@@ -0,0 +1,76 @@
+package search
+
+import (
+	"path/filepath"
+	"strings"
+	"sync"
+	"time"
+)
+
+// ParsleyText is the searchable text of a Parsley source file, sorted by how
+// much it says about the file.
+type ParsleyText struct {
+	Exports     []string // names the module exports
+	Tables      []string // tables named by @query and the mutation expressions
+	Text        []string // string, template and markup text, and comments
+	Identifiers []string // every other name the code uses, once each
+}
+
+// ParsleyExtractor pulls the searchable text out of Parsley source. It is
+// called from several goroutines at once.
+type ParsleyExtractor func(source []byte) ParsleyText
+
+var (
+	parsleyMu        sync.RWMutex
+	parsleyExtractor ParsleyExtractor
+)
+
+// RegisterParsleyExtractor installs fn as the extractor for .pars and .part
+// files. Basil stays free of cgo, so it has none of its own: the tree-sitter
+// grammar in contrib/tree-sitter-parsley provides one (basil/searchtext).
+// Until one is registered, Parsley files are indexed as plain text. Passing
+// nil goes back to plain text.
+func RegisterParsleyExtractor(fn ParsleyExtractor) {
+	parsleyMu.Lock()
+	defer parsleyMu.Unlock()
+	parsleyExtractor = fn
+}
+
+// ProcessParsley turns a Parsley source file into a Document for indexing.
+// With an extractor registered, exported names become the document's
+// headings, table names its tags, and text and identifiers its content, so a
+// search for an exported component ranks the file that defines it first.
+func ProcessParsley(content []byte, filePath string, mtime time.Time) (*Document, error) {
+	parsleyMu.RLock()
+	extract := parsleyExtractor
+	parsleyMu.RUnlock()
+
+	// Title from filename, as for PDFs: Parsley files have no title of their own
+	base := filepath.Base(filePath)
+	title := strings.TrimSuffix(base, filepath.Ext(base))
+
+	doc := &Document{
+		URL:     GenerateURL(filePath),
+		Title:   title,
+		Content: string(content),
+		Path:    filePath,
+		Mtime:   mtime.Unix(),
+	}
+	if extract == nil {
+		return doc, nil
+	}
+
+	text := extract(content)
+	doc.Headings = strings.Join(text.Exports, "\n")
+	doc.Tags = text.Tables
+	parts := make([]string, 0, len(text.Text)+len(text.Identifiers))
+	parts = append(append(parts, text.Text...), text.Identifiers...)
+	doc.Content = strings.Join(parts, "\n")
+	return doc, nil
+}
+
+// IsParsley checks if a file path has a Parsley source extension
+func IsParsley(path string) bool {
+	ext := strings.ToLower(filepath.Ext(path))
+	return ext == ".pars" || ext == ".part"
+}
@@ -0,0 +1,95 @@
+package search
+
+import (
+	"os"
+	"path/filepath"
+	"reflect"
+	"strings"
+	"testing"
+	"time"
+)
+
+const parsleySource = `// Greeting card
+export Card = fn({name}) {
+	<div class="card">"Hello, " + name</div>
+}
+let people = @query(People | active == true ??-> name)
+`
+
+func TestProcessParsleyPlainText(t *testing.T) {
+	RegisterParsleyExtractor(nil)
+
+	doc, err := ProcessParsley([]byte(parsleySource), "site/parts/card.part", time.Unix(100, 0))
+	if err != nil {
+		t.Fatalf("ProcessParsley() failed: %v", err)
+	}
+	if doc.Title != "card" || doc.URL != "/site/parts/card" || doc.Mtime != 100 {
+		t.Errorf("document = %+v", doc)
+	}
+	if doc.Content != parsleySource {
+		t.Errorf("without an extractor the content should be the source, got %q", doc.Content)
+	}
+}
+
+func TestProcessParsleyWithExtractor(t *testing.T) {
+	RegisterParsleyExtractor(func(source []byte) ParsleyText {
+		return ParsleyText{
+			Exports:     []string{"Card"},
+			Tables:      []string{"People"},
+			Text:        []string{"Greeting card", "Hello, "},
+			Identifiers: []string{"name", "people", "active"},
+		}
+	})
+	defer RegisterParsleyExtractor(nil)
+
+	doc, err := ProcessParsley([]byte(parsleySource), "card.pars", time.Now())
+	if err != nil {
+		t.Fatalf("ProcessParsley() failed: %v", err)
+	}
+	if doc.Headings != "Card" {
+		t.Errorf("Headings = %q, want the exported names", doc.Headings)
+	}
+	if !reflect.DeepEqual(doc.Tags, []string{"People"}) {
+		t.Errorf("Tags = %q, want the tables", doc.Tags)
+	}
+	if want := "Greeting card\nHello, \nname\npeople\nactive"; doc.Content != want {
+		t.Errorf("Content = %q, want %q", doc.Content, want)
+	}
+}
+
+func TestScanFolderProcessesInParallel(t *testing.T) {
+	tmpDir := t.TempDir()
+	var names []string
+	for i := 0; i < 40; i++ {
+		name := filepath.Join(tmpDir, "part"+string(rune('a'+i%26))+strings.Repeat("x", i/26)+".pars")
+		if err := os.WriteFile(name, []byte("let x = \"file "+name+"\""), 0644); err != nil {
+			t.Fatal(err)
+		}
+		names = append(names, name)
+	}
+
+	docs, err := ScanFolder(tmpDir, &ScanOptions{Extensions: []string{".pars"}, Recursive: true, Workers: 4})
+	if err != nil {
+		t.Fatalf("ScanFolder() failed: %v", err)
+	}
+	if len(docs) != len(names) {
+		t.Fatalf("got %d documents, want %d", len(docs), len(names))
+	}
+	// Walk order, whatever order the workers finished in
+	for i, doc := range docs {
+		if i > 0 && docs[i-1].Path > doc.Path {
+			t.Errorf("documents out of order: %s before %s", docs[i-1].Path, doc.Path)
+		}
+		if doc.Hash != contentHash([]byte("let x = \"file "+doc.Path+"\"")) {
+			t.Errorf("%s: hash %q does not match its content", doc.Path, doc.Hash)
+		}
+	}
+}
+
+func TestIsParsley(t *testing.T) {
+	for path, want := range map[string]bool{"a.pars": true, "b.PART": true, "c.md": false, "pars": false} {
+		if got := IsParsley(path); got != want {
+			t.Errorf("IsParsley(%q) = %v, want %v", path, got, want)
+		}
+	}
+}
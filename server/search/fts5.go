@@ -75,13 +75,17 @@ func (idx *FTS5Index) createTables() error {
 			path TEXT,
 			mtime INTEGER,
 			indexed_at INTEGER,
-			source TEXT
+			source TEXT,
+			hash TEXT NOT NULL DEFAULT ''
 		)
 	`
 
 	if _, err := idx.db.Exec(metadataSQL); err != nil {
 		return fmt.Errorf("failed to create metadata table: %w", err)
 	}
+	if err := addHashColumn(idx.db); err != nil {
+		return err
+	}
 
 	// Create index on path for efficient lookups
 	indexSQL := `
@@ -12,6 +12,7 @@ type FileMetadata struct {
 	Mtime     int64  // File modification time (Unix timestamp)
 	IndexedAt int64  // When the file was indexed (Unix timestamp)
 	Source    string // Source: "auto" or "manual"
+	Hash      string // SHA-256 of the content when indexed (empty if unknown)
 }
 
 // CreateMetadataTable creates the search_metadata table if it doesn't exist.
@@ -22,7 +23,8 @@ func CreateMetadataTable(db *sql.DB) error {
 			path TEXT NOT NULL,
 			mtime INTEGER NOT NULL,
 			indexed_at INTEGER NOT NULL,
-			source TEXT NOT NULL
+			source TEXT NOT NULL,
+			hash TEXT NOT NULL DEFAULT ''
 		);
 		
 		CREATE INDEX IF NOT EXISTS idx_search_metadata_path ON search_metadata(path);
@@ -31,21 +33,51 @@ func CreateMetadataTable(db *sql.DB) error {
 	if err != nil {
 		return fmt.Errorf("failed to create metadata table: %w", err)
 	}
+	return addHashColumn(db)
+}
+
+// addHashColumn adds the hash column to a search_metadata table created
+// before content hashes were stored. Its rows get an empty hash, so their
+// files are reindexed the next time their mtime changes.
+func addHashColumn(db *sql.DB) error {
+	rows, err := db.Query(`SELECT name FROM pragma_table_info('search_metadata')`)
+	if err != nil {
+		return fmt.Errorf("failed to read metadata columns: %w", err)
+	}
+	defer rows.Close()
+	for rows.Next() {
+		var name string
+		if err := rows.Scan(&name); err != nil {
+			return fmt.Errorf("failed to read metadata columns: %w", err)
+		}
+		if name == "hash" {
+			return nil
+		}
+	}
+	if err := rows.Err(); err != nil {
+		return fmt.Errorf("failed to read metadata columns: %w", err)
+	}
+	rows.Close()
+
+	if _, err := db.Exec(`ALTER TABLE search_metadata ADD COLUMN hash TEXT NOT NULL DEFAULT ''`); err != nil {
+		return fmt.Errorf("failed to add hash column: %w", err)
+	}
 	return nil
 }
 
 // StoreMetadata stores or updates file metadata in the database.
 func StoreMetadata(db *sql.DB, meta FileMetadata) error {
 	query := `
-		INSERT INTO search_metadata (url, path, mtime, indexed_at, source)
-		VALUES (?, ?, ?, ?, ?)
+		INSERT INTO search_metadata (url, path, mtime, indexed_at, source, hash)
+		VALUES (?, ?, ?, ?, ?, ?)
 		ON CONFLICT(url) DO UPDATE SET
 			path = excluded.path,
 			mtime = excluded.mtime,
 			indexed_at = excluded.indexed_at,
-			source = excluded.source
+			source = excluded.source,
+			hash = excluded.hash
 	`
-	_, err := db.Exec(query, meta.URL, meta.Path, meta.Mtime, meta.IndexedAt, meta.Source)
+	_, err := db.Exec(query, meta.URL, meta.Path, meta.Mtime, meta.IndexedAt, meta.Source, meta.Hash)
 	if err != nil {
 		return fmt.Errorf("failed to store metadata: %w", err)
 	}
@@ -54,11 +86,11 @@ func StoreMetadata(db *sql.DB, meta FileMetadata) error {
 
 // GetMetadata retrieves metadata for a specific URL.
 func GetMetadata(db *sql.DB, url string) (*FileMetadata, error) {
-	query := `SELECT url, path, mtime, indexed_at, source FROM search_metadata WHERE url = ?`
+	query := `SELECT url, path, mtime, indexed_at, source, hash FROM search_metadata WHERE url = ?`
 	row := db.QueryRow(query, url)
 
 	var meta FileMetadata
-	err := row.Scan(&meta.URL, &meta.Path, &meta.Mtime, &meta.IndexedAt, &meta.Source)
+	err := row.Scan(&meta.URL, &meta.Path, &meta.Mtime, &meta.IndexedAt, &meta.Source, &meta.Hash)
 	if err == sql.ErrNoRows {
 		return nil, nil
 	}
@@ -70,7 +102,7 @@ func GetMetadata(db *sql.DB, url string) (*FileMetadata, error) {
 
 // GetAllMetadata retrieves all file metadata from the database.
 func GetAllMetadata(db *sql.DB) ([]FileMetadata, error) {
-	query := `SELECT url, path, mtime, indexed_at, source FROM search_metadata ORDER BY url`
+	query := `SELECT url, path, mtime, indexed_at, source, hash FROM search_metadata ORDER BY url`
 	rows, err := db.Query(query)
 	if err != nil {
 		return nil, fmt.Errorf("failed to get all metadata: %w", err)
@@ -80,7 +112,7 @@ func GetAllMetadata(db *sql.DB) ([]FileMetadata, error) {
 	var results []FileMetadata
 	for rows.Next() {
 		var meta FileMetadata
-		err := rows.Scan(&meta.URL, &meta.Path, &meta.Mtime, &meta.IndexedAt, &meta.Source)
+		err := rows.Scan(&meta.URL, &meta.Path, &meta.Mtime, &meta.IndexedAt, &meta.Source, &meta.Hash)
 		if err != nil {
 			return nil, fmt.Errorf("failed to scan metadata row: %w", err)
 		}
@@ -107,7 +139,7 @@ func RemoveMetadata(db *sql.DB, url string) error {
 // GetMetadataByPath retrieves all metadata entries with a specific path prefix.
 // Useful for finding all files in a watched folder.
 func GetMetadataByPath(db *sql.DB, pathPrefix string) ([]FileMetadata, error) {
-	query := `SELECT url, path, mtime, indexed_at, source FROM search_metadata WHERE path LIKE ? ORDER BY path`
+	query := `SELECT url, path, mtime, indexed_at, source, hash FROM search_metadata WHERE path LIKE ? ORDER BY path`
 	rows, err := db.Query(query, pathPrefix+"%")
 	if err != nil {
 		return nil, fmt.Errorf("failed to get metadata by path: %w", err)
@@ -117,7 +149,7 @@ func GetMetadataByPath(db *sql.DB, pathPrefix string) ([]FileMetadata, error) {
 	var results []FileMetadata
 	for rows.Next() {
 		var meta FileMetadata
-		err := rows.Scan(&meta.URL, &meta.Path, &meta.Mtime, &meta.IndexedAt, &meta.Source)
+		err := rows.Scan(&meta.URL, &meta.Path, &meta.Mtime, &meta.IndexedAt, &meta.Source, &meta.Hash)
 		if err != nil {
 			return nil, fmt.Errorf("failed to scan metadata row: %w", err)
 		}
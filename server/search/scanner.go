@@ -1,11 +1,18 @@
 package search
 
 import (
+	"crypto/sha256"
+	"encoding/hex"
 	"fmt"
+	"io"
 	"io/fs"
+	"log"
 	"os"
 	"path/filepath"
+	"runtime"
 	"strings"
+	"sync"
+	"time"
 )
 
 // ScanOptions configures file scanning behavior
@@ -13,6 +20,7 @@ type ScanOptions struct {
 	Extensions     []string // File extensions to include (e.g., [".md", ".html"])
 	Recursive      bool     // Recursively scan subdirectories
 	FollowSymlinks bool     // Follow symbolic links
+	Workers        int      // Files processed at once (0 means one per CPU)
 }
 
 // DefaultScanOptions returns default scanning options
@@ -24,13 +32,48 @@ func DefaultScanOptions() *ScanOptions {
 	}
 }
 
+// scannedFile is an indexable file found by listFiles
+type scannedFile struct {
+	path  string
+	mtime time.Time
+}
+
 // ScanFolder recursively scans a directory for markdown/HTML files and returns documents.
-// It processes each file with ProcessMarkdown() and returns an array of documents ready for indexing.
+// Files are processed on a pool of opts.Workers goroutines, and the documents come
+// back in the order the walk found them.
 func ScanFolder(folderPath string, opts *ScanOptions) ([]*Document, error) {
 	if opts == nil {
 		opts = DefaultScanOptions()
 	}
 
+	files, err := listFiles(folderPath, opts)
+	if err != nil {
+		return nil, err
+	}
+
+	docs := make([]*Document, len(files))
+	errs := make([]error, len(files))
+	parallel(len(files), opts.Workers, func(i int) {
+		docs[i], errs[i] = ProcessFile(files[i].path, files[i].mtime)
+	})
+
+	// A file that cannot be indexed is logged and skipped rather than
+	// failing the whole scan
+	var documents []*Document
+	for i, doc := range docs {
+		if errs[i] != nil {
+			log.Printf("search: %v", errs[i])
+			continue
+		}
+		documents = append(documents, doc)
+	}
+
+	return documents, nil
+}
+
+// listFiles walks a directory and returns the files ScanFolder would process,
+// without reading them.
+func listFiles(folderPath string, opts *ScanOptions) ([]scannedFile, error) {
 	// Check if folder exists
 	info, err := os.Stat(folderPath)
 	if err != nil {
@@ -40,14 +83,13 @@ func ScanFolder(folderPath string, opts *ScanOptions) ([]*Document, error) {
 		return nil, fmt.Errorf("%s is not a directory", folderPath)
 	}
 
-	var documents []*Document
-	var scanErrors []error
+	var files []scannedFile
 
 	// Walk the directory tree
 	err = filepath.WalkDir(folderPath, func(path string, d fs.DirEntry, err error) error {
 		if err != nil {
-			// Log error but continue scanning
-			scanErrors = append(scanErrors, fmt.Errorf("error accessing %s: %w", path, err))
+			// Skip unreadable entries but continue scanning
+			log.Printf("search: error accessing %s: %v", path, err)
 			return nil
 		}
 
@@ -81,42 +123,11 @@ func ScanFolder(folderPath string, opts *ScanOptions) ([]*Document, error) {
 		// Get file modification time
 		fileInfo, err := d.Info()
 		if err != nil {
-			scanErrors = append(scanErrors, fmt.Errorf("error getting file info for %s: %w", path, err))
+			log.Printf("search: error getting file info for %s: %v", path, err)
 			return nil
 		}
-		mtime := fileInfo.ModTime()
-
-		// Process file based on extension
-		var doc *Document
-		if IsDOCX(path) {
-			// Process DOCX file (binary format)
-			doc, err = ProcessDOCX(path, mtime)
-			if err != nil {
-				scanErrors = append(scanErrors, fmt.Errorf("error processing DOCX %s: %w", path, err))
-				return nil
-			}
-		} else if IsPDF(path) {
-			// Process PDF file (binary format)
-			doc, err = ProcessPDF(path, mtime)
-			if err != nil {
-				scanErrors = append(scanErrors, fmt.Errorf("error processing PDF %s: %w", path, err))
-				return nil
-			}
-		} else {
-			// Process text-based files (markdown, HTML, etc.)
-			content, err := os.ReadFile(path)
-			if err != nil {
-				scanErrors = append(scanErrors, fmt.Errorf("error reading %s: %w", path, err))
-				return nil
-			}
-			doc, err = ProcessMarkdown(string(content), path, mtime)
-			if err != nil {
-				scanErrors = append(scanErrors, fmt.Errorf("error processing %s: %w", path, err))
-				return nil
-			}
-		}
 
-		documents = append(documents, doc)
+		files = append(files, scannedFile{path: path, mtime: fileInfo.ModTime()})
 		return nil
 	})
 
@@ -124,11 +135,110 @@ func ScanFolder(folderPath string, opts *ScanOptions) ([]*Document, error) {
 		return nil, fmt.Errorf("error walking directory: %w", err)
 	}
 
-	// Log scan errors but don't fail the whole operation
-	if len(scanErrors) > 0 { //nolint:staticcheck // TODO: Add proper logging when available
+	return files, nil
+}
+
+// ProcessFile reads a file and returns its Document, with Hash set to the
+// SHA-256 of its content.
+func ProcessFile(path string, mtime time.Time) (*Document, error) {
+	content, hash, err := readFile(path)
+	if err != nil {
+		return nil, fmt.Errorf("error reading %s: %w", path, err)
 	}
+	return processContent(path, content, hash, mtime)
+}
 
-	return documents, nil
+// readFile returns a file's content and the hex SHA-256 of it. PDF and DOCX
+// files are opened again by their extractors, so they are only hashed, as a
+// stream, and their content is nil rather than held in memory whole.
+func readFile(path string) ([]byte, string, error) {
+	if !IsDOCX(path) && !IsPDF(path) {
+		content, err := os.ReadFile(path)
+		if err != nil {
+			return nil, "", err
+		}
+		return content, contentHash(content), nil
+	}
+
+	f, err := os.Open(path)
+	if err != nil {
+		return nil, "", err
+	}
+	defer f.Close()
+	h := sha256.New()
+	if _, err := io.Copy(h, f); err != nil {
+		return nil, "", err
+	}
+	return nil, hex.EncodeToString(h.Sum(nil)), nil
+}
+
+// processContent builds the Document for a file read by readFile. Binary
+// formats are reopened by their extractors.
+func processContent(path string, content []byte, hash string, mtime time.Time) (*Document, error) {
+	var doc *Document
+	var err error
+
+	// Process file based on extension
+	switch {
+	case IsDOCX(path):
+		// Process DOCX file (binary format)
+		doc, err = ProcessDOCX(path, mtime)
+		if err != nil {
+			return nil, fmt.Errorf("error processing DOCX %s: %w", path, err)
+		}
+	case IsPDF(path):
+		// Process PDF file (binary format)
+		doc, err = ProcessPDF(path, mtime)
+		if err != nil {
+			return nil, fmt.Errorf("error processing PDF %s: %w", path, err)
+		}
+	case IsParsley(path):
+		doc, err = ProcessParsley(content, path, mtime)
+		if err != nil {
+			return nil, fmt.Errorf("error processing %s: %w", path, err)
+		}
+	default:
+		// Process text-based files (markdown, HTML, etc.)
+		doc, err = ProcessMarkdown(string(content), path, mtime)
+		if err != nil {
+			return nil, fmt.Errorf("error processing %s: %w", path, err)
+		}
+	}
+
+	doc.Hash = hash
+	return doc, nil
+}
+
+// contentHash returns the hex SHA-256 of a file's content.
+func contentHash(content []byte) string {
+	sum := sha256.Sum256(content)
+	return hex.EncodeToString(sum[:])
+}
+
+// parallel calls f(0) through f(n-1) on up to workers goroutines (one per
+// CPU if workers is 0) and waits for them all.
+func parallel(n, workers int, f func(i int)) {
+	if workers <= 0 {
+		workers = runtime.GOMAXPROCS(0)
+	}
+	workers = min(workers, n)
+
+	var wg sync.WaitGroup
+	next := make(chan int)
+	for range workers {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			for i := range next {
+				f(i)
+			}
+		}()
+	}
+	for i := range n {
+		next <- i
+	}
+	close(next)
+	wg.Wait()
 }
 
 // ScanMultipleFolders scans multiple directories and combines the results.
@@ -268,3 +268,26 @@ func TestCountFiles(t *testing.T) {
 		}
 	})
 }
+
+func TestReadFileHashesBinaryFormats(t *testing.T) {
+	tmpDir := t.TempDir()
+	data := []byte("%PDF-1.4 not really a PDF")
+	for _, name := range []string{"doc.pdf", "doc.docx", "doc.md"} {
+		path := filepath.Join(tmpDir, name)
+		if err := os.WriteFile(path, data, 0644); err != nil {
+			t.Fatalf("Failed to create test file: %v", err)
+		}
+
+		content, hash, err := readFile(path)
+		if err != nil {
+			t.Fatalf("readFile(%s) failed: %v", name, err)
+		}
+		if hash != contentHash(data) {
+			t.Errorf("%s: hash = %s, want the SHA-256 of its content", name, hash)
+		}
+		// Extractors reopen binary files, so only text is kept in memory
+		if binary := name != "doc.md"; binary != (content == nil) {
+			t.Errorf("%s: content read = %v, want %v", name, content != nil, !binary)
+		}
+	}
+}
@@ -3,6 +3,7 @@ package search
 import (
 	"database/sql"
 	"fmt"
+	"log"
 	"os"
 	"time"
 )
@@ -18,24 +19,30 @@ type FileChange struct {
 type ChangeSet struct {
 	New     []Document
 	Changed []Document
-	Deleted []string // URLs of deleted documents
+	Deleted []string   // URLs of deleted documents
+	Touched []Document // Files whose mtime moved but whose content did not
 }
 
 // CheckForChanges checks watched folders for file changes.
 // Returns a ChangeSet with new, changed, and deleted files.
+//
+// Only files whose mtime differs from the index are read, and only those
+// whose content hash differs too are processed again, on a pool of one
+// worker per CPU. A file that was saved unchanged, checked out again or
+// copied over is just Touched.
 func CheckForChanges(db *sql.DB, watchFolders []string, extensions []string) (*ChangeSet, error) {
 	// Get current files from filesystem
-	currentFiles := make(map[string]*Document)
+	currentFiles := make(map[string]scannedFile)
 	for _, folder := range watchFolders {
-		docs, err := ScanFolder(folder, &ScanOptions{
+		files, err := listFiles(folder, &ScanOptions{
 			Extensions: extensions,
 			Recursive:  true,
 		})
 		if err != nil {
 			return nil, fmt.Errorf("failed to scan folder %s: %w", folder, err)
 		}
-		for _, doc := range docs {
-			currentFiles[doc.URL] = doc
+		for _, f := range files {
+			currentFiles[GenerateURL(f.path)] = f
 		}
 	}
 
@@ -48,23 +55,62 @@ func CheckForChanges(db *sql.DB, watchFolders []string, extensions []string) (*C
 	// Build metadata map by URL
 	metaMap := make(map[string]*FileMetadata)
 	for i := range allMeta {
-		// Only consider auto-indexed files for change detection
-		if allMeta[i].Source == "auto" {
+		// Only consider indexed files for change detection, not manual documents
+		if allMeta[i].Source != "manual" {
 			metaMap[allMeta[i].URL] = &allMeta[i]
 		}
 	}
 
+	// Files that are new or whose mtime has changed
+	var candidates []scannedFile
+	for url, f := range currentFiles {
+		if meta, exists := metaMap[url]; !exists || f.mtime.Unix() != meta.Mtime {
+			candidates = append(candidates, f)
+		}
+	}
+
+	type result struct {
+		doc     *Document
+		touched bool
+	}
+	results := make([]result, len(candidates))
+	parallel(len(candidates), 0, func(i int) {
+		f := candidates[i]
+		content, hash, err := readFile(f.path)
+		if err != nil {
+			// Skip unreadable files, as ScanFolder does
+			log.Printf("search: error reading %s: %v", f.path, err)
+			return
+		}
+		url := GenerateURL(f.path)
+		if meta := metaMap[url]; meta != nil && meta.Hash != "" && meta.Hash == hash {
+			results[i] = result{
+				doc:     &Document{URL: url, Path: f.path, Mtime: f.mtime.Unix(), Hash: meta.Hash},
+				touched: true,
+			}
+			return
+		}
+		doc, err := processContent(f.path, content, hash, f.mtime)
+		if err != nil {
+			log.Printf("search: %v", err)
+			return
+		}
+		results[i] = result{doc: doc}
+	})
+
 	changeset := &ChangeSet{}
 
-	// Check for new and changed files
-	for url, doc := range currentFiles {
-		meta, exists := metaMap[url]
-		if !exists {
+	// Sort results into new, changed and touched files
+	for _, r := range results {
+		switch {
+		case r.doc == nil:
+		case r.touched:
+			changeset.Touched = append(changeset.Touched, *r.doc)
+		case metaMap[r.doc.URL] == nil:
 			// New file
-			changeset.New = append(changeset.New, *doc)
-		} else if doc.Mtime != meta.Mtime {
-			// Check if mtime has changed
-			changeset.Changed = append(changeset.Changed, *doc)
+			changeset.New = append(changeset.New, *r.doc)
+		default:
+			changeset.Changed = append(changeset.Changed, *r.doc)
 		}
 	}
 
@@ -102,6 +148,7 @@ func UpdateIndex(index *FTS5Index, changes *ChangeSet) error {
 			Mtime:     doc.Mtime,
 			IndexedAt: now,
 			Source:    "auto",
+			Hash:      doc.Hash,
 		}
 		err = StoreMetadata(db, meta)
 		if err != nil {
@@ -130,6 +177,7 @@ func UpdateIndex(index *FTS5Index, changes *ChangeSet) error {
 			Mtime:     doc.Mtime,
 			IndexedAt: now,
 			Source:    "auto",
+			Hash:      doc.Hash,
 		}
 		err = StoreMetadata(db, meta)
 		if err != nil {
@@ -137,6 +185,21 @@ func UpdateIndex(index *FTS5Index, changes *ChangeSet) error {
 		}
 	}
 
+	// Record the new mtime of touched files, so they are not read again
+	for _, doc := range changes.Touched {
+		meta := FileMetadata{
+			URL:       doc.URL,
+			Path:      doc.Path,
+			Mtime:     doc.Mtime,
+			IndexedAt: now,
+			Source:    "auto",
+			Hash:      doc.Hash,
+		}
+		if err := StoreMetadata(db, meta); err != nil {
+			return fmt.Errorf("failed to update metadata for %s: %w", doc.URL, err)
+		}
+	}
+
 	// Remove deleted files
 	for _, url := range changes.Deleted {
 		err := index.RemoveDocument(url)
@@ -186,7 +249,7 @@ func CheckAndUpdate(index *FTS5Index, watchFolders []string, extensions []string
 	}
 
 	// Skip update if no changes
-	if stats.NewFiles == 0 && stats.ChangedFiles == 0 && stats.DeletedFiles == 0 {
+	if stats.NewFiles == 0 && stats.ChangedFiles == 0 && stats.DeletedFiles == 0 && len(changes.Touched) == 0 {
 		stats.Duration = time.Since(start)
 		return stats, nil
 	}
@@ -463,3 +463,55 @@ func TestCheckForChangesIgnoresManualFiles(t *testing.T) {
 		t.Errorf("Expected 0 deleted files (manual files ignored), got %d", len(changes.Deleted))
 	}
 }
+
+func TestCheckForChangesSkipsUnchangedContent(t *testing.T) {
+	tmpDir := t.TempDir()
+
+	file1 := filepath.Join(tmpDir, "touched.md")
+	if err := os.WriteFile(file1, []byte("# Touched\nSame content."), 0644); err != nil {
+		t.Fatalf("Failed to create test file: %v", err)
+	}
+
+	db, err := sql.Open("sqlite", ":memory:")
+	if err != nil {
+		t.Fatalf("Failed to open database: %v", err)
+	}
+	defer db.Close()
+
+	index, err := NewFTS5Index(db, "porter", DefaultWeights())
+	if err != nil {
+		t.Fatalf("NewFTS5Index() failed: %v", err)
+	}
+	if _, err := CheckAndUpdate(index, []string{tmpDir}, []string{".md"}); err != nil {
+		t.Fatalf("CheckAndUpdate() failed: %v", err)
+	}
+
+	// Move the mtime without changing the content, as a checkout does
+	later := time.Now().Add(time.Hour)
+	if err := os.Chtimes(file1, later, later); err != nil {
+		t.Fatalf("Failed to touch file: %v", err)
+	}
+
+	changes, err := CheckForChanges(db, []string{tmpDir}, []string{".md"})
+	if err != nil {
+		t.Fatalf("CheckForChanges() failed: %v", err)
+	}
+	if len(changes.New) != 0 || len(changes.Changed) != 0 {
+		t.Errorf("Expected no new or changed files, got %d new and %d changed", len(changes.New), len(changes.Changed))
+	}
+	if len(changes.Touched) != 1 {
+		t.Fatalf("Expected 1 touched file, got %d", len(changes.Touched))
+	}
+	if err := UpdateIndex(index, changes); err != nil {
+		t.Fatalf("UpdateIndex() failed: %v", err)
+	}
+
+	// The new mtime is recorded, so the file is not read again
+	changes, err = CheckForChanges(db, []string{tmpDir}, []string{".md"})
+	if err != nil {
+		t.Fatalf("CheckForChanges() failed: %v", err)
+	}
+	if len(changes.Touched) != 0 || len(changes.Changed) != 0 {
+		t.Errorf("Expected no changes after recording the mtime, got %d touched and %d changed", len(changes.Touched), len(changes.Changed))
+	}
+}
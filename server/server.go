@@ -62,6 +62,9 @@ type Server struct {
 	// Dev tools (nil if not in dev mode)
 	devLog *DevLog
 
+	// Request profiler for /__/profile (nil unless in dev mode or dev.profile is set)
+	profiler *profiler
+
 	// Auth system (nil if auth not enabled)
 	authDB       *auth.DB
 	authWebAuthn *auth.WebAuthnManager
@@ -99,6 +102,11 @@ func New(cfg *config.Config, configPath string, version, commit string, stdout,
 		return nil, fmt.Errorf("initializing prelude: %w", err)
 	}
 
+	// Profile requests in dev mode, or anywhere dev.profile is set (e.g. staging)
+	if cfg.Server.Dev || cfg.Dev.Profile {
+		s.profiler = newProfiler(cfg.BaseDir)
+	}
+
 	// In dev mode, check if we're in the basil repo and enable prelude live reload
 	if cfg.Server.Dev {
 		s.initPreludeDevMode()
@@ -582,6 +590,15 @@ func (s *Server) setupRoutes() error {
 		devTools := newDevToolsHandler(s)
 		s.mux.Handle("/__/", devTools)
 		s.mux.Handle("/__", devTools)
+	} else if s.profiler != nil {
+		// Outside dev mode only the profile page is served, and only to admins
+		if s.authMW == nil {
+			s.logWarn("dev.profile is set but auth is not enabled; /__/profile is not served")
+		} else {
+			profile := s.protectedPathMiddleware(newDevToolsHandler(s), []string{auth.RoleAdmin})
+			s.mux.Handle("/__/profile", s.authMW.OptionalAuth(profile))
+			s.logInfo("request profiling enabled at /__/profile (admin only)")
+		}
 	}
 
 	// Register auth endpoints if auth is enabled